@@ -0,0 +1,88 @@
+/*
+ * clock_estimator.h - Online GNSS-to-host clock offset, drift and jitter estimation
+ *
+ * Every navigation solution carries its GNSS time (iTOW), and the driver stamps the
+ * frame with CLOCK_MONOTONIC when the I2C read that completed it returns. The
+ * difference host - gnss is the clock offset plus a delivery delay: the receiver's
+ * output latency and bus time (nearly constant) plus scheduling noise (always
+ * positive). The estimator
+ *
+ * - keeps the earliest sample of every CLOCK_BLOCK_NANOS of GNSS time (the lower
+ *   envelope) for the last CLOCK_BLOCK_COUNT blocks and fits the drift of the host
+ *   clock against GNSS time to them by least squares; a long baseline of envelope
+ *   points resolves drift to a few ppm where a fit to raw samples would not;
+ * - takes the lowest detrended block as the offset, so late reads never bias it:
+ *   host time = gnss time + offset + drift * (gnss time - newest sample);
+ * - reports how far the last CLOCK_WINDOW_LENGTH samples sit above that floor (RMS
+ *   and maximum) as jitter.
+ *
+ * The offset therefore includes the constant part of the delivery delay. Without a
+ * timepulse (PPS) that part cannot be observed from the host; subtract a calibrated
+ * receiver output latency to move from "readable at" to "measured at".
+ *
+ * GNSS time is unwrapped across week rollovers; a jump that does not fit the model
+ * (receiver restart, time step) restarts the estimate.
+ */
+
+#ifndef CLOCK_ESTIMATOR_H
+#define CLOCK_ESTIMATOR_H
+
+#include <stdint.h>
+
+#define CLOCK_WINDOW_LENGTH 64                         // Recent samples in the jitter statistics
+#define CLOCK_BLOCK_NANOS 1000000000LL                 // GNSS time covered by one envelope point
+#define CLOCK_BLOCK_COUNT 64                           // Envelope points in the drift fit
+#define CLOCK_MIN_FIT_BLOCKS 4                         // Envelope points before drift is estimated
+#define CLOCK_WEEK_MILLIS 604800000LL                  // iTOW wraps every GPS week
+#define CLOCK_RESET_NANOS 500000000LL                  // Model error that restarts the estimate
+
+typedef struct {
+    uint32_t samples;            // Samples in the jitter window
+    uint32_t blocks;             // Envelope points in the drift fit
+    uint32_t resets;             // Times the estimate was restarted
+    int64_t offsetNanos;         // host - gnss at the newest sample, lower envelope
+    double driftPpb;             // Host clock rate relative to GNSS time (parts per billion)
+    uint32_t jitterNanos;        // RMS of the samples above the lower envelope
+    uint32_t maxDelayNanos;      // Largest sample above the lower envelope
+} GnssClockStats;
+
+class GnssClockEstimator {
+    private:
+        // Recent samples: unwrapped GNSS time and host - gnss
+        int64_t gnssNanos[CLOCK_WINDOW_LENGTH];
+        int64_t residualNanos[CLOCK_WINDOW_LENGTH];
+        uint32_t head;
+        uint32_t count;
+        uint32_t resets;
+
+        // Lower envelope: the sample with the smallest host - gnss in each block
+        int64_t blockGnssNanos[CLOCK_BLOCK_COUNT];
+        int64_t blockResidualNanos[CLOCK_BLOCK_COUNT];
+        uint32_t blockHead;                            // Slot of the block being filled
+        uint32_t blockCount;                           // Blocks including the one being filled
+        int64_t blockStartNanos;
+
+        uint32_t lastITow;
+        int64_t weekNanos;                             // Unwrapped start of the current week
+
+        int64_t referenceNanos;                        // GNSS time the model is anchored at
+        int64_t offsetNanos;
+        double drift;                                  // Fractional rate difference
+        double jitterNanos;
+        int64_t maxDelayNanos;
+
+        int64_t unwrap(uint32_t iTow);
+        void addToEnvelope(int64_t gnss, int64_t residual);
+        void refit(void);
+
+    public:
+        GnssClockEstimator(void);
+
+        void Reset(void);
+        void AddSample(uint32_t iTow, uint64_t hostNanos);
+        bool IsValid(void) const { return count > 0; }
+        uint64_t HostNanos(uint32_t iTow) const;
+        GnssClockStats GetStats(void) const;
+};
+
+#endif // CLOCK_ESTIMATOR_H
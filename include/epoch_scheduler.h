@@ -0,0 +1,56 @@
+/*
+ * epoch_scheduler.h - Predict when the next navigation solution will be readable
+ *
+ * The receiver computes a solution every measurement period, aligned to GPS time
+ * (iTOW is a multiple of the period), and the NAV-PVT message shows up on the data
+ * stream a few milliseconds later. Instead of sleeping a fixed interval or spinning,
+ * the reader records the host time at which each fix was read together with its
+ * iTOW, and sleeps with clock_nanosleep until just after the next solution is due.
+ *
+ * The scheduler tracks the host time at which iTOW 0 would have become readable
+ * (the "offset"; epochs are then offset + k * period). A read that only happens after
+ * a scheduled wake-up tells us how good the prediction was:
+ * - data was already there on the first check: it may be readable even earlier, so
+ *   the offset is probed EPOCH_PROBE_NANOS earlier;
+ * - data was late and needed retries: the offset moves half way towards the read.
+ * Reads that were not preceded by a wait (the caller showed up late) only ever pull
+ * the offset earlier, so a slow caller cannot push the schedule later.
+ */
+
+#ifndef EPOCH_SCHEDULER_H
+#define EPOCH_SCHEDULER_H
+
+#include <stdint.h>
+
+#define NANOS_PER_MILLI 1000000ULL
+#define NANOS_PER_SECOND 1000000000ULL
+
+#define EPOCH_WAKE_GUARD_NANOS (2 * NANOS_PER_MILLI)     // Wake this long after data is due
+#define EPOCH_RETRY_NANOS (2 * NANOS_PER_MILLI)          // Re-check interval when data is late
+#define EPOCH_PROBE_NANOS 200000LL                       // Step earlier after an on-time read
+#define EPOCH_RESYNC_NANOS (500 * NANOS_PER_MILLI)       // Offset jump treated as a discontinuity
+#define EPOCH_UNSYNCED_DIVISOR 4                         // Poll period / 4 until the first fix
+
+class EpochScheduler {
+    private:
+        uint64_t periodNanos;
+        bool synced;
+        int64_t offsetNanos;        // Host monotonic time of iTOW 0 plus output latency
+        uint32_t lastITow;
+
+    public:
+        EpochScheduler(uint16_t periodMillis);
+
+        void SetPeriod(uint16_t periodMillis);
+        uint16_t GetPeriodMillis(void) const { return static_cast<uint16_t>(periodNanos / NANOS_PER_MILLI); }
+        void OnFix(uint32_t iTow, uint64_t readNanos, bool afterWait);
+        void Reset(void) { synced = false; }
+
+        uint64_t NextDueNanos(uint64_t nowNanos) const;
+        uint64_t NextCheckNanos(uint64_t nowNanos) const;
+
+        static uint64_t NowNanos(void);
+        static void SleepUntil(uint64_t wakeNanos);
+};
+
+#endif // EPOCH_SCHEDULER_H
@@ -23,12 +23,24 @@
  *   velocity, and more.
  *
  * Class:
- * - Gps: A class that encapsulates GPS functionality, including I2C communication,
- *   message handling, and data retrieval.
+ * - BasicGps<Transport>: A class template that encapsulates GPS functionality, including
+ *   message handling and data retrieval, over a transport from gps_transport.h.
+ *   Gps is the I2C driver (BasicGps<I2cTransport>) and SerialGps the UART driver
+ *   (BasicGps<SerialTransport>).
  *
  * Usage:
  * - Include this header file in your C++ project to interact with a GPS module.
- * - Instantiate the Gps class to communicate with the GPS module and retrieve data.
+ * - Instantiate the Gps class to communicate with the GPS module and retrieve data, or
+ *   SerialGps with a SerialTransportConfig to use the module's UART.
+ * - Call StartRecording() to capture the raw byte stream, and construct Gps from a
+ *   UbxCaptureReader to replay such a capture without a module attached.
+ * - Call RestoreNavigationDatabase() right after construction and SaveNavigationDatabase()
+ *   (or SetDatabaseAutosave()) while running to turn power-cycle cold starts into hot
+ *   starts; GetTtffStats() reports the time to first fix.
+ * - Call GetPvtAtHostTime() to get the position and velocity at another sensor's
+ *   timestamp, interpolated between the recent fixes.
+ * - Call EnableNmea() and GetNmeaPvt() to take fixes from the NMEA sentences (RMC, GGA,
+ *   VTG, GSA) instead, e.g. for NMEA-only receivers or captures; see nmea_parser.h.
  *
  * Note: This code is designed for a specific GPS module and may require adaptation for
  *       other GPS modules or hardware configurations. Refer to the provided credit and
@@ -39,6 +51,21 @@
 #define GPS_H_INCLUDED
 
 #include "../include/ubx_msg.h"
+#include "../include/ubx_framer.h"
+#include "../include/ubx_view.h"
+#include "../include/spsc_ring.h"
+#include "../include/epoch_scheduler.h"
+#include "../include/ubx_config.h"
+#include "../include/ubx_decode.h"
+#include "../include/ubx_dispatch.h"
+#include "../include/clock_estimator.h"
+#include "../include/ubx_capture.h"
+#include "../include/pvt_history.h"
+#include "../include/ubx_assist.h"
+#include "../include/gps_transport.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstdint>
@@ -51,31 +78,36 @@
 #include <cstdio>
 #include <unistd.h>
 #include <stdio.h>
-extern "C" {
-	#include <i2c/smbus.h>
-	#include <linux/i2c-dev.h>
-	#include <linux/i2c.h>
-}
-
-#define GPS_I2C_ADDRESS 0x42
-#define GPS_I2C_BUS "/dev/i2c-1"
 
 #define BYTE_SHIFT_AMOUNT 8
 #define BYTE_MASK 0xFF
 #define HALF_WORD_SHIFT_AMOUNT 16
 #define THREE_BYTE_SHIFT_AMOUNT 24
 
-#define DATA_STREAM_REGISTER 0xFF
+#define GPS_RX_BUFFER_LENGTH 1024 // Bytes drained from the module per fill of the receive buffer
+
+/** NMEA Input */
+#define GPS_NMEA_QUEUE_CAPACITY 8     // Epochs parsed from NMEA and not yet returned by GetNmeaPvt()
 
-#define AVAILABLE_BYTES_MSB 0xFD
-#define AVAILABLE_BYTES_LSB 0xFE
+/** Background Acquisition */
+#define GPS_FIX_RING_CAPACITY 32      // Fixes buffered between the acquisition thread and the consumer
+#define ACQUISITION_WAIT_MILLS 100    // Longest wait for a fix before re-checking the stop flag
 
 #define DEFAULT_TIMEOUT_MILLS 2000
 #define DEFAULT_UPDATE_MILLS 1000
 #define DEFAULT_SEND_RATE 0x01
 #define DEFAULT_INTERVAL_MILLS 50
 #define DEFAULT_POLLING_STATE false
+#define DEFAULT_PERSIST_CONFIG false
 #define DEFAULT_YEAR -1
+#define DEFAULT_OUTPUT_LATENCY_NANOS 0 // Epoch-to-readable delay subtracted from hostEpochNanos (SetOutputLatency)
+
+// Bits of statusReceived: which status messages have been decoded at least once
+#define STATUS_NAV_SAT 0x01
+#define STATUS_NAV_DOP 0x02
+#define STATUS_NAV_STATUS 0x04
+#define STATUS_NAV_TIMEUTC 0x08
+#define STATUS_MON_HW 0x10
 
 #define VALID_DATE_FLAG 0x01
 #define VALID_TIME_FLAG 0x02
@@ -120,6 +152,11 @@ extern "C" {
 #define HOT_START_TTFF_SECONDS 1      // Time-To-First-Fix for hot start in seconds
 #define AIDED_START_TTFF_SECONDS 2    // Time-To-First-Fix for aided starts in seconds
 
+/** Kinds of start, for GpsTtffStats */
+#define GPS_START_COLD 0              // Nothing injected
+#define GPS_START_AIDED 1             // Time and/or position injected (MGA-INI), no database
+#define GPS_START_DATABASE 2          // Navigation database restored (MGA-DBD) with time and position
+
 #define SENSITIVITY_TRACK_NAV_DBM -165 // Sensitivity for tracking & navigation in dBm
 #define SENSITIVITY_REACQUISITION_DBM -158 // Sensitivity for reacquisition in dBm
 #define SENSITIVITY_COLD_HOT_START_DBM -146 // Sensitivity for cold and hot starts in dBm
@@ -127,6 +164,43 @@ extern "C" {
 #define MEASUREMENT_PERIOD_MILLIS_1_SEC 1000 // Measurement period in milliseconds
 #define MEASUREMENT_PERIOD_MILLIS_100_MS 100 // Measurement period in milliseconds
 #define MEASUREMENT_PERIOD_MILLIS_25_MS 25 // Measurement period in milliseconds
+#define MEASUREMENT_PERIOD_MILLIS_56_MS 56 // Measurement period in milliseconds (~18 Hz)
+
+/** Navigation Rate and Constellations */
+#define MIN_MEASUREMENT_PERIOD_MILLIS MEASUREMENT_PERIOD_MILLIS_25_MS
+#define MAX_NAVIGATION_RATE 127                  // Measurements per navigation solution
+#define MAX_SOLUTION_PERIOD_MILLIS 65535         // Measurement period x navigation rate; the scheduler period is 16 bits
+#define MAX_TIME_REFERENCE 4                     // 0 UTC, 1 GPS, 2 GLONASS, 3 BeiDou, 4 Galileo
+#define TIME_REF_UTC 0
+#define TIME_REF_GPS 1
+#define MAX_NAVIGATION_UPDATE_RATE_HZ_CONCURRENT MAX_NAVIGATION_UPDATE_RATE_HZ_GPS    // Two or more major GNSS
+#define MAX_NAVIGATION_UPDATE_RATE_HZ_SINGLE MAX_NAVIGATION_UPDATE_RATE_HZ_OTHER      // One major GNSS
+#define MAX_CONCURRENT_GNSS 3                    // Major GNSS tracked at the same time
+#define GNSS_TRACKING_CHANNELS 32                // Hardware tracking channels
+
+#define GNSS_MASK_UNCHANGED 0x00                 // Leave the receiver's constellation setup alone
+#define GNSS_MASK_GPS (1 << GNSS_ID_GPS)
+#define GNSS_MASK_SBAS (1 << GNSS_ID_SBAS)
+#define GNSS_MASK_GALILEO (1 << GNSS_ID_GALILEO)
+#define GNSS_MASK_BEIDOU (1 << GNSS_ID_BEIDOU)
+#define GNSS_MASK_QZSS (1 << GNSS_ID_QZSS)
+#define GNSS_MASK_GLONASS (1 << GNSS_ID_GLONASS)
+#define GNSS_MASK_MAJOR (GNSS_MASK_GPS | GNSS_MASK_GALILEO | GNSS_MASK_BEIDOU | GNSS_MASK_GLONASS)
+#define GNSS_MASK_AUGMENTATION (GNSS_MASK_SBAS | GNSS_MASK_QZSS)  // Only usable together with GPS
+#define GNSS_MASK_RECEIVER_DEFAULT (GNSS_MASK_GPS | GNSS_MASK_SBAS | GNSS_MASK_QZSS | GNSS_MASK_GLONASS)
+
+#define NAV_CONFIG_OK 0
+#define NAV_CONFIG_INVALID_PERIOD 1              // Measurement period below MIN_MEASUREMENT_PERIOD_MILLIS
+#define NAV_CONFIG_INVALID_NAV_RATE 2            // Navigation rate 0 or above MAX_NAVIGATION_RATE
+#define NAV_CONFIG_INVALID_TIME_REF 3            // Time reference above MAX_TIME_REFERENCE
+#define NAV_CONFIG_INVALID_GNSS 4                // Unknown GNSS bits or no major GNSS selected
+#define NAV_CONFIG_TOO_MANY_GNSS 5               // More than MAX_CONCURRENT_GNSS major GNSS
+#define NAV_CONFIG_AUGMENTATION_WITHOUT_GPS 6    // SBAS/QZSS selected without GPS
+#define NAV_CONFIG_RATE_TOO_HIGH 7               // Solution rate above the limit for the selected GNSS
+#define NAV_CONFIG_PERIOD_TOO_LONG 8             // Solution period above MAX_SOLUTION_PERIOD_MILLIS
+
+#define DEFAULT_NAVIGATION_CONFIG {MEASUREMENT_PERIOD_MILLIS_100_MS, 1, TIME_REF_UTC, GNSS_MASK_UNCHANGED}
+#define HIGH_RATE_NAVIGATION_CONFIG {MEASUREMENT_PERIOD_MILLIS_56_MS, 1, TIME_REF_UTC, GNSS_MASK_GPS}
 
 
 
@@ -136,18 +210,26 @@ extern "C" {
 
 typedef struct {
     // Time Information
+    uint32_t iTOW;               // GPS time of week of the navigation epoch (ms)
     uint16_t year;               // Year (UTC)
     uint8_t month;               // Month (UTC)
     uint8_t day;                 // Day of the month (UTC)
     uint8_t hour;                // Hour of the day (UTC)
     uint8_t min;                 // Minute of the hour (UTC)
     uint8_t sec;                 // Second of the minute (UTC)
+    int32_t nano;                // Fraction of the second (UTC), -1e9..1e9 (nanoseconds)
+    uint32_t timeAccuracy;       // Time accuracy estimate (nanoseconds)
+
+    // Host Timing (CLOCK_MONOTONIC, nanoseconds)
+    uint64_t hostReceiveNanos;   // When the I2C read that completed this frame returned
+    uint64_t hostEpochNanos;     // Estimated host time of the navigation epoch (clock model)
 
     // Validity Flags
     uint8_t validTimeFlag;       // Validity flags for time
     uint8_t validDateFlag;       // Validity flags for time
     uint8_t fullyResolved;       // Validity flags for time
     uint8_t validMagFlag;       // Validity flags for time
+    uint8_t newFix;              // 1 if this epoch was not returned before, 0 for a repeat
 
     // GNSS
     uint8_t gnssFix;
@@ -157,7 +239,7 @@ typedef struct {
     // Coordinates
     //int32_t longitude;           // Longitude (degrees * 1e7)
     double longitude;
-    double latitude;            // Latitude (degrees * 1e7)
+    double latitude;            // Latitude (degrees)
     int32_t height;              // Height above ellipsoid (millimeters)
     int32_t heightMSL;                // Height above mean sea level (millimeters)
 
@@ -170,44 +252,226 @@ typedef struct {
     int32_t velocityEast;   // Velocity in the east direction (millimeters/second)
     int32_t velocityDown;   // Velocity in the down direction (millimeters/second)
     int32_t groundSpeed;      // Ground speed (millimeters/second)
-    int32_t vehicalHeading;
-    int32_t motionHeading;     // Heading of motion (degrees * 1e5)
+    double vehicalHeading;       // Heading of vehicle (degrees)
+    double motionHeading;        // Heading of motion (degrees)
     uint32_t speedAccuracy;      // Speed accuracy estimate (millimeters/second)
-    int32_t motionHeadingAccuracy;
+    double motionHeadingAccuracy; // Heading accuracy estimate (degrees)
 
     // Vehicle Heading and Magnetic Declination
-    int16_t magneticDeclination; // Magnetic declination (degrees * 1e2)
-    uint16_t magnetDeclinationAccuracy; // Declination accuracy (degrees * 1e2)
+    double magneticDeclination;  // Magnetic declination (degrees)
+    double magnetDeclinationAccuracy; // Declination accuracy (degrees)
 } PVTData;
 
-class Gps {
+typedef struct {
+    uint16_t measurementPeriodMillis; // Time between measurements
+    uint8_t navigationRate;      // Measurements per navigation solution
+    uint8_t timeReference;       // TIME_REF_* alignment of the measurements
+    uint8_t gnssMask;            // GNSS_MASK_* bits, or GNSS_MASK_UNCHANGED
+} GpsNavigationConfig;
+
+typedef struct {
+    uint32_t fixes;              // NAV-PVT epochs returned for the first time
+    uint32_t duplicates;         // NAV-PVT messages repeating an epoch already returned
+    uint32_t polls;              // NAV-PVT poll requests written
+} GpsFixStats;
+
+typedef struct {
+    uint32_t fixesQueued;        // Fixes pushed into the ring by the acquisition thread
+    uint32_t overruns;           // Fixes lost because the ring was full (consumer too slow)
+    uint32_t drops;              // NAV-PVT messages discarded as invalid (e.g. wrong year)
+} GpsAcquisitionStats;
+
+typedef struct {
+    uint8_t start;               // GPS_START_* of the current start
+    uint32_t ttffMillis;         // Start (construction or RestartTtff) to the first gnssFixOK fix; 0 before it
+    uint32_t receiverTtffMillis; // The receiver's own TTFF from NAV-STATUS; 0 if NAV-STATUS is not enabled
+    uint32_t elapsedMillis;      // Since the start
+} GpsTtffStats;
+
+typedef struct {
+    uint32_t saves;              // Navigation databases saved (manually or by autosave)
+    uint32_t saveFailures;       // Dumps that were incomplete or could not be written
+    uint16_t savedMessages;      // MGA-DBD messages in the last save
+    uint32_t savedBytes;         // MGA-DBD bytes in the last save
+    uint32_t saveMillis;         // Duration of the last dump and save
+    UbxAssistStats restore;      // Upload of the last RestoreNavigationDatabase()
+} GpsDatabaseStats;
+
+class NmeaParser;
+
+template <class Transport>
+class BasicGps {
 
 	private:
-		UbxMessage ubxmsg;
 		PVTData pvtData;
-		int i2c_fd;
+		Transport transport;
         int16_t currentYear;
-
-		void ubxOnly(void);
+		GpsBusStats busStats;
+
+		// Bytes drained from the data stream that the framer has not consumed yet
+		UbxFramer framer;
+		uint8_t rxBuffer[GPS_RX_BUFFER_LENGTH];
+		uint16_t rxHead;
+		uint16_t rxLength;
+		uint64_t rxStampNanos;       // When the read that filled rxBuffer completed
+
+		// Raw capture of the bus traffic, and the capture replayed instead of the bus
+		UbxCaptureWriter recorder;
+		UbxCaptureReader *replay;
+
+		// Predicts when the next solution is readable from the configured rate and iTOW
+		EpochScheduler scheduler;
+
+		// Epoch of the last NAV-PVT returned, for duplicate detection
+		bool lastFixValid;
+		bool lastFixNew;
+		uint32_t lastFixITow;
+		uint64_t lastFixRxNanos;
+		GpsFixStats fixStats;
+
+		// GNSS time to host monotonic time, updated on every new fix
+		std::mutex clockMutex;
+		GnssClockEstimator clock;
+		uint32_t outputLatencyNanos;
+
+		// Recent fixes with gnssFixOK, for lookups at arbitrary host or GNSS times
+		std::mutex historyMutex;
+		PvtHistory history;
+
+		// Background acquisition; the thread owns the bus while it runs
+		std::thread acquisitionThread;
+		std::atomic<bool> acquisitionRunning;
+		SpscRing<PVTData, GPS_FIX_RING_CAPACITY> fixRing;
+		std::atomic<uint32_t> fixesQueued;
+		std::atomic<uint32_t> overruns;
+		std::atomic<uint32_t> drops;
+		std::atomic<uint64_t> nextFixDueNanos;
+
+		// Outcome of the last configuration transaction
+		UbxConfigStats configStats;
+		uint16_t navigationPeriodMillis;
+		GpsNavigationConfig navigationConfig;
+
+		// Hot start support: last fix to restart from, autosave, and time to first fix
+		uint8_t lastGoodFix[ASSIST_NAV_PVT_FRAME_LENGTH];
+		bool lastGoodFixValid;
+		std::string autosavePath;
+		uint64_t autosavePeriodNanos;
+		uint64_t nextAutosaveNanos;
+		GpsDatabaseStats databaseStats;     // Guarded by statusMutex, autosave writes it
+		uint8_t startKind;
+		uint64_t ttffStartNanos;
+		uint64_t firstFixNanos;
+
+		// NMEA input (EnableNmea): sentences in the drained bytes are parsed into epochs
+		NmeaParser *nmea;
+		std::deque<PVTData> nmeaEpochs;
+		uint32_t nmeaOverruns;       // Epochs dropped because GetNmeaPvt() was not called often enough
+
+		// Routes messages other than NAV-PVT; the latest status messages are kept here
+		UbxDispatcher dispatcher;
+		std::mutex statusMutex;
+		uint8_t statusReceived;
+		NavSatData navSat;
+		NavDopData navDop;
+		NavStatusData navStatus;
+		NavTimeUtcData navTimeUtc;
+		MonHwData monHw;
+
+		void init(void);
+		void ubxOnly(UbxConfigTransaction &config);
 		bool writeUbxMessage(UbxMessage& msg);
+		bool writeUbxFrame(const uint8_t *frame, uint16_t length);
 		uint16_t getAvailableBytes(void);
-		UbxMessage readUbxMessage(void);
-		bool setMessageSendRate(uint8_t msgClass, uint8_t msgId,
-		uint8_t sendRate);
-		bool setMeasurementFrequency(uint16_t measurementPeriodMillis,
-		uint8_t navigationRate, uint8_t timeref);
-
-		int16_t i2_to_int(const uint8_t *little_endian_bytes);
-        double bytes_to_double(const uint8_t *little_endian_bytes);
-		uint16_t u2_to_int(const uint8_t *little_endian_bytes);
-		int32_t i4_to_int(const uint8_t *little_endian_bytes);
-		uint32_t u4_to_int(const uint8_t *little_endian_bytes);
+		bool readDataStream(uint8_t *buf, uint16_t length);
+		bool fillRxBuffer(void);
+		void parseNmea(const uint8_t *data, uint16_t length);
+		bool decodePvt(const NavPvtView &pvt, PVTData &data);
+		void acquisitionLoop(bool polling);
+		UbxMessageView readUbxMessage(void);
+		void setMessageSendRate(UbxConfigTransaction &config, uint8_t msgClass, uint8_t msgId,
+		uint8_t sendRate = DEFAULT_SEND_RATE);
+		void setMeasurementFrequency(UbxConfigTransaction &config, uint16_t measurementPeriodMillis = DEFAULT_UPDATE_MILLS,
+		uint8_t navigationRate = 1, uint8_t timeref = 0);
+		void setGnss(UbxConfigTransaction &config, uint8_t gnssMask);
+		void addNavigationConfig(UbxConfigTransaction &config, const GpsNavigationConfig &navigation);
+		void saveConfiguration(UbxConfigTransaction &config);
+		bool commitConfig(UbxConfigTransaction &config, bool persist);
+		void waitForConfig(UbxConfigTransaction &config, bool pollPhase);
+		bool dumpNavigationDatabase(UbxNavDatabase &database);
+		bool uploadAssistance(UbxAssistUpload &upload);
+		static void onNavSat(const UbxMessageView &msg, void *context);
+		static void onNavDop(const UbxMessageView &msg, void *context);
+		static void onNavStatus(const UbxMessageView &msg, void *context);
+		static void onNavTimeUtc(const UbxMessageView &msg, void *context);
+		static void onMonHw(const UbxMessageView &msg, void *context);
 
   	public:
-		Gps(int16_t currentYear);
-		~Gps(void);
-		PVTData GetPvt(bool polling, uint16_t timeOutMillis);
+		BasicGps(int16_t currentYear = DEFAULT_YEAR);
+		BasicGps(int16_t currentYear, const GpsNavigationConfig &navigation);
+		BasicGps(int16_t currentYear, const GpsNavigationConfig &navigation, const Transport &transport);
+		BasicGps(int16_t currentYear, UbxCaptureReader &replay);
+		~BasicGps(void);
+		PVTData GetPvt(bool polling = DEFAULT_POLLING_STATE, uint16_t timeOutMillis = DEFAULT_UPDATE_MILLS);
+		NavPvtView GetPvtView(bool polling, uint16_t timeOutMillis);
+		void SetReadMode(uint8_t mode);
+		GpsBusStats GetBusStats(void) { return busStats; }
+		void ResetBusStats(void);
+		UbxFramerStats GetFramerStats(void) { return framer.GetStats(); }
+		bool LastPvtIsNew(void) const { return lastFixNew; }
+		GpsFixStats GetFixStats(void) { return fixStats; }
+		void ResetFixStats(void);
+		bool StartRecording(const char *path);
+		void StopRecording(void);
+		bool IsRecording(void) const { return recorder.IsOpen(); }
+		UbxCaptureStats GetRecordingStats(void) const { return recorder.GetStats(); }
+		bool IsReplaying(void) const { return replay != nullptr; }
+		bool HasPendingData(void) const { return rxHead < rxLength; }
+		GnssClockStats GetClockStats(void);
+		uint64_t GnssToHostNanos(uint32_t iTow);
+		void SetOutputLatency(uint32_t nanos) { outputLatencyNanos = nanos; }
+		bool GetPvtAtHostTime(uint64_t hostNanos, PvtSample &sample, uint8_t mode = PVT_INTERPOLATE_HERMITE);
+		bool GetPvtAtGnssTime(double iTowMillis, PvtSample &sample, uint8_t mode = PVT_INTERPOLATE_HERMITE);
+
+		bool StartAcquisition(bool polling = DEFAULT_POLLING_STATE);
+		void StopAcquisition(void);
+		bool IsAcquiring(void) const { return acquisitionRunning.load(); }
+		bool PopPvt(PVTData &data) { return fixRing.Pop(data); }
+		bool WaitPvt(PVTData &data, uint16_t timeOutMillis);
+		GpsAcquisitionStats GetAcquisitionStats(void);
+
+		bool SaveConfiguration(void);
+		bool SaveNavigationDatabase(const char *path);
+		bool RestoreNavigationDatabase(const char *path);
+		void SetDatabaseAutosave(const char *path, uint32_t periodSeconds);
+		GpsDatabaseStats GetDatabaseStats(void);
+		GpsTtffStats GetTtffStats(void);
+		void RestartTtff(void);
+		bool SetNavigationConfig(const GpsNavigationConfig &navigation);
+		GpsNavigationConfig GetNavigationConfig(void) { return navigationConfig; }
+		static uint8_t ValidateNavigationConfig(const GpsNavigationConfig &navigation);
+		static const char *NavigationConfigErrorToString(uint8_t error);
+		static void DecodePvtFields(const NavPvtView &pvt, PVTData &data);
+		UbxConfigStats GetConfigStats(void) { return configStats; }
+
+		bool EnableMessage(uint8_t msgClass, uint8_t msgId, uint8_t sendRate);
+		bool EnableNmea(bool enable = true);
+		bool IsNmeaEnabled(void) const { return nmea != nullptr; }
+		PVTData GetNmeaPvt(uint16_t timeOutMillis = DEFAULT_UPDATE_MILLS);
+		uint32_t GetNmeaOverruns(void) const { return nmeaOverruns; }
+		const NmeaParser *GetNmeaParser(void) const { return nmea; }
+		bool RegisterHandler(uint8_t msgClass, uint8_t msgId, UbxHandler handler, void *context);
+		UbxDispatchStats GetDispatchStats(void) { return dispatcher.GetStats(); }
+		bool GetNavSat(NavSatData &data);
+		bool GetNavDop(NavDopData &data);
+		bool GetNavStatus(NavStatusData &data);
+		bool GetNavTimeUtc(NavTimeUtcData &data);
+		bool GetMonHw(MonHwData &data);
 };
 
+/** The SAM-M8Q on the I2C bus (GPS_I2C_BUS), and on a UART or pseudo terminal */
+typedef BasicGps<I2cTransport> Gps;
+typedef BasicGps<SerialTransport> SerialGps;
+
 #endif // GPS_H
 
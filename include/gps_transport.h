@@ -0,0 +1,153 @@
+/*
+ * gps_transport.h - Byte transports between the Gps driver and the receiver
+ *
+ * The driver is a class template over its transport (BasicGps<Transport>, see gps.h),
+ * so every read and write on the hot path is a direct, inlinable call. A transport
+ * provides:
+ *
+ *     static constexpr uint8_t PortId;                 // Receiver port, CFG-PRT/CFG-MSG
+ *     bool Open(void);                                 // Ready for UBX traffic
+ *     void Close(void);
+ *     bool IsOpen(void) const;
+ *     uint16_t Available(GpsBusStats &stats);          // Bytes readable now
+ *     bool Read(uint8_t *buf, uint16_t length, GpsBusStats &stats);
+ *     bool Write(const uint8_t *frame, uint16_t length, GpsBusStats &stats);
+ *     void PortConfig(uint8_t *payload) const;         // CFG-PRT: UBX only on PortId
+ *     void SetReadMode(uint8_t mode);
+ *
+ * - I2cTransport: the DDC port at GPS_I2C_ADDRESS, read through the byte count
+ *   registers (0xFD, 0xFE) and the data stream register (0xFF). The adapter is
+ *   shared with the other devices on it through I2cBus at bulk priority.
+ * - SerialTransport: UART1 through termios. Open() switches the receiver from
+ *   initialBaudRate to baudRate with CFG-PRT before the driver configures it; reads
+ *   are non-blocking read() calls drained after poll() reports data. Any tty works,
+ *   including the slave side of a pseudo terminal (GpsPty), which makes the UART path
+ *   testable without a receiver.
+ *
+ * Transports are copied into the driver before Open(); an open transport is not
+ * meant to be copied.
+ */
+
+#ifndef GPS_TRANSPORT_H
+#define GPS_TRANSPORT_H
+
+#include "i2c_bus.h"
+#include "ubx_msg.h"
+#include <stdint.h>
+#include <termios.h>
+extern "C" {
+	#include <i2c/smbus.h>
+}
+
+#define GPS_I2C_ADDRESS 0x42
+#define GPS_I2C_BUS "/dev/i2c-1"
+#define GPS_I2C_DEVICE_CONFIG {"gps", GPS_I2C_ADDRESS, I2C_PRIORITY_BULK, 0, 0}
+
+#define DATA_STREAM_REGISTER 0xFF
+
+#define AVAILABLE_BYTES_MSB 0xFD
+#define AVAILABLE_BYTES_LSB 0xFE
+#define AVAILABLE_BYTES_LENGTH 2
+
+/** Data Stream Read Modes */
+#define GPS_READ_MODE_BYTE 0   // One transaction per byte (legacy)
+#define GPS_READ_MODE_BLOCK 1  // One I2C_RDWR transaction per chunk
+#define DEFAULT_READ_MODE GPS_READ_MODE_BLOCK
+#define MAX_BLOCK_READ_LENGTH 256 // Largest chunk requested in a single block read
+
+/** UART */
+#define GPS_SERIAL_DEVICE "/dev/serial0"
+#define GPS_SERIAL_FACTORY_BAUD 9600      // UART1 rate of an unconfigured receiver
+#define GPS_SERIAL_BAUD 115200
+#define GPS_SERIAL_RX_BUFFER_LENGTH 4096  // Bytes drained from the tty ahead of the framer
+#define GPS_SERIAL_WRITE_TIMEOUT_MILLS 100
+#define GPS_SERIAL_SWITCH_MILLS 50        // Receiver applies a new baud rate after its ACK
+
+typedef struct {
+    uint32_t transactions;       // I2C transactions (ioctl/read/write calls) issued
+    uint32_t bytesRead;          // Bytes read from the module
+    uint32_t bytesWritten;       // Bytes written to the module
+} GpsBusStats;
+
+class I2cTransport {
+    private:
+        const char *device;
+        I2cBus *bus;
+        int busDevice;          // Handle on bus, -1 when closed
+        uint8_t readMode;
+
+        bool readRegisters(uint8_t reg, uint8_t *buf, uint16_t length, GpsBusStats &stats);
+
+    public:
+        static constexpr uint8_t PortId = PORT_ID_DDC;
+
+        I2cTransport(const char *device = GPS_I2C_BUS);
+
+        bool Open(void);
+        void Close(void);
+        bool IsOpen(void) const { return busDevice >= 0; }
+        uint16_t Available(GpsBusStats &stats);
+        bool Read(uint8_t *buf, uint16_t length, GpsBusStats &stats);
+        bool Write(const uint8_t *frame, uint16_t length, GpsBusStats &stats);
+        void PortConfig(uint8_t *payload) const;
+        void SetReadMode(uint8_t mode);
+
+        I2cBus *Bus(void) const { return bus; }
+        int BusDevice(void) const { return busDevice; }
+};
+
+typedef struct {
+    const char *device;
+    uint32_t baudRate;           // Rate the receiver and host are switched to
+    uint32_t initialBaudRate;    // Rate the receiver's UART1 is at when opened
+} SerialTransportConfig;
+
+#define SERIAL_TRANSPORT_DEFAULT_CONFIG {GPS_SERIAL_DEVICE, GPS_SERIAL_BAUD, GPS_SERIAL_FACTORY_BAUD}
+
+class SerialTransport {
+    private:
+        SerialTransportConfig config;
+        int fd;
+        uint8_t rxBuffer[GPS_SERIAL_RX_BUFFER_LENGTH];
+        uint16_t rxHead;
+        uint16_t rxLength;
+
+        bool setBaudRate(uint32_t baudRate);
+        bool writeAll(const uint8_t *frame, uint16_t length, GpsBusStats &stats);
+
+    public:
+        static constexpr uint8_t PortId = PORT_ID_UART1;
+
+        SerialTransport(void);
+        SerialTransport(const SerialTransportConfig &config);
+
+        bool Open(void);
+        void Close(void);
+        bool IsOpen(void) const { return fd >= 0; }
+        uint16_t Available(GpsBusStats &stats);
+        bool Read(uint8_t *buf, uint16_t length, GpsBusStats &stats);
+        bool Write(const uint8_t *frame, uint16_t length, GpsBusStats &stats);
+        void PortConfig(uint8_t *payload) const;
+        void SetReadMode(uint8_t mode) { (void)mode; }   // A UART is always read in blocks
+
+        static speed_t BaudToSpeed(uint32_t baudRate);
+};
+
+/** A pseudo terminal pair: SerialTransport opens SlaveName(), a simulated receiver
+ *  reads and writes MasterFd() */
+class GpsPty {
+    private:
+        int masterFd;
+        char slaveName[64];
+
+    public:
+        GpsPty(void) : masterFd(-1) { slaveName[0] = '\0'; }
+        ~GpsPty(void) { Close(); }
+
+        bool Open(void);
+        void Close(void);
+        int MasterFd(void) const { return masterFd; }
+        const char *SlaveName(void) const { return slaveName; }
+};
+
+#endif // GPS_TRANSPORT_H
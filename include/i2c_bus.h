@@ -0,0 +1,159 @@
+/*
+ * i2c_bus.h - One owner for an I2C adapter shared by several devices
+ *
+ * Gps (I2cTransport) and Imu used to open /dev/i2c-1 each and interleave their
+ * transactions with nothing in between to arbitrate. I2cBus::Shared(path) returns
+ * the single manager of an adapter; it holds the only fd and every device submits
+ * its transfers to it:
+ *
+ * - Each device is attached with a priority, an optional sample period and an
+ *   optional relative deadline. A transfer addresses the device with I2C_RDWR
+ *   messages, so no I2C_SLAVE ioctl is needed when the bus changes hands.
+ * - Waiting transfers are granted the bus highest priority first, then earliest
+ *   deadline, then in submission order. A transfer in flight is never preempted.
+ * - A periodic device reserves its next slot (last start + period). A lower
+ *   priority transfer whose estimated duration would run into a reserved slot is
+ *   held back until the slot has been used or SLOT_SLACK has passed, so GPS drains
+ *   fill the gaps between IMU samples instead of delaying them.
+ * - I2cBusSession holds the bus across several transfers (one IMU sample is a
+ *   bank select and a run of register reads) without letting others in between.
+ *
+ * The caller's thread performs its own transfer once granted, so there is no
+ * worker thread and no hand-off latency. Per-device statistics give the time spent
+ * on the bus, its share of the elapsed time, and the queueing delay before each
+ * grant.
+ */
+
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+extern "C" {
+	#include <linux/i2c-dev.h>
+	#include <linux/i2c.h>
+}
+#include <stdint.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define I2C_BUS_DEFAULT_HZ 400000
+#define I2C_BUS_TRANSFER_OVERHEAD_NANOS 50000ULL   // ioctl, start/stop and address per transfer
+#define I2C_BUS_SLOT_GUARD_NANOS 100000ULL         // Free margin kept before a reserved slot
+#define I2C_BUS_SLOT_SLACK_NANOS 1000000ULL        // A reserved slot not used by then is released
+#define I2C_BUS_MAX_DEVICES 8
+
+/** Priorities: higher is granted first */
+#define I2C_PRIORITY_BULK 0      // Stream drains, configuration
+#define I2C_PRIORITY_NORMAL 1
+#define I2C_PRIORITY_HIGH 2      // Periodic sensor samples
+
+typedef struct {
+    const char *name;
+    uint16_t address;            // 7-bit slave address
+    uint8_t priority;            // I2C_PRIORITY_*
+    uint32_t periodMicros;       // Expected sample period; 0 if the device is not periodic
+    uint32_t deadlineMicros;     // Grant within this long of submission; 0 for no deadline
+} I2cDeviceConfig;
+
+typedef struct {
+    uint32_t transfers;          // Grants (a session counts once)
+    uint32_t bytes;              // Bytes read and written, address bytes excluded
+    uint64_t busyNanos;          // Time holding the bus
+    uint64_t queueNanos;         // Time from submission to grant, summed
+    uint64_t maxQueueNanos;
+    uint32_t deadlineMisses;     // Grants later than the deadline
+    uint32_t deferrals;          // Held back for a higher priority device's slot
+    uint32_t errors;             // Failed ioctls
+} I2cDeviceStats;
+
+class I2cBus {
+    private:
+        typedef struct {
+            uint8_t priority;
+            uint64_t deadlineNanos;
+            uint64_t sequence;
+            int device;
+        } Ticket;
+
+        struct TicketOrder {
+            bool operator()(const Ticket &a, const Ticket &b) const;
+        };
+
+        typedef struct {
+            bool attached;
+            std::string name;
+            I2cDeviceConfig config;
+            I2cDeviceStats stats;
+            uint64_t nextSlotNanos;      // Reserved start of the next periodic sample; 0 if none
+        } Device;
+
+        std::string path;
+        int fd;
+        uint32_t clockHz;
+        std::mutex lock;
+        std::condition_variable released;
+        std::set<Ticket, TicketOrder> waiting;
+        uint64_t sequence;
+        Device devices[I2C_BUS_MAX_DEVICES];
+        uint8_t attachedCount;
+
+        bool busy;
+        int owner;                   // Device holding the bus
+        std::thread::id ownerThread;
+        uint32_t ownerDepth;         // Nested Acquire() calls by the owner
+        uint64_t grantNanos;
+        uint64_t statsStartNanos;
+
+        I2cBus(const char *path);
+
+        uint64_t estimateNanos(uint32_t bytes, uint32_t messages) const;
+        uint64_t deferUntil(const Ticket &ticket, uint64_t durationNanos, uint64_t nowNanos) const;
+        bool validDevice(int device) const;
+
+    public:
+        static I2cBus &Shared(const char *path);
+
+        int Attach(const I2cDeviceConfig &config);
+        void Detach(int device);
+        void SetPeriod(int device, uint32_t periodMicros);
+        void SetClockHz(uint32_t hz) { clockHz = hz; }
+
+        bool Acquire(int device, uint32_t expectedBytes = 0);
+        void Release(int device);
+
+        bool Transfer(int device, struct i2c_msg *msgs, uint32_t count);
+        bool ReadRegisters(int device, uint8_t reg, uint8_t *buf, uint16_t length);
+        bool Write(int device, const uint8_t *data, uint16_t length);
+        bool WriteRegister(int device, uint8_t reg, uint8_t value);
+
+        I2cDeviceStats GetStats(int device);
+        double Utilization(int device);
+        int Find(const char *name);
+        void ResetStats(void);
+        bool IsOpen(void) const { return fd >= 0; }
+};
+
+/** Holds the bus for one device for the lifetime of the object */
+class I2cBusSession {
+    private:
+        I2cBus &bus;
+        int device;
+        bool held;
+
+    public:
+        I2cBusSession(I2cBus &bus, int device, uint32_t expectedBytes = 0) : bus(bus), device(device) {
+            held = bus.Acquire(device, expectedBytes);
+        }
+        ~I2cBusSession(void) {
+            if (held) {
+                bus.Release(device);
+            }
+        }
+        bool Held(void) const { return held; }
+};
+
+#endif // I2C_BUS_H
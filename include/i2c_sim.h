@@ -0,0 +1,85 @@
+/*
+ * i2c_sim.h - Local stand-in for the I2C bus with a simulated SAM-M8Q and ICM-20948
+ *
+ * Linking src/i2c_sim.cpp into a program (instead of -li2c) replaces the Linux
+ * I2C interface underneath Gps and Imu, so both drivers run unmodified on a machine
+ * without the hardware:
+ *
+ * - open() of a "/dev/i2c-*" device returns a simulated bus; ioctl() handles
+ *   I2C_SLAVE, I2C_SLAVE_FORCE, I2C_FUNCS, I2C_RDWR and I2C_SMBUS on it, and read()
+ *   and write() are plain transfers to the selected slave. The SMBus helpers of
+ *   libi2c are provided on top of I2C_SMBUS. Every other descriptor goes to libc.
+ * - The receiver answers at GPS_I2C_ADDRESS (see sim_sam_m8q.h) and the IMU at
+ *   IMU_I2C_ADDRESS (see sim_icm20948.h); other addresses are not acknowledged.
+ * - Transactions are serialised on one bus and take (bytes + addressing) * 9 bits at
+ *   busHz plus latencyMicros. nackRate fails whole transactions with EREMOTEIO and
+ *   corruptRate flips bits in bytes read from the receiver's stream.
+ * - With timeScale above 1 the clock runs faster than real time: CLOCK_MONOTONIC
+ *   reads (clock_gettime, and so std::chrono::steady_clock and EpochScheduler) and
+ *   clock_nanosleep, nanosleep, usleep and sleep are scaled. CLOCK_REALTIME and
+ *   condition variable timeouts are not.
+ *
+ * The same source builds i2c_sim.so, which runs already linked binaries against the
+ * simulator through LD_PRELOAD. Without a call to Configure() the settings come from
+ * the environment:
+ *
+ *   I2C_SIM_BUS_HZ, I2C_SIM_LATENCY_US, I2C_SIM_NACK_RATE, I2C_SIM_CORRUPT_RATE,
+ *   I2C_SIM_TIME_SCALE, I2C_SIM_SEED
+ */
+
+#ifndef I2C_SIM_H
+#define I2C_SIM_H
+
+#include "sim_icm20948.h"
+#include "sim_sam_m8q.h"
+#include <stdint.h>
+
+#define I2C_SIM_DEVICE_PREFIX "/dev/i2c-"
+#define I2C_SIM_BITS_PER_BYTE 9            // 8 data bits and the acknowledge
+#define I2C_SIM_GPS_ADDRESS 0x42           // As GPS_I2C_ADDRESS
+#define I2C_SIM_IMU_ADDRESS 0x69           // As IMU_I2C_ADDRESS
+#define I2C_SIM_MAX_TIME_SCALE 1000.0
+
+typedef struct {
+    uint32_t busHz;                 // SCL frequency; 0 makes transfers free
+    uint32_t latencyMicros;         // Fixed cost of every transaction (driver, controller)
+    double nackRate;                // Probability that a transaction is not acknowledged
+    double corruptRate;             // Probability that a receiver stream byte is corrupted
+    double timeScale;               // Virtual seconds per real second
+    uint32_t seed;                  // Error injection and sensor noise
+} I2cSimConfig;
+
+#define I2C_SIM_DEFAULT_CONFIG {400000, 50, 0.0, 0.0, 1.0, 1}
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t nacks;                 // Injected or to an absent address
+    uint32_t corruptedBytes;
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    uint64_t busyNanos;             // Virtual time the bus spent on this device
+} I2cSimDeviceStats;
+
+typedef struct {
+    I2cSimDeviceStats gps;
+    I2cSimDeviceStats imu;
+    I2cSimDeviceStats other;        // Addresses without a device
+} I2cSimStats;
+
+class I2cSim {
+    public:
+        static void Configure(const I2cSimConfig &config);
+        static I2cSimConfig GetConfig(void);
+        static I2cSimStats GetStats(void);
+        static void ResetStats(void);
+
+        static void ConfigureGps(const SimSamM8qConfig &config);
+        static void ConfigureImu(const SimIcm20948Config &config);
+        static void PowerCycleGps(void);
+        static SimSamM8qStats GetGpsStats(void);
+        static SimIcm20948Stats GetImuStats(void);
+
+        static uint64_t NowNanos(void);
+};
+
+#endif // I2C_SIM_H
@@ -18,12 +18,32 @@
  * - Various constants for I2C addresses, register addresses, data sizes, and sensitivities.
  *
  * Class:
- * - Imu: A class that encapsulates IMU functionality, including I2C communication,
- *   sensor data retrieval, and telemetry functions.
+ * - ImuDevice: I2C communication, configuration, sensor data retrieval and the FIFO.
+ * - BasicImu<GyroRange, AccelRange, AccelAxes, GyroAxes>: An ImuDevice whose full-scale
+ *   ranges (Gyro250dps..Gyro2000dps, Accel2g..Accel16g) and axis maps (AxisMap) are
+ *   fixed at compile time, so each scaled axis is one multiply-add with no branches.
+ *   Imu is the reset ranges with the accelerometer's Y axis flipped.
  *
  * Usage:
  * - Include this header file in your C++ project to interact with an IMU sensor.
  * - Instantiate the Imu class to communicate with the IMU sensor and retrieve data.
+ * - The IMU shares the adapter with the GPS through I2cBus (i2c_bus.h) at high
+ *   priority; call SetSamplePeriod() when sampling at a fixed rate.
+ * - ReadSensorData() reads accelerometer, gyroscope and magnetometer in one burst
+ *   from ACCEL_XOUT_H to MAGNETO_ZOUT_L (IMU_READ_MODE_BLOCK). BANK_SEL is written
+ *   only when another bank is selected.
+ * - For a steady inertial stream, StartFifo() has the sensor sample itself at up to
+ *   1.1 kHz into its FIFO, and ReadFifo() drains the whole frames in one block read
+ *   as a batch of evenly spaced ImuSamples. An overflow resets the FIFO and restarts
+ *   the timestamps; the lost samples are counted in ImuFifoStats.
+ * - Configure() sets the low pass filters and output data rates at run time
+ *   (ImuConfig, DEFAULT_IMU_CONFIG); the full-scale ranges are written from the type.
+ * - SetBiases() replaces the accel offsets and gyro biases the getters subtract
+ *   (ImuBiases, DEFAULT_IMU_BIASES); ImuBiasEstimator in imu_bias.h tracks them at
+ *   standstill and over temperature. GetTemperature() is the die temperature of the
+ *   last ReadSensorData() or ReadTemperature().
+ * - SetMagCalibration() applies a hard-iron and soft-iron correction (MagCalibration,
+ *   fitted by MagCalibrator in mag_calibration.h) to GetMagX() and the others.
  *
  * Note: This code is designed for a specific IMU sensor and may require adaptation for
  *       other IMU sensors or hardware configurations. Refer to the provided credit and
@@ -33,6 +53,7 @@
 #ifndef IMU_H
 #define IMU_H
 
+#include "i2c_bus.h"
 extern "C" {
 	#include <i2c/smbus.h>
 	#include <linux/i2c-dev.h>
@@ -50,6 +71,7 @@ extern "C" {
 /** IMU Constants */
 #define TIME_DELAY_MS 1000
 #define ACCEL_MAG_DATA_SIZE 12
+#define SENSOR_DATA_SIZE 6 // Three 16-bit axes
 #define PI 3.14159265359f
 #define DEG_TO_RAD PI / 180.0
 #define RAD_TO_DEG 180.0 / PI
@@ -67,19 +89,41 @@ extern "C" {
 /** I2C Specifics */
 #define IMU_I2C_ADDRESS 0x69
 #define IMU_I2C_BUS "/dev/i2c-1"
+#define IMU_I2C_DEVICE_CONFIG {"imu", IMU_I2C_ADDRESS, I2C_PRIORITY_HIGH, 0, 0}
 #define IMU_ID 0xEA
 
+/** Sample read modes */
+#define IMU_READ_MODE_BYTE 0   // One transaction per register (legacy)
+#define IMU_READ_MODE_BLOCK 1  // One I2C_RDWR transaction per sample
+#define DEFAULT_IMU_READ_MODE IMU_READ_MODE_BLOCK
+
 /** General Registers */
 #define BANK_SEL 0x7F
 #define BANK_REG_0 0x00
 #define BANK_REG_1 0x10
 #define BANK_REG_2 0x20
 #define BANK_REG_3 0x30
+#define BANK_UNKNOWN 0xFF
 
 /** Bank 0 Registers */
 #define WHO_AM_I 0x00
+#define USER_CTRL 0x03
 #define PWR_MGMT_1 0x06
 #define INT_PIN_CFG 0x0F
+#define INT_STATUS_2 0x1B
+#define FIFO_EN_1 0x66
+#define FIFO_EN_2 0x67
+#define FIFO_RST 0x68
+#define FIFO_MODE 0x69
+#define FIFO_COUNTH 0x70
+#define FIFO_R_W 0x72
+
+/** Bank 2 Registers */
+#define GYRO_SMPLRT_DIV 0x00
+#define GYRO_CONFIG_1 0x01
+#define ACCEL_SMPLRT_DIV_1 0x10
+#define ACCEL_SMPLRT_DIV_2 0x11
+#define ACCEL_CONFIG 0x14
 
 /** Bank 3 Registers */
 #define I2C_MST_CTRL 0x01
@@ -93,7 +137,6 @@ extern "C" {
 
 /** Gyroscope Registers */
 #define GYRO_REG_START 0x00
-#define GYRO_CONFIG 0x01
 #define GYRO_XOUT_H 0x33
 #define GYRO_XOUT_L 0x34
 #define GYRO_YOUT_H 0x35
@@ -103,7 +146,6 @@ extern "C" {
 
 /** Accelerometer Registers */
 #define ACCEL_REG_START 0x00
-#define ACCEL_CONFIG 0x01
 #define ACCEL_XOUT_H 0x2D
 #define ACCEL_XOUT_L 0x2E
 #define ACCEL_YOUT_H 0x2F
@@ -121,10 +163,43 @@ extern "C" {
 #define MAGNETO_ZOUT_H 0x40
 #define MAGNETO_ZOUT_L 0x41
 
+/** Temperature Registers: degrees C = TEMP_OUT / TEMP_SENSITIVITY + TEMP_OFFSET_C */
+#define TEMP_OUT_H 0x39
+#define TEMP_OUT_L 0x3A
+#define TEMP_DATA_SIZE 2
+#define TEMP_SENSITIVITY 333.87F
+#define TEMP_OFFSET_C 21.0F
+
+/** Sample block: accel, gyro, temperature, AK09916 ST1 and the magnetometer (EXT_SLV_SENS_DATA) */
+#define SAMPLE_BLOCK_START ACCEL_XOUT_H
+#define SAMPLE_BLOCK_LENGTH (MAGNETO_ZOUT_L - ACCEL_XOUT_H + 1)
+
+/** FIFO: frames of accel, gyro and the SLV0 read of the magnetometer (ST1, HXL..HZH, TMPS, ST2) */
+#define USER_CTRL_FIFO_EN 0x40
+#define USER_CTRL_I2C_MST_EN 0x20
+#define FIFO_EN_1_SLV0 0x01
+#define FIFO_EN_2_ACCEL_GYRO 0x1E
+#define FIFO_RST_ALL 0x1F
+#define FIFO_MODE_STREAM 0x00
+#define INT_STATUS_2_FIFO_OVERFLOW 0x1F
+#define FIFO_COUNT_MASK 0x1FFF
+#define FIFO_SIZE 512
+#define FIFO_SLV0_LENGTH 9
+#define FIFO_FRAME_SIZE (2 * SENSOR_DATA_SIZE + FIFO_SLV0_LENGTH)
+#define FIFO_MAG_OFFSET (2 * SENSOR_DATA_SIZE + 1)
+#define FIFO_MAX_FRAMES (FIFO_SIZE / FIFO_FRAME_SIZE)
+#define GYRO_ODR_HZ 1100 // Gyro sample rate is 1.1 kHz / (1 + GYRO_SMPLRT_DIV)
+#define ACCEL_ODR_HZ 1125 // Accel sample rate is 1.125 kHz / (1 + ACCEL_SMPLRT_DIV)
+#define ACCEL_SMPLRT_DIV_MAX 0x0FFF
+
 /** Gyroscope sensitivity at 250dps */
 #define GYRO_SENSITIVITY_250DPS (1/131.0F)
 /** Gyroscope sensitivity at 500dps */
 #define GYRO_SENSITIVITY_500DPS (1/65.5F) 
+/** Gyroscope sensitivity at 1000dps */
+#define GYRO_SENSITIVITY_1000DPS (1/32.8F)
+/** Gyroscope sensitivity at 2000dps */
+#define GYRO_SENSITIVITY_2000DPS (1/16.4F)
 #define GYRO_DATA_SIZE 6
 #define GYRO_CONFIG_VALUE 0x11 << 1
 
@@ -133,12 +208,93 @@ extern "C" {
 /** Macro for mg per LSB at +/- 4g sensitivity (1 LSB = 0.000488mg) */
 #define ACCEL_MG_LSB_4G (1/8192.0F)
 /** Macro for mg per LSB at +/- 8g sensitivity (1 LSB = 0.000976mg) */
-#define ACCEL_MG_LSB_8G (/4096.0F)
+#define ACCEL_MG_LSB_8G (1/4096.0F)
+/** Macro for mg per LSB at +/- 16g sensitivity (1 LSB = 0.001953mg) */
+#define ACCEL_MG_LSB_16G (1/2048.0F)
+
+/** GYRO_CONFIG_1 and ACCEL_CONFIG: DLPFCFG in bits 5:3, FS_SEL in bits 2:1, FCHOICE in bit 0 */
+#define SENSOR_CONFIG_FCHOICE 0x01
+#define SENSOR_CONFIG_FS_SEL_SHIFT 1
+#define SENSOR_CONFIG_DLPFCFG_SHIFT 3
+#define SENSOR_CONFIG_DLPFCFG_MAX 7
+#define GYRO_FS_SEL_250DPS 0
+#define GYRO_FS_SEL_500DPS 1
+#define GYRO_FS_SEL_1000DPS 2
+#define GYRO_FS_SEL_2000DPS 3
+#define ACCEL_FS_SEL_2G 0
+#define ACCEL_FS_SEL_4G 1
+#define ACCEL_FS_SEL_8G 2
+#define ACCEL_FS_SEL_16G 3
+
+/** Low pass filter settings (DLPFCFG), by 3 dB bandwidth */
+#define GYRO_DLPF_197HZ 0
+#define GYRO_DLPF_152HZ 1
+#define GYRO_DLPF_120HZ 2
+#define GYRO_DLPF_51HZ 3
+#define GYRO_DLPF_24HZ 4
+#define GYRO_DLPF_12HZ 5
+#define GYRO_DLPF_6HZ 6
+#define GYRO_DLPF_361HZ 7
+#define ACCEL_DLPF_246HZ 0
+#define ACCEL_DLPF_111HZ 2
+#define ACCEL_DLPF_50HZ 3
+#define ACCEL_DLPF_24HZ 4
+#define ACCEL_DLPF_12HZ 5
+#define ACCEL_DLPF_6HZ 6
+#define ACCEL_DLPF_473HZ 7
+#define IMU_DLPF_OFF 0xFF            // FCHOICE 0: no filter, 9 kHz gyro and 4.5 kHz accel, dividers ignored
+#define GYRO_UNFILTERED_ODR_HZ 9000
+#define ACCEL_UNFILTERED_ODR_HZ 4500
+
+/** Reset configuration of the chip; begin() applies it with the full scale of the Imu type */
+#define DEFAULT_IMU_CONFIG {GYRO_DLPF_197HZ, ACCEL_DLPF_246HZ, GYRO_ODR_HZ, ACCEL_ODR_HZ}
+
+/** Axis map entries: a sensor axis, negated for the opposite direction */
+#define IMU_AXIS_X 1
+#define IMU_AXIS_Y 2
+#define IMU_AXIS_Z 3
 
 /** Macro for micro tesla (uT) per LSB (1 LSB = 0.1uT) */
 #define MAG_UT_LSB (0.15)
 #define MAG_MAX_THRESHOLD 5000 // µT, adjust as needed
 
+typedef struct {
+	uint64_t timeNanos;          // CLOCK_MONOTONIC, evenly spaced at the FIFO rate
+	int16_t accelerometer[3];
+	int16_t gyroscope[3];
+	int16_t magnetometer[3];
+} ImuSample;
+
+typedef struct {
+	uint32_t samples;            // Frames drained
+	uint32_t drains;             // ReadFifo() calls that returned frames
+	uint32_t overflows;          // Times the FIFO overflowed and was reset
+	uint32_t samplesLost;        // Frames missed by the overflows, from the elapsed time
+} ImuFifoStats;
+
+typedef struct {
+	float hardIron[3];           // uT, subtracted from the measurement first
+	float softIron[3][3];        // Applied to the difference
+	float fieldUt;               // Field strength after the correction; 0 if unknown
+} MagCalibration;
+
+#define MAG_CALIBRATION_IDENTITY {{0.0F, 0.0F, 0.0F}, {{1.0F, 0.0F, 0.0F}, {0.0F, 1.0F, 0.0F}, {0.0F, 0.0F, 1.0F}}, 0.0F}
+
+typedef struct {
+	uint8_t gyroDlpf;            // GYRO_DLPF_*, or IMU_DLPF_OFF
+	uint8_t accelDlpf;           // ACCEL_DLPF_*, or IMU_DLPF_OFF
+	uint16_t gyroRateHz;         // Output data rate; the nearest of 1.1 kHz / (1 + GYRO_SMPLRT_DIV)
+	uint16_t accelRateHz;        // The nearest of 1.125 kHz / (1 + ACCEL_SMPLRT_DIV)
+} ImuConfig;
+
+typedef struct {
+	float accel[3];              // g, body axes, subtracted from the scaled accelerometer
+	float gyro[3];               // rad/s, body axes
+} ImuBiases;
+
+/** One run of calibrate_accel_gyro.py; the biases until SetBiases() */
+#define DEFAULT_IMU_BIASES {{accel_x_offset, accel_y_offset, accel_z_offset}, {gyro_x_bias, gyro_y_bias, gyro_z_bias}}
+
 const float alpha = 0.5; // Adjust this parameter to tweak the filter (range: 0-1)
 const float accel_x_offset = -0.05673657500210876;
 const float accel_y_offset = -0.014051752249833504;
@@ -147,32 +303,207 @@ const float gyro_x_bias = -0.008447830282040561;
 const float gyro_y_bias = 0.0064697791963203004;
 const float gyro_z_bias = -0.009548081446790717;
 
-class Imu {
+/** Full-scale ranges: FS_SEL and the rad/s (gyro) or g (accel) per LSB */
+struct Gyro250dps {
+	static constexpr uint8_t FS_SEL = GYRO_FS_SEL_250DPS;
+	static constexpr float SCALE = static_cast<float>(GYRO_SENSITIVITY_250DPS * DEG_TO_RAD);
+};
+struct Gyro500dps {
+	static constexpr uint8_t FS_SEL = GYRO_FS_SEL_500DPS;
+	static constexpr float SCALE = static_cast<float>(GYRO_SENSITIVITY_500DPS * DEG_TO_RAD);
+};
+struct Gyro1000dps {
+	static constexpr uint8_t FS_SEL = GYRO_FS_SEL_1000DPS;
+	static constexpr float SCALE = static_cast<float>(GYRO_SENSITIVITY_1000DPS * DEG_TO_RAD);
+};
+struct Gyro2000dps {
+	static constexpr uint8_t FS_SEL = GYRO_FS_SEL_2000DPS;
+	static constexpr float SCALE = static_cast<float>(GYRO_SENSITIVITY_2000DPS * DEG_TO_RAD);
+};
+struct Accel2g {
+	static constexpr uint8_t FS_SEL = ACCEL_FS_SEL_2G;
+	static constexpr float SCALE = ACCEL_MG_LSB_2G;
+};
+struct Accel4g {
+	static constexpr uint8_t FS_SEL = ACCEL_FS_SEL_4G;
+	static constexpr float SCALE = ACCEL_MG_LSB_4G;
+};
+struct Accel8g {
+	static constexpr uint8_t FS_SEL = ACCEL_FS_SEL_8G;
+	static constexpr float SCALE = ACCEL_MG_LSB_8G;
+};
+struct Accel16g {
+	static constexpr uint8_t FS_SEL = ACCEL_FS_SEL_16G;
+	static constexpr float SCALE = ACCEL_MG_LSB_16G;
+};
+
+/**
+ * Body axes from sensor axes: body X reads sensor axis X (IMU_AXIS_*), negated when
+ * X is negative, and so on. AxisMap<IMU_AXIS_X, -IMU_AXIS_Y, IMU_AXIS_Z> flips Y.
+ */
+template <int X, int Y, int Z>
+struct AxisMap {
+	static constexpr int index(int entry) { return (entry < 0 ? -entry : entry) - IMU_AXIS_X; }
+	static constexpr int entry(int axis) { return axis == X_AXIS ? X : (axis == Y_AXIS ? Y : Z); }
+	static constexpr int Source(int axis) { return index(entry(axis)); }
+	static constexpr float Sign(int axis) { return entry(axis) < 0 ? -1.0F : 1.0F; }
+};
+
+typedef AxisMap<IMU_AXIS_X, IMU_AXIS_Y, IMU_AXIS_Z> SensorAxes;
+
+/** Whether an axis map takes each sensor axis once */
+template <class Axes>
+constexpr bool IsAxisPermutation(void) {
+	return Axes::Source(X_AXIS) >= X_AXIS && Axes::Source(X_AXIS) <= Z_AXIS &&
+		Axes::Source(Y_AXIS) >= X_AXIS && Axes::Source(Y_AXIS) <= Z_AXIS &&
+		Axes::Source(Z_AXIS) >= X_AXIS && Axes::Source(Z_AXIS) <= Z_AXIS &&
+		Axes::Source(X_AXIS) != Axes::Source(Y_AXIS) && Axes::Source(Y_AXIS) != Axes::Source(Z_AXIS) &&
+		Axes::Source(X_AXIS) != Axes::Source(Z_AXIS);
+}
+
+/**
+ * Register access, configuration and the FIFO; BasicImu adds the scaled getters.
+ */
+class ImuDevice {
 private:
-	int i2c_fd;
+	I2cBus *bus;
+	int busDevice;
+	uint8_t readMode;
+	uint8_t bank;                // Bank last written to BANK_SEL; BANK_UNKNOWN after a failed write
+	uint8_t gyroFsSel;           // Fixed by the BasicImu type
+	uint8_t accelFsSel;
+	ImuConfig config;
+	uint8_t gyroDivider;         // GYRO_SMPLRT_DIV
+	uint16_t accelDivider;       // ACCEL_SMPLRT_DIV
+	bool fifoEnabled;
+	uint64_t fifoStartNanos;     // Time of the last FIFO reset; frame n follows (n + 1) periods later
+	uint64_t fifoFrames;         // Frames drained since then
+	ImuFifoStats fifoStats;
+	MagCalibration magCalibration;
+	float magMatrix[3][3];       // softIron * MAG_UT_LSB, applied to the raw counts
+	float magOffset[3];          // -softIron * hardIron
+	int16_t temperature;         // TEMP_OUT
+	void begin(void);
+	int32_t readRegister(uint8_t reg);
+	bool writeRegister(uint8_t reg, uint8_t value);
+	bool selectBank(uint8_t value);
+	bool writeConfig(void);
+	bool readSampleBlock(uint8_t *block);
+	bool resetFifo(void);
+	int recoverFifoOverflow(uint64_t nowNanos);
+
+protected:
 	int16_t accelerometer[3];
 	int16_t magnetometer[3];
 	int16_t gyroscope[3];
-	void begin(void);
+	ImuBiases biases;
+	ImuDevice(uint8_t gyroFsSel, uint8_t accelFsSel);
+
+	/** Three multiply-adds: the calibration is folded into magMatrix and magOffset */
+	float calibratedMag(const int16_t *raw, int axis) const {
+		return magMatrix[axis][X_AXIS] * raw[X_AXIS] + magMatrix[axis][Y_AXIS] * raw[Y_AXIS] +
+			magMatrix[axis][Z_AXIS] * raw[Z_AXIS] + magOffset[axis];
+	}
 
 public:
-	Imu();
-	~Imu();
-	void ReadSensorData(void);
+	~ImuDevice();
+	bool ReadSensorData(void);
+	bool ReadTemperature(void);
+	void SetSamplePeriod(uint32_t periodMicros);
+	void SetReadMode(uint8_t mode) { readMode = mode; }
+
+	bool Configure(const ImuConfig &requested);
+	ImuConfig GetConfig(void) const { return config; }
+	double GetGyroRate(void) const;
+	double GetAccelRate(void) const;
+
+	bool StartFifo(uint16_t rateHz);
+	bool StopFifo(void);
+	int ReadFifo(ImuSample *samples, uint16_t maxSamples);
+	bool IsFifoEnabled(void) const { return fifoEnabled; }
+	double GetFifoRate(void) const { return fifoEnabled ? GetGyroRate() : 0.0; }
+	ImuFifoStats GetFifoStats(void) const { return fifoStats; }
+	void ResetFifoStats(void);
+	I2cDeviceStats GetBusStats(void) { return bus->GetStats(busDevice); }
+
+	void SetMagCalibration(const MagCalibration &calibration);
+	MagCalibration GetMagCalibration(void) const { return magCalibration; }
+	void CalibrateMag(const int16_t *raw, float *mag) const;
+
+	void SetBiases(const ImuBiases &value) { biases = value; }
+	ImuBiases GetBiases(void) const { return biases; }
+	float GetTemperature(void) const { return temperature / TEMP_SENSITIVITY + TEMP_OFFSET_C; }
 
     const int16_t* GetRawAccelerometerData() { return accelerometer; }
     const int16_t* GetRawMagnetometerData() { return magnetometer; }
     const int16_t* GetRawGyroscopeData() { return gyroscope; }
+};
+
+/**
+ * The getters in g, rad/s and uT for a full-scale range and axis map fixed at compile
+ * time: each axis is one multiply-add of a constant (scale and sign) with a constant
+ * register index, which the compiler fuses where the CPU has FMA (AArch64 does).
+ * The accelerometer and gyro have the ImuBiases set on the ImuDevice subtracted.
+ * The magnetometer is not remapped (the AK09916 has axes of its own); it is
+ * corrected with the MagCalibration set on the ImuDevice.
+ */
+template <class GyroRange, class AccelRange, class AccelAxes = SensorAxes, class GyroAxes = AccelAxes>
+class BasicImu : public ImuDevice {
+private:
+	static_assert(IsAxisPermutation<AccelAxes>() && IsAxisPermutation<GyroAxes>(),
+		"An AxisMap takes each of IMU_AXIS_X, IMU_AXIS_Y and IMU_AXIS_Z once");
+
+	template <class Range, class Axes, int Axis>
+	static float scale(const int16_t *raw, float offset) {
+		return static_cast<float>(raw[Axes::Source(Axis)]) * (Axes::Sign(Axis) * Range::SCALE) - offset;
+	}
 
-	float GetAccelX() { return static_cast<float>(accelerometer[X_AXIS]) * ACCEL_MG_LSB_2G - accel_x_offset; }
-	float GetAccelY() { return -1 * static_cast<float>(accelerometer[Y_AXIS]) * ACCEL_MG_LSB_2G - accel_y_offset; }
-	float GetAccelZ() { return static_cast<float>(accelerometer[Z_AXIS]) * ACCEL_MG_LSB_2G - accel_z_offset; }
-	float GetGyroX() { return (GYRO_SENSITIVITY_250DPS * DEG_TO_RAD * static_cast<float>(gyroscope[X_AXIS]) - gyro_x_bias); }
-	float GetGyroY() { return (GYRO_SENSITIVITY_250DPS * DEG_TO_RAD * static_cast<float>(gyroscope[Y_AXIS]) - gyro_y_bias); }
-	float GetGyroZ() { return (GYRO_SENSITIVITY_250DPS * DEG_TO_RAD * static_cast<float>(gyroscope[Z_AXIS]) - gyro_z_bias); }
-	float GetMagX() { return static_cast<float>(magnetometer[X_AXIS]) * MAG_UT_LSB; }
-	float GetMagY() { return static_cast<float>(magnetometer[Y_AXIS]) * MAG_UT_LSB; }
-	float GetMagZ() { return static_cast<float>(magnetometer[Z_AXIS]) * MAG_UT_LSB; }
+public:
+	BasicImu() : ImuDevice(GyroRange::FS_SEL, AccelRange::FS_SEL) {}
+
+	float GetAccelX() { return scale<AccelRange, AccelAxes, X_AXIS>(accelerometer, biases.accel[X_AXIS]); }
+	float GetAccelY() { return scale<AccelRange, AccelAxes, Y_AXIS>(accelerometer, biases.accel[Y_AXIS]); }
+	float GetAccelZ() { return scale<AccelRange, AccelAxes, Z_AXIS>(accelerometer, biases.accel[Z_AXIS]); }
+	float GetGyroX() { return scale<GyroRange, GyroAxes, X_AXIS>(gyroscope, biases.gyro[X_AXIS]); }
+	float GetGyroY() { return scale<GyroRange, GyroAxes, Y_AXIS>(gyroscope, biases.gyro[Y_AXIS]); }
+	float GetGyroZ() { return scale<GyroRange, GyroAxes, Z_AXIS>(gyroscope, biases.gyro[Z_AXIS]); }
+	float GetMagX() { return calibratedMag(magnetometer, X_AXIS); }
+	float GetMagY() { return calibratedMag(magnetometer, Y_AXIS); }
+	float GetMagZ() { return calibratedMag(magnetometer, Z_AXIS); }
+
+	/**
+	 * @brief   Scale a FIFO sample as the getters scale the latest one.
+	 */
+	void ScaleSample(const ImuSample &sample, float accel[3], float gyro[3]) const {
+		ScaleUncorrected(sample.accelerometer, sample.gyroscope, accel, gyro);
+		for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+			accel[axis] -= biases.accel[axis];
+			gyro[axis] -= biases.gyro[axis];
+		}
+	}
+
+	/**
+	 * @brief   Scale and map raw counts into body axes without subtracting the biases,
+	 *          which is what ImuBiasEstimator needs.
+	 */
+	static void ScaleUncorrected(const int16_t *accelRaw, const int16_t *gyroRaw, float accel[3], float gyro[3]) {
+		accel[X_AXIS] = scale<AccelRange, AccelAxes, X_AXIS>(accelRaw, 0.0F);
+		accel[Y_AXIS] = scale<AccelRange, AccelAxes, Y_AXIS>(accelRaw, 0.0F);
+		accel[Z_AXIS] = scale<AccelRange, AccelAxes, Z_AXIS>(accelRaw, 0.0F);
+		gyro[X_AXIS] = scale<GyroRange, GyroAxes, X_AXIS>(gyroRaw, 0.0F);
+		gyro[Y_AXIS] = scale<GyroRange, GyroAxes, Y_AXIS>(gyroRaw, 0.0F);
+		gyro[Z_AXIS] = scale<GyroRange, GyroAxes, Z_AXIS>(gyroRaw, 0.0F);
+	}
+
+	/**
+	 * @brief   The latest sample in body axes, without the biases.
+	 */
+	void GetUncorrected(float accel[3], float gyro[3]) {
+		ScaleUncorrected(accelerometer, gyroscope, accel, gyro);
+	}
 };
 
+/** The reset ranges (250 dps, 2 g) with the accelerometer's Y axis flipped, as before */
+typedef BasicImu<Gyro250dps, Accel2g, AxisMap<IMU_AXIS_X, -IMU_AXIS_Y, IMU_AXIS_Z>, SensorAxes> Imu;
+
 #endif // IMU_H
@@ -0,0 +1,106 @@
+/*
+ * imu_bias.h - Accelerometer and gyro biases tracked at standstill and over temperature
+ *
+ * The biases in imu.h (DEFAULT_IMU_BIASES) come from one run of calibrate_accel_gyro.py;
+ * they differ from unit to unit and drift with the die temperature. ImuBiasEstimator
+ * follows them from the sample stream instead:
+ *
+ * - The samples are cut into windows of windowSamples. A window is still when the
+ *   standard deviation of every accel and gyro axis is below its threshold (Welford's
+ *   running variance) and the gyro mean is within gyroRateRadS of the bias, since a
+ *   steady turn is as quiet as standstill.
+ * - A still window's gyro mean is an observation of the gyro bias. For the accelerometer
+ *   only the component along gravity is observable from one attitude: the observation
+ *   moves the bias along the measured direction until |accel - bias| is 1 g. The other
+ *   components are corrected when the rover stops in other attitudes.
+ * - Each axis fits bias = offset + slope * (T - IMU_BIAS_REFERENCE_C) over the still
+ *   windows by least squares with exponential forgetting, so a recent window weighs
+ *   most and the model follows aging. The slope is used once the still windows have
+ *   seen a spread of IMU_BIAS_MIN_TEMP_SPREAD_C; before that the bias is the
+ *   exponentially weighted mean. Between still windows the model keeps following the
+ *   temperature, which is what keeps the gyro-integrated attitude from drifting on a
+ *   long drive.
+ * - The biases passed to the constructor hold until the first still window, and for
+ *   the accelerometer components no stop has observed yet.
+ *
+ * Usage:
+ *     ImuBiasEstimator estimator(imu.GetBiases());
+ *     while (imu.ReadSensorData()) {
+ *         float accel[3], gyro[3];
+ *         imu.GetUncorrected(accel, gyro);
+ *         if (estimator.AddSample(accel, gyro, imu.GetTemperature())) {
+ *             imu.SetBiases(estimator.GetBiases());
+ *         }
+ *     }
+ */
+
+#ifndef IMU_BIAS_H
+#define IMU_BIAS_H
+
+#include "imu.h"
+#include <stdint.h>
+
+#define IMU_BIAS_CHANNELS 6                  // Accel X, Y, Z then gyro X, Y, Z
+#define IMU_BIAS_REFERENCE_C 25.0            // Temperature the offsets are fitted at
+#define IMU_BIAS_MIN_TEMP_SPREAD_C 2.0       // Standard deviation of the still temperatures before slopes are fitted
+
+typedef struct {
+    uint16_t windowSamples;      // Samples per standstill window
+    float gyroStillRadS;         // Largest gyro standard deviation in a still window, any axis
+    float gyroRateRadS;          // Largest |gyro mean - bias| in a still window
+    float accelStillG;           // Largest accel standard deviation in a still window
+    double forgetting;           // Weight kept by the past at each still window (0 to 1)
+} ImuBiasConfig;
+
+/** One second windows at 100 Hz, about 17 minutes of memory */
+#define DEFAULT_IMU_BIAS_CONFIG {100, 0.01F, 0.05F, 0.01F, 0.999}
+
+typedef struct {
+    uint32_t samples;            // Samples added since Reset()
+    uint32_t windows;            // Complete windows
+    uint32_t stillWindows;       // Windows used for the biases
+    float temperatureC;          // Mean temperature of the last window
+    float temperatureSpreadC;    // Weighted standard deviation of the still windows' temperatures
+    bool temperatureModel;       // The slopes are fitted, not zero
+} ImuBiasStats;
+
+class ImuBiasEstimator {
+    private:
+        ImuBiasConfig config;
+        ImuBiasStats stats;
+        bool still;
+
+        // The current window (Welford)
+        uint16_t count;
+        double mean[IMU_BIAS_CHANNELS];
+        double m2[IMU_BIAS_CHANNELS];
+        double temperatureSum;
+
+        // Weighted sums of the still windows, temperatures relative to IMU_BIAS_REFERENCE_C
+        double weight;
+        double sumT;
+        double sumTT;
+        double sumY[IMU_BIAS_CHANNELS];
+        double sumTY[IMU_BIAS_CHANNELS];
+        double offset[IMU_BIAS_CHANNELS];
+        double slope[IMU_BIAS_CHANNELS];
+
+        void endWindow(void);
+        bool isStill(void) const;
+        void addObservation(const double observed[IMU_BIAS_CHANNELS], double deltaT);
+        void fit(void);
+
+    public:
+        ImuBiasEstimator(const ImuBiases &initial, const ImuBiasConfig &config = DEFAULT_IMU_BIAS_CONFIG);
+        void Reset(const ImuBiases &initial);
+
+        bool AddSample(const float accel[3], const float gyro[3], float temperatureC);
+
+        ImuBiases GetBiases(float temperatureC) const;
+        ImuBiases GetBiases(void) const { return GetBiases(stats.temperatureC); }
+        ImuBiases GetSlopes(void) const;
+        bool IsStill(void) const { return still; }
+        ImuBiasStats GetStats(void) const { return stats; }
+};
+
+#endif // IMU_BIAS_H
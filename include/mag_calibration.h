@@ -0,0 +1,100 @@
+/*
+ * mag_calibration.h - Online magnetometer hard-iron and soft-iron calibration
+ *
+ * The field measured by the AK09916 is the earth's field, distorted by the rover:
+ * m = S * f + b, with the hard-iron bias b (magnetised parts) and the soft-iron
+ * matrix S (nearby iron, sensor scale errors). Rotated through many orientations,
+ * the measurements lie on an ellipsoid; MagCalibrator fits it as they stream in and
+ * returns the MagCalibration that maps it back onto a sphere:
+ *
+ *     corrected = softIron * (m - hardIron),    |corrected| = fieldUt
+ *
+ * - Every sample adds its row of the linear ellipsoid model (nine coefficients, the
+ *   sum of the squared coordinates on the left, see Petrov's ellipsoid fit) to the
+ *   normal equations. This is recursive least squares in information form: adding a
+ *   sample is a fixed 54 multiply-adds, an optional forgetting factor lets the fit
+ *   follow a changing installation, and solving (a 9x9 Cholesky) is only needed
+ *   when a calibration is wanted, every MAG_CAL_REFIT_SAMPLES samples online.
+ * - softIron is the symmetric square root of the fitted ellipsoid's matrix, scaled
+ *   to keep the mean field strength in uT; it does not rotate the axes.
+ * - A fit is accepted only with enough samples, spread in all three axes (the
+ *   samples' covariance, so a rover turning only about Z is not calibrated in Z), a
+ *   real ellipsoid, a bounded axis ratio and a plausible field strength (a sensor
+ *   that was not rotated fits its noise).
+ * - AddSamples(), AddCsvFile() and AddBinaryFile() take whole logs (the CSV written
+ *   by tests/calibration/imu_mag_calibrate.cpp, or packed little endian int16 x, y,
+ *   z) without refitting in between; the files are mapped, not read line by line.
+ *
+ * Usage:
+ *     MagCalibrator calibrator;
+ *     while (imu.ReadSensorData()) {
+ *         if (calibrator.AddSample(imu.GetRawMagnetometerData())) {
+ *             imu.SetMagCalibration(calibrator.GetCalibration());
+ *         }
+ *     }
+ *     MagCalibrator::Save(calibrator.GetCalibration(), path);   // MagCalibrator::Load() at the next start
+ */
+
+#ifndef MAG_CALIBRATION_H
+#define MAG_CALIBRATION_H
+
+#include "imu.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAG_CAL_PARAMETERS 9                 // Ellipsoid model coefficients
+#define MAG_CAL_SCALE_UT 50.0                // Coordinates are fitted in units of about the earth's field
+#define MAG_CAL_MIN_SAMPLES 200              // Before the first fit
+#define MAG_CAL_REFIT_SAMPLES 100            // Online: samples between fits
+#define MAG_CAL_MIN_SPREAD 0.1               // Smallest / largest variance of the samples over the axes
+#define MAG_CAL_MAX_AXIS_RATIO 2.0           // Longest / shortest ellipsoid axis
+#define MAG_CAL_MIN_FIELD_UT 10.0            // Earth's field is 25 to 65 uT; a smaller sphere is noise
+#define MAG_CAL_MAX_FIELD_UT 150.0
+#define MAG_CAL_PIVOT_EPSILON 1e-12          // Relative Cholesky pivot below which the fit is singular
+#define MAG_CAL_NO_FORGETTING 1.0
+#define MAG_CAL_FILE_VALUES 13               // Saved: field strength, hard iron, soft iron
+
+typedef struct {
+    uint32_t samples;            // Samples added since Reset()
+    uint32_t fits;               // Accepted fits
+    uint32_t rejected;           // Fits refused (too few samples, poor spread, not a plausible ellipsoid)
+    double fieldUt;              // Field strength the calibration keeps
+    double axisRatio;            // Longest / shortest axis of the last accepted ellipsoid
+    double spread;               // Smallest / largest sample variance over the axes, at the last Fit()
+    double residualUt;           // RMS of |corrected| - fieldUt over the samples since the last fit
+} MagCalibrationStats;
+
+class MagCalibrator {
+    private:
+        double forgetting;
+        double information[MAG_CAL_PARAMETERS][MAG_CAL_PARAMETERS];   // Upper triangle used
+        double projection[MAG_CAL_PARAMETERS];
+        uint32_t pending;            // Samples since the last fit
+        bool valid;
+        MagCalibration calibration;
+        MagCalibrationStats stats;
+        double residualSum;
+        uint32_t residualCount;
+
+        void accumulate(double x, double y, double z);
+        void trackResidual(double x, double y, double z);
+
+    public:
+        MagCalibrator(double forgetting = MAG_CAL_NO_FORGETTING);
+        void Reset(void);
+
+        bool AddSample(const int16_t *raw);
+        void AddSamples(const int16_t *raw, size_t count);
+        bool AddCsvFile(const char *path);
+        bool AddBinaryFile(const char *path);
+        bool Fit(void);
+
+        bool IsValid(void) const { return valid; }
+        MagCalibration GetCalibration(void) const { return calibration; }
+        MagCalibrationStats GetStats(void) const { return stats; }
+
+        static bool Save(const MagCalibration &calibration, const char *path);
+        static bool Load(MagCalibration &calibration, const char *path);
+};
+
+#endif // MAG_CALIBRATION_H
@@ -0,0 +1,136 @@
+/*
+ * nmea_parser.h - Streaming NMEA 0183 parser that fills PVTData
+ *
+ * For receivers and recorded datasets that only speak NMEA. NmeaParser takes the
+ * raw byte stream in chunks of any size, like UbxFramer, and assembles the
+ * sentences of one navigation epoch into the PVTData that GetPvt() returns:
+ *
+ *     RMC  UTC time and date, status, position, speed and course, magnetic variation
+ *     GGA  UTC time, position, fix quality, satellites used, altitude (MSL and ellipsoid)
+ *     VTG  course and speed (knots, or km/h when knots are empty)
+ *     GSA  fix dimension
+ *
+ * Any talker (GP, GN, GL, GA, GB) is accepted; other sentences are checked and
+ * ignored, and UBX frames or noise between sentences are skipped.
+ *
+ * - Sentence and field delimiters are found 16 bytes at a time (SSE2 on x86, NEON
+ *   on ARM, a byte loop elsewhere), and every sentence must carry a matching
+ *   "*hh" checksum.
+ * - Numbers are parsed as fixed point integers, with no strtod and no locale.
+ *   Positions are exact to 1e-7 degrees (as NAV-PVT) and distances to 1 mm.
+ * - An epoch is every sentence with the same UTC time; untimed ones (VTG, GSA)
+ *   join the epoch in progress. After the first epoch the parser knows which
+ *   sentence type ends an epoch and completes each epoch as soon as that sentence
+ *   arrives. Until then, and whenever that type goes missing, an epoch completes
+ *   when the next UTC time starts.
+ * - iTOW is derived from the UTC date and time (GPS = UTC + NMEA_GPS_LEAP_SECONDS),
+ *   so fixes from NMEA sort and interpolate like fixes from NAV-PVT. Fields NMEA
+ *   does not carry (accuracies, vertical velocity) are 0.
+ *
+ * Usage:
+ *     size_t offset = 0;
+ *     while (true) {
+ *         offset += parser.Consume(&buf[offset], length - offset);
+ *         if (!parser.EpochReady()) break;   // input exhausted
+ *         handle(parser.Epoch());
+ *     }
+ *     parser.Flush();                        // at the end of a log: the last epoch
+ */
+
+#ifndef NMEA_PARSER_H
+#define NMEA_PARSER_H
+
+#include "gps.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define NMEA_START_CHAR '$'
+#define NMEA_CHECKSUM_CHAR '*'
+#define NMEA_FIELD_SEPARATOR ','
+#define NMEA_END_CHAR '\n'
+#define NMEA_MAX_SENTENCE_LENGTH 128     // 82 by the standard; longer proprietary lines fit
+#define NMEA_MAX_FIELDS 32
+#define NMEA_SCAN_BLOCK_LENGTH 16
+#define NMEA_GPS_LEAP_SECONDS 18
+#define NMEA_QUALITY_UNKNOWN 0xFF
+
+/** Delimiter scanning */
+#define NMEA_SCAN_SIMD 0                 // 16 bytes per step (scalar where no SIMD is available)
+#define NMEA_SCAN_SCALAR 1               // One byte per step
+
+/** Sentence types that contribute to an epoch */
+#define NMEA_SENTENCE_NONE 0
+#define NMEA_SENTENCE_RMC 1
+#define NMEA_SENTENCE_GGA 2
+#define NMEA_SENTENCE_VTG 3
+#define NMEA_SENTENCE_GSA 4
+
+typedef struct {
+    uint32_t sentences;          // Sentences with a valid checksum
+    uint32_t checksumFailures;   // Dropped: checksum missing or wrong
+    uint32_t overruns;           // Dropped: longer than NMEA_MAX_SENTENCE_LENGTH
+    uint32_t truncated;          // Dropped: a '$' arrived before the line ended
+    uint32_t ignored;            // Other types (GSV, GLL, TXT, ...), and RMC/GGA without a UTC time
+    uint32_t malformed;          // RMC/GGA/VTG/GSA with unusable fields
+    uint32_t late;               // Timed sentences for an epoch already completed
+    uint32_t epochs;             // Epochs completed
+    uint32_t bytesDiscarded;     // Bytes outside sentences (UBX frames, noise)
+} NmeaParserStats;
+
+class NmeaParser {
+    private:
+        char sentence[NMEA_MAX_SENTENCE_LENGTH];
+        uint16_t sentenceLength;
+        bool inSentence;
+        bool overrun;
+
+        PVTData current;             // Epoch being assembled
+        bool currentHasData;
+        bool currentHasTime;
+        int32_t currentTimeMillis;   // UTC milliseconds of the day
+        bool currentHasDate;
+        uint8_t gsaNavMode;          // GSA: 1 no fix, 2 2D, 3 3D; 0 without GSA
+        uint8_t ggaQuality;          // GGA fix quality; NMEA_QUALITY_UNKNOWN without GGA
+        char rmcStatus;              // RMC: 'A' valid, 'V' warning; 0 without RMC
+        char modeIndicator;          // RMC/VTG FAA mode (A, D, E, F, R, N); 0 if absent
+        bool hasSpeed;
+        bool hasCourse;
+        uint8_t lastSentence;        // Type last merged into the current epoch
+        uint8_t terminator;          // Type that ends an epoch; NMEA_SENTENCE_NONE until learned
+        bool afterTerminator;        // Repeats of the terminator (one GSA per GNSS) join the epoch just completed
+        bool lastEpochValid;
+        int32_t lastEpochTimeMillis;
+
+        PVTData epoch;
+        bool epochReady;
+        NmeaParserStats stats;
+
+        void handleSentence(void);
+        bool mergeRmc(const char *fields, const uint16_t *starts, uint8_t count);
+        bool mergeGga(const char *fields, const uint16_t *starts, uint8_t count);
+        bool mergeVtg(const char *fields, const uint16_t *starts, uint8_t count);
+        bool mergeGsa(const char *fields, const uint16_t *starts, uint8_t count);
+        bool startTime(int32_t timeMillis);
+        void startEpoch(void);
+        void completeEpoch(void);
+
+    public:
+        NmeaParser(void);
+        size_t Consume(const uint8_t *data, size_t length);
+        void Flush(void);
+        void Reset(void);
+        void ResetStats(void);
+
+        bool EpochReady(void) const { return epochReady; }
+        const PVTData &Epoch(void) const { return epoch; }
+        NmeaParserStats GetStats(void) const { return stats; }
+
+        static void SetScanMode(uint8_t mode);
+        static uint8_t GetScanMode(void);
+        static size_t FindEither(const uint8_t *data, size_t length, uint8_t first, uint8_t second);
+        static uint8_t SplitFields(const char *sentence, uint16_t length, uint16_t *starts, uint8_t maxFields);
+        static uint8_t Checksum(const char *data, uint16_t length);
+        static bool ParseFixed(const char *field, uint16_t length, int64_t &mantissa, uint8_t &decimals);
+};
+
+#endif // NMEA_PARSER_H
@@ -0,0 +1,100 @@
+/*
+ * pvt_history.h - Recent fixes, looked up and interpolated by GNSS or host time
+ *
+ * Sensor fusion needs the GPS state at IMU sample times, which fall between fixes.
+ * PvtHistory keeps the last PVT_HISTORY_CAPACITY fixes in a ring, one array per
+ * field (structure of arrays), keyed by unwrapped GNSS time and by host monotonic
+ * time (hostEpochNanos from the clock model). All storage is inside the object;
+ * nothing is allocated after construction.
+ *
+ * - Lookup is a binary search over the ring, O(log n).
+ * - PVT_INTERPOLATE_LINEAR blends position and velocity between the two fixes.
+ * - PVT_INTERPOLATE_HERMITE fits a cubic through both positions using the measured
+ *   velocities as end slopes, which follows turns that a straight line cuts short.
+ *   Velocity is still blended linearly.
+ * - A query up to PVT_HISTORY_MAX_EXTRAPOLATION_NANOS past the newest fix is
+ *   dead-reckoned from its velocity and flagged as extrapolated; queries before the
+ *   oldest fix, or across a gap longer than PVT_HISTORY_MAX_GAP_NANOS, fail.
+ *
+ * Positions are geodetic (degrees, metres above the ellipsoid). Velocities are
+ * converted to angular rates with the WGS84 meridian and prime-vertical radii.
+ *
+ * Not thread-safe; Gps guards its history with a mutex.
+ */
+
+#ifndef PVT_HISTORY_H
+#define PVT_HISTORY_H
+
+#include "ubx_view.h"
+#include "epoch_scheduler.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define PVT_HISTORY_CAPACITY 256                                     // Power of two; ~14 s at 18 Hz
+#define PVT_HISTORY_MAX_GAP_NANOS (2000 * NANOS_PER_MILLI)           // Longest interval interpolated across
+#define PVT_HISTORY_MAX_EXTRAPOLATION_NANOS (250 * NANOS_PER_MILLI)  // Dead reckoning past the newest fix
+#define PVT_HISTORY_WEEK_MILLIS 604800000LL
+
+#define PVT_INTERPOLATE_LINEAR 0
+#define PVT_INTERPOLATE_HERMITE 1
+
+#define WGS84_SEMI_MAJOR_AXIS 6378137.0             // metres
+#define WGS84_ECCENTRICITY_SQUARED 6.69437999014e-3
+
+typedef struct {
+    double iTOW;                 // GPS time of week (ms, fractional between fixes)
+    uint64_t hostNanos;          // Host CLOCK_MONOTONIC time (ns)
+    double latitude;             // degrees
+    double longitude;            // degrees
+    double height;               // Height above ellipsoid (m)
+    double velocityNorth;        // m/s
+    double velocityEast;         // m/s
+    double velocityDown;         // m/s
+    double horizontalAccuracy;   // m
+    double verticalAccuracy;     // m
+    uint8_t gnssFix;             // Worse fix type of the two fixes used
+    uint8_t extrapolated;        // 1 if past the newest fix
+} PvtSample;
+
+class PvtHistory {
+    static_assert((PVT_HISTORY_CAPACITY & (PVT_HISTORY_CAPACITY - 1)) == 0,
+        "PVT_HISTORY_CAPACITY must be a power of two");
+
+    private:
+        int64_t gnssNanos[PVT_HISTORY_CAPACITY];     // Unwrapped GNSS time
+        uint64_t hostNanos[PVT_HISTORY_CAPACITY];
+        double latitude[PVT_HISTORY_CAPACITY];
+        double longitude[PVT_HISTORY_CAPACITY];
+        double height[PVT_HISTORY_CAPACITY];
+        double velocityNorth[PVT_HISTORY_CAPACITY];
+        double velocityEast[PVT_HISTORY_CAPACITY];
+        double velocityDown[PVT_HISTORY_CAPACITY];
+        double horizontalAccuracy[PVT_HISTORY_CAPACITY];
+        double verticalAccuracy[PVT_HISTORY_CAPACITY];
+        uint8_t gnssFix[PVT_HISTORY_CAPACITY];
+
+        size_t head;                 // Slot of the oldest fix
+        size_t count;
+        uint32_t lastITow;
+        int64_t weekNanos;           // Unwrapped start of the newest fix's week
+
+        size_t slot(size_t index) const { return (head + index) & (PVT_HISTORY_CAPACITY - 1); }
+        template<typename T>
+        size_t upperBound(const T *keys, T key) const;
+        void fill(size_t index, double fraction, uint8_t mode, PvtSample &sample) const;
+        void extrapolate(int64_t nanos, PvtSample &sample) const;
+        bool at(int64_t gnss, size_t index, uint8_t mode, PvtSample &sample) const;
+
+    public:
+        PvtHistory(void);
+
+        void Clear(void);
+        size_t Size(void) const { return count; }
+        bool Push(const PvtSample &sample);
+        bool Push(const NavPvtView &pvt, uint64_t hostNanos);
+
+        bool AtGnssTime(double iTowMillis, PvtSample &sample, uint8_t mode) const;
+        bool AtHostTime(uint64_t hostNanos, PvtSample &sample, uint8_t mode) const;
+};
+
+#endif // PVT_HISTORY_H
@@ -0,0 +1,112 @@
+/*
+ * sim_icm20948.h - Register-level model of the ICM-20948 and its AK09916 magnetometer
+ *
+ * Used by I2cSim as a stand-in for the IMU at IMU_I2C_ADDRESS:
+ *
+ * - Four register banks of 128 bytes selected by REG_BANK_SEL (0x7F, bits 5:4), with
+ *   WHO_AM_I 0xEA and the reset values of PWR_MGMT_1 (sleep) and the full-scale
+ *   registers. Reads auto-increment the register address within the bank.
+ * - ACCEL_XOUT_H..GYRO_ZOUT_L and TEMP_OUT are sampled from the motion model when read,
+ *   scaled by the accel (ACCEL_CONFIG) and gyro (GYRO_CONFIG_1) full-scale settings, and
+ *   hold zero while PWR_MGMT_1 sleeps.
+ * - The I2C master (USER_CTRL I2C_MST_EN) talks to an AK09916 at SIM_AK09916_ADDRESS:
+ *   SLV4 performs single register writes and reads when I2C_SLV4_CTRL is enabled, and
+ *   an enabled SLV0 read copies its registers into EXT_SLV_SENS_DATA_00.. on every
+ *   sample. The AK09916 measures in continuous modes only (CNTL2).
+ * - The FIFO (USER_CTRL FIFO_EN) takes a frame at the gyro rate, 1.1 kHz / (1 +
+ *   GYRO_SMPLRT_DIV), or the accel rate when only the accelerometer is enabled: accel,
+ *   the enabled gyro axes, temperature and SLV0 data, in that order, as selected by
+ *   FIFO_EN_1 and FIFO_EN_2. It holds SIM_ICM_FIFO_SIZE bytes; in stream mode a full
+ *   FIFO drops its oldest bytes and sets INT_STATUS_2, in snapshot mode new frames are
+ *   dropped. Each frame sets RAW_DATA_0_RDY in INT_STATUS_1; both status registers
+ *   clear when read. FIFO_COUNTH/L give the byte count, FIFO_R_W pops one byte per read
+ *   without advancing the register address, and FIFO_RST empties it.
+ * - The motion model is a level sensor yawing at a constant rate in a fixed Earth
+ *   field, plus a hard-iron offset and Gaussian noise. The AK09916 is sampled with
+ *   every ICM-20948 sample, whatever its CNTL2 rate.
+ *
+ * Times are I2cSim virtual CLOCK_MONOTONIC nanoseconds.
+ */
+
+#ifndef SIM_ICM20948_H
+#define SIM_ICM20948_H
+
+#include <stdint.h>
+#include <random>
+
+#define SIM_ICM_BANKS 4
+#define SIM_ICM_BANK_SIZE 128
+#define SIM_ICM_REG_BANK_SEL 0x7F
+#define SIM_ICM_WHO_AM_I_VALUE 0xEA
+#define SIM_AK09916_ADDRESS 0x0C
+#define SIM_AK09916_WIA2_VALUE 0x09
+#define SIM_ICM_FIFO_SIZE 512
+
+typedef struct {
+    double yawRate;              // rad/s about Z
+    double gyroBias[3];          // rad/s
+    double accelBias[3];         // m/s^2
+    double magField[3];          // uT in the level frame at yaw 0 (north, east, down)
+    double magHardIron[3];       // uT added in the sensor frame
+    double gyroNoise;            // rad/s, standard deviation
+    double accelNoise;           // m/s^2
+    double magNoise;             // uT
+    double temperature;          // degrees C
+} SimIcm20948Config;
+
+#define SIM_ICM20948_DEFAULT_CONFIG {0.2, {0.01, -0.005, 0.008}, {0.05, -0.02, 0.1}, \
+    {22.0, 5.0, 42.0}, {12.0, -7.0, 3.0}, 0.002, 0.02, 0.3, 25.0}
+
+typedef struct {
+    uint32_t registerReads;      // Bytes read from the ICM-20948
+    uint32_t registerWrites;     // Bytes written
+    uint32_t samples;            // Motion model evaluations
+    uint32_t slaveTransfers;     // SLV0/SLV4 transfers to the AK09916
+    uint32_t fifoFrames;         // Frames written to the FIFO
+    uint32_t fifoOverflows;      // Frames that did not fit (stream: oldest bytes dropped)
+} SimIcm20948Stats;
+
+class SimIcm20948 {
+    private:
+        SimIcm20948Config config;
+        SimIcm20948Stats stats;
+        uint8_t banks[SIM_ICM_BANKS][SIM_ICM_BANK_SIZE];
+        uint8_t bank;
+        uint8_t registerPointer;
+        uint8_t magnetometer[0x40];  // AK09916 registers
+        uint64_t powerOnNanos;
+        uint8_t fifo[SIM_ICM_FIFO_SIZE];
+        uint16_t fifoHead;
+        uint16_t fifoCount;
+        uint64_t fifoNextNanos;      // Time of the next frame; 0 while the FIFO is off
+        std::mt19937 random;
+        std::normal_distribution<double> noise;
+
+        uint8_t &reg(uint8_t address) { return banks[bank][address & 0x7F]; }
+        void reset(void);
+        void sample(uint64_t nowNanos);
+        void writeRegister(uint8_t address, uint8_t value, uint64_t nowNanos);
+        void slave4Transfer(void);
+        void slave0Read(void);
+        bool fifoEnabled(void) const;
+        uint8_t fifoFrameLength(void) const;
+        uint64_t fifoPeriodNanos(void) const;
+        void updateFifo(uint64_t nowNanos);
+        void pushFifoFrame(void);
+        uint8_t popFifo(void);
+
+    public:
+        SimIcm20948(void);
+
+        void Configure(const SimIcm20948Config &config, uint32_t seed, uint64_t nowNanos);
+        SimIcm20948Config GetConfig(void) const { return config; }
+
+        void Write(const uint8_t *data, uint16_t length, uint64_t nowNanos);
+        void Read(uint8_t *data, uint16_t length, uint64_t nowNanos);
+
+        double AccelScale(void) const;   // m/s^2 per LSB at the configured full scale
+        double GyroScale(void) const;    // rad/s per LSB
+        SimIcm20948Stats GetStats(void) const { return stats; }
+};
+
+#endif // SIM_ICM20948_H
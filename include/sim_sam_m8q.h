@@ -0,0 +1,154 @@
+/*
+ * sim_sam_m8q.h - Register-level model of the SAM-M8Q DDC (I2C) and UART1 ports
+ *
+ * Used by I2cSim as a stand-in for the receiver at GPS_I2C_ADDRESS:
+ *
+ * - Registers 0xFD/0xFE hold the number of queued output bytes (big endian) and
+ *   0xFF is the output stream; reading an empty stream returns 0xFF. A one-byte write
+ *   sets the register pointer, which auto-increments up to 0xFF and stays there.
+ *   Longer writes are UBX input, as the driver writes frames without a register byte.
+ * - SetPort(PORT_ID_UART1) models UART1 instead: WriteStream() and ReadStream() carry
+ *   the raw byte stream (no registers, no filler) and periodic output follows the
+ *   UART1 column of CFG-MSG. BaudRate() is the rate last set with CFG-PRT.
+ * - CFG-PRT, CFG-MSG, CFG-RATE, CFG-GNSS and CFG-NAVX5 are stored and returned on a
+ *   poll; every CFG message is answered with ACK-ACK (or ACK-NAK for a bad payload
+ *   or an unsupported rate). CFG-CFG is acknowledged and otherwise ignored.
+ * - NAV-PVT and NAV-STATUS are output once per navigation solution at their CFG-MSG
+ *   DDC rate, outputLatencyNanos after the solution's GPS time, and answered at once
+ *   when polled. The solution drives a circle around the configured origin.
+ * - When CFG-PRT has NMEA output on, RMC, VTG, GGA and GSA (one per GPS and GLONASS,
+ *   GN talker) of the same solution follow at their CFG-MSG rates, which are 0 until
+ *   configured.
+ * - The fix is valid ttffColdSeconds after power-up; MGA-INI time and position make
+ *   it an aided start and a restored MGA-DBD database a hot start. MGA-DBD polls are
+ *   answered with the database (generated at the first fix) and MGA-ACK-DATA0
+ *   carrying the message count; with CFG-NAVX5 ackAiding every MGA message is
+ *   answered with MGA-ACK-DATA0.
+ * - Output beyond bufferBytes is dropped, as on the receiver.
+ *
+ * Times are I2cSim virtual CLOCK_MONOTONIC nanoseconds.
+ */
+
+#ifndef SIM_SAM_M8Q_H
+#define SIM_SAM_M8Q_H
+
+#include "ubx_framer.h"
+#include "ubx_view.h"
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <vector>
+
+#define SIM_GPS_REG_COUNT_MSB 0xFD
+#define SIM_GPS_REG_STREAM 0xFF
+#define SIM_GPS_EMPTY_STREAM_BYTE 0xFF
+
+#define SIM_GPS_TTFF_COLD_SECONDS 26       // As COLD_START_TTFF_SECONDS
+#define SIM_GPS_TTFF_AIDED_SECONDS 2       // As AIDED_START_TTFF_SECONDS
+#define SIM_GPS_TTFF_HOT_SECONDS 1         // As HOT_START_TTFF_SECONDS
+#define SIM_GPS_DBD_MESSAGES 96            // Database handed out after the first fix
+#define SIM_GPS_DBD_PAYLOAD_LENGTH 52
+#define SIM_GPS_LEAP_SECONDS 18
+#define SIM_GPS_EPOCH_UNIX_SECONDS 315964800LL   // 1980-01-06T00:00:00Z
+#define SIM_GPS_WEEK_MILLIS 604800000ULL
+#define SIM_GPS_SATELLITES 12
+
+typedef struct {
+    int64_t startUtcSeconds;        // UTC at power-up (virtual time 0 of the receiver)
+    uint32_t outputLatencyNanos;    // Solution readable this long after its epoch
+    uint32_t bufferBytes;           // DDC output buffer
+    uint16_t ttffColdSeconds;
+    double latitude;                // Centre of the simulated drive, degrees
+    double longitude;
+    double height;                  // m above the ellipsoid
+    double radius;                  // m; 0 keeps the receiver still
+    double speed;                   // m/s along the circle
+} SimSamM8qConfig;
+
+#define SIM_SAM_M8Q_DEFAULT_CONFIG {1717200000LL, 30000000, 4096, SIM_GPS_TTFF_COLD_SECONDS, \
+    34.0205, -118.2854, 95.0, 20.0, 2.0}   // 2024-06-01T00:00:00Z
+
+typedef struct {
+    uint32_t framesIn;              // UBX frames written to the receiver
+    uint32_t acks;
+    uint32_t naks;
+    uint32_t solutions;             // Navigation epochs computed
+    uint32_t messagesOut;           // Frames queued for output
+    uint32_t messagesDropped;       // Frames lost to a full output buffer
+    uint32_t mgaAccepted;           // MGA messages applied
+    uint32_t sentencesOut;          // NMEA sentences queued for output
+    uint32_t ttffMillis;            // Power-up to first valid fix; 0 before it
+} SimSamM8qStats;
+
+class SimSamM8q {
+    private:
+        typedef struct {
+            bool fix;
+            double latitude;            // degrees
+            double longitude;
+            double velocityNorth;       // m/s
+            double velocityEast;
+            double speed;
+            double heading;             // degrees, 0..360
+        } Solution;
+
+        SimSamM8qConfig config;
+        SimSamM8qStats stats;
+        uint8_t registerPointer;
+        uint8_t port;                   // PORT_ID_DDC or PORT_ID_UART1
+        UbxFramer framer;
+        std::deque<uint8_t> output;
+        std::map<uint32_t, std::vector<uint8_t>> cfg;   // Stored CFG payloads by cfgKey()
+        std::vector<std::vector<uint8_t>> database;     // MGA-DBD frames
+        uint64_t powerOnNanos;
+        uint64_t startGpsNanos;         // GPS time at powerOnNanos
+        uint64_t fixDueNanos;
+        uint64_t nextEpochGpsNanos;     // GPS time of the next solution
+        uint64_t lastEpochGpsNanos;
+        bool timeKnown;
+        bool positionKnown;
+
+        static uint32_t cfgKey(uint8_t msgId, const uint8_t *key, uint16_t keyLength);
+        const std::vector<uint8_t> &cfgPayload(uint32_t key);
+        void loadDefaults(void);
+        uint64_t gpsNanos(uint64_t nowNanos) const;
+        uint64_t solutionPeriodNanos(void);
+        uint8_t outputRate(uint8_t msgClass, uint8_t msgId);
+        bool ackAiding(void);
+        bool outputsProtocol(uint16_t protocol);
+        bool noteFix(uint64_t epochGpsNanos);
+        Solution solutionAt(uint64_t epochGpsNanos) const;
+
+        void send(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length);
+        void sendAck(uint8_t msgClass, uint8_t msgId, bool ack);
+        void sendMgaAck(uint8_t msgId, bool accepted, const uint8_t *payload);
+        void sendNavPvt(uint64_t epochGpsNanos, uint64_t nowNanos);
+        void sendNavStatus(uint64_t epochGpsNanos, uint64_t nowNanos);
+        void sendNmea(uint64_t epochGpsNanos, uint64_t index);
+        void sendSentence(const char *body);
+        void receive(const UbxMessageView &msg, uint64_t nowNanos);
+        void receiveCfg(const UbxMessageView &msg);
+        void receiveMga(const UbxMessageView &msg, uint64_t nowNanos);
+        void shortenTtff(uint64_t nowNanos, uint16_t seconds);
+
+    public:
+        SimSamM8q(void);
+
+        void Configure(const SimSamM8qConfig &config, uint64_t nowNanos);
+        SimSamM8qConfig GetConfig(void) const { return config; }
+        void PowerCycle(uint64_t nowNanos);
+        void Advance(uint64_t nowNanos);
+
+        void Write(const uint8_t *data, uint16_t length, uint64_t nowNanos);
+        void Read(uint8_t *data, uint16_t length, uint64_t nowNanos);
+
+        void SetPort(uint8_t portId) { port = portId; }
+        void WriteStream(const uint8_t *data, uint16_t length, uint64_t nowNanos);
+        uint16_t ReadStream(uint8_t *data, uint16_t length, uint64_t nowNanos);
+        uint32_t BaudRate(void);
+
+        bool HasFix(uint64_t nowNanos) const { return nowNanos >= fixDueNanos; }
+        SimSamM8qStats GetStats(void) const { return stats; }
+};
+
+#endif // SIM_SAM_M8Q_H
@@ -0,0 +1,70 @@
+/*
+ * spsc_ring.h - Bounded single-producer/single-consumer lock-free ring buffer
+ *
+ * One thread may call Push() and one (other) thread may call Pop(); neither ever
+ * blocks or takes a lock. Capacity must be a power of two. Items are copied in and
+ * out, so T should be a small trivially copyable struct (e.g. PVTData).
+ *
+ * Head and tail live on separate cache lines so the producer and consumer do not
+ * bounce the same line between cores on every operation.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+
+#define SPSC_CACHE_LINE_SIZE 64
+
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+        "SpscRing capacity must be a power of two");
+
+    private:
+        alignas(SPSC_CACHE_LINE_SIZE) std::atomic<size_t> head;   // Next slot to pop (consumer owned)
+        alignas(SPSC_CACHE_LINE_SIZE) std::atomic<size_t> tail;   // Next slot to push (producer owned)
+        alignas(SPSC_CACHE_LINE_SIZE) T items[Capacity];
+
+    public:
+        SpscRing(void) : head(0), tail(0) {}
+
+        /**
+         * @brief   Append an item. Producer thread only.
+         * @return  false if the ring is full (the item is not stored).
+         */
+        bool Push(const T &item) {
+            size_t currentTail = tail.load(std::memory_order_relaxed);
+            if (currentTail - head.load(std::memory_order_acquire) == Capacity) {
+                return false;
+            }
+            items[currentTail & (Capacity - 1)] = item;
+            tail.store(currentTail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief   Remove the oldest item. Consumer thread only.
+         * @return  false if the ring is empty (item is left untouched).
+         */
+        bool Pop(T &item) {
+            size_t currentHead = head.load(std::memory_order_relaxed);
+            if (currentHead == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = items[currentHead & (Capacity - 1)];
+            head.store(currentHead + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** Number of queued items; exact only when called from the producer or consumer. */
+        size_t Size(void) const {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+
+        bool Empty(void) const { return Size() == 0; }
+        static constexpr size_t GetCapacity(void) { return Capacity; }
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,126 @@
+/*
+ * ubx_assist.h - Navigation database save/restore for hot starts (MGA-DBD, MGA-INI)
+ *
+ * A receiver that loses backup power forgets its ephemerides, almanac, time and
+ * position, so every power cycle is a cold start (COLD_START_TTFF_SECONDS). The
+ * receiver can hand out its navigation database as a series of UBX-MGA-DBD messages
+ * and take the same messages back later; together with the current time
+ * (MGA-INI-TIME_UTC) and the last position (MGA-INI-POS_LLH) that turns the next start
+ * into a hot or aided start.
+ *
+ * - UbxNavDatabase holds the MGA-DBD messages of one dump and the last good NAV-PVT,
+ *   and saves/loads them as a plain UBX file: the frames back to back, as u-center
+ *   writes them. Save() writes a temporary file and renames it over the old one, so a
+ *   power cut while saving leaves the previous database intact.
+ * - A dump is complete when the receiver sends UBX-MGA-ACK-DATA0 for MGA-DBD, which
+ *   carries the number of MGA-DBD messages it sent; if that never arrives the dump
+ *   ends after ASSIST_DUMP_IDLE_MILLS without a new message.
+ * - UbxAssistUpload sends a list of MGA frames with flow control. With CFG-NAVX5
+ *   ackAiding on, the receiver answers every MGA message with MGA-ACK-DATA0 in order,
+ *   and at most ASSIST_ACK_WINDOW messages are in flight. If no ACK arrives within
+ *   ASSIST_ACK_TIMEOUT_MILLS the rest is paced ASSIST_PACING_MILLS apart instead, so
+ *   the receiver's input buffer does not overflow.
+ *
+ * As with UbxConfigTransaction these classes only keep the books; Gps does the I/O
+ * (SaveNavigationDatabase(), RestoreNavigationDatabase()).
+ */
+
+#ifndef UBX_ASSIST_H
+#define UBX_ASSIST_H
+
+#include "ubx_msg.h"
+#include "ubx_view.h"
+#include "ubx_framer.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <vector>
+
+#define ASSIST_MAX_DBD_MESSAGES 1024       // Far more than an M8 database holds
+#define ASSIST_DUMP_TIMEOUT_MILLS 10000    // Longest dump, ~60 KB at 400 kHz takes under 2 s
+#define ASSIST_DUMP_IDLE_MILLS 1000        // Dump over after this long without an MGA-DBD
+#define ASSIST_ACK_WINDOW 8                // MGA messages in flight before waiting for MGA-ACK
+#define ASSIST_ACK_TIMEOUT_MILLS 1000      // No MGA-ACK this long: pace instead of waiting
+#define ASSIST_PACING_MILLS 10             // Gap between messages when the receiver does not ACK
+#define ASSIST_IDLE_MILLS 2                // Sleep between empty reads while waiting
+
+#define ASSIST_POSITION_MARGIN_CM 100000   // Added to the saved accuracy: the rover may move while off
+#define ASSIST_TIME_ACCURACY_MILLIS 2000   // Assumed accuracy of the host clock (RTC or NTP)
+#define ASSIST_LEAP_SECONDS_UNKNOWN -128
+
+#define MGA_INI_TYPE_POS_LLH 0x01
+#define MGA_INI_TYPE_TIME_UTC 0x10
+#define MGA_ACK_TYPE_ACCEPTED 1
+#define CFG_NAVX5_VERSION 2
+#define CFG_NAVX5_MASK1_ACK_AIDING 0x0400
+
+#define ASSIST_NAV_PVT_FRAME_LENGTH (UBX_FRAME_OVERHEAD + NAV_PVT_PAYLOAD_LENGTH)
+
+typedef struct {
+    uint16_t sent;               // MGA messages written
+    uint16_t accepted;           // Acknowledged as used
+    uint16_t rejected;           // Acknowledged as not used (e.g. stale data)
+    uint16_t unconfirmed;        // Sent without an answer (receiver not ACKing, or timed out)
+    uint8_t lastInfoCode;        // MGA-ACK infoCode of the last rejection
+    uint32_t bytes;              // Frame bytes written
+    uint32_t elapsedMillis;      // Wall time of the whole upload
+} UbxAssistStats;
+
+/** One MGA-DBD dump and the last fix, as stored between power cycles */
+class UbxNavDatabase {
+    private:
+        std::vector<uint8_t> dbd;    // MGA-DBD frames back to back
+        uint16_t dbdCount;
+        uint8_t lastFix[ASSIST_NAV_PVT_FRAME_LENGTH];
+        bool lastFixValid;
+
+    public:
+        UbxNavDatabase(void);
+
+        void Clear(void);
+        bool AddDbd(const UbxMessageView &msg);
+        bool SetLastFix(const NavPvtView &pvt);
+
+        uint16_t DbdCount(void) const { return dbdCount; }
+        size_t DbdBytes(void) const { return dbd.size(); }
+        const uint8_t *DbdFrames(void) const { return dbd.data(); }
+        bool HasLastFix(void) const { return lastFixValid; }
+        NavPvtView LastFix(void) const { return NavPvtView(UbxMessageView(lastFix)); }
+
+        bool Save(const char *path) const;
+        bool Load(const char *path);
+};
+
+/** MGA frames to send, and their MGA-ACK-DATA0 answers matched in order */
+class UbxAssistUpload {
+    private:
+        std::vector<uint8_t> frames;
+        std::vector<uint32_t> offsets;   // Start of each frame in frames
+        size_t next;                     // Frames sent
+        size_t answered;                 // Frames acknowledged or given up on
+        bool paced;
+        UbxAssistStats stats;
+
+    public:
+        UbxAssistUpload(void);
+
+        void Clear(void);
+        bool Add(const uint8_t *frame, uint16_t length);
+        size_t AddFrames(const uint8_t *data, size_t length);
+        size_t Count(void) const { return offsets.size(); }
+
+        bool CanSend(void) const;
+        const uint8_t *Next(uint16_t &length);
+        bool OnAck(const UbxMessageView &msg);
+        bool AcksOutstanding(void) const { return answered < next; }
+        bool Done(void) const { return next == Count() && !AcksOutstanding(); }
+        void StopWaitingForAcks(void);
+        bool Paced(void) const { return paced; }
+        UbxAssistStats GetStats(void) const { return stats; }
+        void SetElapsed(uint32_t millis) { stats.elapsedMillis = millis; }
+};
+
+uint16_t ComposeIniPosition(uint8_t *frame, const NavPvtView &fix, uint32_t marginCm);
+uint16_t ComposeIniTime(uint8_t *frame, const struct timespec &utc, uint32_t accuracyMillis);
+
+#endif // UBX_ASSIST_H
@@ -0,0 +1,169 @@
+/*
+ * ubx_batch.h - Parallel decoding of recorded NAV-PVT into columns
+ *
+ * Post-mission analysis needs days of 10-18 Hz NAV-PVT decoded at disk speed rather
+ * than one GetPvt() at a time. UbxBatchDecoder maps a capture (ubx_capture.h) or a raw
+ * UBX byte stream read-only and decodes it on all cores:
+ *
+ * - The RX records of a capture are indexed once into spans of the received byte
+ *   stream, so frames split across two reads are reassembled exactly as live.
+ * - The stream is cut into equal chunks at arbitrary byte positions. Every chunk is
+ *   scanned independently for SYNC_CHAR_1 SYNC_CHAR_2, and a candidate is accepted
+ *   only if its length is sane and its Fletcher checksum matches; otherwise the scan
+ *   moves on by one byte (as UbxFramer rescans). A chunk owns the frames that start
+ *   inside it and reads past its end to finish the last one.
+ * - Chunk edges are reconciled after the scan: frames of a chunk that start before the
+ *   end of the previous chunk's last frame were false syncs inside that frame and are
+ *   dropped. If such a false frame runs past that end, the scan lost sync there and the
+ *   chunk is rescanned from the end of the previous frame. The result is identical to
+ *   a single sequential scan.
+ * - Each chunk decodes NAV-PVT into its own structure of arrays (one contiguous column
+ *   per PVTData field); the columns are concatenated in stream order. newFix and
+ *   hostEpochNanos (GnssClockEstimator, causal as on the live receiver) are filled in
+ *   by one sequential pass at the end.
+ *
+ * WritePvtColumns() stores the columns in a flat file that numpy.memmap can open
+ * without parsing:
+ *
+ *     header       "PVTCOL01" (8 bytes), column count (u4), header length (u4), rows (u8)
+ *     descriptor   name (24 bytes, NUL padded), NumPy dtype (8 bytes, e.g. "<u4"),
+ *                  data offset (u8)                       -- one per column
+ *     data         each column contiguous, starting on a PVT_COLUMNS_ALIGNMENT boundary
+ *
+ * tests/gps_tests/load_pvt_columns.py loads such a file into a dict of arrays.
+ */
+
+#ifndef UBX_BATCH_H
+#define UBX_BATCH_H
+
+#include "gps.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define UBX_BATCH_CHUNKS_PER_THREAD 4          // Chunks per worker, to balance uneven chunks
+#define UBX_BATCH_MIN_CHUNK_LENGTH (1 << 20)   // Smaller chunks are not worth a thread
+
+#define PVT_COLUMNS_MAGIC "PVTCOL01"
+#define PVT_COLUMNS_MAGIC_LENGTH 8
+#define PVT_COLUMNS_HEADER_LENGTH 24
+#define PVT_COLUMN_NAME_LENGTH 24
+#define PVT_COLUMN_DTYPE_LENGTH 8
+#define PVT_COLUMN_DESCRIPTOR_LENGTH 40
+#define PVT_COLUMNS_ALIGNMENT 64
+
+/** Every PVTData field as (type, name, NumPy dtype), in struct order */
+#define PVT_COLUMN_LIST(X) \
+    X(uint32_t, iTOW, "<u4") \
+    X(uint16_t, year, "<u2") \
+    X(uint8_t, month, "u1") \
+    X(uint8_t, day, "u1") \
+    X(uint8_t, hour, "u1") \
+    X(uint8_t, min, "u1") \
+    X(uint8_t, sec, "u1") \
+    X(int32_t, nano, "<i4") \
+    X(uint32_t, timeAccuracy, "<u4") \
+    X(uint64_t, hostReceiveNanos, "<u8") \
+    X(uint64_t, hostEpochNanos, "<u8") \
+    X(uint8_t, validTimeFlag, "u1") \
+    X(uint8_t, validDateFlag, "u1") \
+    X(uint8_t, fullyResolved, "u1") \
+    X(uint8_t, validMagFlag, "u1") \
+    X(uint8_t, newFix, "u1") \
+    X(uint8_t, gnssFix, "u1") \
+    X(uint8_t, fixStatusFlags, "u1") \
+    X(uint8_t, numberOfSatellites, "u1") \
+    X(double, longitude, "<f8") \
+    X(double, latitude, "<f8") \
+    X(int32_t, height, "<i4") \
+    X(int32_t, heightMSL, "<i4") \
+    X(uint32_t, horizontalAccuracy, "<u4") \
+    X(uint32_t, verticalAccuracy, "<u4") \
+    X(int32_t, velocityNorth, "<i4") \
+    X(int32_t, velocityEast, "<i4") \
+    X(int32_t, velocityDown, "<i4") \
+    X(int32_t, groundSpeed, "<i4") \
+    X(double, vehicalHeading, "<f8") \
+    X(double, motionHeading, "<f8") \
+    X(uint32_t, speedAccuracy, "<u4") \
+    X(double, motionHeadingAccuracy, "<f8") \
+    X(double, magneticDeclination, "<f8") \
+    X(double, magnetDeclinationAccuracy, "<f8")
+
+/** Structure of arrays: row i of every column belongs to the same NAV-PVT */
+struct PvtColumns {
+#define PVT_COLUMN_MEMBER(type, name, dtype) std::vector<type> name;
+    PVT_COLUMN_LIST(PVT_COLUMN_MEMBER)
+#undef PVT_COLUMN_MEMBER
+
+    size_t Rows(void) const { return iTOW.size(); }
+    void Clear(void);
+    void Reserve(size_t rows);
+    void Append(const PVTData &data);
+    void Append(const PvtColumns &other, size_t first);
+};
+
+/** Received bytes of one capture record, placed in the reassembled stream */
+typedef struct {
+    uint64_t streamOffset;       // Position of bytes[0] in the stream
+    const uint8_t *bytes;
+    size_t length;
+    uint64_t hostNanos;          // Recorded read time (0 for raw UBX files)
+} UbxStreamSpan;
+
+typedef struct {
+    uint64_t streamBytes;        // Bytes of UBX stream scanned
+    uint32_t spans;              // Capture records indexed (1 for raw UBX)
+    uint32_t chunks;             // Chunks scanned
+    uint32_t threads;            // Worker threads used
+    uint32_t rescannedChunks;    // Chunks that lost sync at their start and were rescanned
+    uint64_t frames;             // Frames with a valid checksum
+    uint64_t rows;               // NAV-PVT decoded
+    uint64_t checksumFailures;   // Candidates dropped (false syncs near chunk edges may count twice)
+} UbxBatchStats;
+
+class UbxBatchDecoder {
+    private:
+        const uint8_t *data;
+        size_t size;
+        std::vector<UbxStreamSpan> spans;
+        uint64_t streamLength;
+        UbxBatchStats stats;
+
+        struct LeadFrame {
+            uint64_t start;
+            uint64_t end;
+            size_t rowsAfter;            // Rows decoded up to and including this frame
+            uint64_t framesAfter;
+        };
+
+        struct ChunkResult {
+            uint64_t start;
+            uint64_t end;
+            PvtColumns columns;
+            std::vector<LeadFrame> lead;     // Frames that may overlap the previous chunk's last one
+            uint64_t lastEnd;                // End of the last frame accepted, 0 if none
+            uint64_t frames;
+            uint64_t checksumFailures;
+        };
+
+        bool indexCapture(void);
+        size_t findSpan(uint64_t position) const;
+        uint64_t findSync(uint64_t position, size_t &span) const;
+        const uint8_t *gather(uint64_t position, size_t length, size_t span, uint8_t *scratch) const;
+        void scanChunk(ChunkResult &chunk) const;
+        void fillHostTiming(PvtColumns &columns) const;
+
+    public:
+        UbxBatchDecoder(void);
+        ~UbxBatchDecoder(void);
+
+        bool Open(const char *path);
+        void Close(void);
+        bool Decode(PvtColumns &columns, uint32_t threads);
+        UbxBatchStats GetStats(void) const { return stats; }
+};
+
+bool WritePvtColumns(const char *path, const PvtColumns &columns);
+
+#endif // UBX_BATCH_H
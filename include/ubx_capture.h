@@ -0,0 +1,95 @@
+/*
+ * ubx_capture.h - Record the raw receiver byte stream and replay it later
+ *
+ * A capture file holds exactly what the driver exchanged with the receiver, so field
+ * problems can be reproduced on a machine without a GPS attached:
+ *
+ *     header   "UBXCAP01" (8 bytes), header length (u4), reserved (u4)
+ *     record   host CLOCK_MONOTONIC time (u8, ns), length (u2), direction (u1),
+ *              reserved (u1), followed by length bytes
+ *
+ * All integers are little-endian. There is one RX record per drain of the data stream
+ * register, stamped when the read completed, and one TX record per frame written.
+ *
+ * UbxCaptureWriter appends records through a buffered FILE. UbxCaptureReader maps the
+ * whole file read-only and hands out RX records without copying them through the
+ * kernel again; TX records are skipped. In CAPTURE_REPLAY_REALTIME mode each record
+ * becomes readable at its original spacing from the start of the replay, in
+ * CAPTURE_REPLAY_FAST mode every record is readable immediately. A record cut short by
+ * the end of the file (recording interrupted) ends the replay.
+ */
+
+#ifndef UBX_CAPTURE_H
+#define UBX_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define UBX_CAPTURE_MAGIC "UBXCAP01"
+#define UBX_CAPTURE_MAGIC_LENGTH 8
+#define UBX_CAPTURE_HEADER_LENGTH 16
+#define UBX_CAPTURE_RECORD_HEADER_LENGTH 12
+#define UBX_CAPTURE_FILE_BUFFER 65536      // stdio buffer of the writer
+
+#define CAPTURE_RECORD_RX 0                // Bytes read from the receiver
+#define CAPTURE_RECORD_TX 1                // Frame written to the receiver
+
+#define CAPTURE_REPLAY_REALTIME 0          // Records readable at their recorded spacing
+#define CAPTURE_REPLAY_FAST 1              // Records readable as soon as they are asked for
+
+typedef struct {
+    uint32_t records;            // Records written or replayed
+    uint64_t bytes;              // Payload bytes in those records
+    uint32_t errors;             // Failed writes (writer only)
+} UbxCaptureStats;
+
+class UbxCaptureWriter {
+    private:
+        FILE *file;
+        UbxCaptureStats stats;
+
+    public:
+        UbxCaptureWriter(void);
+        ~UbxCaptureWriter(void);
+
+        bool Open(const char *path);
+        void Close(void);
+        bool IsOpen(void) const { return file != nullptr; }
+        bool Write(uint8_t direction, uint64_t hostNanos, const uint8_t *data, uint16_t length);
+        UbxCaptureStats GetStats(void) const { return stats; }
+};
+
+class UbxCaptureReader {
+    private:
+        const uint8_t *data;
+        size_t size;
+        uint8_t mode;
+
+        size_t offset;               // Header of the current RX record, size at the end
+        uint16_t consumed;           // Bytes of the current record already read
+        uint64_t firstNanos;         // Recorded time of the first record
+        uint64_t startNanos;         // Host time the replay started, 0 until the first read
+        UbxCaptureStats stats;
+
+        void skipToRx(void);
+        uint64_t recordNanos(void) const;
+        uint16_t recordLength(void) const;
+
+    public:
+        UbxCaptureReader(void);
+        ~UbxCaptureReader(void);
+
+        bool Open(const char *path, uint8_t mode);
+        void Close(void);
+        bool IsOpen(void) const { return data != nullptr; }
+        void Rewind(void);
+        bool AtEnd(void) const { return offset >= size; }
+
+        uint16_t Available(uint64_t nowNanos);
+        uint16_t Read(uint8_t *buf, uint16_t length, uint64_t &hostNanos);
+        uint64_t NextReadableNanos(uint64_t nowNanos) const;
+        UbxCaptureStats GetStats(void) const { return stats; }
+};
+
+#endif // UBX_CAPTURE_H
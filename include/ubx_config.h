@@ -0,0 +1,90 @@
+/*
+ * ubx_config.h - Pipelined, acknowledged UBX-CFG transactions
+ *
+ * A UbxConfigTransaction collects the CFG messages that should be in effect on the
+ * receiver and tracks their progress through two pipelined phases:
+ *
+ * 1. Poll:  every pollable entry's poll request is sent back to back, and the
+ *           responses are compared with the desired payload. Entries that already
+ *           match are marked CONFIG_STATUS_SKIPPED and are never written.
+ * 2. Write: all remaining entries are sent back to back and each UBX-ACK-ACK /
+ *           UBX-ACK-NAK is matched to the oldest outstanding entry with the same
+ *           class/id (the receiver answers CFG messages in order).
+ *
+ * This class only does the bookkeeping; the Gps class performs the I/O and feeds
+ * received frames to OnPollResponse() and OnAck().
+ */
+
+#ifndef UBX_CONFIG_H
+#define UBX_CONFIG_H
+
+#include "ubx_msg.h"
+#include "ubx_view.h"
+#include <stdint.h>
+
+#define CONFIG_MAX_ENTRIES 12
+#define CONFIG_MAX_PAYLOAD_LENGTH 64   // Largest CFG payload sent (CFG-PRT is 20 bytes)
+#define CONFIG_MAX_POLL_LENGTH 2       // Poll key bytes (CFG-PRT port id, CFG-MSG class/id)
+
+#define CONFIG_STATUS_PENDING 0        // Not written yet
+#define CONFIG_STATUS_SENT 1           // Written, waiting for an ACK
+#define CONFIG_STATUS_ACKED 2          // Receiver acknowledged the write
+#define CONFIG_STATUS_NAKED 3          // Receiver rejected the write
+#define CONFIG_STATUS_SKIPPED 4        // Receiver already had this configuration
+#define CONFIG_STATUS_TIMEOUT 5        // No ACK/NAK arrived in time
+
+#define CONFIG_ACK_TIMEOUT_MILLS 1000  // The receiver answers CFG messages within one second
+#define CONFIG_POLL_ACK_GRACE_MILLS 20 // Extra wait for poll ACKs once all responses arrived
+#define CONFIG_IDLE_MILLS 2            // Sleep between empty reads while waiting for answers
+
+/** CFG-CFG: save the current configuration to all non-volatile devices */
+#define CFG_CFG_SAVE_MASK 0x0000061F   // ioPort, msgConf, infMsg, navConf, rxmConf, antConf, logConf
+#define CFG_CFG_DEVICE_MASK 0x17       // BBR, Flash, EEPROM, SPI Flash
+
+typedef struct {
+    uint8_t msgClass;
+    uint8_t msgId;
+    uint8_t payload[CONFIG_MAX_PAYLOAD_LENGTH];
+    uint16_t payloadLength;
+    uint8_t poll[CONFIG_MAX_POLL_LENGTH];   // Payload of the poll request / key of its response
+    uint16_t pollLength;
+    bool pollable;
+    bool polled;                            // A poll response was received
+    uint8_t outstandingAcks;                // Poll and write ACKs not received yet
+    uint8_t status;
+} UbxConfigEntry;
+
+typedef struct {
+    uint16_t written;            // CFG messages written
+    uint16_t skipped;            // CFG messages skipped because the receiver already matched
+    uint16_t acked;              // Writes acknowledged
+    uint16_t naked;              // Writes rejected
+    uint16_t timeouts;           // Writes with no answer
+    uint32_t elapsedMillis;      // Wall time of the whole transaction
+} UbxConfigStats;
+
+class UbxConfigTransaction {
+    private:
+        UbxConfigEntry entries[CONFIG_MAX_ENTRIES];
+        uint8_t count;
+
+    public:
+        UbxConfigTransaction(void) : count(0) {}
+
+        bool Add(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t payloadLength,
+            const uint8_t *poll, uint16_t pollLength, bool pollable);
+        uint8_t Count(void) const { return count; }
+        UbxConfigEntry &Entry(uint8_t index) { return entries[index]; }
+        const UbxConfigEntry &Entry(uint8_t index) const { return entries[index]; }
+
+        bool OnPollResponse(const UbxMessageView &msg);
+        bool OnAck(const UbxMessageView &msg);
+
+        bool PollsAnswered(void) const;
+        bool AcksOutstanding(void) const;
+        void ExpireOutstanding(void);
+        bool Succeeded(void) const;
+        UbxConfigStats Summarize(void) const;
+};
+
+#endif // UBX_CONFIG_H
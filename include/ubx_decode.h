@@ -0,0 +1,118 @@
+/*
+ * ubx_decode.h - Decoders for the UBX status messages besides NAV-PVT
+ *
+ * Each decoder checks class, id and payload length against the message schema
+ * (ubx_schema.h) and fills a fixed-capacity struct; nothing is allocated, so the
+ * decoders can run at the full navigation rate from the reading thread.
+ *
+ * Decoded messages:
+ * - NAV-SAT:     per-satellite C/N0, elevation/azimuth, residual and usage flags
+ * - NAV-DOP:     geometric, position, time, vertical, horizontal, north and east DOP
+ * - NAV-STATUS:  fix status, time to first fix, time since startup
+ * - NAV-TIMEUTC: UTC date and time with validity flags
+ * - MON-HW:      antenna state, AGC, noise level and jamming indicators
+ */
+
+#ifndef UBX_DECODE_H
+#define UBX_DECODE_H
+
+#include "ubx_msg.h"
+#include "ubx_schema.h"
+#include "ubx_view.h"
+#include <stdint.h>
+
+#define NAV_SAT_MAX_SVS 72               // Receiver channels on the u-blox M8
+
+//********* NAV-SAT FLAGS SECTION **********
+#define NAV_SAT_QUALITY_MASK 0x07
+#define NAV_SAT_SV_USED_FLAG 0x08
+#define NAV_SAT_HEALTH_SHIFT 4
+#define NAV_SAT_HEALTH_MASK 0x03
+
+//********* NAV-TIMEUTC VALID SECTION **********
+#define TIMEUTC_VALID_TOW_FLAG 0x01
+#define TIMEUTC_VALID_WKN_FLAG 0x02
+#define TIMEUTC_VALID_UTC_FLAG 0x04
+
+//********* MON-HW SECTION **********
+#define MON_HW_JAMMING_SHIFT 2
+#define MON_HW_JAMMING_MASK 0x03
+#define MON_HW_JAMMING_UNKNOWN 0
+#define MON_HW_JAMMING_OK 1
+#define MON_HW_JAMMING_WARNING 2
+#define MON_HW_JAMMING_CRITICAL 3
+#define MON_HW_AGC_MAX 8191
+
+typedef struct {
+    uint8_t gnssId;
+    uint8_t svId;
+    uint8_t cno;                 // Carrier to noise ratio (dBHz)
+    int8_t elevation;            // degrees (-91 if unknown)
+    int16_t azimuth;             // degrees
+    double pseudorangeResidual;  // m
+    uint8_t qualityIndicator;    // 0 - 7, see NAV-SAT flags
+    bool used;                   // Used in the navigation solution
+    uint8_t health;              // 0 unknown, 1 healthy, 2 unhealthy
+    uint32_t flags;              // Raw flags
+} NavSatInfo;
+
+typedef struct {
+    uint32_t iTOW;               // ms
+    uint8_t numSvs;              // Satellites reported by the receiver
+    uint8_t numDecoded;          // Satellites stored in svs (at most NAV_SAT_MAX_SVS)
+    uint8_t numUsed;             // Satellites used in the navigation solution
+    NavSatInfo svs[NAV_SAT_MAX_SVS];
+} NavSatData;
+
+typedef struct {
+    uint32_t iTOW;               // ms
+    double geometricDop;
+    double positionDop;
+    double timeDop;
+    double verticalDop;
+    double horizontalDop;
+    double northingDop;
+    double eastingDop;
+} NavDopData;
+
+typedef struct {
+    uint32_t iTOW;               // ms
+    uint8_t gpsFix;              // Same values as NAV-PVT fixType
+    uint8_t flags;
+    uint8_t fixStatus;
+    uint8_t flags2;
+    uint32_t timeToFirstFix;     // ms
+    uint32_t millisSinceStartup; // ms
+} NavStatusData;
+
+typedef struct {
+    uint32_t iTOW;               // ms
+    uint32_t timeAccuracy;       // ns
+    int32_t nano;                // ns
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+    uint8_t valid;               // TIMEUTC_VALID_*_FLAG bits
+} NavTimeUtcData;
+
+typedef struct {
+    uint16_t noisePerMS;         // Noise level as measured by the GPS core
+    uint16_t agcCount;           // AGC monitor, 0 - MON_HW_AGC_MAX
+    double agcPercent;           // AGC monitor as a percentage of full scale
+    uint8_t antennaStatus;       // 0 init, 1 dontknow, 2 ok, 3 short, 4 open
+    uint8_t antennaPower;        // 0 off, 1 on, 2 dontknow
+    uint8_t jammingState;        // MON_HW_JAMMING_* (needs jamming monitoring enabled)
+    uint8_t jammingIndicator;    // CW jamming indicator, 0 (none) - 255 (strong)
+    uint8_t flags;
+} MonHwData;
+
+bool DecodeNavSat(const UbxMessageView &msg, NavSatData &data);
+bool DecodeNavDop(const UbxMessageView &msg, NavDopData &data);
+bool DecodeNavStatus(const UbxMessageView &msg, NavStatusData &data);
+bool DecodeNavTimeUtc(const UbxMessageView &msg, NavTimeUtcData &data);
+bool DecodeMonHw(const UbxMessageView &msg, MonHwData &data);
+
+#endif // UBX_DECODE_H
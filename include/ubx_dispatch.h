@@ -0,0 +1,54 @@
+/*
+ * ubx_dispatch.h - Constant-time routing of received UBX messages to handlers
+ *
+ * Handlers are registered per (class, id). Lookup is two array indexing steps: the
+ * class byte selects one of UBX_DISPATCH_MAX_CLASSES id tables (0 = no handlers for
+ * that class), and the id byte selects the handler inside it. Compared with a flat
+ * 256 x 256 table (1 MB of 16-byte entries on a 64-bit host) this keeps the
+ * dispatcher at about 32 KB (UBX_DISPATCH_MAX_CLASSES x 256 entries) while staying
+ * O(1) and allocation-free.
+ *
+ * Handlers run on the thread that reads the module (the caller of GetPvt/GetPvtView,
+ * or the acquisition thread) and receive a view that is only valid for the call.
+ */
+
+#ifndef UBX_DISPATCH_H
+#define UBX_DISPATCH_H
+
+#include "ubx_view.h"
+#include <stdint.h>
+
+#define UBX_DISPATCH_MAX_CLASSES 8       // Distinct message classes with handlers
+#define UBX_DISPATCH_IDS 256
+
+typedef void (*UbxHandler)(const UbxMessageView &msg, void *context);
+
+typedef struct {
+    UbxHandler handler;
+    void *context;
+} UbxHandlerEntry;
+
+typedef struct {
+    uint32_t dispatched;         // Messages passed to a handler
+    uint32_t unhandled;          // Messages with no handler registered
+} UbxDispatchStats;
+
+class UbxDispatcher {
+    private:
+        uint8_t classSlot[UBX_DISPATCH_IDS];    // 0 = unused, otherwise table index + 1
+        uint8_t classesUsed;
+        UbxHandlerEntry tables[UBX_DISPATCH_MAX_CLASSES][UBX_DISPATCH_IDS];
+        UbxDispatchStats stats;
+
+    public:
+        UbxDispatcher(void);
+
+        bool Register(uint8_t msgClass, uint8_t msgId, UbxHandler handler, void *context);
+        void Unregister(uint8_t msgClass, uint8_t msgId);
+        bool Dispatch(const UbxMessageView &msg);
+
+        UbxDispatchStats GetStats(void) const { return stats; }
+        void ResetStats(void);
+};
+
+#endif // UBX_DISPATCH_H
@@ -0,0 +1,86 @@
+/*
+ * ubx_framer.h - Incremental UBX frame extraction from a raw byte stream
+ *
+ * The receiver's data stream register hands out whatever bytes are queued, which
+ * may be several UBX messages back to back, a message split across two reads, or
+ * leftover NMEA/garbage. UbxFramer runs a byte-wise state machine over that stream:
+ *
+ *     SYNC_CHAR_1 | SYNC_CHAR_2 | class | id | length (LE) | payload | checksum A | checksum B
+ *
+ * - Input can be fed in chunks of any size; a frame may span any number of chunks.
+ * - Every complete frame is reported, one at a time, through FrameReady()/Frame().
+ * - Frames whose length exceeds MAX_MESSAGE_LENGTH or whose Fletcher checksum does
+ *   not match are dropped, and the bytes after the false sync character are
+ *   rescanned so a real frame hidden behind garbage is not lost.
+ *
+ * Usage:
+ *     size_t offset = 0;
+ *     while (true) {
+ *         offset += framer.Consume(&buf[offset], length - offset);
+ *         if (!framer.FrameReady()) break;   // input exhausted
+ *         handle(framer.Frame(), framer.FrameLength());
+ *     }
+ */
+
+#ifndef UBX_FRAMER_H
+#define UBX_FRAMER_H
+
+#include "ubx_msg.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define UBX_HEADER_LENGTH 6
+#define UBX_CHECKSUM_LENGTH 2
+#define UBX_FRAME_OVERHEAD (UBX_HEADER_LENGTH + UBX_CHECKSUM_LENGTH)
+#define UBX_MAX_FRAME_LENGTH (MAX_MESSAGE_LENGTH + UBX_FRAME_OVERHEAD)
+
+typedef struct {
+    uint32_t frames;            // Frames emitted with a valid checksum
+    uint32_t resyncs;           // Times framing was abandoned and sync had to be searched for
+    uint32_t checksumFailures;  // Frames dropped because checksum A/B did not match
+    uint32_t lengthErrors;      // Frames dropped because the payload length was too large
+    uint32_t bytesDiscarded;    // Bytes skipped while searching for SYNC_CHAR_1
+} UbxFramerStats;
+
+class UbxFramer {
+    private:
+        enum FramerState {
+            STATE_SYNC1,
+            STATE_SYNC2,
+            STATE_HEADER,
+            STATE_PAYLOAD,
+            STATE_CHECKSUM
+        };
+
+        FramerState state;
+        uint8_t frame[UBX_MAX_FRAME_LENGTH];
+        uint16_t frameLength;
+        uint16_t expectedLength;
+        bool frameReady;
+        bool discarding;
+
+        // Bytes that must be rescanned after a dropped frame, before any new input
+        uint8_t rescan[UBX_MAX_FRAME_LENGTH];
+        uint16_t rescanHead;
+        uint16_t rescanLength;
+
+        UbxFramerStats stats;
+
+        bool pushByte(uint8_t byte);
+        void dropFrame(void);
+
+    public:
+        UbxFramer(void);
+        size_t Consume(const uint8_t *data, size_t length);
+        void Reset(void);
+
+        bool FrameReady(void) const { return frameReady; }
+        const uint8_t *Frame(void) const { return frame; }
+        uint16_t FrameLength(void) const { return frameLength; }
+        void ToUbxMessage(UbxMessage &msg) const;
+
+        UbxFramerStats GetStats(void) const { return stats; }
+        void ResetStats(void);
+};
+
+#endif // UBX_FRAMER_H
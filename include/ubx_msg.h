@@ -53,22 +53,61 @@ CREDIT/CODE MODIFIED FROM: https://github.com/melopero/Melopero_UBX/tree/master
 #define LOG_CLASS 0x21
 #define SEC_CLASS 0x27
 #define HNR_CLASS 0x28
+#define NMEA_CLASS 0xF0     // Standard NMEA sentences, for CFG-MSG only
 
 //********* SYNC CHAR SECTION **********
 #define SYNC_CHAR_1 0xB5
 #define SYNC_CHAR_2 0x62
 
 //********* NAV MESSAGE SECTION **********
+#define NAV_STATUS 0x03
+#define NAV_DOP 0x04
 #define NAV_PVT 0x07
+#define NAV_TIMEUTC 0x21
+#define NAV_SAT 0x35
+
+//********* MON MESSAGE SECTION **********
+#define MON_HW 0x09
 
 //********* ACK MESSAGE SECTION **********
 #define ACK_ACK 0x01
 #define ACK_NAK 0x00
 
+//********* MGA MESSAGE SECTION **********
+#define MGA_INI 0x40
+#define MGA_ACK 0x60
+#define MGA_DBD 0x80
+
+//********* NMEA MESSAGE SECTION **********
+#define NMEA_GGA 0x00
+#define NMEA_GSA 0x02
+#define NMEA_RMC 0x04
+#define NMEA_VTG 0x05
+
 //********* CFG MESSAGE SECTION **********
 #define CFG_PRT 0x00
 #define CFG_MSG 0x01
 #define CFG_RATE 0x08
+#define CFG_CFG 0x09
+#define CFG_NAVX5 0x23
+#define CFG_GNSS 0x3E
+
+//********* CFG-PRT PORT SECTION **********
+#define PORT_ID_DDC 0x00
+#define PORT_ID_UART1 0x01
+#define PORT_PROTOCOL_UBX 0x0001
+#define PORT_PROTOCOL_NMEA 0x0002
+#define PORT_MODE_8N1 0x000008D0   // UART: 8 data bits, no parity, 1 stop bit
+
+//********* GNSS ID SECTION **********
+#define GNSS_ID_GPS 0
+#define GNSS_ID_SBAS 1
+#define GNSS_ID_GALILEO 2
+#define GNSS_ID_BEIDOU 3
+#define GNSS_ID_IMES 4
+#define GNSS_ID_QZSS 5
+#define GNSS_ID_GLONASS 6
+#define GNSS_ID_COUNT 7
 
 //********* FixTypes SECTION **********
 #define NO_FIX 0
@@ -78,6 +117,17 @@ CREDIT/CODE MODIFIED FROM: https://github.com/melopero/Melopero_UBX/tree/master
 #define GNSS_DEAD_RECKONING_COMBINED 4
 #define TIME_ONLY_FIX 5
 
+//********* CHECKSUM SECTION **********
+// UpdateChecksum() dispatches to one of these; UBX_CHECKSUM_AUTO times both once at
+// load time on a NAV-PVT sized frame and keeps the faster one.
+#define UBX_CHECKSUM_AUTO 0
+#define UBX_CHECKSUM_SCALAR 1           // One byte per step
+#define UBX_CHECKSUM_BLOCKED 2          // Eight bytes per step from SWAR lane sums (little endian)
+#define UBX_CHECKSUM_BLOCK_LENGTH 8
+#define UBX_CHECKSUM_CALIBRATION_LENGTH 96    // Class to end of a NAV-PVT payload
+#define UBX_CHECKSUM_CALIBRATION_RUNS 200
+#define UBX_CHECKSUM_CALIBRATION_ROUNDS 5     // Best of, against scheduling noise
+
 //******* DEBUG/HELPING CONSTANTS ********
 #define MAX_MESSAGE_LENGTH 1000
 #define MAX_PAYLOAD_LENGTH 92
@@ -94,7 +144,13 @@ typedef struct {
 } UbxMessage;
 
 UbxMessage ComposeMessage(uint8_t msg_class, uint8_t msg_id, uint16_t payloadLength, const uint8_t* payload);
+uint16_t ComposeFrame(uint8_t *frame, uint8_t msg_class, uint8_t msg_id, uint16_t payloadLength, const uint8_t* payload);
 void ComputeChecksum(UbxMessage &msg);
+void UpdateChecksum(const uint8_t *data, uint16_t length, uint8_t &checksumA, uint8_t &checksumB);
+void UpdateChecksumScalar(const uint8_t *data, uint16_t length, uint8_t &checksumA, uint8_t &checksumB);
+void UpdateChecksumBlocked(const uint8_t *data, uint16_t length, uint8_t &checksumA, uint8_t &checksumB);
+uint8_t SelectChecksum(uint8_t implementation);
+uint8_t GetChecksumImplementation(void);
 void ResetPayload(UbxMessage &msg);
 std::string MsgClassToString(uint8_t msgClass);
 std::string GetGNSSFixType(uint8_t fixFlag);
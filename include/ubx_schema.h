@@ -0,0 +1,426 @@
+/*
+ * ubx_schema.h - Compile-time UBX message schemas
+ *
+ * Every UBX message is declared once as a list of fields, each with its payload
+ * offset, wire type and scale:
+ *
+ *     struct CfgRate {
+ *         typedef UbxField<0, UbxU2> MeasRate;                 // ms
+ *         typedef UbxField<2, UbxU2> NavRate;                  // cycles
+ *         typedef UbxField<4, UbxU2> TimeRef;
+ *         typedef UbxSchema<CFG_CLASS, CFG_RATE, CFG_RATE_PAYLOAD_LENGTH,
+ *             MeasRate, NavRate, TimeRef> Schema;
+ *     };
+ *
+ * The schema checks at compile time that every field lies inside the payload and
+ * that fields are declared in payload order without overlapping. Decoding a field
+ * (CfgRate::MeasRate::Get(payload)) is a single unaligned little-endian load plus an
+ * optional multiply by a constant; encoding a message (CfgRate::Schema::Encode())
+ * zero-fills the payload and stores every field. Nothing is looked up at run time.
+ *
+ * Messages with repeated blocks (NAV-SAT) declare the fixed header and the block as
+ * two schemas; block fields are read relative to the start of each block.
+ *
+ * Scales are std::ratio values (degrees = raw * 1e-7 is std::ratio<1, 10000000>);
+ * scaled fields decode to double so no precision is lost to integer truncation.
+ *
+ * Payload offsets and units follow the u-blox M8 receiver description (UBX-13003221).
+ */
+
+#ifndef UBX_SCHEMA_H
+#define UBX_SCHEMA_H
+
+#include "ubx_msg.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <ratio>
+#include <type_traits>
+
+#define NAV_PVT_PAYLOAD_LENGTH 92
+#define CFG_PRT_PAYLOAD_LENGTH 20
+#define CFG_MSG_PAYLOAD_LENGTH 8
+#define CFG_RATE_PAYLOAD_LENGTH 6
+#define CFG_CFG_PAYLOAD_LENGTH 13
+#define NAV_STATUS_PAYLOAD_LENGTH 16
+#define NAV_DOP_PAYLOAD_LENGTH 18
+#define NAV_TIMEUTC_PAYLOAD_LENGTH 20
+#define NAV_SAT_HEADER_LENGTH 8            // Followed by numSvs NAV_SAT_BLOCK_LENGTH blocks
+#define NAV_SAT_BLOCK_LENGTH 12
+#define MON_HW_PAYLOAD_LENGTH 60
+#define CFG_GNSS_HEADER_LENGTH 4           // Followed by numConfigBlocks CFG_GNSS_BLOCK_LENGTH blocks
+#define CFG_GNSS_BLOCK_LENGTH 8
+#define CFG_NAVX5_PAYLOAD_LENGTH 40
+#define MGA_INI_POS_LLH_PAYLOAD_LENGTH 20
+#define MGA_INI_TIME_UTC_PAYLOAD_LENGTH 24
+#define MGA_ACK_PAYLOAD_LENGTH 8
+#define MGA_DBD_HEADER_LENGTH 12           // Reserved, followed by receiver-specific database bytes
+
+/** Wire type: a little-endian integer of sizeof(T) bytes at any alignment */
+template<typename T>
+struct UbxWire {
+    typedef T raw_type;
+    static constexpr uint16_t size = sizeof(T);
+
+    static inline T Load(const uint8_t *bytes) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        T value;
+        memcpy(&value, bytes, sizeof(T));
+        return value;
+#else
+        typename std::make_unsigned<T>::type value = 0;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            value |= static_cast<typename std::make_unsigned<T>::type>(bytes[i]) << (8 * i);
+        }
+        return static_cast<T>(value);
+#endif
+    }
+
+    static inline void Store(uint8_t *bytes, T value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(bytes, &value, sizeof(T));
+#else
+        typename std::make_unsigned<T>::type bits = static_cast<typename std::make_unsigned<T>::type>(value);
+        for (size_t i = 0; i < sizeof(T); i++) {
+            bytes[i] = static_cast<uint8_t>(bits >> (8 * i));
+        }
+#endif
+    }
+};
+
+typedef UbxWire<uint8_t> UbxU1;
+typedef UbxWire<int8_t> UbxI1;
+typedef UbxWire<uint16_t> UbxU2;
+typedef UbxWire<int16_t> UbxI2;
+typedef UbxWire<uint32_t> UbxU4;
+typedef UbxWire<int32_t> UbxI4;
+typedef UbxWire<uint8_t> UbxX1;    // Bitfields
+typedef UbxWire<uint16_t> UbxX2;
+typedef UbxWire<uint32_t> UbxX4;
+
+typedef std::ratio<1> UbxUnscaled;
+
+/** One field of a payload: Get() returns raw * Scale, Put() stores a raw value */
+template<uint16_t Offset, typename Wire, typename Scale = UbxUnscaled>
+struct UbxField {
+    typedef typename Wire::raw_type raw_type;
+    static constexpr bool scaled = !std::ratio_equal<Scale, UbxUnscaled>::value;
+    typedef typename std::conditional<scaled, double, raw_type>::type value_type;
+
+    static constexpr uint16_t offset = Offset;
+    static constexpr uint16_t size = Wire::size;
+    static constexpr uint16_t end = Offset + Wire::size;
+    static constexpr double scale = static_cast<double>(Scale::num) / static_cast<double>(Scale::den);
+
+    static inline raw_type Raw(const uint8_t *payload) { return Wire::Load(payload + Offset); }
+    static inline void Put(uint8_t *payload, raw_type value) { Wire::Store(payload + Offset, value); }
+
+    static inline value_type Get(const uint8_t *payload) {
+        if constexpr (scaled) {
+            return static_cast<double>(Raw(payload)) * scale;
+        } else {
+            return Raw(payload);
+        }
+    }
+};
+
+/** true if every field starts at or after the end of the one declared before it */
+template<typename... Fields>
+constexpr bool UbxFieldsOrdered(void) {
+    const uint16_t offsets[] = {Fields::offset...};
+    const uint16_t ends[] = {Fields::end...};
+    for (size_t i = 1; i < sizeof...(Fields); i++) {
+        if (offsets[i] < ends[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** A message: class, id, fixed payload length and its fields in payload order */
+template<uint8_t MsgClass, uint8_t MsgId, uint16_t PayloadLength, typename... Fields>
+struct UbxSchema {
+    static constexpr uint8_t msgClass = MsgClass;
+    static constexpr uint8_t msgId = MsgId;
+    static constexpr uint16_t payloadLength = PayloadLength;
+    static constexpr size_t fieldCount = sizeof...(Fields);
+
+    static_assert(sizeof...(Fields) > 0, "UBX schema declares no fields");
+    static_assert(((Fields::end <= PayloadLength) && ...), "UBX field extends past the end of the payload");
+    static_assert(UbxFieldsOrdered<Fields...>(), "UBX fields must be declared in payload order without overlapping");
+
+    /** Check class, id and that the payload is long enough for every field */
+    static inline bool Matches(uint8_t cls, uint8_t id, uint16_t length) {
+        return cls == MsgClass && id == MsgId && length >= PayloadLength;
+    }
+
+    /** Zero the payload (reserved bytes included) and store every field in declaration order */
+    static inline void Encode(uint8_t *payload, typename Fields::raw_type... values) {
+        memset(payload, 0, PayloadLength);
+        (Fields::Put(payload, values), ...);
+    }
+};
+
+/** UBX-NAV-PVT (0x01 0x07): navigation position velocity time solution */
+struct NavPvt {
+    typedef UbxField<0, UbxU4> ITow;                                    // GPS time of week (ms)
+    typedef UbxField<4, UbxU2> Year;                                    // Year (UTC)
+    typedef UbxField<6, UbxU1> Month;
+    typedef UbxField<7, UbxU1> Day;
+    typedef UbxField<8, UbxU1> Hour;
+    typedef UbxField<9, UbxU1> Min;
+    typedef UbxField<10, UbxU1> Sec;
+    typedef UbxField<11, UbxX1> Valid;                                  // VALID_*_FLAG bits
+    typedef UbxField<12, UbxU4> TAcc;                                   // ns
+    typedef UbxField<16, UbxI4> Nano;                                   // Fraction of second (ns)
+    typedef UbxField<20, UbxU1> FixType;
+    typedef UbxField<21, UbxX1> Flags;
+    typedef UbxField<22, UbxX1> Flags2;
+    typedef UbxField<23, UbxU1> NumSv;
+    typedef UbxField<24, UbxI4, std::ratio<1, 10000000>> Lon;           // degrees
+    typedef UbxField<28, UbxI4, std::ratio<1, 10000000>> Lat;           // degrees
+    typedef UbxField<32, UbxI4> Height;                                 // mm above ellipsoid
+    typedef UbxField<36, UbxI4> HMsl;                                   // mm above mean sea level
+    typedef UbxField<40, UbxU4> HAcc;                                   // mm
+    typedef UbxField<44, UbxU4> VAcc;                                   // mm
+    typedef UbxField<48, UbxI4> VelN;                                   // mm/s
+    typedef UbxField<52, UbxI4> VelE;                                   // mm/s
+    typedef UbxField<56, UbxI4> VelD;                                   // mm/s
+    typedef UbxField<60, UbxI4> GSpeed;                                 // mm/s
+    typedef UbxField<64, UbxI4, std::ratio<1, 100000>> HeadMot;         // degrees
+    typedef UbxField<68, UbxU4> SAcc;                                   // mm/s
+    typedef UbxField<72, UbxU4, std::ratio<1, 100000>> HeadAcc;         // degrees
+    typedef UbxField<76, UbxU2, std::ratio<1, 100>> PDop;
+    typedef UbxField<84, UbxI4, std::ratio<1, 100000>> HeadVeh;         // degrees
+    typedef UbxField<88, UbxI2, std::ratio<1, 100>> MagDec;             // degrees
+    typedef UbxField<90, UbxU2, std::ratio<1, 100>> MagAcc;             // degrees
+
+    typedef UbxSchema<NAV_CLASS, NAV_PVT, NAV_PVT_PAYLOAD_LENGTH,
+        ITow, Year, Month, Day, Hour, Min, Sec, Valid, TAcc, Nano, FixType, Flags, Flags2, NumSv,
+        Lon, Lat, Height, HMsl, HAcc, VAcc, VelN, VelE, VelD, GSpeed, HeadMot, SAcc, HeadAcc, PDop,
+        HeadVeh, MagDec, MagAcc> Schema;
+};
+
+/** UBX-CFG-PRT (0x06 0x00) for the DDC (I2C) and UART ports */
+struct CfgPrt {
+    typedef UbxField<0, UbxU1> PortId;
+    typedef UbxField<2, UbxX2> TxReady;
+    typedef UbxField<4, UbxX4> Mode;                                    // DDC: slave address << 1; UART: framing
+    typedef UbxField<8, UbxU4> BaudRate;                                // UART only
+    typedef UbxField<12, UbxX2> InProtoMask;
+    typedef UbxField<14, UbxX2> OutProtoMask;
+    typedef UbxField<16, UbxX2> Flags;
+
+    typedef UbxSchema<CFG_CLASS, CFG_PRT, CFG_PRT_PAYLOAD_LENGTH,
+        PortId, TxReady, Mode, BaudRate, InProtoMask, OutProtoMask, Flags> Schema;
+};
+
+/** UBX-CFG-MSG (0x06 0x01): output rate of one message on each port */
+struct CfgMsg {
+    typedef UbxField<0, UbxU1> MsgClass;
+    typedef UbxField<1, UbxU1> MsgId;
+    typedef UbxField<2, UbxU1> RateDdc;                                 // Per navigation solution
+    typedef UbxField<3, UbxU1> RateUart1;
+    typedef UbxField<4, UbxU1> RateUart2;
+    typedef UbxField<5, UbxU1> RateUsb;
+    typedef UbxField<6, UbxU1> RateSpi;
+
+    typedef UbxSchema<CFG_CLASS, CFG_MSG, CFG_MSG_PAYLOAD_LENGTH,
+        MsgClass, MsgId, RateDdc, RateUart1, RateUart2, RateUsb, RateSpi> Schema;
+};
+
+/** UBX-CFG-RATE (0x06 0x08): measurement and navigation rate */
+struct CfgRate {
+    typedef UbxField<0, UbxU2> MeasRate;                                // ms
+    typedef UbxField<2, UbxU2> NavRate;                                 // Measurements per solution
+    typedef UbxField<4, UbxU2> TimeRef;                                 // 0 = UTC, 1 = GPS time
+
+    typedef UbxSchema<CFG_CLASS, CFG_RATE, CFG_RATE_PAYLOAD_LENGTH,
+        MeasRate, NavRate, TimeRef> Schema;
+};
+
+/** UBX-CFG-CFG (0x06 0x09): clear, save and load configurations */
+struct CfgCfg {
+    typedef UbxField<0, UbxX4> ClearMask;
+    typedef UbxField<4, UbxX4> SaveMask;
+    typedef UbxField<8, UbxX4> LoadMask;
+    typedef UbxField<12, UbxX1> DeviceMask;
+
+    typedef UbxSchema<CFG_CLASS, CFG_CFG, CFG_CFG_PAYLOAD_LENGTH,
+        ClearMask, SaveMask, LoadMask, DeviceMask> Schema;
+};
+
+/** UBX-NAV-STATUS (0x01 0x03): receiver navigation status */
+struct NavStatus {
+    typedef UbxField<0, UbxU4> ITow;                                    // ms
+    typedef UbxField<4, UbxU1> GpsFix;                                  // Same values as NAV-PVT fixType
+    typedef UbxField<5, UbxX1> Flags;
+    typedef UbxField<6, UbxX1> FixStat;
+    typedef UbxField<7, UbxX1> Flags2;
+    typedef UbxField<8, UbxU4> Ttff;                                    // Time to first fix (ms)
+    typedef UbxField<12, UbxU4> Msss;                                   // Milliseconds since startup
+
+    typedef UbxSchema<NAV_CLASS, NAV_STATUS, NAV_STATUS_PAYLOAD_LENGTH,
+        ITow, GpsFix, Flags, FixStat, Flags2, Ttff, Msss> Schema;
+};
+
+/** UBX-NAV-DOP (0x01 0x04): dilution of precision */
+struct NavDop {
+    typedef UbxField<0, UbxU4> ITow;                                    // ms
+    typedef UbxField<4, UbxU2, std::ratio<1, 100>> GDop;
+    typedef UbxField<6, UbxU2, std::ratio<1, 100>> PDop;
+    typedef UbxField<8, UbxU2, std::ratio<1, 100>> TDop;
+    typedef UbxField<10, UbxU2, std::ratio<1, 100>> VDop;
+    typedef UbxField<12, UbxU2, std::ratio<1, 100>> HDop;
+    typedef UbxField<14, UbxU2, std::ratio<1, 100>> NDop;
+    typedef UbxField<16, UbxU2, std::ratio<1, 100>> EDop;
+
+    typedef UbxSchema<NAV_CLASS, NAV_DOP, NAV_DOP_PAYLOAD_LENGTH,
+        ITow, GDop, PDop, TDop, VDop, HDop, NDop, EDop> Schema;
+};
+
+/** UBX-NAV-TIMEUTC (0x01 0x21): UTC time solution */
+struct NavTimeUtc {
+    typedef UbxField<0, UbxU4> ITow;                                    // ms
+    typedef UbxField<4, UbxU4> TAcc;                                    // ns
+    typedef UbxField<8, UbxI4> Nano;                                    // ns
+    typedef UbxField<12, UbxU2> Year;
+    typedef UbxField<14, UbxU1> Month;
+    typedef UbxField<15, UbxU1> Day;
+    typedef UbxField<16, UbxU1> Hour;
+    typedef UbxField<17, UbxU1> Min;
+    typedef UbxField<18, UbxU1> Sec;
+    typedef UbxField<19, UbxX1> Valid;                                  // validTOW, validWKN, validUTC, utcStandard
+
+    typedef UbxSchema<NAV_CLASS, NAV_TIMEUTC, NAV_TIMEUTC_PAYLOAD_LENGTH,
+        ITow, TAcc, Nano, Year, Month, Day, Hour, Min, Sec, Valid> Schema;
+};
+
+/** UBX-NAV-SAT (0x01 0x35): satellite information; a header followed by numSvs blocks */
+struct NavSat {
+    typedef UbxField<0, UbxU4> ITow;                                    // ms
+    typedef UbxField<4, UbxU1> Version;
+    typedef UbxField<5, UbxU1> NumSvs;
+
+    typedef UbxSchema<NAV_CLASS, NAV_SAT, NAV_SAT_HEADER_LENGTH,
+        ITow, Version, NumSvs> Schema;
+
+    /** One repeated block; offsets are relative to the start of the block */
+    struct Sv {
+        typedef UbxField<0, UbxU1> GnssId;
+        typedef UbxField<1, UbxU1> SvId;
+        typedef UbxField<2, UbxU1> Cno;                                 // dBHz
+        typedef UbxField<3, UbxI1> Elev;                                // degrees
+        typedef UbxField<4, UbxI2> Azim;                                // degrees
+        typedef UbxField<6, UbxI2, std::ratio<1, 10>> PrRes;            // m
+        typedef UbxField<8, UbxX4> Flags;
+
+        typedef UbxSchema<NAV_CLASS, NAV_SAT, NAV_SAT_BLOCK_LENGTH,
+            GnssId, SvId, Cno, Elev, Azim, PrRes, Flags> Schema;
+    };
+};
+
+/** UBX-MON-HW (0x0A 0x09): hardware status, antenna, AGC and jamming */
+struct MonHw {
+    typedef UbxField<0, UbxX4> PinSel;
+    typedef UbxField<4, UbxX4> PinBank;
+    typedef UbxField<8, UbxX4> PinDir;
+    typedef UbxField<12, UbxX4> PinVal;
+    typedef UbxField<16, UbxU2> NoisePerMs;
+    typedef UbxField<18, UbxU2> AgcCnt;                                 // 0 - 8191
+    typedef UbxField<20, UbxU1> AStatus;                                // Antenna supervisor state
+    typedef UbxField<21, UbxU1> APower;                                 // Antenna power state
+    typedef UbxField<22, UbxX1> Flags;                                  // Bits 2..3: jamming state
+    typedef UbxField<24, UbxX4> UsedMask;
+    typedef UbxField<45, UbxU1> JamInd;                                 // CW jamming indicator 0 - 255
+    typedef UbxField<48, UbxX4> PinIrq;
+    typedef UbxField<52, UbxX4> PullH;
+    typedef UbxField<56, UbxX4> PullL;
+
+    typedef UbxSchema<MON_CLASS, MON_HW, MON_HW_PAYLOAD_LENGTH,
+        PinSel, PinBank, PinDir, PinVal, NoisePerMs, AgcCnt, AStatus, APower, Flags, UsedMask,
+        JamInd, PinIrq, PullH, PullL> Schema;
+};
+
+/** UBX-CFG-GNSS (0x06 0x3E): GNSS system configuration; a header followed by one block per GNSS */
+struct CfgGnss {
+    typedef UbxField<0, UbxU1> MsgVer;
+    typedef UbxField<1, UbxU1> NumTrkChHw;                              // Read only
+    typedef UbxField<2, UbxU1> NumTrkChUse;
+    typedef UbxField<3, UbxU1> NumConfigBlocks;
+
+    typedef UbxSchema<CFG_CLASS, CFG_GNSS, CFG_GNSS_HEADER_LENGTH,
+        MsgVer, NumTrkChHw, NumTrkChUse, NumConfigBlocks> Schema;
+
+    /** One repeated block; offsets are relative to the start of the block */
+    struct Block {
+        typedef UbxField<0, UbxU1> GnssId;
+        typedef UbxField<1, UbxU1> ResTrkCh;                            // Reserved tracking channels
+        typedef UbxField<2, UbxU1> MaxTrkCh;                            // Maximum tracking channels
+        typedef UbxField<4, UbxX4> Flags;                               // Bit 0: enable, bits 16..23: sigCfgMask
+
+        typedef UbxSchema<CFG_CLASS, CFG_GNSS, CFG_GNSS_BLOCK_LENGTH,
+            GnssId, ResTrkCh, MaxTrkCh, Flags> Schema;
+    };
+};
+
+/** UBX-CFG-NAVX5 (0x06 0x23): navigation engine expert settings; only masked fields are applied */
+struct CfgNavx5 {
+    typedef UbxField<0, UbxU2> Version;                                 // 2
+    typedef UbxField<2, UbxX2> Mask1;                                   // Bit 10: apply ackAiding
+    typedef UbxField<4, UbxX4> Mask2;
+    typedef UbxField<17, UbxU1> AckAiding;                              // 1: answer MGA messages with MGA-ACK
+
+    typedef UbxSchema<CFG_CLASS, CFG_NAVX5, CFG_NAVX5_PAYLOAD_LENGTH,
+        Version, Mask1, Mask2, AckAiding> Schema;
+};
+
+/** UBX-MGA-INI-POS_LLH (0x13 0x40, type 0x01): initial position */
+struct MgaIniPosLlh {
+    typedef UbxField<0, UbxU1> Type;                                    // 0x01
+    typedef UbxField<1, UbxU1> Version;                                 // 0
+    typedef UbxField<4, UbxI4, std::ratio<1, 10000000>> Lat;            // degrees
+    typedef UbxField<8, UbxI4, std::ratio<1, 10000000>> Lon;            // degrees
+    typedef UbxField<12, UbxI4> Alt;                                    // cm above ellipsoid
+    typedef UbxField<16, UbxU4> PosAcc;                                 // cm
+
+    typedef UbxSchema<MGA_CLASS, MGA_INI, MGA_INI_POS_LLH_PAYLOAD_LENGTH,
+        Type, Version, Lat, Lon, Alt, PosAcc> Schema;
+};
+
+/** UBX-MGA-INI-TIME_UTC (0x13 0x40, type 0x10): initial time */
+struct MgaIniTimeUtc {
+    typedef UbxField<0, UbxU1> Type;                                    // 0x10
+    typedef UbxField<1, UbxU1> Version;                                 // 0
+    typedef UbxField<2, UbxX1> Ref;                                     // 0: time of receipt of the message
+    typedef UbxField<3, UbxI1> LeapSecs;                                // -128: unknown
+    typedef UbxField<4, UbxU2> Year;
+    typedef UbxField<6, UbxU1> Month;
+    typedef UbxField<7, UbxU1> Day;
+    typedef UbxField<8, UbxU1> Hour;
+    typedef UbxField<9, UbxU1> Minute;
+    typedef UbxField<10, UbxU1> Second;
+    typedef UbxField<12, UbxU4> Ns;
+    typedef UbxField<16, UbxU2> TAccS;                                  // s
+    typedef UbxField<20, UbxU4> TAccNs;                                 // ns
+
+    typedef UbxSchema<MGA_CLASS, MGA_INI, MGA_INI_TIME_UTC_PAYLOAD_LENGTH,
+        Type, Version, Ref, LeapSecs, Year, Month, Day, Hour, Minute, Second, Ns, TAccS, TAccNs> Schema;
+};
+
+/** UBX-MGA-ACK-DATA0 (0x13 0x60): acknowledgement of one MGA message (CFG-NAVX5 ackAiding) */
+struct MgaAck {
+    typedef UbxField<0, UbxU1> Type;                                    // 1: accepted, 0: not used
+    typedef UbxField<1, UbxU1> Version;
+    typedef UbxField<2, UbxU1> InfoCode;                                // Reason when not used
+    typedef UbxField<3, UbxU1> MsgId;                                   // MGA message acknowledged
+    typedef UbxField<4, UbxU4> MsgPayloadStart;                         // Its first four payload bytes
+
+    typedef UbxSchema<MGA_CLASS, MGA_ACK, MGA_ACK_PAYLOAD_LENGTH,
+        Type, Version, InfoCode, MsgId, MsgPayloadStart> Schema;
+};
+
+static_assert(NavPvt::HeadVeh::offset == 84 && NavPvt::MagAcc::end == NAV_PVT_PAYLOAD_LENGTH,
+    "NAV-PVT layout does not match the M8 protocol description");
+
+#endif // UBX_SCHEMA_H
@@ -0,0 +1,143 @@
+/*
+ * ubx_view.h - Non-owning, lazily decoded views over received UBX frames
+ *
+ * A view is a pointer into a buffer that already holds a complete frame (for example
+ * UbxFramer::Frame()); nothing is copied when a view is created, and a field is only
+ * decoded from its little-endian bytes when its accessor is called. A view is only
+ * valid as long as the buffer it points into is unchanged; for frames returned by the
+ * Gps class that is until the next call that reads from the module.
+ *
+ * Payload offsets and units follow the u-blox M8 receiver description (UBX-13003221).
+ */
+
+#ifndef UBX_VIEW_H
+#define UBX_VIEW_H
+
+#include "ubx_msg.h"
+#include "ubx_schema.h"
+#include <stdint.h>
+
+#define UBX_VIEW_CLASS_OFFSET 2
+#define UBX_VIEW_ID_OFFSET 3
+#define UBX_VIEW_LENGTH_OFFSET 4
+#define UBX_VIEW_PAYLOAD_OFFSET 6
+
+#define NAV_PVT_FLAGS_GNSS_FIX_OK 0x01       // NAV-PVT flags: fix within DOP and accuracy masks
+#define NAV_PVT_FLAGS_DIFF_SOLN 0x02         // NAV-PVT flags: differential corrections applied
+
+/** Little-endian field loaders */
+inline uint16_t UbxReadU2(const uint8_t *bytes) {
+    return UbxU2::Load(bytes);
+}
+
+inline int16_t UbxReadI2(const uint8_t *bytes) {
+    return UbxI2::Load(bytes);
+}
+
+inline uint32_t UbxReadU4(const uint8_t *bytes) {
+    return UbxU4::Load(bytes);
+}
+
+inline int32_t UbxReadI4(const uint8_t *bytes) {
+    return UbxI4::Load(bytes);
+}
+
+/** Read-only span over a payload */
+class UbxSpan {
+    private:
+        const uint8_t *bytes;
+        uint16_t length;
+
+    public:
+        UbxSpan(const uint8_t *bytes, uint16_t length) : bytes(bytes), length(length) {}
+        const uint8_t *data(void) const { return bytes; }
+        uint16_t size(void) const { return length; }
+        uint8_t operator[](uint16_t index) const { return bytes[index]; }
+};
+
+/** View over a complete frame: sync chars, class, id, length, payload, checksum */
+class UbxMessageView {
+    private:
+        const uint8_t *frame;
+
+    public:
+        UbxMessageView(void) : frame(nullptr) {}
+        explicit UbxMessageView(const uint8_t *frame) : frame(frame) {}
+
+        bool IsValid(void) const { return frame != nullptr; }
+        const uint8_t *Data(void) const { return frame; }
+        uint16_t FrameLength(void) const { return UBX_VIEW_PAYLOAD_OFFSET + PayloadLength() + 2; }
+        bool Is(uint8_t msgClass, uint8_t msgId) const {
+            return frame != nullptr && MsgClass() == msgClass && MsgId() == msgId;
+        }
+
+        uint8_t MsgClass(void) const { return frame[UBX_VIEW_CLASS_OFFSET]; }
+        uint8_t MsgId(void) const { return frame[UBX_VIEW_ID_OFFSET]; }
+        uint16_t PayloadLength(void) const { return UbxReadU2(&frame[UBX_VIEW_LENGTH_OFFSET]); }
+        UbxSpan Payload(void) const { return UbxSpan(&frame[UBX_VIEW_PAYLOAD_OFFSET], PayloadLength()); }
+
+        uint8_t U1(uint16_t offset) const { return frame[UBX_VIEW_PAYLOAD_OFFSET + offset]; }
+        int8_t I1(uint16_t offset) const { return static_cast<int8_t>(U1(offset)); }
+        uint16_t U2(uint16_t offset) const { return UbxReadU2(&frame[UBX_VIEW_PAYLOAD_OFFSET + offset]); }
+        int16_t I2(uint16_t offset) const { return UbxReadI2(&frame[UBX_VIEW_PAYLOAD_OFFSET + offset]); }
+        uint32_t U4(uint16_t offset) const { return UbxReadU4(&frame[UBX_VIEW_PAYLOAD_OFFSET + offset]); }
+        int32_t I4(uint16_t offset) const { return UbxReadI4(&frame[UBX_VIEW_PAYLOAD_OFFSET + offset]); }
+};
+
+/** View over a NAV-PVT (0x01 0x07) frame; only the fields that are read get decoded */
+class NavPvtView {
+    private:
+        UbxMessageView msg;
+
+        const uint8_t *payload(void) const { return msg.Payload().data(); }
+
+    public:
+        NavPvtView(void) {}
+        explicit NavPvtView(UbxMessageView msg) : msg(msg) {}
+
+        bool IsValid(void) const {
+            return msg.IsValid() && NavPvt::Schema::Matches(msg.MsgClass(), msg.MsgId(), msg.PayloadLength());
+        }
+        UbxMessageView Message(void) const { return msg; }
+
+        // Time Information
+        uint32_t ITow(void) const { return NavPvt::ITow::Get(payload()); }             // GPS time of week (ms)
+        uint16_t Year(void) const { return NavPvt::Year::Get(payload()); }             // Year (UTC)
+        uint8_t Month(void) const { return NavPvt::Month::Get(payload()); }
+        uint8_t Day(void) const { return NavPvt::Day::Get(payload()); }
+        uint8_t Hour(void) const { return NavPvt::Hour::Get(payload()); }
+        uint8_t Min(void) const { return NavPvt::Min::Get(payload()); }
+        uint8_t Sec(void) const { return NavPvt::Sec::Get(payload()); }
+        uint8_t Valid(void) const { return NavPvt::Valid::Get(payload()); }           // VALID_*_FLAG bits
+        uint32_t TimeAccuracy(void) const { return NavPvt::TAcc::Get(payload()); }     // ns
+        int32_t Nano(void) const { return NavPvt::Nano::Get(payload()); }              // Fraction of second (ns)
+
+        // GNSS
+        uint8_t FixType(void) const { return NavPvt::FixType::Get(payload()); }
+        uint8_t Flags(void) const { return NavPvt::Flags::Get(payload()); }
+        uint8_t Flags2(void) const { return NavPvt::Flags2::Get(payload()); }
+        uint8_t NumSv(void) const { return NavPvt::NumSv::Get(payload()); }
+
+        // Coordinates
+        double Longitude(void) const { return NavPvt::Lon::Get(payload()); }           // degrees
+        double Latitude(void) const { return NavPvt::Lat::Get(payload()); }            // degrees
+        int32_t Height(void) const { return NavPvt::Height::Get(payload()); }          // mm above ellipsoid
+        int32_t HeightMSL(void) const { return NavPvt::HMsl::Get(payload()); }         // mm above mean sea level
+        uint32_t HorizontalAccuracy(void) const { return NavPvt::HAcc::Get(payload()); } // mm
+        uint32_t VerticalAccuracy(void) const { return NavPvt::VAcc::Get(payload()); }   // mm
+
+        // Velocity and Heading
+        int32_t VelocityNorth(void) const { return NavPvt::VelN::Get(payload()); }     // mm/s
+        int32_t VelocityEast(void) const { return NavPvt::VelE::Get(payload()); }      // mm/s
+        int32_t VelocityDown(void) const { return NavPvt::VelD::Get(payload()); }      // mm/s
+        int32_t GroundSpeed(void) const { return NavPvt::GSpeed::Get(payload()); }    // mm/s
+        double MotionHeading(void) const { return NavPvt::HeadMot::Get(payload()); }   // degrees
+        uint32_t SpeedAccuracy(void) const { return NavPvt::SAcc::Get(payload()); }    // mm/s
+        double MotionHeadingAccuracy(void) const { return NavPvt::HeadAcc::Get(payload()); } // degrees
+        double PositionDop(void) const { return NavPvt::PDop::Get(payload()); }
+        double VehicleHeading(void) const { return NavPvt::HeadVeh::Get(payload()); }  // degrees
+        double MagneticDeclination(void) const { return NavPvt::MagDec::Get(payload()); } // degrees
+        double MagneticDeclinationAccuracy(void) const { return NavPvt::MagAcc::Get(payload()); } // degrees
+};
+
+#endif // UBX_VIEW_H
@@ -0,0 +1,196 @@
+#include "clock_estimator.h"
+#include "epoch_scheduler.h"
+#include <math.h>
+
+/**
+ * @brief   Constructor for the GnssClockEstimator class; starts without samples.
+ */
+GnssClockEstimator::GnssClockEstimator(void) {
+    resets = 0;
+    Reset();
+}
+
+/**
+ * @brief   Drop every sample; the next one starts a new estimate.
+ */
+void GnssClockEstimator::Reset(void) {
+    head = 0;
+    count = 0;
+    blockHead = 0;
+    blockCount = 0;
+    blockStartNanos = 0;
+    lastITow = 0;
+    weekNanos = 0;
+    referenceNanos = 0;
+    offsetNanos = 0;
+    drift = 0.0;
+    jitterNanos = 0.0;
+    maxDelayNanos = 0;
+}
+
+/**
+ * @brief   Convert iTOW into GNSS time that keeps increasing across week rollovers.
+ */
+int64_t GnssClockEstimator::unwrap(uint32_t iTow) {
+    if (count > 0 && iTow < lastITow &&
+        static_cast<int64_t>(lastITow) - static_cast<int64_t>(iTow) > CLOCK_WEEK_MILLIS / 2) {
+        weekNanos += CLOCK_WEEK_MILLIS * static_cast<int64_t>(NANOS_PER_MILLI);
+    }
+    lastITow = iTow;
+    return weekNanos + static_cast<int64_t>(iTow) * static_cast<int64_t>(NANOS_PER_MILLI);
+}
+
+/**
+ * @brief   Add the host receive time of the solution for iTOW.
+ *
+ * @param   iTow        GPS time of week of the solution in milliseconds.
+ * @param   hostNanos   CLOCK_MONOTONIC time at which the frame was read.
+ */
+void GnssClockEstimator::AddSample(uint32_t iTow, uint64_t hostNanos) {
+    if (count > 0) {
+        if (iTow == lastITow) {
+            return;
+        }
+
+        // Restart on anything the current model cannot explain
+        int64_t error = static_cast<int64_t>(hostNanos) - static_cast<int64_t>(HostNanos(iTow));
+        if (error > CLOCK_RESET_NANOS || error < -CLOCK_RESET_NANOS) {
+            resets++;
+            Reset();
+        }
+    }
+
+    int64_t gnss = unwrap(iTow);
+    gnssNanos[head] = gnss;
+    residualNanos[head] = static_cast<int64_t>(hostNanos) - gnss;
+    head = (head + 1) % CLOCK_WINDOW_LENGTH;
+    if (count < CLOCK_WINDOW_LENGTH) {
+        count++;
+    }
+    addToEnvelope(gnss, static_cast<int64_t>(hostNanos) - gnss);
+
+    referenceNanos = gnss;
+    refit();
+}
+
+/**
+ * @brief   Keep the sample if it is the earliest-arriving one of its block.
+ */
+void GnssClockEstimator::addToEnvelope(int64_t gnss, int64_t residual) {
+    if (blockCount == 0 || gnss - blockStartNanos >= CLOCK_BLOCK_NANOS) {
+        if (blockCount > 0) {
+            blockHead = (blockHead + 1) % CLOCK_BLOCK_COUNT;
+        }
+        if (blockCount < CLOCK_BLOCK_COUNT) {
+            blockCount++;
+        }
+        blockStartNanos = gnss;
+        blockGnssNanos[blockHead] = gnss;
+        blockResidualNanos[blockHead] = residual;
+        return;
+    }
+
+    if (residual < blockResidualNanos[blockHead]) {
+        blockGnssNanos[blockHead] = gnss;
+        blockResidualNanos[blockHead] = residual;
+    }
+}
+
+/**
+ * @brief   Fit drift to the envelope by least squares, then offset and jitter.
+ *
+ * Times are taken relative to the newest sample so the sums stay well inside double
+ * precision.
+ */
+void GnssClockEstimator::refit(void) {
+    int64_t base = blockResidualNanos[blockHead];
+
+    drift = 0.0;
+    if (blockCount >= CLOCK_MIN_FIT_BLOCKS) {
+        double meanX = 0.0;
+        double meanY = 0.0;
+        for (uint32_t i = 0; i < blockCount; i++) {
+            meanX += static_cast<double>(blockGnssNanos[i] - referenceNanos);
+            meanY += static_cast<double>(blockResidualNanos[i] - base);
+        }
+        meanX /= blockCount;
+        meanY /= blockCount;
+
+        double sxy = 0.0;
+        double sxx = 0.0;
+        for (uint32_t i = 0; i < blockCount; i++) {
+            double dx = static_cast<double>(blockGnssNanos[i] - referenceNanos) - meanX;
+            double dy = static_cast<double>(blockResidualNanos[i] - base) - meanY;
+            sxy += dx * dy;
+            sxx += dx * dx;
+        }
+        if (sxx > 0.0) {
+            drift = sxy / sxx;
+        }
+    }
+
+    // Lowest detrended envelope point, referred to the newest sample
+    double floor = 0.0;
+    for (uint32_t i = 0; i < blockCount; i++) {
+        double detrended = static_cast<double>(blockResidualNanos[i] - base) -
+            drift * static_cast<double>(blockGnssNanos[i] - referenceNanos);
+        if (i == 0 || detrended < floor) {
+            floor = detrended;
+        }
+    }
+    offsetNanos = base + static_cast<int64_t>(llround(floor));
+
+    double sumSquares = 0.0;
+    double maxDelay = 0.0;
+    for (uint32_t i = 0; i < count; i++) {
+        double delay = static_cast<double>(residualNanos[i] - offsetNanos) -
+            drift * static_cast<double>(gnssNanos[i] - referenceNanos);
+        if (delay < 0.0) {
+            delay = 0.0;
+        }
+        sumSquares += delay * delay;
+        if (delay > maxDelay) {
+            maxDelay = delay;
+        }
+    }
+    jitterNanos = count > 0 ? sqrt(sumSquares / count) : 0.0;
+    maxDelayNanos = static_cast<int64_t>(llround(maxDelay));
+}
+
+/**
+ * @brief   Predict the host time at which the solution for iTOW is (or was) readable.
+ *
+ * @param   iTow    GPS time of week in milliseconds, within half a week of the newest sample.
+ * @return  CLOCK_MONOTONIC nanoseconds, or 0 before the first sample.
+ */
+uint64_t GnssClockEstimator::HostNanos(uint32_t iTow) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    int64_t delta = (static_cast<int64_t>(iTow) - static_cast<int64_t>(lastITow));
+    if (delta > CLOCK_WEEK_MILLIS / 2) {
+        delta -= CLOCK_WEEK_MILLIS;
+    } else if (delta < -CLOCK_WEEK_MILLIS / 2) {
+        delta += CLOCK_WEEK_MILLIS;
+    }
+
+    int64_t gnss = referenceNanos + delta * static_cast<int64_t>(NANOS_PER_MILLI);
+    double correction = drift * static_cast<double>(gnss - referenceNanos);
+    return static_cast<uint64_t>(gnss + offsetNanos + static_cast<int64_t>(llround(correction)));
+}
+
+/**
+ * @brief   Report the current estimate.
+ */
+GnssClockStats GnssClockEstimator::GetStats(void) const {
+    GnssClockStats stats;
+    stats.samples = count;
+    stats.blocks = blockCount;
+    stats.resets = resets;
+    stats.offsetNanos = offsetNanos;
+    stats.driftPpb = drift * 1e9;
+    stats.jitterNanos = static_cast<uint32_t>(jitterNanos);
+    stats.maxDelayNanos = static_cast<uint32_t>(maxDelayNanos);
+    return stats;
+}
@@ -0,0 +1,126 @@
+#include "epoch_scheduler.h"
+#include <errno.h>
+#include <time.h>
+
+/**
+ * @brief   Constructor for the EpochScheduler class.
+ *
+ * @param   periodMillis    The navigation solution period (measurement period * navigation rate).
+ */
+EpochScheduler::EpochScheduler(uint16_t periodMillis) {
+    SetPeriod(periodMillis);
+    offsetNanos = 0;
+    lastITow = 0;
+}
+
+/**
+ * @brief   Change the navigation solution period; the epoch phase is re-learned.
+ *
+ * @param   periodMillis    The new period in milliseconds (0 is treated as 1).
+ */
+void EpochScheduler::SetPeriod(uint16_t periodMillis) {
+    periodNanos = (periodMillis > 0 ? periodMillis : 1) * NANOS_PER_MILLI;
+    synced = false;
+}
+
+/**
+ * @brief   Record that the solution for iTOW was read at readNanos.
+ *
+ * @param   iTow        GPS time of week of the solution in milliseconds.
+ * @param   readNanos   CLOCK_MONOTONIC time at which the read completed.
+ * @param   afterWait   true if the read followed a sleep until NextCheckNanos().
+ */
+void EpochScheduler::OnFix(uint32_t iTow, uint64_t readNanos, bool afterWait) {
+    int64_t sample = static_cast<int64_t>(readNanos) - static_cast<int64_t>(iTow) * static_cast<int64_t>(NANOS_PER_MILLI);
+    int64_t delay = sample - offsetNanos;
+
+    lastITow = iTow;
+
+    if (!synced || delay > static_cast<int64_t>(EPOCH_RESYNC_NANOS) ||
+        delay < -static_cast<int64_t>(EPOCH_RESYNC_NANOS)) {
+        // First fix, week rollover or receiver restart
+        offsetNanos = sample;
+        synced = true;
+        return;
+    }
+
+    if (!afterWait) {
+        if (delay < 0) {
+            offsetNanos = sample;
+        }
+        return;
+    }
+
+    if (delay > static_cast<int64_t>(EPOCH_WAKE_GUARD_NANOS + EPOCH_RETRY_NANOS / 2)) {
+        // Needed retries: the solution shows up later than predicted
+        offsetNanos += (delay - static_cast<int64_t>(EPOCH_WAKE_GUARD_NANOS)) / 2;
+    } else {
+        offsetNanos -= EPOCH_PROBE_NANOS;
+    }
+}
+
+/**
+ * @brief   Predict when the first solution after nowNanos becomes readable.
+ *
+ * @param   nowNanos    The current CLOCK_MONOTONIC time.
+ * @return  The CLOCK_MONOTONIC time at which the next solution is due.
+ */
+uint64_t EpochScheduler::NextDueNanos(uint64_t nowNanos) const {
+    if (!synced) {
+        return nowNanos + periodNanos / EPOCH_UNSYNCED_DIVISOR;
+    }
+
+    int64_t elapsed = static_cast<int64_t>(nowNanos) - offsetNanos;
+    int64_t period = static_cast<int64_t>(periodNanos);
+    int64_t epochs = elapsed / period + 1;
+    return static_cast<uint64_t>(offsetNanos + epochs * period);
+}
+
+/**
+ * @brief   Pick the next time to look at the data stream after finding it empty.
+ *
+ * If the solution for the epoch that just passed has not been read yet it is late,
+ * so check again shortly; otherwise sleep until just after the next epoch is due.
+ *
+ * @param   nowNanos    The current CLOCK_MONOTONIC time.
+ * @return  The CLOCK_MONOTONIC time to wake up at.
+ */
+uint64_t EpochScheduler::NextCheckNanos(uint64_t nowNanos) const {
+    if (!synced) {
+        return nowNanos + periodNanos / EPOCH_UNSYNCED_DIVISOR;
+    }
+
+    int64_t period = static_cast<int64_t>(periodNanos);
+    int64_t elapsed = static_cast<int64_t>(nowNanos) - offsetNanos;
+    int64_t previousDue = offsetNanos + (elapsed / period) * period;
+    int64_t previousITow = (previousDue - offsetNanos) / static_cast<int64_t>(NANOS_PER_MILLI);
+
+    bool pending = previousITow > static_cast<int64_t>(lastITow);
+    if (pending && static_cast<int64_t>(nowNanos) - previousDue < period / 2) {
+        return nowNanos + EPOCH_RETRY_NANOS;
+    }
+
+    return NextDueNanos(nowNanos) + EPOCH_WAKE_GUARD_NANOS;
+}
+
+/**
+ * @brief   Read CLOCK_MONOTONIC in nanoseconds.
+ */
+uint64_t EpochScheduler::NowNanos(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * NANOS_PER_SECOND + static_cast<uint64_t>(now.tv_nsec);
+}
+
+/**
+ * @brief   Sleep until an absolute CLOCK_MONOTONIC time, resuming after signals.
+ *
+ * @param   wakeNanos   The absolute wake-up time in nanoseconds.
+ */
+void EpochScheduler::SleepUntil(uint64_t wakeNanos) {
+    struct timespec wake;
+    wake.tv_sec = static_cast<time_t>(wakeNanos / NANOS_PER_SECOND);
+    wake.tv_nsec = static_cast<long>(wakeNanos % NANOS_PER_SECOND);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr) == EINTR) {
+    }
+}
@@ -1,35 +1,92 @@
 #include "gps.h"
+#include "nmea_parser.h"
 
 /**
  * @brief   Constructor for the Gps class.
  *
- * Initializes the GPS module communication, sets message send rates, and measurement frequencies.
+ * Initializes the GPS module communication with the default navigation configuration
+ * (DEFAULT_NAVIGATION_CONFIG: one solution every 100 ms, constellations unchanged).
  */
-Gps::Gps(int16_t currentYear=DEFAULT_YEAR) {
-	const char *deviceName = GPS_I2C_BUS;
-	i2c_fd = open(deviceName, O_RDWR);
-	if (i2c_fd < 0) {
-		perror("Unable to open I2C GPS device");
-	}
+template <class Transport>
+BasicGps<Transport>::BasicGps(int16_t currentYear) : BasicGps(currentYear, GpsNavigationConfig DEFAULT_NAVIGATION_CONFIG) {
+}
+
+/**
+ * @brief   Constructor for the Gps class on the transport's default port.
+ *
+ * @param   currentYear The current year, used to reject fixes with an unresolved date.
+ * @param   navigation  The navigation rate and constellations; see ValidateNavigationConfig().
+ */
+template <class Transport>
+BasicGps<Transport>::BasicGps(int16_t currentYear, const GpsNavigationConfig &navigation) :
+	BasicGps(currentYear, navigation, Transport()) {
+}
 
-	if (ioctl(i2c_fd, I2C_SLAVE, GPS_I2C_ADDRESS) < 0) {
-		perror("Failed to acquire I2C GPS address");
+/**
+ * @brief   Constructor for the Gps class.
+ *
+ * Initializes the GPS module communication, sets message send rates, and applies the
+ * measurement period, navigation rate and constellation selection.
+ *
+ * @param   currentYear The current year, used to reject fixes with an unresolved date.
+ * @param   navigation  The navigation rate and constellations; see ValidateNavigationConfig().
+ * @param   transport   The port to use, not yet opened (e.g. a SerialTransport for a tty).
+ */
+template <class Transport>
+BasicGps<Transport>::BasicGps(int16_t currentYear, const GpsNavigationConfig &navigation, const Transport &transport) :
+	transport(transport), scheduler(DEFAULT_UPDATE_MILLS) {
+	this->init();
+	this->transport.Open();
+
+	uint8_t navigationError = ValidateNavigationConfig(navigation);
+	if (navigationError != NAV_CONFIG_OK) {
+		printf("Error: Invalid navigation configuration: %s.\n", NavigationConfigErrorToString(navigationError));
+		exit(-1);
 	}
 
-	this->ubxOnly();
+	// Poll, diff and write the whole configuration as one pipelined transaction
+	UbxConfigTransaction config;
+	this->ubxOnly(config);
+	this->setMessageSendRate(config, NAV_CLASS, NAV_PVT, 1);
+	this->addNavigationConfig(config, navigation);
 
-	bool result = this->setMessageSendRate(NAV_CLASS, NAV_PVT, 1);
-	if (!result) {
-		printf("Error: Failed to set message send rate for NAV_PVT.\n");
+	if (!this->commitConfig(config, DEFAULT_PERSIST_CONFIG)) {
+		for (uint8_t i = 0; i < config.Count(); i++) {
+			const UbxConfigEntry &entry = config.Entry(i);
+			if (entry.status != CONFIG_STATUS_ACKED && entry.status != CONFIG_STATUS_SKIPPED) {
+				printf("Error: CFG message 0x%02X 0x%02X was %s.\n", entry.msgClass, entry.msgId,
+					entry.status == CONFIG_STATUS_NAKED ? "rejected" : "not acknowledged");
+			}
+		}
 		exit(-1);
 	}
+	scheduler.SetPeriod(navigationPeriodMillis);
+	this->navigationConfig = navigation;
 
-	result = this->setMeasurementFrequency(MEASUREMENT_PERIOD_MILLIS_100_MS, 1, 0);
-	if (!result) {
-		printf("Error: Failed to set measurement frequency.\n");
+	if (currentYear == DEFAULT_YEAR) {
+		printf("Error: Current year is not set.\n");
 		exit(-1);
 	}
 
+	this->currentYear = currentYear;
+}
+
+/**
+ * @brief   Constructor for the Gps class that replays a capture instead of using the bus.
+ *
+ * Nothing is opened or configured: the capture already holds the receiver's output,
+ * which is read through the same framer, dispatcher and GetPvt/GetPvtView path as a
+ * live module. Written frames (polls, configuration) are discarded, so configuration
+ * calls fail. Fixes carry the host timestamps recorded in the capture.
+ *
+ * @param   currentYear The current year, used to reject fixes with an unresolved date.
+ * @param   replay      An open capture; must outlive this object.
+ */
+template <class Transport>
+BasicGps<Transport>::BasicGps(int16_t currentYear, UbxCaptureReader &replay) : scheduler(DEFAULT_UPDATE_MILLS) {
+	this->init();
+	this->replay = &replay;
+
 	if (currentYear == DEFAULT_YEAR) {
 		printf("Error: Current year is not set.\n");
 		exit(-1);
@@ -38,86 +95,719 @@ Gps::Gps(int16_t currentYear=DEFAULT_YEAR) {
 	this->currentYear = currentYear;
 }
 
+/**
+ * @brief   Reset the driver state and register the status message handlers.
+ */
+template <class Transport>
+void BasicGps<Transport>::init(void) {
+	this->ResetBusStats();
+	this->rxHead = 0;
+	this->rxLength = 0;
+	this->rxStampNanos = 0;
+	this->replay = nullptr;
+	this->nmea = nullptr;
+	this->nmeaOverruns = 0;
+	this->acquisitionRunning = false;
+	this->fixesQueued = 0;
+	this->overruns = 0;
+	this->drops = 0;
+	this->nextFixDueNanos = 0;
+	this->lastFixValid = false;
+	this->lastFixNew = false;
+	this->lastFixITow = 0;
+	this->lastFixRxNanos = 0;
+	this->outputLatencyNanos = DEFAULT_OUTPUT_LATENCY_NANOS;
+	this->ResetFixStats();
+	this->navigationPeriodMillis = DEFAULT_UPDATE_MILLS;
+	this->navigationConfig = GpsNavigationConfig DEFAULT_NAVIGATION_CONFIG;
+	memset(&this->configStats, 0, sizeof(this->configStats));
+	this->statusReceived = 0;
+	this->lastGoodFixValid = false;
+	this->autosavePeriodNanos = 0;
+	this->nextAutosaveNanos = 0;
+	memset(&this->databaseStats, 0, sizeof(this->databaseStats));
+	this->RestartTtff();
+
+	// Status messages are decoded as they arrive once their output is enabled (EnableMessage)
+	dispatcher.Register(NAV_CLASS, NAV_SAT, &BasicGps::onNavSat, this);
+	dispatcher.Register(NAV_CLASS, NAV_DOP, &BasicGps::onNavDop, this);
+	dispatcher.Register(NAV_CLASS, NAV_STATUS, &BasicGps::onNavStatus, this);
+	dispatcher.Register(NAV_CLASS, NAV_TIMEUTC, &BasicGps::onNavTimeUtc, this);
+	dispatcher.Register(MON_CLASS, MON_HW, &BasicGps::onMonHw, this);
+}
+
 /**
  * @brief   Destructor for the Gps class.
  *
  * Closes the communication with the GPS module.
  */
-Gps::~Gps(void) { close(i2c_fd); }
+template <class Transport>
+BasicGps<Transport>::~BasicGps(void) {
+	StopAcquisition();
+	StopRecording();
+	transport.Close();
+	delete nmea;
+}
 
 /**
  * @brief   Configure the GPS module to use UBX protocol exclusively.
  *
- * Sends a UBX configuration message to the GPS module to use UBX protocol only.
+ * Queues a CFG-PRT message that restricts the transport's port (DDC for I2C, UART1
+ * at the configured baud rate for serial) to UBX in and out.
+ *
+ * @param   config  The transaction to add the message to.
  */
-void Gps::ubxOnly(void) {
-    uint8_t payload[] = {
-        0x00, 0x00, 0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00,
-        0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
+template <class Transport>
+void BasicGps<Transport>::ubxOnly(UbxConfigTransaction &config) {
+    uint8_t payload[CFG_PRT_PAYLOAD_LENGTH];
+    transport.PortConfig(payload);
+    uint8_t poll[] = {Transport::PortId};
 
-    UbxMessage message = ComposeMessage(CFG_CLASS, CFG_PRT, 20, payload);
-
-    bool result = this->writeUbxMessage(message);
-    if (!result) {
-      exit(-1);
-    }
+    config.Add(CFG_CLASS, CFG_PRT, payload, sizeof(payload), poll, sizeof(poll), true);
 }
 
 /**
- * @brief   Set the message send rate for a specific UBX message.
+ * @brief   Set the message send rate for a specific UBX message on the transport's port.
  *
+ * @param   config      The transaction to add the CFG-MSG message to.
  * @param   msgClass    The message class of the UBX message.
  * @param   msgId       The message ID of the UBX message.
  * @param   sendRate    The desired message send rate (default is DEFAULT_SEND_RATE).
- * @return  true if the message send rate was successfully set, false otherwise.
  */
-bool Gps::setMessageSendRate(uint8_t msgClass, uint8_t msgId, uint8_t sendRate = DEFAULT_SEND_RATE) {
-    uint8_t payload[] = {msgClass, msgId, sendRate, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-    UbxMessage message = ComposeMessage(CFG_CLASS, CFG_MSG, 8, payload);
+template <class Transport>
+void BasicGps<Transport>::setMessageSendRate(UbxConfigTransaction &config, uint8_t msgClass, uint8_t msgId, uint8_t sendRate) {
+    uint8_t payload[CFG_MSG_PAYLOAD_LENGTH];
+    CfgMsg::Schema::Encode(payload, msgClass, msgId, 0, 0, 0, 0, 0);
+    payload[CfgMsg::RateDdc::offset + Transport::PortId] = sendRate;   // One rate per port, by port id
+    uint8_t poll[] = {msgClass, msgId};
 
-    bool result = this->writeUbxMessage(message);
-
-    return result;
+    config.Add(CFG_CLASS, CFG_MSG, payload, sizeof(payload), poll, sizeof(poll), true);
 }
 
 /**
  * @brief   Set the measurement frequency of the GPS module.
  *
+ * @param   config                  The transaction to add the CFG-RATE message to.
  * @param   measurementPeriodMillis The measurement period in milliseconds (default is DEFAULT_UPDATE_MILLS).
  * @param   navigationRate          The navigation rate (default is 1).
  * @param   timeref                 The time reference (default is 0).
- * @return  true if the measurement frequency was successfully set, false otherwise.
  */
-bool Gps::setMeasurementFrequency(uint16_t measurementPeriodMillis = DEFAULT_UPDATE_MILLS, uint8_t navigationRate = 1, uint8_t timeref = 0) {
-    uint8_t payload[6];
+template <class Transport>
+void BasicGps<Transport>::setMeasurementFrequency(UbxConfigTransaction &config, uint16_t measurementPeriodMillis, uint8_t navigationRate, uint8_t timeref) {
+    uint8_t payload[CFG_RATE_PAYLOAD_LENGTH];
+    CfgRate::Schema::Encode(payload, measurementPeriodMillis, navigationRate, timeref);
+
+    config.Add(CFG_CLASS, CFG_RATE, payload, sizeof(payload), nullptr, 0, true);
+    // ValidateNavigationConfig() keeps the product within MAX_SOLUTION_PERIOD_MILLIS
+    navigationPeriodMillis = static_cast<uint16_t>(measurementPeriodMillis * navigationRate);
+}
+
+/** Per-GNSS CFG-GNSS block contents as reported by M8 firmware with the default setup */
+typedef struct {
+    uint8_t gnssId;
+    uint8_t resTrkCh;
+    uint8_t maxTrkCh;
+    uint8_t sigCfgMask;
+} GnssBlockDefaults;
+
+static const GnssBlockDefaults GNSS_BLOCK_DEFAULTS[GNSS_ID_COUNT] = {
+    {GNSS_ID_GPS, 8, 16, 0x01},         // L1C/A
+    {GNSS_ID_SBAS, 1, 3, 0x01},         // L1C/A
+    {GNSS_ID_GALILEO, 4, 8, 0x01},      // E1
+    {GNSS_ID_BEIDOU, 8, 16, 0x01},      // B1I
+    {GNSS_ID_IMES, 0, 8, 0x01},         // L1 (not supported by the SAM-M8Q, always disabled)
+    {GNSS_ID_QZSS, 0, 3, 0x05},         // L1C/A, L1SAIF
+    {GNSS_ID_GLONASS, 8, 14, 0x01}      // L1
+};
+
+#define CFG_GNSS_ENABLE_FLAG 0x00000001
+#define CFG_GNSS_SIG_CFG_SHIFT 16
+#define CFG_GNSS_RESERVED_FLAGS 0x01000000   // Reported set by the firmware; written back unchanged
+
+/**
+ * @brief   Select the constellations the receiver tracks.
+ *
+ * Queues a CFG-GNSS message with one block per GNSS. The channel split matches the
+ * receiver's defaults, so a configuration that is already in effect is skipped.
+ *
+ * @param   config      The transaction to add the message to.
+ * @param   gnssMask    The GNSS_MASK_* bits to enable; every other GNSS is disabled.
+ */
+template <class Transport>
+void BasicGps<Transport>::setGnss(UbxConfigTransaction &config, uint8_t gnssMask) {
+    uint8_t payload[CFG_GNSS_HEADER_LENGTH + GNSS_ID_COUNT * CFG_GNSS_BLOCK_LENGTH];
+    CfgGnss::Schema::Encode(payload, 0, GNSS_TRACKING_CHANNELS, GNSS_TRACKING_CHANNELS, GNSS_ID_COUNT);
+
+    for (uint8_t i = 0; i < GNSS_ID_COUNT; i++) {
+        const GnssBlockDefaults &defaults = GNSS_BLOCK_DEFAULTS[i];
+        uint32_t flags = CFG_GNSS_RESERVED_FLAGS | static_cast<uint32_t>(defaults.sigCfgMask) << CFG_GNSS_SIG_CFG_SHIFT;
+        if (gnssMask & (1 << defaults.gnssId)) {
+            flags |= CFG_GNSS_ENABLE_FLAG;
+        }
+
+        CfgGnss::Block::Schema::Encode(&payload[CFG_GNSS_HEADER_LENGTH + i * CFG_GNSS_BLOCK_LENGTH],
+            defaults.gnssId, defaults.resTrkCh, defaults.maxTrkCh, flags);
+    }
+
+    config.Add(CFG_CLASS, CFG_GNSS, payload, sizeof(payload), nullptr, 0, true);
+}
+
+/**
+ * @brief   Queue CFG-RATE and, if requested, CFG-GNSS for a navigation configuration.
+ *
+ * The receiver applies messages in order, so when the new rate needs fewer GNSS the
+ * constellations are switched first, and otherwise the rate is lowered first; the
+ * receiver never runs a rate its current constellations cannot sustain.
+ *
+ * @param   config      The transaction to add the messages to.
+ * @param   navigation  A configuration accepted by ValidateNavigationConfig().
+ */
+template <class Transport>
+void BasicGps<Transport>::addNavigationConfig(UbxConfigTransaction &config, const GpsNavigationConfig &navigation) {
+    uint32_t solutionPeriodMillis = static_cast<uint32_t>(navigation.measurementPeriodMillis) * navigation.navigationRate;
+    bool highRate = solutionPeriodMillis * MAX_NAVIGATION_UPDATE_RATE_HZ_CONCURRENT < 1000;
 
-    payload[0] = static_cast<uint8_t>(measurementPeriodMillis & BYTE_MASK);
-    payload[1] = static_cast<uint8_t>((measurementPeriodMillis >> BYTE_SHIFT_AMOUNT) & BYTE_MASK);
-    payload[2] = navigationRate;
-    payload[3] = 0x00;
-    payload[4] = timeref;
-    payload[5] = 0x00;
+    if (navigation.gnssMask != GNSS_MASK_UNCHANGED && highRate) {
+        this->setGnss(config, navigation.gnssMask);
+    }
+    this->setMeasurementFrequency(config, navigation.measurementPeriodMillis, navigation.navigationRate,
+        navigation.timeReference);
+    if (navigation.gnssMask != GNSS_MASK_UNCHANGED && !highRate) {
+        this->setGnss(config, navigation.gnssMask);
+    }
+}
 
-    UbxMessage message = ComposeMessage(CFG_CLASS, CFG_RATE, 6, payload);
+/**
+ * @brief   Check a navigation configuration against the SAM-M8Q limits.
+ *
+ * - The measurement period is at least MIN_MEASUREMENT_PERIOD_MILLIS, the navigation
+ *   rate is 1..MAX_NAVIGATION_RATE, and their product, the solution period, is at
+ *   most MAX_SOLUTION_PERIOD_MILLIS.
+ * - At most MAX_CONCURRENT_GNSS major GNSS (GPS, Galileo, BeiDou, GLONASS); SBAS and
+ *   QZSS only together with GPS.
+ * - Solutions faster than MAX_NAVIGATION_UPDATE_RATE_HZ_CONCURRENT need exactly one
+ *   major GNSS and are limited to MAX_NAVIGATION_UPDATE_RATE_HZ_SINGLE. With
+ *   GNSS_MASK_UNCHANGED the constellations are unknown, so the concurrent limit applies.
+ *
+ * @param   navigation  The configuration to check.
+ * @return  NAV_CONFIG_OK or one of the NAV_CONFIG_* errors.
+ */
+template <class Transport>
+uint8_t BasicGps<Transport>::ValidateNavigationConfig(const GpsNavigationConfig &navigation) {
+    if (navigation.measurementPeriodMillis < MIN_MEASUREMENT_PERIOD_MILLIS) {
+        return NAV_CONFIG_INVALID_PERIOD;
+    }
+    if (navigation.navigationRate == 0 || navigation.navigationRate > MAX_NAVIGATION_RATE) {
+        return NAV_CONFIG_INVALID_NAV_RATE;
+    }
+    if (navigation.timeReference > MAX_TIME_REFERENCE) {
+        return NAV_CONFIG_INVALID_TIME_REF;
+    }
+    uint32_t solutionPeriodMillis = static_cast<uint32_t>(navigation.measurementPeriodMillis) * navigation.navigationRate;
+    if (solutionPeriodMillis > MAX_SOLUTION_PERIOD_MILLIS) {
+        return NAV_CONFIG_PERIOD_TOO_LONG;
+    }
+
+    uint32_t maxRateHz = MAX_NAVIGATION_UPDATE_RATE_HZ_CONCURRENT;
+    if (navigation.gnssMask != GNSS_MASK_UNCHANGED) {
+        uint8_t major = navigation.gnssMask & GNSS_MASK_MAJOR;
+        if ((navigation.gnssMask & ~(GNSS_MASK_MAJOR | GNSS_MASK_AUGMENTATION)) != 0 || major == 0) {
+            return NAV_CONFIG_INVALID_GNSS;
+        }
 
-    bool result = writeUbxMessage(message);
+        uint8_t majorCount = 0;
+        for (uint8_t bits = major; bits != 0; bits &= bits - 1) {
+            majorCount++;
+        }
+        if (majorCount > MAX_CONCURRENT_GNSS) {
+            return NAV_CONFIG_TOO_MANY_GNSS;
+        }
+        if ((navigation.gnssMask & GNSS_MASK_AUGMENTATION) != 0 && (navigation.gnssMask & GNSS_MASK_GPS) == 0) {
+            return NAV_CONFIG_AUGMENTATION_WITHOUT_GPS;
+        }
+        if (majorCount == 1) {
+            maxRateHz = MAX_NAVIGATION_UPDATE_RATE_HZ_SINGLE;
+        }
+    }
+
+    if (solutionPeriodMillis * maxRateHz < 1000) {
+        return NAV_CONFIG_RATE_TOO_HIGH;
+    }
 
-    return result;
+    return NAV_CONFIG_OK;
+}
+
+/** Descriptions of the NAV_CONFIG_* codes */
+static const char *const NAV_CONFIG_ERRORS[] = {
+    "ok",
+    "measurement period too short",
+    "navigation rate out of range",
+    "unknown time reference",
+    "no or unknown GNSS selected",
+    "too many concurrent GNSS",
+    "SBAS/QZSS require GPS",
+    "navigation rate too high for the selected GNSS",
+    "solution period too long"
+};
+
+/**
+ * @brief   Describe a NAV_CONFIG_* code returned by ValidateNavigationConfig().
+ */
+template <class Transport>
+const char *BasicGps<Transport>::NavigationConfigErrorToString(uint8_t error) {
+    if (error < sizeof(NAV_CONFIG_ERRORS) / sizeof(NAV_CONFIG_ERRORS[0])) {
+        return NAV_CONFIG_ERRORS[error];
+    }
+    return "unknown error";
+}
+
+/**
+ * @brief   Change the navigation rate and constellations at run time.
+ *
+ * Must not be called while acquisition is running. Switching constellations makes
+ * the receiver restart its GNSS tracking, so expect a short gap in fixes.
+ *
+ * @param   navigation  The new configuration; see ValidateNavigationConfig().
+ * @return  true if the configuration is valid and was acknowledged, false otherwise.
+ */
+template <class Transport>
+bool BasicGps<Transport>::SetNavigationConfig(const GpsNavigationConfig &navigation) {
+    if (IsAcquiring() || ValidateNavigationConfig(navigation) != NAV_CONFIG_OK) {
+        return false;
+    }
+
+    uint16_t previousPeriodMillis = navigationPeriodMillis;
+    UbxConfigTransaction config;
+    this->addNavigationConfig(config, navigation);
+    if (!this->commitConfig(config, false)) {
+        navigationPeriodMillis = previousPeriodMillis;
+        return false;
+    }
+
+    scheduler.SetPeriod(navigationPeriodMillis);
+    navigationConfig = navigation;
+    return true;
+}
+
+/**
+ * @brief   Save the receiver's current configuration to its non-volatile memory (CFG-CFG).
+ *
+ * @return  true if the receiver acknowledged the save, false otherwise.
+ */
+template <class Transport>
+bool BasicGps<Transport>::SaveConfiguration(void) {
+    UbxConfigTransaction config;
+    this->saveConfiguration(config);
+    return commitConfig(config, false);
+}
+
+/**
+ * @brief   Queue a CFG-CFG message that saves the current configuration to all devices.
+ *
+ * @param   config  The transaction to add the message to.
+ */
+template <class Transport>
+void BasicGps<Transport>::saveConfiguration(UbxConfigTransaction &config) {
+    uint8_t payload[CFG_CFG_PAYLOAD_LENGTH];
+    CfgCfg::Schema::Encode(payload, 0, CFG_CFG_SAVE_MASK, 0, CFG_CFG_DEVICE_MASK);
+
+    config.Add(CFG_CLASS, CFG_CFG, payload, sizeof(payload), nullptr, 0, false);
+}
+
+/**
+ * @brief   Apply a configuration transaction with pipelined polls, writes and ACK matching.
+ *
+ * All polls are sent back to back and answered together; entries whose current value
+ * already matches are skipped; the rest are written back to back and their ACK/NAKs
+ * are matched as they arrive. Optionally the result is saved with CFG-CFG.
+ *
+ * @param   config  The transaction to apply; entry statuses are updated in place.
+ * @param   persist Save the configuration to non-volatile memory if anything was written.
+ * @return  true if every entry is acknowledged or already in effect, false otherwise.
+ */
+template <class Transport>
+bool BasicGps<Transport>::commitConfig(UbxConfigTransaction &config, bool persist) {
+    // A capture cannot acknowledge anything
+    if (replay != nullptr) {
+        return false;
+    }
+
+    uint64_t start = EpochScheduler::NowNanos();
+    uint8_t frame[UBX_FRAME_OVERHEAD + CONFIG_MAX_PAYLOAD_LENGTH];
+
+    // Poll phase: read back what the receiver currently has
+    for (uint8_t i = 0; i < config.Count(); i++) {
+        UbxConfigEntry &entry = config.Entry(i);
+        if (!entry.pollable) {
+            continue;
+        }
+        uint16_t length = ComposeFrame(frame, entry.msgClass, entry.msgId, entry.pollLength, entry.poll);
+        if (writeUbxFrame(frame, length)) {
+            entry.outstandingAcks++;
+        } else {
+            entry.polled = true;
+        }
+    }
+    waitForConfig(config, true);
+
+    // Write phase: only what differs
+    bool anyWrites = false;
+    for (uint8_t i = 0; i < config.Count(); i++) {
+        anyWrites |= config.Entry(i).status == CONFIG_STATUS_PENDING;
+    }
+    if (persist && anyWrites) {
+        this->saveConfiguration(config);
+    }
+
+    for (uint8_t i = 0; i < config.Count(); i++) {
+        UbxConfigEntry &entry = config.Entry(i);
+        if (entry.status != CONFIG_STATUS_PENDING) {
+            continue;
+        }
+        uint16_t length = ComposeFrame(frame, entry.msgClass, entry.msgId, entry.payloadLength, entry.payload);
+        entry.status = CONFIG_STATUS_SENT;
+        if (writeUbxFrame(frame, length)) {
+            entry.outstandingAcks++;
+        }
+    }
+    waitForConfig(config, false);
+    config.ExpireOutstanding();
+
+    configStats = config.Summarize();
+    configStats.elapsedMillis = static_cast<uint32_t>((EpochScheduler::NowNanos() - start) / NANOS_PER_MILLI);
+    return config.Succeeded();
+}
+
+/**
+ * @brief   Route received messages to the transaction until the phase is answered.
+ *
+ * @param   config      The transaction being applied.
+ * @param   pollPhase   true while waiting for poll responses, false while waiting for ACKs.
+ */
+template <class Transport>
+void BasicGps<Transport>::waitForConfig(UbxConfigTransaction &config, bool pollPhase) {
+    uint64_t deadline = EpochScheduler::NowNanos() + CONFIG_ACK_TIMEOUT_MILLS * NANOS_PER_MILLI;
+    bool graceStarted = false;
+
+    while (true) {
+        UbxMessageView message = this->readUbxMessage();
+        if (message.IsValid()) {
+            if (!config.OnAck(message) && !config.OnPollResponse(message)) {
+                dispatcher.Dispatch(message);
+            }
+            continue;
+        }
+
+        uint64_t now = EpochScheduler::NowNanos();
+        if (!config.AcksOutstanding()) {
+            return;
+        }
+        if (pollPhase && config.PollsAnswered() && !graceStarted) {
+            // Responses are in; poll ACKs still pending are matched during the write phase
+            uint64_t grace = now + CONFIG_POLL_ACK_GRACE_MILLS * NANOS_PER_MILLI;
+            deadline = grace < deadline ? grace : deadline;
+            graceStarted = true;
+        }
+        if (now >= deadline) {
+            return;
+        }
+
+        uint64_t wake = now + CONFIG_IDLE_MILLS * NANOS_PER_MILLI;
+        EpochScheduler::SleepUntil(wake < deadline ? wake : deadline);
+    }
+}
+
+/**
+ * @brief   Dump the receiver's navigation database (MGA-DBD poll) and save it with the last fix.
+ *
+ * Must not be called while acquisition runs, except by the acquisition thread itself
+ * (SetDatabaseAutosave()). NAV-PVT output arriving during the dump (about a second)
+ * is not returned.
+ *
+ * @param   path    The file to write; the previous file is kept if the dump is incomplete.
+ * @return  true if a complete dump was saved.
+ */
+template <class Transport>
+bool BasicGps<Transport>::SaveNavigationDatabase(const char *path) {
+	if (replay != nullptr || (IsAcquiring() && std::this_thread::get_id() != acquisitionThread.get_id())) {
+		return false;
+	}
+
+	uint64_t start = EpochScheduler::NowNanos();
+	UbxNavDatabase database;
+	bool saved = dumpNavigationDatabase(database);
+	if (lastGoodFixValid) {
+		database.SetLastFix(NavPvtView(UbxMessageView(lastGoodFix)));
+	}
+	saved = saved && database.Save(path);
+
+	std::lock_guard<std::mutex> lock(statusMutex);
+	if (saved) {
+		databaseStats.saves++;
+		databaseStats.savedMessages = database.DbdCount();
+		databaseStats.savedBytes = static_cast<uint32_t>(database.DbdBytes());
+		databaseStats.saveMillis = static_cast<uint32_t>((EpochScheduler::NowNanos() - start) / NANOS_PER_MILLI);
+	} else {
+		databaseStats.saveFailures++;
+	}
+	return saved;
+}
+
+/**
+ * @brief   Poll MGA-DBD and collect the messages of the dump.
+ *
+ * @param   database    Receives the MGA-DBD messages.
+ * @return  true if the receiver sent its database and confirmed the number of messages
+ *          (or stopped sending after at least one).
+ */
+template <class Transport>
+bool BasicGps<Transport>::dumpNavigationDatabase(UbxNavDatabase &database) {
+	uint8_t frame[UBX_FRAME_OVERHEAD];
+	uint16_t length = ComposeFrame(frame, MGA_CLASS, MGA_DBD, 0, nullptr);
+	if (!writeUbxFrame(frame, length)) {
+		return false;
+	}
+
+	uint64_t now = EpochScheduler::NowNanos();
+	uint64_t deadline = now + ASSIST_DUMP_TIMEOUT_MILLS * NANOS_PER_MILLI;
+	uint64_t idleDeadline = now + ASSIST_DUMP_IDLE_MILLS * NANOS_PER_MILLI;
+	while (true) {
+		UbxMessageView message = this->readUbxMessage();
+		if (message.IsValid()) {
+			if (database.AddDbd(message)) {
+				idleDeadline = EpochScheduler::NowNanos() + ASSIST_DUMP_IDLE_MILLS * NANOS_PER_MILLI;
+			} else if (MgaAck::Schema::Matches(message.MsgClass(), message.MsgId(), message.PayloadLength()) &&
+				MgaAck::MsgId::Get(message.Payload().data()) == MGA_DBD) {
+				// The receiver reports how many messages it sent; any lost frame spoils the dump
+				return MgaAck::MsgPayloadStart::Get(message.Payload().data()) == database.DbdCount();
+			} else {
+				dispatcher.Dispatch(message);
+			}
+			continue;
+		}
+
+		now = EpochScheduler::NowNanos();
+		if (now >= deadline || now >= idleDeadline) {
+			return database.DbdCount() > 0 && now < deadline;
+		}
+		uint64_t wake = now + ASSIST_IDLE_MILLS * NANOS_PER_MILLI;
+		EpochScheduler::SleepUntil(wake < idleDeadline ? wake : idleDeadline);
+	}
+}
+
+/**
+ * @brief   Restore a saved navigation database, with the current time and last position.
+ *
+ * Call right after construction, before acquisition starts. Turns on MGA-ACK
+ * (CFG-NAVX5 ackAiding) for flow control, then sends MGA-INI-TIME_UTC from the host
+ * clock (if it is set, i.e. not before the configured current year), MGA-INI-POS_LLH
+ * from the saved fix and every saved MGA-DBD message. Also restarts the TTFF
+ * measurement; GetDatabaseStats().restore tells how much the receiver accepted.
+ *
+ * @param   path    A file written by SaveNavigationDatabase().
+ * @return  true if everything was sent, false if the file could not be read or the
+ *          upload failed.
+ */
+template <class Transport>
+bool BasicGps<Transport>::RestoreNavigationDatabase(const char *path) {
+	if (replay != nullptr || IsAcquiring()) {
+		return false;
+	}
+
+	UbxNavDatabase database;
+	if (!database.Load(path)) {
+		return false;
+	}
+
+	// Without ACKs the upload is paced instead
+	UbxConfigTransaction config;
+	uint8_t payload[CFG_NAVX5_PAYLOAD_LENGTH];
+	CfgNavx5::Schema::Encode(payload, CFG_NAVX5_VERSION, CFG_NAVX5_MASK1_ACK_AIDING, 0, 1);
+	config.Add(CFG_CLASS, CFG_NAVX5, payload, sizeof(payload), nullptr, 0, false);
+	bool acking = commitConfig(config, false);
+
+	UbxAssistUpload upload;
+	uint8_t frame[UBX_FRAME_OVERHEAD + MGA_INI_TIME_UTC_PAYLOAD_LENGTH];
+	struct timespec utc;
+	struct tm calendar;
+	bool timeKnown = clock_gettime(CLOCK_REALTIME, &utc) == 0 && gmtime_r(&utc.tv_sec, &calendar) != nullptr &&
+		calendar.tm_year + 1900 >= currentYear;
+	if (timeKnown) {
+		upload.Add(frame, ComposeIniTime(frame, utc, ASSIST_TIME_ACCURACY_MILLIS));
+	}
+	if (database.HasLastFix()) {
+		upload.Add(frame, ComposeIniPosition(frame, database.LastFix(), ASSIST_POSITION_MARGIN_CM));
+	}
+	upload.AddFrames(database.DbdFrames(), database.DbdBytes());
+	if (!acking) {
+		upload.StopWaitingForAcks();
+	}
+
+	bool sent = uploadAssistance(upload);
+	{
+		std::lock_guard<std::mutex> lock(statusMutex);
+		databaseStats.restore = upload.GetStats();
+	}
+
+	RestartTtff();
+	if (timeKnown || database.HasLastFix()) {
+		startKind = database.DbdCount() > 0 ? GPS_START_DATABASE : GPS_START_AIDED;
+	}
+	return sent;
+}
+
+/**
+ * @brief   Write MGA frames with flow control and match their MGA-ACKs.
+ *
+ * @param   upload  The frames; statistics are updated in place.
+ * @return  true if every frame was written.
+ */
+template <class Transport>
+bool BasicGps<Transport>::uploadAssistance(UbxAssistUpload &upload) {
+	uint64_t start = EpochScheduler::NowNanos();
+	uint64_t ackDeadline = start + ASSIST_ACK_TIMEOUT_MILLS * NANOS_PER_MILLI;
+	bool written = true;
+
+	while (!upload.Done()) {
+		while (upload.CanSend()) {
+			uint16_t length;
+			const uint8_t *frame = upload.Next(length);
+			written &= writeUbxFrame(frame, length);
+			if (upload.Paced()) {
+				EpochScheduler::SleepUntil(EpochScheduler::NowNanos() + ASSIST_PACING_MILLS * NANOS_PER_MILLI);
+			}
+		}
+
+		UbxMessageView message = this->readUbxMessage();
+		if (message.IsValid()) {
+			if (upload.OnAck(message)) {
+				ackDeadline = EpochScheduler::NowNanos() + ASSIST_ACK_TIMEOUT_MILLS * NANOS_PER_MILLI;
+			} else {
+				dispatcher.Dispatch(message);
+			}
+			continue;
+		}
+
+		uint64_t now = EpochScheduler::NowNanos();
+		if (now >= ackDeadline) {
+			upload.StopWaitingForAcks();
+			continue;
+		}
+		uint64_t wake = now + ASSIST_IDLE_MILLS * NANOS_PER_MILLI;
+		EpochScheduler::SleepUntil(wake < ackDeadline ? wake : ackDeadline);
+	}
+
+	upload.SetElapsed(static_cast<uint32_t>((EpochScheduler::NowNanos() - start) / NANOS_PER_MILLI));
+	return written;
+}
+
+/**
+ * @brief   Save the navigation database periodically from the acquisition thread, and
+ *          once more when acquisition stops.
+ *
+ * Must not be called while acquisition runs.
+ *
+ * @param   path            The file to write, or nullptr to turn autosave off.
+ * @param   periodSeconds   Time between saves; ephemerides stay useful for about 4 hours.
+ */
+template <class Transport>
+void BasicGps<Transport>::SetDatabaseAutosave(const char *path, uint32_t periodSeconds) {
+	autosavePath = path != nullptr ? path : "";
+	autosavePeriodNanos = static_cast<uint64_t>(periodSeconds) * NANOS_PER_SECOND;
+	nextAutosaveNanos = EpochScheduler::NowNanos() + autosavePeriodNanos;
+}
+
+/**
+ * @brief   Report the navigation database saves and the last restore; safe to call
+ *          while acquisition (and autosave) runs.
+ */
+template <class Transport>
+GpsDatabaseStats BasicGps<Transport>::GetDatabaseStats(void) {
+	std::lock_guard<std::mutex> lock(statusMutex);
+	return databaseStats;
+}
+
+/**
+ * @brief   Report the time to first fix of the current start.
+ */
+template <class Transport>
+GpsTtffStats BasicGps<Transport>::GetTtffStats(void) {
+	GpsTtffStats stats;
+	stats.start = startKind;
+	stats.ttffMillis = firstFixNanos != 0 ?
+		static_cast<uint32_t>((firstFixNanos - ttffStartNanos) / NANOS_PER_MILLI) : 0;
+	stats.elapsedMillis = static_cast<uint32_t>((EpochScheduler::NowNanos() - ttffStartNanos) / NANOS_PER_MILLI);
+
+	std::lock_guard<std::mutex> lock(statusMutex);
+	stats.receiverTtffMillis = (statusReceived & STATUS_NAV_STATUS) ? navStatus.timeToFirstFix : 0;
+	return stats;
+}
+
+/**
+ * @brief   Start measuring TTFF again, e.g. after power cycling the receiver.
+ */
+template <class Transport>
+void BasicGps<Transport>::RestartTtff(void) {
+	startKind = GPS_START_COLD;
+	ttffStartNanos = EpochScheduler::NowNanos();
+	firstFixNanos = 0;
+}
+
+/**
+ * @brief   Select how the data stream register is read; only I2C has more than one way.
+ *
+ * @param   mode    GPS_READ_MODE_BLOCK (default) or GPS_READ_MODE_BYTE.
+ */
+template <class Transport>
+void BasicGps<Transport>::SetReadMode(uint8_t mode) {
+	transport.SetReadMode(mode);
+}
+
+/**
+ * @brief   Reset the transaction and byte counters.
+ */
+template <class Transport>
+void BasicGps<Transport>::ResetBusStats(void) {
+	memset(&busStats, 0, sizeof(busStats));
+}
+
+/**
+ * @brief   Read bytes from the receiver's output stream.
+ *
+ * @param   buf     Destination buffer, at least length bytes long.
+ * @param   length  The number of bytes to read (from getAvailableBytes).
+ * @return  true if all bytes were read, false otherwise.
+ */
+template <class Transport>
+bool BasicGps<Transport>::readDataStream(uint8_t *buf, uint16_t length) {
+	if (replay != nullptr) {
+		uint16_t offset = 0;
+		while (offset < length) {
+			uint16_t chunk = replay->Read(&buf[offset], length - offset, rxStampNanos);
+			if (chunk == 0) {
+				return false;
+			}
+			offset += chunk;
+		}
+		busStats.bytesRead += length;
+		return true;
+	}
+
+	return transport.Read(buf, length, busStats);
 }
 
 /**
  * @brief   Retrieve the number of available bytes for reading from the GPS module.
  *
- * @return  The number of available bytes.
+ * @return  The number of available bytes, 0 if the read failed.
  */
-uint16_t Gps::getAvailableBytes() {
-  uint8_t msb = i2c_smbus_read_byte_data(i2c_fd, AVAILABLE_BYTES_MSB);
-  uint8_t lsb = i2c_smbus_read_byte_data(i2c_fd, AVAILABLE_BYTES_LSB);
+template <class Transport>
+uint16_t BasicGps<Transport>::getAvailableBytes() {
+  if (replay != nullptr) {
+    return replay->Available(EpochScheduler::NowNanos());
+  }
 
-  uint16_t availableBytes = (msb << BYTE_SHIFT_AMOUNT) | lsb;
-  return availableBytes;
+  return transport.Available(busStats);
 }
 
 /**
@@ -126,81 +816,219 @@ uint16_t Gps::getAvailableBytes() {
  * @param   msg The UBX message to be written.
  * @return  true if the message was successfully written, false otherwise.
  */
-bool Gps::writeUbxMessage(UbxMessage &msg) {
-	std::vector<uint8_t> tempBuf;
-	tempBuf.push_back(msg.sync1);
-	tempBuf.push_back(msg.sync2);
-	tempBuf.push_back(msg.msgClass);
-	tempBuf.push_back(msg.msgId);
-	tempBuf.push_back(msg.payloadLength & BYTE_MASK);
-	tempBuf.push_back(msg.payloadLength >> BYTE_SHIFT_AMOUNT);
-	for (int i = 0; i < msg.payloadLength; i++) {
-		tempBuf.push_back(msg.payload[i]);
-	}
-	tempBuf.push_back(msg.checksumA);
-	tempBuf.push_back(msg.checksumB);
-
-	uint8_t buf[tempBuf.size()];
-	for (int i = 0; i < tempBuf.size(); i++) {
-		buf[i] = tempBuf[i];
-	}
-
-	for (int i = 0; i < tempBuf.size(); i++) {
-		if (write(i2c_fd, buf, sizeof(buf)) != sizeof(buf)) {
-		perror("Failed to write to I2C device");
-		close(i2c_fd);
-		return 1;
-		}
+template <class Transport>
+bool BasicGps<Transport>::writeUbxMessage(UbxMessage &msg) {
+	uint8_t frame[UBX_MAX_FRAME_LENGTH];
+	uint16_t length = ComposeFrame(frame, msg.msgClass, msg.msgId, msg.payloadLength, msg.payload);
+
+	return writeUbxFrame(frame, length);
+}
+
+/**
+ * @brief   Write an already serialized UBX frame to the GPS module in one transaction.
+ *
+ * @param   frame   The frame bytes, as produced by ComposeFrame.
+ * @param   length  The number of bytes in frame.
+ * @return  true if the frame was successfully written, false otherwise.
+ */
+template <class Transport>
+bool BasicGps<Transport>::writeUbxFrame(const uint8_t *frame, uint16_t length) {
+	if (replay != nullptr) {
+		return true;
+	}
+	if (recorder.IsOpen()) {
+		recorder.Write(CAPTURE_RECORD_TX, EpochScheduler::NowNanos(), frame, length);
+	}
+
+	return transport.Write(frame, length, busStats);
+}
+
+/**
+ * @brief   Drain queued bytes from the GPS module into the receive buffer.
+ *
+ * Only called once the framer has consumed everything already buffered.
+ *
+ * @return  true if new bytes were read, false if none were available or the read failed.
+ */
+template <class Transport>
+bool BasicGps<Transport>::fillRxBuffer(void) {
+	uint16_t available = getAvailableBytes();
+	if (available == 0) {
+		return false;
+	}
+	if (available > GPS_RX_BUFFER_LENGTH) {
+		available = GPS_RX_BUFFER_LENGTH;
 	}
 
+	rxHead = 0;
+	rxLength = 0;
+	if (!readDataStream(rxBuffer, available)) {
+		return false;
+	}
+	if (replay == nullptr) {
+		rxStampNanos = EpochScheduler::NowNanos();
+	}
+	if (recorder.IsOpen()) {
+		recorder.Write(CAPTURE_RECORD_RX, rxStampNanos, rxBuffer, available);
+	}
+	if (nmea != nullptr) {
+		parseNmea(rxBuffer, available);
+	}
+	rxLength = available;
 	return true;
 }
 
 /**
- * @brief   Read a UBX message from the GPS module.
+ * @brief   Queue the NMEA epochs completed by newly drained bytes.
+ *
+ * The UBX framer sees the same bytes and skips the sentences; the parser skips the
+ * UBX frames. When the queue is full the oldest epoch is dropped.
  *
- * @return  The read UBX message.
+ * @param   data    The bytes just read.
+ * @param   length  The number of bytes.
  */
-UbxMessage Gps::readUbxMessage(void) {
-	uint16_t messageLength = getAvailableBytes();
-  	std::vector<uint8_t> message;
+template <class Transport>
+void BasicGps<Transport>::parseNmea(const uint8_t *data, uint16_t length) {
+	size_t offset = 0;
+	while (true) {
+		offset += nmea->Consume(&data[offset], length - offset);
+		if (!nmea->EpochReady()) {
+			break;
+		}
+		if (nmeaEpochs.size() == GPS_NMEA_QUEUE_CAPACITY) {
+			nmeaEpochs.pop_front();
+			nmeaOverruns++;
+		}
+		nmeaEpochs.push_back(nmea->Epoch());
+		nmeaEpochs.back().hostReceiveNanos = rxStampNanos;
+	}
+}
 
-  	if (messageLength > 2 && messageLength < MAX_MESSAGE_LENGTH) {
-		for (int i = 0; i < messageLength; i++) {
-			uint8_t byte_data = i2c_smbus_read_byte_data(i2c_fd, DATA_STREAM_REGISTER);
-			if (byte_data < -1) {
-				perror("Failed to read byte from I2C device");
-				UbxMessage badMsg;
-				badMsg.sync1 = INVALID_SYNC_FLAG;
-				return badMsg;
-			}
-			message.push_back(static_cast<uint8_t>(byte_data));
+/**
+ * @brief   Read the next UBX message from the GPS module.
+ *
+ * Messages are extracted from the byte stream by the framer, so several messages
+ * queued in one read are returned one per call without touching the bus again,
+ * and frames with a bad checksum are never returned.
+ *
+ * @return  A view of the message inside the framer's buffer, valid until the next
+ *          read; IsValid() is false if no complete message is available.
+ */
+template <class Transport>
+UbxMessageView BasicGps<Transport>::readUbxMessage(void) {
+	while (true) {
+		rxHead += framer.Consume(&rxBuffer[rxHead], rxLength - rxHead);
+		if (framer.FrameReady()) {
+			return UbxMessageView(framer.Frame());
+		}
+		if (!fillRxBuffer()) {
+			break;
 		}
+	}
 
-		if (message[0] == SYNC_CHAR_1 && message[1] == SYNC_CHAR_2) {
-			UbxMessage ubxMsg;
-			ubxMsg.sync1 = message[0];
-			ubxMsg.sync2 = message[1];
-			ubxMsg.msgClass = message[2];
-			ubxMsg.msgId = message[3];
-			ubxMsg.payloadLength = (message[5] << BYTE_SHIFT_AMOUNT | message[4]);
-			if (ubxMsg.payloadLength > messageLength) {
-			UbxMessage badMsg;
-			badMsg.sync1 = INVALID_SYNC_FLAG;
-			return badMsg;
-			}
-			memcpy(&ubxMsg.payload, &message[6], ubxMsg.payloadLength);
-			ubxMsg.checksumA = message[message.size() - 2];
-			ubxMsg.checksumB = message[message.size() - 1];
+	return UbxMessageView();
+}
 
-			return ubxMsg;
-		}
+/**
+ * @brief   Retrieve the next NAV-PVT message from the GPS module without decoding it.
+ *
+ * Fields are only decoded when read through the returned view, so consumers that need
+ * a handful of fields (e.g. latitude/longitude) skip the rest of the payload.
+ *
+ * Without polling this is a subscription to the receiver's periodic output (CFG-MSG
+ * NAV-PVT rate 1, set up by the constructor): nothing is written to the bus, and a
+ * NAV-PVT repeating the epoch that was already returned is dropped, so every fix
+ * returned is new. With polling a poll request is written first and the answer is
+ * returned even if it repeats the last epoch; LastPvtIsNew() tells the two apart.
+ *
+ * When nothing is queued the call sleeps until just after the next navigation epoch
+ * is due (or briefly, after a poll) and checks the module once more, until the
+ * timeout expires. A timeout of 0 checks exactly once.
+ *
+ * @param   polling         Whether to poll the GPS module for new data.
+ * @param   timeOutMillis   The longest time in milliseconds to wait for a message.
+ * @return  A view of the NAV-PVT message, valid until the next call that reads from
+ *          the module; IsValid() is false if no NAV-PVT message arrived in time.
+ */
+template <class Transport>
+NavPvtView BasicGps<Transport>::GetPvtView(bool polling, uint16_t timeOutMillis) {
+	uint64_t deadline = EpochScheduler::NowNanos() + timeOutMillis * NANOS_PER_MILLI;
+
+	if (polling) {
+		uint8_t frame[UBX_FRAME_OVERHEAD];
+		uint16_t length = ComposeFrame(frame, NAV_CLASS, NAV_PVT, 0, nullptr);
+		this->writeUbxFrame(frame, length);
+		fixStats.polls++;
 	}
 
-  UbxMessage badMsg;
-  badMsg.sync1 = INVALID_SYNC_FLAG;
+	bool afterWait = false;
+	while (true) {
+		// The solution was readable when this check started; bus time must not count as latency
+		uint64_t checkNanos = EpochScheduler::NowNanos();
+
+		// Route any other queued messages (status, ACKs, INF, ...) ahead of the NAV-PVT
+		UbxMessageView message = this->readUbxMessage();
+		while (message.IsValid() && !message.Is(NAV_CLASS, NAV_PVT)) {
+			dispatcher.Dispatch(message);
+			message = this->readUbxMessage();
+		}
+
+		NavPvtView pvt(message);
+		uint64_t now = EpochScheduler::NowNanos();
+		if (pvt.IsValid()) {
+			uint32_t iTow = pvt.ITow();
+			bool isNew = !lastFixValid || iTow != lastFixITow;
+			if (isNew) {
+				scheduler.OnFix(iTow, checkNanos, afterWait && !polling);
+				fixStats.fixes++;
+
+				// The frame was complete once the read that delivered its last byte returned
+				uint64_t epochNanos = 0;
+				{
+					std::lock_guard<std::mutex> lock(clockMutex);
+					clock.AddSample(iTow, rxStampNanos);
+					if (clock.IsValid()) {
+						epochNanos = clock.HostNanos(iTow) - outputLatencyNanos;
+					}
+				}
+				std::lock_guard<std::mutex> lock(historyMutex);
+				history.Push(pvt, epochNanos);
+
+				// Keep the newest good fix as the position for the next start
+				if ((pvt.Flags() & NAV_PVT_FLAGS_GNSS_FIX_OK) && pvt.Message().FrameLength() == sizeof(lastGoodFix)) {
+					memcpy(lastGoodFix, pvt.Message().Data(), sizeof(lastGoodFix));
+					lastGoodFixValid = true;
+					if (firstFixNanos == 0) {
+						firstFixNanos = rxStampNanos;
+					}
+				}
+			} else {
+				fixStats.duplicates++;
+			}
+
+			if (isNew || polling) {
+				lastFixValid = true;
+				lastFixNew = isNew;
+				lastFixITow = iTow;
+				lastFixRxNanos = rxStampNanos;
+				return pvt;
+			}
+			// Repeated epoch on the periodic output: drop it and look for the next one
+			continue;
+		}
+		if (now >= deadline || (replay != nullptr && replay->AtEnd())) {
+			lastFixNew = false;
+			return pvt;
+		}
 
-  return badMsg;
+		// A poll is answered right away; otherwise wait for the next epoch (or replayed record)
+		uint64_t wake = polling ? now + EPOCH_RETRY_NANOS : scheduler.NextCheckNanos(now);
+		if (replay != nullptr) {
+			wake = replay->NextReadableNanos(now);
+		}
+		EpochScheduler::SleepUntil(wake < deadline ? wake : deadline);
+		afterWait = true;
+	}
 }
 
 /**
@@ -210,124 +1038,587 @@ UbxMessage Gps::readUbxMessage(void) {
  * @param   timeOutMillis   The timeout in milliseconds for data retrieval (default is DEFAULT_UPDATE_MILLS).
  * @return  The PVTData structure containing GPS-related information.
  */
-PVTData Gps::GetPvt(bool polling = DEFAULT_POLLING_STATE,
-	uint16_t timeOutMillis = DEFAULT_UPDATE_MILLS) {
+template <class Transport>
+PVTData BasicGps<Transport>::GetPvt(bool polling, uint16_t timeOutMillis) {
 
-	if (polling) {
-		UbxMessage message = ComposeMessage(NAV_CLASS, NAV_PVT, 0, nullptr);
-		this->writeUbxMessage(message);
+	NavPvtView pvt = this->GetPvtView(polling, timeOutMillis);
+	if (!pvt.IsValid() || !decodePvt(pvt, this->pvtData)) {
+		pvtData.year = INVALID_YEAR_FLAG;
+		pvtData.newFix = 0;
+	}
+
+	return this->pvtData;
+}
+
+/**
+ * @brief   Clear the new/duplicate epoch and poll counters.
+ */
+template <class Transport>
+void BasicGps<Transport>::ResetFixStats(void) {
+	memset(&fixStats, 0, sizeof(fixStats));
+}
+
+/**
+ * @brief   Record everything read from and written to the module to a capture file.
+ *
+ * Must not be called while background acquisition is running.
+ *
+ * @param   path    The capture file to create; an existing file is overwritten.
+ * @return  true if recording started, false if the file could not be created or
+ *          acquisition is running.
+ */
+template <class Transport>
+bool BasicGps<Transport>::StartRecording(const char *path) {
+	if (IsAcquiring()) {
+		return false;
 	}
+	return recorder.Open(path);
+}
 
-	UbxMessage message = this->readUbxMessage();
+/**
+ * @brief   Flush and close the capture file. Must not be called while acquiring.
+ */
+template <class Transport>
+void BasicGps<Transport>::StopRecording(void) {
+	recorder.Close();
+}
 
-	if (message.sync1 != INVALID_SYNC1_FLAG) {
-		pvtData.year = u2_to_int(&message.payload[4]);
-		if (pvtData.year != currentYear) {
-			pvtData.year = INVALID_YEAR_FLAG;
-			return this->pvtData;
+/**
+ * @brief   Report the GNSS-to-host clock offset, drift and jitter estimate.
+ */
+template <class Transport>
+GnssClockStats BasicGps<Transport>::GetClockStats(void) {
+	std::lock_guard<std::mutex> lock(clockMutex);
+	return clock.GetStats();
+}
+
+/**
+ * @brief   Convert the GPS time of week of a navigation epoch into host monotonic time.
+ *
+ * Uses the clock model fitted to the fixes read so far, minus the receiver output
+ * latency set with SetOutputLatency(), so the result can be compared directly with
+ * CLOCK_MONOTONIC stamps of other sensors (e.g. IMU samples).
+ *
+ * @param   iTow    GPS time of week in milliseconds.
+ * @return  CLOCK_MONOTONIC nanoseconds, or 0 before the first fix.
+ */
+template <class Transport>
+uint64_t BasicGps<Transport>::GnssToHostNanos(uint32_t iTow) {
+	std::lock_guard<std::mutex> lock(clockMutex);
+	if (!clock.IsValid()) {
+		return 0;
+	}
+	return clock.HostNanos(iTow) - outputLatencyNanos;
+}
+
+/**
+ * @brief   Position and velocity at a host monotonic time, interpolated between fixes.
+ *
+ * @param   hostNanos   CLOCK_MONOTONIC time, e.g. the timestamp of an IMU sample.
+ * @param   sample      Receives the interpolated state.
+ * @param   mode        PVT_INTERPOLATE_LINEAR or PVT_INTERPOLATE_HERMITE.
+ * @return  true if the time is covered by the recent fixes (or slightly past the newest).
+ */
+template <class Transport>
+bool BasicGps<Transport>::GetPvtAtHostTime(uint64_t hostNanos, PvtSample &sample, uint8_t mode) {
+	std::lock_guard<std::mutex> lock(historyMutex);
+	return history.AtHostTime(hostNanos, sample, mode);
+}
+
+/**
+ * @brief   Position and velocity at a GPS time of week, interpolated between fixes.
+ *
+ * @param   iTowMillis  GPS time of week in milliseconds.
+ * @param   sample      Receives the interpolated state.
+ * @param   mode        PVT_INTERPOLATE_LINEAR or PVT_INTERPOLATE_HERMITE.
+ * @return  true if the time is covered by the recent fixes (or slightly past the newest).
+ */
+template <class Transport>
+bool BasicGps<Transport>::GetPvtAtGnssTime(double iTowMillis, PvtSample &sample, uint8_t mode) {
+	std::lock_guard<std::mutex> lock(historyMutex);
+	return history.AtGnssTime(iTowMillis, sample, mode);
+}
+
+/**
+ * @brief   Decode a NAV-PVT view into a PVTData structure.
+ *
+ * @param   pvt     A valid NAV-PVT view.
+ * @param   data    The structure to fill.
+ * @return  true if the fix is for the configured current year, false otherwise
+ *          (data is then only partially filled).
+ */
+template <class Transport>
+bool BasicGps<Transport>::decodePvt(const NavPvtView &pvt, PVTData &data) {
+	data.year = pvt.Year();
+	if (data.year != currentYear) {
+		return false;
+	}
+	DecodePvtFields(pvt, data);
+	data.hostReceiveNanos = lastFixRxNanos;
+	data.hostEpochNanos = GnssToHostNanos(data.iTOW);
+	data.newFix = lastFixNew ? 1 : 0;
+
+	return true;
+}
+
+/**
+ * @brief   Convert every NAV-PVT payload field into its PVTData member.
+ *
+ * Host timing (hostReceiveNanos, hostEpochNanos) and newFix are not part of the
+ * message and are left unchanged.
+ *
+ * @param   pvt     A valid NAV-PVT view.
+ * @param   data    The structure to fill.
+ */
+template <class Transport>
+void BasicGps<Transport>::DecodePvtFields(const NavPvtView &pvt, PVTData &data) {
+	data.iTOW = pvt.ITow();
+	data.year = pvt.Year();
+	data.nano = pvt.Nano();
+	data.timeAccuracy = pvt.TimeAccuracy();
+	data.month = pvt.Month();
+	data.day = pvt.Day();
+	data.hour = pvt.Hour();
+	data.min = pvt.Min();
+	data.sec = pvt.Sec();
+	uint8_t valid_flag = pvt.Valid();
+
+	// Extract and clarify flags
+	data.validDateFlag = (valid_flag & VALID_DATE_FLAG) == VALID_DATE_FLAG ? 1 : 0;
+	data.validTimeFlag = (valid_flag & VALID_TIME_FLAG) == VALID_TIME_FLAG ? 1 : 0;
+	data.fullyResolved = (valid_flag & FULLY_RESOLVED_FLAG) == FULLY_RESOLVED_FLAG ? 1 : 0;
+	data.validMagFlag = (valid_flag & VALID_MAG_FLAG) == VALID_MAG_FLAG ? 1 : 0;
+
+	// Extract GNSS fix and related data
+	data.gnssFix = pvt.FixType();
+	data.fixStatusFlags = pvt.Flags();
+	data.numberOfSatellites = pvt.NumSv();
+
+	// Extract longitude and latitude in degrees
+	data.longitude = pvt.Longitude();
+	data.latitude = pvt.Latitude();
+	data.height = pvt.Height();
+	data.heightMSL = pvt.HeightMSL();
+	// Extract horizontal and vertical accuracy in millimeters
+	data.horizontalAccuracy = pvt.HorizontalAccuracy();
+	data.verticalAccuracy = pvt.VerticalAccuracy();
+	// Extract North East Down velocity in mm/s
+	data.velocityNorth = pvt.VelocityNorth();
+	data.velocityEast = pvt.VelocityEast();
+	data.velocityDown = pvt.VelocityDown();
+	// Extract ground speed in mm/s and motion heading in degrees
+	data.groundSpeed = pvt.GroundSpeed();
+	data.motionHeading = pvt.MotionHeading();
+	// Extract speed accuracy in mm/s and heading accuracy in degrees
+	data.speedAccuracy = pvt.SpeedAccuracy();
+	data.motionHeadingAccuracy = pvt.MotionHeadingAccuracy();
+	// Extract vehicle heading in degrees
+	data.vehicalHeading = pvt.VehicleHeading();
+	// Extract magnetic declination and accuracy in degrees
+	data.magneticDeclination = pvt.MagneticDeclination();
+	data.magnetDeclinationAccuracy = pvt.MagneticDeclinationAccuracy();
+}
+
+/**
+ * @brief   Have the receiver output a message periodically on the I2C port.
+ *
+ * The rate counts navigation solutions, so 1 delivers the message every epoch with
+ * no polling round trip. NAV-SAT, NAV-DOP, NAV-STATUS, NAV-TIMEUTC and MON-HW are
+ * decoded as they arrive and can be read with the matching Get function. Must not
+ * be called while acquisition is running.
+ *
+ * @param   msgClass    The message class.
+ * @param   msgId       The message ID.
+ * @param   sendRate    Output once every sendRate solutions (0 disables the message).
+ * @return  true if the receiver acknowledged the rate or already had it, false otherwise.
+ */
+template <class Transport>
+bool BasicGps<Transport>::EnableMessage(uint8_t msgClass, uint8_t msgId, uint8_t sendRate) {
+	if (IsAcquiring()) {
+		return false;
+	}
+
+	UbxConfigTransaction config;
+	this->setMessageSendRate(config, msgClass, msgId, sendRate);
+	return this->commitConfig(config, false);
+}
+
+/**
+ * @brief   Parse the receiver's NMEA output into fixes for GetNmeaPvt().
+ *
+ * Turns NMEA output on (or back off) on the transport's port next to UBX and sets
+ * RMC, GGA, VTG and GSA to one per solution, so the same receiver can be read either
+ * way. When replaying a capture nothing is written and only parsing is switched.
+ * Must not be called while acquisition is running.
+ *
+ * @param   enable  true to parse NMEA, false to return to UBX only.
+ * @return  true if the receiver acknowledged the configuration (or when replaying),
+ *          false otherwise.
+ */
+template <class Transport>
+bool BasicGps<Transport>::EnableNmea(bool enable) {
+	if (IsAcquiring()) {
+		return false;
+	}
+
+	if (enable && nmea == nullptr) {
+		nmea = new NmeaParser();
+	} else if (!enable && nmea != nullptr) {
+		delete nmea;
+		nmea = nullptr;
+		nmeaEpochs.clear();
+	}
+	if (replay != nullptr) {
+		return true;
+	}
+
+	UbxConfigTransaction config;
+	uint8_t payload[CFG_PRT_PAYLOAD_LENGTH];
+	transport.PortConfig(payload);
+	if (enable) {
+		CfgPrt::OutProtoMask::Put(payload, PORT_PROTOCOL_UBX | PORT_PROTOCOL_NMEA);
+	}
+	uint8_t poll[] = {Transport::PortId};
+	config.Add(CFG_CLASS, CFG_PRT, payload, sizeof(payload), poll, sizeof(poll), true);
+
+	const uint8_t sentences[] = {NMEA_RMC, NMEA_GGA, NMEA_VTG, NMEA_GSA};
+	for (uint8_t i = 0; i < sizeof(sentences); i++) {
+		this->setMessageSendRate(config, NMEA_CLASS, sentences[i], enable ? 1 : 0);
+	}
+	return this->commitConfig(config, false);
+}
+
+/**
+ * @brief   Retrieve the next fix parsed from the receiver's NMEA sentences.
+ *
+ * The NMEA counterpart of GetPvt() for EnableNmea(): epochs are queued as the bytes
+ * arrive, so UBX messages in between are dispatched as usual (NAV-PVT is dropped).
+ * hostReceiveNanos is the read that completed the epoch; fields NMEA does not carry
+ * are 0. At the end of a replayed capture the last pending epoch is returned.
+ *
+ * @param   timeOutMillis   The longest time in milliseconds to wait for an epoch.
+ * @return  The next epoch; year is INVALID_YEAR_FLAG and newFix 0 if none arrived
+ *          in time, NMEA is not enabled, or the date is not the current year.
+ */
+template <class Transport>
+PVTData BasicGps<Transport>::GetNmeaPvt(uint16_t timeOutMillis) {
+	uint64_t deadline = EpochScheduler::NowNanos() + timeOutMillis * NANOS_PER_MILLI;
+
+	while (nmea != nullptr && !IsAcquiring()) {
+		if (!nmeaEpochs.empty()) {
+			PVTData data = nmeaEpochs.front();
+			nmeaEpochs.pop_front();
+			if (data.year != currentYear) {
+				break;
+			}
+			return data;
 		}
-		pvtData.month = message.payload[6];
-		pvtData.day = message.payload[7];
-		pvtData.hour = message.payload[8];
-		pvtData.min = message.payload[9];
-		pvtData.sec = message.payload[10];
-		uint8_t valid_flag = message.payload[11];
-
-		// Extract and clarify flags
-		pvtData.validDateFlag = (valid_flag & VALID_DATE_FLAG) == VALID_DATE_FLAG ? 1 : 0;
-		pvtData.validTimeFlag = (valid_flag & VALID_TIME_FLAG) == VALID_TIME_FLAG ? 1 : 0;
-		pvtData.fullyResolved = (valid_flag & FULLY_RESOLVED_FLAG) == FULLY_RESOLVED_FLAG ? 1 : 0;
-		pvtData.validMagFlag = (valid_flag & VALID_MAG_FLAG) == VALID_MAG_FLAG ? 1 : 0;
-
-		// Extract GNSS fix and related data
-		pvtData.gnssFix = message.payload[20];
-		memcpy(&pvtData.fixStatusFlags, &message.payload[21], 2);
-		pvtData.numberOfSatellites = message.payload[23];
-
-		// Extract longitude and latitude in degrees
-		pvtData.longitude = i4_to_int(&message.payload[24])* 1e-07;
-		pvtData.latitude = i4_to_int(&message.payload[28]) * 1e-07;
-		pvtData.height = i4_to_int(&message.payload[32]);
-		pvtData.heightMSL = i4_to_int(&message.payload[36]);
-		// Extract horizontal and vertical accuracy in millimeters
-		pvtData.horizontalAccuracy = u4_to_int(&message.payload[40]);
-		pvtData.verticalAccuracy = u4_to_int(&message.payload[44]);
-		// Extract North East Down velocity in mm/s
-		pvtData.velocityNorth = i4_to_int(&message.payload[48]);
-		pvtData.velocityEast = i4_to_int(&message.payload[52]);
-		pvtData.velocityDown = i4_to_int(&message.payload[56]);
-		// Extract ground speed in mm/s and motion heading in degrees
-		pvtData.groundSpeed = i4_to_int(&message.payload[60]);
-		pvtData.motionHeading = i4_to_int(&message.payload[64]) * 1e-05;
-		// Extract speed accuracy in mm/s and heading accuracy in degrees
-		pvtData.speedAccuracy = u4_to_int(&message.payload[68]);
-		pvtData.motionHeadingAccuracy = u4_to_int(&message.payload[72]) * 1e-05;
-		// Extract vehicle heading in degrees
-		pvtData.vehicalHeading = i4_to_int(&message.payload[84]) * 1e-05;
-		// Extract magnetic declination and accuracy in degrees
-		pvtData.magneticDeclination = i2_to_int(&message.payload[88]) * 1e-02;
-		pvtData.magnetDeclinationAccuracy = u2_to_int(&message.payload[90]) * 1e-02;
-
-		return this->pvtData;
-	}
-
-	pvtData.year = INVALID_YEAR_FLAG;
-	return this->pvtData;
+
+		// Drain only until an epoch completes, routing the UBX frames passed on the way
+		while (nmeaEpochs.empty()) {
+			rxHead += framer.Consume(&rxBuffer[rxHead], rxLength - rxHead);
+			if (framer.FrameReady()) {
+				dispatcher.Dispatch(UbxMessageView(framer.Frame()));
+			} else if (!fillRxBuffer()) {
+				break;
+			}
+		}
+		if (!nmeaEpochs.empty()) {
+			continue;
+		}
+
+		uint64_t now = EpochScheduler::NowNanos();
+		if (replay != nullptr && replay->AtEnd()) {
+			nmea->Flush();
+			if (!nmea->EpochReady()) {
+				break;
+			}
+			nmeaEpochs.push_back(nmea->Epoch());
+			nmeaEpochs.back().hostReceiveNanos = rxStampNanos;
+			continue;
+		}
+		if (now >= deadline) {
+			break;
+		}
+		uint64_t wake = replay != nullptr ? replay->NextReadableNanos(now) : now + EPOCH_RETRY_NANOS;
+		EpochScheduler::SleepUntil(wake < deadline ? wake : deadline);
+	}
+
+	PVTData invalid;
+	memset(&invalid, 0, sizeof(invalid));
+	invalid.year = INVALID_YEAR_FLAG;
+	return invalid;
 }
 
 /**
- * @brief   Convert a little-endian byte array to a signed 16-bit integer.
+ * @brief   Route every received message with the given class and id to a handler.
+ *
+ * The handler runs on the thread reading the module; the view it receives is only
+ * valid during the call. NAV-PVT is always returned through GetPvt/GetPvtView instead.
+ * Must not be called while acquisition is running.
  *
- * @param   little_endian_bytes The input byte array.
- * @return  The converted signed 16-bit integer.
+ * @param   msgClass    The message class.
+ * @param   msgId       The message ID.
+ * @param   handler     The function to call.
+ * @param   context     Passed to the handler unchanged.
+ * @return  true if registered, false otherwise.
  */
-int16_t Gps::i2_to_int(const uint8_t *little_endian_bytes) {
-    return (int16_t)(((uint16_t)little_endian_bytes[1] << BYTE_SHIFT_AMOUNT) |
-		(uint16_t)little_endian_bytes[0]);
+template <class Transport>
+bool BasicGps<Transport>::RegisterHandler(uint8_t msgClass, uint8_t msgId, UbxHandler handler, void *context) {
+	if (IsAcquiring()) {
+		return false;
+	}
+
+	return dispatcher.Register(msgClass, msgId, handler, context);
+}
+
+template <class Transport>
+void BasicGps<Transport>::onNavSat(const UbxMessageView &msg, void *context) {
+	BasicGps *gps = static_cast<BasicGps *>(context);
+	std::lock_guard<std::mutex> lock(gps->statusMutex);
+	if (DecodeNavSat(msg, gps->navSat)) {
+		gps->statusReceived |= STATUS_NAV_SAT;
+	}
+}
+
+template <class Transport>
+void BasicGps<Transport>::onNavDop(const UbxMessageView &msg, void *context) {
+	BasicGps *gps = static_cast<BasicGps *>(context);
+	std::lock_guard<std::mutex> lock(gps->statusMutex);
+	if (DecodeNavDop(msg, gps->navDop)) {
+		gps->statusReceived |= STATUS_NAV_DOP;
+	}
+}
+
+template <class Transport>
+void BasicGps<Transport>::onNavStatus(const UbxMessageView &msg, void *context) {
+	BasicGps *gps = static_cast<BasicGps *>(context);
+	std::lock_guard<std::mutex> lock(gps->statusMutex);
+	if (DecodeNavStatus(msg, gps->navStatus)) {
+		gps->statusReceived |= STATUS_NAV_STATUS;
+	}
+}
+
+template <class Transport>
+void BasicGps<Transport>::onNavTimeUtc(const UbxMessageView &msg, void *context) {
+	BasicGps *gps = static_cast<BasicGps *>(context);
+	std::lock_guard<std::mutex> lock(gps->statusMutex);
+	if (DecodeNavTimeUtc(msg, gps->navTimeUtc)) {
+		gps->statusReceived |= STATUS_NAV_TIMEUTC;
+	}
+}
+
+template <class Transport>
+void BasicGps<Transport>::onMonHw(const UbxMessageView &msg, void *context) {
+	BasicGps *gps = static_cast<BasicGps *>(context);
+	std::lock_guard<std::mutex> lock(gps->statusMutex);
+	if (DecodeMonHw(msg, gps->monHw)) {
+		gps->statusReceived |= STATUS_MON_HW;
+	}
 }
 
 /**
- * @brief   Convert a little-endian byte array to an unsigned 16-bit integer.
+ * @brief   Copy the latest NAV-SAT message; safe to call while acquisition runs.
  *
- * @param   little_endian_bytes The input byte array.
- * @return  The converted unsigned 16-bit integer.
+ * @param   data    The structure to fill.
+ * @return  true if a NAV-SAT message has been received, false otherwise.
  */
-uint16_t Gps::u2_to_int(const uint8_t *little_endian_bytes) {
-    return (uint16_t)(((uint16_t)little_endian_bytes[1] << BYTE_SHIFT_AMOUNT) |
-		(uint16_t)little_endian_bytes[0]);
+template <class Transport>
+bool BasicGps<Transport>::GetNavSat(NavSatData &data) {
+	std::lock_guard<std::mutex> lock(statusMutex);
+	if (!(statusReceived & STATUS_NAV_SAT)) {
+		return false;
+	}
+	data = navSat;
+	return true;
 }
 
-double Gps::bytes_to_double(const uint8_t *little_endian_bytes) {
-    // Assuming little_endian_bytes is a representation of a double
-    // If it's not, you'll need to adjust the conversion logic accordingly
-    double result;
-    memcpy(&result, little_endian_bytes, sizeof(result));
-    printf("Result: %f\n", result);
-    return result * 1e-07;
+/**
+ * @brief   Copy the latest NAV-DOP message; safe to call while acquisition runs.
+ *
+ * @param   data    The structure to fill.
+ * @return  true if a NAV-DOP message has been received, false otherwise.
+ */
+template <class Transport>
+bool BasicGps<Transport>::GetNavDop(NavDopData &data) {
+	std::lock_guard<std::mutex> lock(statusMutex);
+	if (!(statusReceived & STATUS_NAV_DOP)) {
+		return false;
+	}
+	data = navDop;
+	return true;
 }
 
 /**
- * @brief   Convert a little-endian byte array to a signed 32-bit integer.
+ * @brief   Copy the latest NAV-STATUS message; safe to call while acquisition runs.
  *
- * @param   little_endian_bytes The input byte array.
- * @return  The converted signed 32-bit integer.
+ * @param   data    The structure to fill.
+ * @return  true if a NAV-STATUS message has been received, false otherwise.
  */
-int32_t Gps::i4_to_int(const uint8_t *little_endian_bytes) {
-    return (int32_t)(((uint32_t)little_endian_bytes[3] << THREE_BYTE_SHIFT_AMOUNT) |
-		((uint32_t)little_endian_bytes[2] << HALF_WORD_SHIFT_AMOUNT) |
-		((uint32_t)little_endian_bytes[1] << BYTE_SHIFT_AMOUNT) |
-		(uint32_t)little_endian_bytes[0]);
+template <class Transport>
+bool BasicGps<Transport>::GetNavStatus(NavStatusData &data) {
+	std::lock_guard<std::mutex> lock(statusMutex);
+	if (!(statusReceived & STATUS_NAV_STATUS)) {
+		return false;
+	}
+	data = navStatus;
+	return true;
 }
 
 /**
- * @brief   Convert a little-endian byte array to an unsigned 32-bit integer.
+ * @brief   Copy the latest NAV-TIMEUTC message; safe to call while acquisition runs.
  *
- * @param   little_endian_bytes The input byte array.
- * @return  The converted unsigned 32-bit integer.
+ * @param   data    The structure to fill.
+ * @return  true if a NAV-TIMEUTC message has been received, false otherwise.
  */
-uint32_t Gps::u4_to_int(const uint8_t *little_endian_bytes) {
-    return (uint32_t)(((uint32_t)little_endian_bytes[3] << THREE_BYTE_SHIFT_AMOUNT) |
-		((uint32_t)little_endian_bytes[2] << HALF_WORD_SHIFT_AMOUNT) |
-		((uint32_t)little_endian_bytes[1] << BYTE_SHIFT_AMOUNT) |
-		(uint32_t)little_endian_bytes[0]);
+template <class Transport>
+bool BasicGps<Transport>::GetNavTimeUtc(NavTimeUtcData &data) {
+	std::lock_guard<std::mutex> lock(statusMutex);
+	if (!(statusReceived & STATUS_NAV_TIMEUTC)) {
+		return false;
+	}
+	data = navTimeUtc;
+	return true;
 }
+
+/**
+ * @brief   Copy the latest MON-HW message; safe to call while acquisition runs.
+ *
+ * @param   data    The structure to fill.
+ * @return  true if a MON-HW message has been received, false otherwise.
+ */
+template <class Transport>
+bool BasicGps<Transport>::GetMonHw(MonHwData &data) {
+	std::lock_guard<std::mutex> lock(statusMutex);
+	if (!(statusReceived & STATUS_MON_HW)) {
+		return false;
+	}
+	data = monHw;
+	return true;
+}
+
+/**
+ * @brief   Start draining the GPS module on a background thread.
+ *
+ * Decoded fixes are pushed into a lock-free single-producer/single-consumer ring
+ * that the caller empties with PopPvt(), so the consumer never waits on the bus.
+ * While acquisition runs the thread owns the bus: do not call GetPvt/GetPvtView
+ * concurrently.
+ *
+ * @param   polling Whether the thread sends a NAV-PVT poll before each read.
+ * @return  true if the thread was started, false if it was already running.
+ */
+template <class Transport>
+bool BasicGps<Transport>::StartAcquisition(bool polling) {
+	if (acquisitionRunning.exchange(true)) {
+		return false;
+	}
+
+	acquisitionThread = std::thread(&BasicGps::acquisitionLoop, this, polling);
+	return true;
+}
+
+/**
+ * @brief   Stop the background acquisition thread and wait for it to exit.
+ *
+ * Fixes already in the ring stay available to PopPvt(). With autosave on, the
+ * navigation database is saved once more.
+ */
+template <class Transport>
+void BasicGps<Transport>::StopAcquisition(void) {
+	acquisitionRunning = false;
+	if (acquisitionThread.joinable()) {
+		acquisitionThread.join();
+		if (!autosavePath.empty()) {
+			SaveNavigationDatabase(autosavePath.c_str());
+		}
+	}
+}
+
+/**
+ * @brief   Take the oldest fix queued by the acquisition thread, waiting for one if needed.
+ *
+ * Sleeps until just after the acquisition thread is expected to have queued the next
+ * fix instead of spinning on PopPvt(); never touches the bus.
+ *
+ * @param   data            Filled with the fix when one is available.
+ * @param   timeOutMillis   The longest time in milliseconds to wait.
+ * @return  true if a fix was returned, false if none arrived in time.
+ */
+template <class Transport>
+bool BasicGps<Transport>::WaitPvt(PVTData &data, uint16_t timeOutMillis) {
+	uint64_t deadline = EpochScheduler::NowNanos() + timeOutMillis * NANOS_PER_MILLI;
+
+	while (true) {
+		if (fixRing.Pop(data)) {
+			return true;
+		}
+
+		uint64_t now = EpochScheduler::NowNanos();
+		if (now >= deadline) {
+			return false;
+		}
+
+		uint64_t wake = nextFixDueNanos.load();
+		if (wake <= now) {
+			wake = now + EPOCH_RETRY_NANOS;
+		}
+		EpochScheduler::SleepUntil(wake < deadline ? wake : deadline);
+	}
+}
+
+/**
+ * @brief   Snapshot the acquisition counters, for sizing GPS_FIX_RING_CAPACITY.
+ *
+ * @return  Fixes queued, ring overruns and dropped invalid fixes since construction.
+ */
+template <class Transport>
+GpsAcquisitionStats BasicGps<Transport>::GetAcquisitionStats(void) {
+	GpsAcquisitionStats stats;
+	stats.fixesQueued = fixesQueued.load();
+	stats.overruns = overruns.load();
+	stats.drops = drops.load();
+	return stats;
+}
+
+/**
+ * @brief   Body of the acquisition thread: drain every queued NAV-PVT, then idle.
+ *
+ * @param   polling Whether to send a NAV-PVT poll before each read.
+ */
+template <class Transport>
+void BasicGps<Transport>::acquisitionLoop(bool polling) {
+	PVTData data;
+	memset(&data, 0, sizeof(data));
+
+	while (acquisitionRunning) {
+		NavPvtView pvt = this->GetPvtView(polling, ACQUISITION_WAIT_MILLS);
+		if (!pvt.IsValid() || !LastPvtIsNew()) {
+			continue;
+		}
+
+		if (!decodePvt(pvt, data)) {
+			drops++;
+			continue;
+		}
+
+		if (fixRing.Push(data)) {
+			fixesQueued++;
+		} else {
+			overruns++;
+		}
+
+		uint64_t now = EpochScheduler::NowNanos();
+		if (!autosavePath.empty() && now >= nextAutosaveNanos) {
+			SaveNavigationDatabase(autosavePath.c_str());
+			now = EpochScheduler::NowNanos();
+			nextAutosaveNanos = now + autosavePeriodNanos;
+		}
+
+		// Tell WaitPvt() when to look again: after this thread has read the next epoch
+		nextFixDueNanos = scheduler.NextDueNanos(now) + 2 * EPOCH_WAKE_GUARD_NANOS;
+	}
+}
+
+template class BasicGps<I2cTransport>;
+template class BasicGps<SerialTransport>;
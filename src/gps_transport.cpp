@@ -0,0 +1,392 @@
+#include "gps_transport.h"
+#include "ubx_framer.h"
+#include "ubx_schema.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define BYTE_SHIFT 8
+
+/**
+ * @brief   Constructor for the I2cTransport class; nothing is opened yet.
+ *
+ * @param   device  The I2C bus the receiver is on.
+ */
+I2cTransport::I2cTransport(const char *device) : device(device), bus(nullptr), busDevice(-1), readMode(DEFAULT_READ_MODE) {
+}
+
+/**
+ * @brief   Attach the receiver to the shared bus manager of the adapter.
+ *
+ * Stream drains are bulk traffic: they wait for higher priority devices and
+ * fill the gaps between their samples (see i2c_bus.h).
+ *
+ * @return  true if the bus could be opened, false otherwise.
+ */
+bool I2cTransport::Open(void) {
+	I2cDeviceConfig config = GPS_I2C_DEVICE_CONFIG;
+	bus = &I2cBus::Shared(device);
+	busDevice = bus->Attach(config);
+	if (busDevice < 0) {
+		fprintf(stderr, "Unable to attach the GPS to %s\n", device);
+		return false;
+	}
+	return true;
+}
+
+void I2cTransport::Close(void) {
+	if (busDevice >= 0) {
+		bus->Detach(busDevice);
+		busDevice = -1;
+	}
+}
+
+/**
+ * @brief   Select how the data stream register is read.
+ *
+ * @param   mode    GPS_READ_MODE_BLOCK (default) or GPS_READ_MODE_BYTE.
+ */
+void I2cTransport::SetReadMode(uint8_t mode) {
+	readMode = (mode == GPS_READ_MODE_BYTE) ? GPS_READ_MODE_BYTE : GPS_READ_MODE_BLOCK;
+}
+
+/**
+ * @brief   CFG-PRT restricting the DDC port to UBX in and out.
+ *
+ * @param   payload Receives CFG_PRT_PAYLOAD_LENGTH bytes.
+ */
+void I2cTransport::PortConfig(uint8_t *payload) const {
+	CfgPrt::Schema::Encode(payload, PORT_ID_DDC, 0, GPS_I2C_ADDRESS << 1, 0,
+		PORT_PROTOCOL_UBX, PORT_PROTOCOL_UBX, 0);
+}
+
+/**
+ * @brief   Read consecutive bytes starting at a register in a single transaction.
+ *
+ * Issues a combined write(register) / repeated-start / read(length) transfer
+ * through I2C_RDWR, so the whole block costs one ioctl and one bus transaction.
+ *
+ * @param   reg     The register address to start reading from.
+ * @param   buf     Destination buffer, at least length bytes long.
+ * @param   length  The number of bytes to read.
+ * @param   stats   Counters to update.
+ * @return  true if the transfer succeeded, false otherwise.
+ */
+bool I2cTransport::readRegisters(uint8_t reg, uint8_t *buf, uint16_t length, GpsBusStats &stats) {
+	stats.transactions++;
+	if (!bus->ReadRegisters(busDevice, reg, buf, length)) {
+		perror("Failed to block read from I2C GPS device");
+		return false;
+	}
+
+	stats.bytesRead += length;
+	return true;
+}
+
+/**
+ * @brief   Retrieve the number of available bytes for reading from the GPS module.
+ *
+ * In block mode both count registers (0xFD, 0xFE) are fetched in one transaction.
+ *
+ * @return  The number of available bytes, 0 if the read failed.
+ */
+uint16_t I2cTransport::Available(GpsBusStats &stats) {
+	if (readMode == GPS_READ_MODE_BLOCK) {
+		uint8_t count[AVAILABLE_BYTES_LENGTH];
+		if (!readRegisters(AVAILABLE_BYTES_MSB, count, AVAILABLE_BYTES_LENGTH, stats)) {
+			return 0;
+		}
+		return (count[0] << BYTE_SHIFT) | count[1];
+	}
+
+	uint8_t msb = 0;
+	uint8_t lsb = 0;
+	if (!readRegisters(AVAILABLE_BYTES_MSB, &msb, 1, stats) || !readRegisters(AVAILABLE_BYTES_LSB, &lsb, 1, stats)) {
+		return 0;
+	}
+	return (msb << BYTE_SHIFT) | lsb;
+}
+
+/**
+ * @brief   Read bytes from the data stream register (0xFF).
+ *
+ * In block mode the stream is drained in chunks of at most MAX_BLOCK_READ_LENGTH
+ * bytes; in byte mode every byte costs its own SMBus transaction.
+ *
+ * @param   buf     Destination buffer, at least length bytes long.
+ * @param   length  The number of bytes to read (from Available).
+ * @param   stats   Counters to update.
+ * @return  true if all bytes were read, false otherwise.
+ */
+bool I2cTransport::Read(uint8_t *buf, uint16_t length, GpsBusStats &stats) {
+	if (readMode == GPS_READ_MODE_BLOCK) {
+		uint16_t offset = 0;
+		while (offset < length) {
+			uint16_t chunk = length - offset;
+			if (chunk > MAX_BLOCK_READ_LENGTH) {
+				chunk = MAX_BLOCK_READ_LENGTH;
+			}
+			if (!readRegisters(DATA_STREAM_REGISTER, &buf[offset], chunk, stats)) {
+				return false;
+			}
+			offset += chunk;
+		}
+		return true;
+	}
+
+	for (int i = 0; i < length; i++) {
+		if (!readRegisters(DATA_STREAM_REGISTER, &buf[i], 1, stats)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief   Write a serialized UBX frame in one transaction (no register address).
+ */
+bool I2cTransport::Write(const uint8_t *frame, uint16_t length, GpsBusStats &stats) {
+	stats.transactions++;
+	if (!bus->Write(busDevice, frame, length)) {
+		perror("Failed to write to I2C device");
+		return false;
+	}
+	stats.bytesWritten += length;
+	return true;
+}
+
+/**
+ * @brief   Constructor for the SerialTransport class with SERIAL_TRANSPORT_DEFAULT_CONFIG.
+ */
+SerialTransport::SerialTransport(void) : SerialTransport(SerialTransportConfig SERIAL_TRANSPORT_DEFAULT_CONFIG) {
+}
+
+/**
+ * @brief   Constructor for the SerialTransport class; nothing is opened yet.
+ *
+ * @param   config  The tty and the baud rates; see SerialTransportConfig.
+ */
+SerialTransport::SerialTransport(const SerialTransportConfig &config) : config(config), fd(-1), rxHead(0), rxLength(0) {
+}
+
+/**
+ * @brief   The termios speed for a baud rate the receiver supports.
+ *
+ * @return  The speed, or B0 if the rate is not supported.
+ */
+speed_t SerialTransport::BaudToSpeed(uint32_t baudRate) {
+	switch (baudRate) {
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+		case 460800: return B460800;
+		case 921600: return B921600;
+		default: return B0;
+	}
+}
+
+/**
+ * @brief   Put the tty in raw 8N1 mode at baudRate, with reads that never block.
+ */
+bool SerialTransport::setBaudRate(uint32_t baudRate) {
+	speed_t speed = BaudToSpeed(baudRate);
+	struct termios options;
+	if (speed == B0 || tcgetattr(fd, &options) < 0) {
+		fprintf(stderr, "Unable to set GPS serial baud rate %u\n", baudRate);
+		return false;
+	}
+
+	cfmakeraw(&options);
+	options.c_cflag |= CLOCAL | CREAD;
+	options.c_cflag &= ~(CSTOPB | CRTSCTS);
+	options.c_cc[VMIN] = 0;
+	options.c_cc[VTIME] = 0;
+	cfsetispeed(&options, speed);
+	cfsetospeed(&options, speed);
+	if (tcsetattr(fd, TCSANOW, &options) < 0) {
+		perror("Unable to configure GPS serial device");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief   Open the tty and switch the receiver's UART1 to the configured baud rate.
+ *
+ * The CFG-PRT is sent at initialBaudRate and not waited on: the receiver answers at
+ * the old rate and switches, so its ACK is usually garbled. The driver's own CFG-PRT
+ * poll afterwards confirms the new rate.
+ *
+ * @return  true if the tty is open at baudRate, false otherwise.
+ */
+bool SerialTransport::Open(void) {
+	fd = open(config.device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0) {
+		perror("Unable to open GPS serial device");
+		return false;
+	}
+	if (!setBaudRate(config.initialBaudRate)) {
+		return false;
+	}
+
+	if (config.baudRate != config.initialBaudRate) {
+		uint8_t payload[CFG_PRT_PAYLOAD_LENGTH];
+		PortConfig(payload);
+		uint8_t frame[UBX_FRAME_OVERHEAD + CFG_PRT_PAYLOAD_LENGTH];
+		uint16_t length = ComposeFrame(frame, CFG_CLASS, CFG_PRT, sizeof(payload), payload);
+
+		GpsBusStats stats;
+		memset(&stats, 0, sizeof(stats));
+		if (!writeAll(frame, length, stats)) {
+			return false;
+		}
+		tcdrain(fd);
+		usleep(GPS_SERIAL_SWITCH_MILLS * 1000);
+		if (!setBaudRate(config.baudRate)) {
+			return false;
+		}
+	}
+
+	tcflush(fd, TCIOFLUSH);
+	rxHead = 0;
+	rxLength = 0;
+	return true;
+}
+
+void SerialTransport::Close(void) {
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+/**
+ * @brief   CFG-PRT for UART1: 8N1 at the configured baud rate, UBX in and out.
+ *
+ * @param   payload Receives CFG_PRT_PAYLOAD_LENGTH bytes.
+ */
+void SerialTransport::PortConfig(uint8_t *payload) const {
+	CfgPrt::Schema::Encode(payload, PORT_ID_UART1, 0, PORT_MODE_8N1, config.baudRate,
+		PORT_PROTOCOL_UBX, PORT_PROTOCOL_UBX, 0);
+}
+
+/**
+ * @brief   Drain what the tty holds into the receive buffer.
+ *
+ * poll() with a zero timeout tells whether anything arrived; the non-blocking read()
+ * calls then take everything queued without waiting for more.
+ *
+ * @return  The number of buffered bytes.
+ */
+uint16_t SerialTransport::Available(GpsBusStats &stats) {
+	if (rxHead > 0) {
+		memmove(rxBuffer, &rxBuffer[rxHead], rxLength);
+		rxHead = 0;
+	}
+
+	struct pollfd ready;
+	ready.fd = fd;
+	ready.events = POLLIN;
+	while (rxLength < GPS_SERIAL_RX_BUFFER_LENGTH && poll(&ready, 1, 0) > 0 && (ready.revents & POLLIN)) {
+		ssize_t count = read(fd, &rxBuffer[rxLength], GPS_SERIAL_RX_BUFFER_LENGTH - rxLength);
+		if (count <= 0) {
+			if (count < 0 && errno != EAGAIN && errno != EINTR) {
+				perror("Failed to read from GPS serial device");
+			}
+			break;
+		}
+		stats.transactions++;
+		stats.bytesRead += count;
+		rxLength += count;
+	}
+	return rxLength;
+}
+
+/**
+ * @brief   Take length bytes that Available() buffered.
+ *
+ * @return  true if length bytes were buffered, false otherwise.
+ */
+bool SerialTransport::Read(uint8_t *buf, uint16_t length, GpsBusStats &stats) {
+	if (length > rxLength && Available(stats) < length) {
+		return false;
+	}
+	memcpy(buf, &rxBuffer[rxHead], length);
+	rxHead += length;
+	rxLength -= length;
+	return true;
+}
+
+/**
+ * @brief   Write all of frame, waiting for the tty to accept more when its buffer is full.
+ */
+bool SerialTransport::writeAll(const uint8_t *frame, uint16_t length, GpsBusStats &stats) {
+	uint16_t offset = 0;
+	while (offset < length) {
+		ssize_t count = write(fd, &frame[offset], length - offset);
+		if (count < 0 && (errno == EAGAIN || errno == EINTR)) {
+			struct pollfd ready;
+			ready.fd = fd;
+			ready.events = POLLOUT;
+			if (poll(&ready, 1, GPS_SERIAL_WRITE_TIMEOUT_MILLS) <= 0) {
+				fprintf(stderr, "Timed out writing to GPS serial device\n");
+				return false;
+			}
+			continue;
+		}
+		if (count < 0) {
+			perror("Failed to write to GPS serial device");
+			return false;
+		}
+		stats.transactions++;
+		offset += count;
+	}
+	stats.bytesWritten += length;
+	return true;
+}
+
+/**
+ * @brief   Write a serialized UBX frame.
+ */
+bool SerialTransport::Write(const uint8_t *frame, uint16_t length, GpsBusStats &stats) {
+	return writeAll(frame, length, stats);
+}
+
+/**
+ * @brief   Create the pair; the master side is raw and non-blocking.
+ *
+ * @return  true if the pair exists, false otherwise.
+ */
+bool GpsPty::Open(void) {
+	masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (masterFd < 0 || grantpt(masterFd) < 0 || unlockpt(masterFd) < 0 ||
+		ptsname_r(masterFd, slaveName, sizeof(slaveName)) != 0) {
+		perror("Unable to create pseudo terminal");
+		Close();
+		return false;
+	}
+
+	struct termios options;
+	if (tcgetattr(masterFd, &options) == 0) {
+		cfmakeraw(&options);
+		tcsetattr(masterFd, TCSANOW, &options);
+	}
+	fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+	return true;
+}
+
+void GpsPty::Close(void) {
+	if (masterFd >= 0) {
+		close(masterFd);
+		masterFd = -1;
+	}
+	slaveName[0] = '\0';
+}
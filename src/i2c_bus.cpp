@@ -0,0 +1,370 @@
+#include "i2c_bus.h"
+#include "epoch_scheduler.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define I2C_BUS_BITS_PER_BYTE 9               // 8 data bits and the ACK
+#define I2C_BUS_DEFER_POLL_NANOS 200000ULL    // Re-check interval while held back for a slot
+#define I2C_BUS_NO_DEADLINE UINT64_MAX
+
+bool I2cBus::TicketOrder::operator()(const Ticket &a, const Ticket &b) const {
+    if (a.priority != b.priority) {
+        return a.priority > b.priority;
+    }
+    if (a.deadlineNanos != b.deadlineNanos) {
+        return a.deadlineNanos < b.deadlineNanos;
+    }
+    return a.sequence < b.sequence;
+}
+
+/**
+ * @brief   Constructor for the I2cBus class; the adapter is opened by the first Attach().
+ */
+I2cBus::I2cBus(const char *path) : path(path), fd(-1), clockHz(I2C_BUS_DEFAULT_HZ), sequence(0), attachedCount(0),
+    busy(false), owner(-1), ownerDepth(0), grantNanos(0) {
+    for (int i = 0; i < I2C_BUS_MAX_DEVICES; i++) {
+        devices[i].attached = false;
+    }
+    statsStartNanos = EpochScheduler::NowNanos();
+}
+
+/**
+ * @brief   The manager of an adapter, created on first use and shared by every device on it.
+ *
+ * @param   path    The adapter, e.g. "/dev/i2c-1".
+ */
+I2cBus &I2cBus::Shared(const char *path) {
+    static std::mutex registryLock;
+    static std::map<std::string, I2cBus *> buses;
+
+    std::lock_guard<std::mutex> guard(registryLock);
+    I2cBus *&bus = buses[path];
+    if (bus == nullptr) {
+        bus = new I2cBus(path);
+    }
+    return *bus;
+}
+
+/**
+ * @brief   Register a device; the adapter is opened if this is the first one.
+ *
+ * @param   config  Address, priority, period and deadline; see I2cDeviceConfig.
+ * @return  The device handle, or -1 if the adapter cannot be opened or is full.
+ */
+int I2cBus::Attach(const I2cDeviceConfig &config) {
+    std::lock_guard<std::mutex> guard(lock);
+    int device = -1;
+    for (int i = 0; i < I2C_BUS_MAX_DEVICES; i++) {
+        if (!devices[i].attached) {
+            device = i;
+            break;
+        }
+    }
+    if (device < 0) {
+        fprintf(stderr, "Too many devices on %s\n", path.c_str());
+        return -1;
+    }
+
+    if (fd < 0) {
+        fd = open(path.c_str(), O_RDWR);
+        if (fd < 0) {
+            perror("Unable to open I2C bus");
+            return -1;
+        }
+        // Transfers address each message; this only sets the adapter's default slave
+        if (ioctl(fd, I2C_SLAVE, config.address) < 0) {
+            perror("Failed to acquire I2C bus address");
+        }
+    }
+
+    Device &entry = devices[device];
+    entry.attached = true;
+    entry.name = config.name != nullptr ? config.name : "";
+    entry.config = config;
+    entry.config.name = entry.name.c_str();
+    memset(&entry.stats, 0, sizeof(entry.stats));
+    entry.nextSlotNanos = 0;
+    attachedCount++;
+    return device;
+}
+
+/**
+ * @brief   Unregister a device; the adapter is closed with the last one.
+ */
+void I2cBus::Detach(int device) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!validDevice(device)) {
+        return;
+    }
+    devices[device].attached = false;
+    attachedCount--;
+    if (attachedCount == 0 && fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+/**
+ * @brief   Change the sample period a device reserves slots for.
+ *
+ * @param   periodMicros    The period, or 0 to stop reserving.
+ */
+void I2cBus::SetPeriod(int device, uint32_t periodMicros) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (validDevice(device)) {
+        devices[device].config.periodMicros = periodMicros;
+        devices[device].nextSlotNanos = 0;
+    }
+}
+
+bool I2cBus::validDevice(int device) const {
+    return device >= 0 && device < I2C_BUS_MAX_DEVICES && devices[device].attached;
+}
+
+/**
+ * @brief   Time a transfer keeps the bus: per-message overhead plus the bits on the wire.
+ */
+uint64_t I2cBus::estimateNanos(uint32_t bytes, uint32_t messages) const {
+    uint64_t bits = static_cast<uint64_t>(bytes + messages) * I2C_BUS_BITS_PER_BYTE;
+    return messages * I2C_BUS_TRANSFER_OVERHEAD_NANOS + bits * NANOS_PER_SECOND / clockHz;
+}
+
+/**
+ * @brief   Whether a granted transfer would run into a higher priority device's slot.
+ *
+ * Slots more than I2C_BUS_SLOT_SLACK_NANOS old are treated as released, and a transfer
+ * too long to fit between two slots at all is never held back.
+ *
+ * @return  The time until which the transfer should wait, or 0 to go now.
+ */
+uint64_t I2cBus::deferUntil(const Ticket &ticket, uint64_t durationNanos, uint64_t nowNanos) const {
+    uint64_t until = 0;
+    for (int i = 0; i < I2C_BUS_MAX_DEVICES; i++) {
+        const Device &other = devices[i];
+        if (!other.attached || other.nextSlotNanos == 0 || other.config.priority <= ticket.priority) {
+            continue;
+        }
+        uint64_t periodNanos = static_cast<uint64_t>(other.config.periodMicros) * 1000;
+        if (durationNanos + I2C_BUS_SLOT_GUARD_NANOS >= periodNanos) {
+            continue;
+        }
+        uint64_t slot = other.nextSlotNanos;
+        if (nowNanos >= slot + I2C_BUS_SLOT_SLACK_NANOS) {
+            continue;
+        }
+        if (nowNanos + durationNanos + I2C_BUS_SLOT_GUARD_NANOS > slot && slot + I2C_BUS_SLOT_SLACK_NANOS > until) {
+            until = slot + I2C_BUS_SLOT_SLACK_NANOS;
+        }
+    }
+    return until;
+}
+
+/**
+ * @brief   Wait for the bus and take it for a device.
+ *
+ * The owner may call Acquire() again (for instance through Transfer()) without
+ * waiting; each call needs its Release().
+ *
+ * @param   device          The handle from Attach().
+ * @param   expectedBytes   Bytes the caller is about to move, used to fit the transfer
+ *                          into the gaps between reserved slots.
+ * @return  true once the bus is held, false for an unknown device.
+ */
+bool I2cBus::Acquire(int device, uint32_t expectedBytes) {
+    uint64_t submitted = EpochScheduler::NowNanos();
+    std::unique_lock<std::mutex> guard(lock);
+    if (!validDevice(device)) {
+        return false;
+    }
+    if (busy && owner == device && ownerThread == std::this_thread::get_id()) {
+        ownerDepth++;
+        return true;
+    }
+
+    Device &entry = devices[device];
+    Ticket ticket;
+    ticket.priority = entry.config.priority;
+    ticket.deadlineNanos = entry.config.deadlineMicros > 0 ?
+        submitted + static_cast<uint64_t>(entry.config.deadlineMicros) * 1000 : I2C_BUS_NO_DEADLINE;
+    ticket.sequence = sequence++;
+    ticket.device = device;
+    waiting.insert(ticket);
+
+    uint64_t duration = estimateNanos(expectedBytes, 1);
+    bool deferred = false;
+    uint64_t now = submitted;
+    while (true) {
+        if (!busy && waiting.begin()->sequence == ticket.sequence) {
+            now = EpochScheduler::NowNanos();
+            uint64_t until = deferUntil(ticket, duration, now);
+            if (until == 0) {
+                break;
+            }
+            if (!deferred) {
+                entry.stats.deferrals++;
+                deferred = true;
+            }
+            // Sleep without the lock so the slot owner can take the bus meanwhile
+            guard.unlock();
+            EpochScheduler::SleepUntil(now + I2C_BUS_DEFER_POLL_NANOS < until ? now + I2C_BUS_DEFER_POLL_NANOS : until);
+            guard.lock();
+            continue;
+        }
+        released.wait(guard);
+    }
+
+    waiting.erase(ticket);
+    busy = true;
+    owner = device;
+    ownerThread = std::this_thread::get_id();
+    ownerDepth = 1;
+    grantNanos = now;
+
+    uint64_t queued = now - submitted;
+    entry.stats.transfers++;
+    entry.stats.queueNanos += queued;
+    if (queued > entry.stats.maxQueueNanos) {
+        entry.stats.maxQueueNanos = queued;
+    }
+    if (now > ticket.deadlineNanos) {
+        entry.stats.deadlineMisses++;
+    }
+    if (entry.config.periodMicros > 0) {
+        // From the submission: a periodic caller submits on its schedule even when granted late
+        entry.nextSlotNanos = submitted + static_cast<uint64_t>(entry.config.periodMicros) * 1000;
+    }
+    return true;
+}
+
+/**
+ * @brief   Give the bus back and wake the next waiting transfer.
+ */
+void I2cBus::Release(int device) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!busy || owner != device) {
+        return;
+    }
+    if (--ownerDepth > 0) {
+        return;
+    }
+    busy = false;
+    owner = -1;
+    if (validDevice(device)) {
+        devices[device].stats.busyNanos += EpochScheduler::NowNanos() - grantNanos;
+    }
+    released.notify_all();
+}
+
+/**
+ * @brief   Run one combined I2C_RDWR transfer for a device once it is granted the bus.
+ *
+ * @param   device  The handle from Attach().
+ * @param   msgs    The messages; their addresses are set to the device's.
+ * @param   count   The number of messages (at most I2C_RDWR_IOCTL_MAX_MSGS).
+ * @return  true if the transfer succeeded, false otherwise (errno is kept).
+ */
+bool I2cBus::Transfer(int device, struct i2c_msg *msgs, uint32_t count) {
+    uint32_t bytes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        bytes += msgs[i].len;
+    }
+    if (!Acquire(device, bytes)) {
+        errno = ENODEV;
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        msgs[i].addr = devices[device].config.address;
+    }
+    struct i2c_rdwr_ioctl_data transfer;
+    transfer.msgs = msgs;
+    transfer.nmsgs = count;
+    bool ok = ioctl(fd, I2C_RDWR, &transfer) >= 0;
+    int error = errno;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (ok) {
+            devices[device].stats.bytes += bytes;
+        } else {
+            devices[device].stats.errors++;
+        }
+    }
+    Release(device);
+    errno = error;
+    return ok;
+}
+
+/**
+ * @brief   Read consecutive registers: write(register), repeated start, read(length).
+ */
+bool I2cBus::ReadRegisters(int device, uint8_t reg, uint8_t *buf, uint16_t length) {
+    struct i2c_msg msgs[2];
+    msgs[0].flags = 0;
+    msgs[0].len = 1;
+    msgs[0].buf = &reg;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = length;
+    msgs[1].buf = buf;
+    return Transfer(device, msgs, 2);
+}
+
+/**
+ * @brief   Write raw bytes to a device in one message.
+ */
+bool I2cBus::Write(int device, const uint8_t *data, uint16_t length) {
+    struct i2c_msg msg;
+    msg.flags = 0;
+    msg.len = length;
+    msg.buf = const_cast<uint8_t *>(data);
+    return Transfer(device, &msg, 1);
+}
+
+bool I2cBus::WriteRegister(int device, uint8_t reg, uint8_t value) {
+    uint8_t data[] = {reg, value};
+    return Write(device, data, sizeof(data));
+}
+
+I2cDeviceStats I2cBus::GetStats(int device) {
+    std::lock_guard<std::mutex> guard(lock);
+    I2cDeviceStats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (validDevice(device)) {
+        stats = devices[device].stats;
+    }
+    return stats;
+}
+
+/**
+ * @brief   Share of the time since the last ResetStats() the device held the bus.
+ */
+double I2cBus::Utilization(int device) {
+    I2cDeviceStats stats = GetStats(device);
+    uint64_t elapsed = EpochScheduler::NowNanos() - statsStartNanos;
+    return elapsed > 0 ? static_cast<double>(stats.busyNanos) / elapsed : 0.0;
+}
+
+/**
+ * @brief   The handle of the attached device with this name, or -1.
+ */
+int I2cBus::Find(const char *name) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < I2C_BUS_MAX_DEVICES; i++) {
+        if (devices[i].attached && devices[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void I2cBus::ResetStats(void) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < I2C_BUS_MAX_DEVICES; i++) {
+        memset(&devices[i].stats, 0, sizeof(devices[i].stats));
+    }
+    statsStartNanos = EpochScheduler::NowNanos();
+}
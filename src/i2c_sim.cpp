@@ -0,0 +1,655 @@
+// The fortified inline wrappers of open() and read() would clash with the definitions below
+#undef _FORTIFY_SOURCE
+
+#include "i2c_sim.h"
+#include "epoch_scheduler.h"
+#include <atomic>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+	#include <linux/i2c-dev.h>
+	#include <linux/i2c.h>
+}
+
+#define I2C_SIM_FUNCTIONALITY (I2C_FUNC_I2C | I2C_FUNC_SMBUS_QUICK | I2C_FUNC_SMBUS_BYTE | \
+    I2C_FUNC_SMBUS_BYTE_DATA | I2C_FUNC_SMBUS_WORD_DATA | I2C_FUNC_SMBUS_I2C_BLOCK)
+#define I2C_SIM_MAX_TRANSFER 8192
+#define I2C_SIM_BACKING_DEVICE "/dev/null"
+
+typedef int (*OpenFunction)(const char *, int, ...);
+typedef int (*CloseFunction)(int);
+typedef int (*IoctlFunction)(int, unsigned long, ...);
+typedef ssize_t (*ReadFunction)(int, void *, size_t);
+typedef ssize_t (*WriteFunction)(int, const void *, size_t);
+typedef int (*ClockGettimeFunction)(clockid_t, struct timespec *);
+typedef int (*ClockNanosleepFunction)(clockid_t, int, const struct timespec *, struct timespec *);
+typedef int (*NanosleepFunction)(const struct timespec *, struct timespec *);
+
+/**
+ * @brief   The libc definition of an interposed function.
+ */
+template <typename Function>
+static Function next(const char *name) {
+    return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+}
+
+static int realClockGettime(clockid_t clock, struct timespec *ts) {
+    static ClockGettimeFunction function = next<ClockGettimeFunction>("clock_gettime");
+    return function(clock, ts);
+}
+
+static int realNanosleep(const struct timespec *request, struct timespec *remaining) {
+    static NanosleepFunction function = next<NanosleepFunction>("nanosleep");
+    return function(request, remaining);
+}
+
+static uint64_t toNanos(const struct timespec &ts) {
+    return static_cast<uint64_t>(ts.tv_sec) * NANOS_PER_SECOND + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static struct timespec toTimespec(uint64_t nanos) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(nanos / NANOS_PER_SECOND);
+    ts.tv_nsec = static_cast<long>(nanos % NANOS_PER_SECOND);
+    return ts;
+}
+
+static uint64_t realMonotonicNanos(void) {
+    struct timespec now;
+    realClockGettime(CLOCK_MONOTONIC, &now);
+    return toNanos(now);
+}
+
+/**
+ * Virtual CLOCK_MONOTONIC: virtualEpoch + (real - realEpoch) * timeScale. The clock is
+ * rebased whenever the scale changes so it never jumps; identity is set while the
+ * virtual clock equals the real one and lets the time functions pass straight through.
+ */
+static std::mutex clockMutex;
+static double timeScale = 1.0;
+static uint64_t realEpochNanos = 0;
+static uint64_t virtualEpochNanos = 0;
+static std::atomic<bool> clockIdentity(true);
+
+static uint64_t virtualNanos(uint64_t realNanos) {
+    std::lock_guard<std::mutex> lock(clockMutex);
+    return virtualEpochNanos + static_cast<uint64_t>((realNanos - realEpochNanos) * timeScale);
+}
+
+static double currentTimeScale(void) {
+    std::lock_guard<std::mutex> lock(clockMutex);
+    return timeScale;
+}
+
+static void setTimeScale(double scale) {
+    scale = scale < 1.0 ? 1.0 : (scale > I2C_SIM_MAX_TIME_SCALE ? I2C_SIM_MAX_TIME_SCALE : scale);
+    uint64_t realNow = realMonotonicNanos();
+
+    std::lock_guard<std::mutex> lock(clockMutex);
+    virtualEpochNanos = realEpochNanos == 0 ? realNow :
+        virtualEpochNanos + static_cast<uint64_t>((realNow - realEpochNanos) * timeScale);
+    realEpochNanos = realNow;
+    timeScale = scale;
+    clockIdentity = scale == 1.0 && virtualEpochNanos == realEpochNanos;
+}
+
+/**
+ * @brief   Sleep for a virtual duration.
+ *
+ * @return  0, or -1 with errno set if interrupted; remaining then holds the virtual time left.
+ */
+static int sleepVirtual(uint64_t nanos, struct timespec *remaining) {
+    double scale = currentTimeScale();
+    struct timespec request = toTimespec(static_cast<uint64_t>(nanos / scale));
+    struct timespec left;
+    int result = realNanosleep(&request, &left);
+    if (result != 0 && remaining != nullptr) {
+        *remaining = toTimespec(static_cast<uint64_t>(toNanos(left) * scale));
+    }
+    return result;
+}
+
+/**
+ * The simulated bus: both devices, the open bus descriptors and the error injection.
+ * Created on first use, which reads the environment.
+ */
+typedef struct {
+    I2cSimConfig config;
+    I2cSimStats stats;
+    SimSamM8q gps;
+    SimIcm20948 imu;
+    std::map<int, uint16_t> slaves;     // Open bus descriptors and their I2C_SLAVE address
+    uint8_t gpsRegister;                // Last register address written to the receiver
+    std::mt19937 random;
+    std::uniform_real_distribution<double> uniform;
+} SimBus;
+
+static std::mutex busMutex;
+static std::atomic<int> openBuses(0);
+
+static double environmentValue(const char *name, double fallback) {
+    const char *value = getenv(name);
+    return value != nullptr && *value != '\0' ? atof(value) : fallback;
+}
+
+static void applyConfig(SimBus &bus, const I2cSimConfig &config) {
+    bus.config = config;
+    bus.random.seed(config.seed);
+    setTimeScale(config.timeScale);
+    bus.config.timeScale = currentTimeScale();
+}
+
+static SimBus &simBus(void) {
+    static SimBus *bus = [] {
+        SimBus *created = new SimBus();
+        I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+        config.busHz = static_cast<uint32_t>(environmentValue("I2C_SIM_BUS_HZ", config.busHz));
+        config.latencyMicros = static_cast<uint32_t>(environmentValue("I2C_SIM_LATENCY_US", config.latencyMicros));
+        config.nackRate = environmentValue("I2C_SIM_NACK_RATE", config.nackRate);
+        config.corruptRate = environmentValue("I2C_SIM_CORRUPT_RATE", config.corruptRate);
+        config.timeScale = environmentValue("I2C_SIM_TIME_SCALE", config.timeScale);
+        config.seed = static_cast<uint32_t>(environmentValue("I2C_SIM_SEED", config.seed));
+        applyConfig(*created, config);
+
+        uint64_t now = virtualNanos(realMonotonicNanos());
+        created->gps.Configure(SimSamM8qConfig SIM_SAM_M8Q_DEFAULT_CONFIG, now);
+        created->imu.Configure(SimIcm20948Config SIM_ICM20948_DEFAULT_CONFIG, config.seed, now);
+        created->gpsRegister = SIM_GPS_REG_STREAM;
+        return created;
+    }();
+    return *bus;
+}
+
+/**
+ * @brief   Read the environment at load time, so I2C_SIM_TIME_SCALE also covers the
+ *          program's clock reads before it first opens the bus.
+ */
+__attribute__((constructor)) static void loadEnvironment(void) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    simBus();
+}
+
+static I2cSimDeviceStats &deviceStats(SimBus &bus, uint16_t address) {
+    if (address == I2C_SIM_GPS_ADDRESS) {
+        return bus.stats.gps;
+    }
+    if (address == I2C_SIM_IMU_ADDRESS) {
+        return bus.stats.imu;
+    }
+    return bus.stats.other;
+}
+
+/**
+ * @brief   Run one bus transaction (a start, repeated starts between msgs, a stop).
+ *
+ * The bus is held for the transfer time of every message, so concurrent drivers queue
+ * behind each other as on the real bus.
+ *
+ * @return  The number of messages transferred, or -1 with errno set.
+ */
+static int transact(struct i2c_msg *msgs, uint32_t count) {
+    if (count == 0 || msgs == nullptr) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(busMutex);
+    SimBus &bus = simBus();
+    uint16_t address = msgs[0].addr;
+    I2cSimDeviceStats &stats = deviceStats(bus, address);
+    bool present = address == I2C_SIM_GPS_ADDRESS || address == I2C_SIM_IMU_ADDRESS;
+    bool nack = !present || (bus.config.nackRate > 0.0 && bus.uniform(bus.random) < bus.config.nackRate);
+
+    uint64_t now = I2cSim::NowNanos();
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < count && !nack; i++) {
+        struct i2c_msg &msg = msgs[i];
+        bytes += msg.len + 1;
+        if (msg.flags & I2C_M_RD) {
+            if (address == I2C_SIM_GPS_ADDRESS) {
+                bus.gps.Read(msg.buf, msg.len, now);
+                for (uint16_t j = 0; j < msg.len && bus.gpsRegister == SIM_GPS_REG_STREAM; j++) {
+                    if (bus.config.corruptRate > 0.0 && bus.uniform(bus.random) < bus.config.corruptRate) {
+                        msg.buf[j] ^= static_cast<uint8_t>(1 << (bus.random() % 8));
+                        stats.corruptedBytes++;
+                    }
+                }
+            } else {
+                bus.imu.Read(msg.buf, msg.len, now);
+            }
+            stats.bytesRead += msg.len;
+        } else {
+            if (address == I2C_SIM_GPS_ADDRESS) {
+                if (msg.len == 1) {
+                    bus.gpsRegister = msg.buf[0];
+                }
+                bus.gps.Write(msg.buf, msg.len, now);
+            } else {
+                bus.imu.Write(msg.buf, msg.len, now);
+            }
+            stats.bytesWritten += msg.len;
+        }
+    }
+    if (nack) {
+        bytes = 1;   // The address byte that was not acknowledged
+    }
+
+    uint64_t busyNanos = static_cast<uint64_t>(bus.config.latencyMicros) * 1000;
+    if (bus.config.busHz > 0) {
+        busyNanos += bytes * I2C_SIM_BITS_PER_BYTE * NANOS_PER_SECOND / bus.config.busHz;
+    }
+    stats.transactions++;
+    stats.busyNanos += busyNanos;
+    sleepVirtual(busyNanos, nullptr);
+
+    if (nack) {
+        stats.nacks++;
+        errno = EREMOTEIO;
+        return -1;
+    }
+    return static_cast<int>(count);
+}
+
+/**
+ * @brief   The I2C_SLAVE address of a simulated bus descriptor.
+ *
+ * @return  false if fd is not a simulated bus.
+ */
+static bool slaveAddress(int fd, uint16_t *address) {
+    if (openBuses.load() == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(busMutex);
+    std::map<int, uint16_t> &slaves = simBus().slaves;
+    std::map<int, uint16_t>::iterator entry = slaves.find(fd);
+    if (entry == slaves.end()) {
+        return false;
+    }
+    *address = entry->second;
+    return true;
+}
+
+/**
+ * @brief   I2C_SMBUS on a simulated bus, as the kernel emulates it with I2C messages.
+ */
+static int smbusTransfer(uint16_t address, struct i2c_smbus_ioctl_data *request) {
+    union i2c_smbus_data *data = request->data;
+    bool read = request->read_write == I2C_SMBUS_READ;
+    uint8_t command = request->command;
+    uint8_t buffer[I2C_SMBUS_BLOCK_MAX + 1];
+    struct i2c_msg msgs[2];
+    msgs[0].addr = address;
+    msgs[0].flags = 0;
+    msgs[0].len = 1;
+    msgs[0].buf = &command;
+    msgs[1].addr = address;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].buf = buffer;
+
+    uint16_t length = 0;
+    switch (request->size) {
+        case I2C_SMBUS_QUICK:
+            msgs[0].len = 0;
+            return transact(msgs, 1) < 0 ? -1 : 0;
+        case I2C_SMBUS_BYTE:
+            if (read) {
+                msgs[1].len = 1;
+                if (transact(&msgs[1], 1) < 0) {
+                    return -1;
+                }
+                data->byte = buffer[0];
+                return 0;
+            }
+            return transact(msgs, 1) < 0 ? -1 : 0;
+        case I2C_SMBUS_BYTE_DATA:
+            length = 1;
+            break;
+        case I2C_SMBUS_WORD_DATA:
+            length = 2;
+            break;
+        case I2C_SMBUS_I2C_BLOCK_DATA:
+            length = data->block[0] > I2C_SMBUS_BLOCK_MAX ? I2C_SMBUS_BLOCK_MAX : data->block[0];
+            break;
+        default:
+            errno = EOPNOTSUPP;
+            return -1;
+    }
+
+    if (read) {
+        msgs[1].len = length;
+        if (transact(msgs, 2) < 0) {
+            return -1;
+        }
+        if (request->size == I2C_SMBUS_BYTE_DATA) {
+            data->byte = buffer[0];
+        } else if (request->size == I2C_SMBUS_WORD_DATA) {
+            data->word = static_cast<uint16_t>(buffer[0] | (buffer[1] << 8));
+        } else {
+            memcpy(&data->block[1], buffer, length);
+        }
+        return 0;
+    }
+
+    uint8_t frame[I2C_SMBUS_BLOCK_MAX + 1];
+    frame[0] = command;
+    if (request->size == I2C_SMBUS_BYTE_DATA) {
+        frame[1] = data->byte;
+    } else if (request->size == I2C_SMBUS_WORD_DATA) {
+        frame[1] = static_cast<uint8_t>(data->word);
+        frame[2] = static_cast<uint8_t>(data->word >> 8);
+    } else {
+        memcpy(&frame[1], &data->block[1], length);
+    }
+    msgs[0].len = length + 1;
+    msgs[0].buf = frame;
+    return transact(msgs, 1) < 0 ? -1 : 0;
+}
+
+/**
+ * @brief   Replace the bus and error injection settings; the devices keep their state.
+ */
+void I2cSim::Configure(const I2cSimConfig &config) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    applyConfig(simBus(), config);
+}
+
+I2cSimConfig I2cSim::GetConfig(void) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    return simBus().config;
+}
+
+I2cSimStats I2cSim::GetStats(void) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    return simBus().stats;
+}
+
+void I2cSim::ResetStats(void) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    memset(&simBus().stats, 0, sizeof(I2cSimStats));
+}
+
+/**
+ * @brief   Replace the receiver model and power it up now.
+ */
+void I2cSim::ConfigureGps(const SimSamM8qConfig &config) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    SimBus &bus = simBus();
+    bus.gps.Configure(config, NowNanos());
+    bus.gpsRegister = SIM_GPS_REG_STREAM;
+}
+
+/**
+ * @brief   Replace the IMU motion model and reset the device now.
+ */
+void I2cSim::ConfigureImu(const SimIcm20948Config &config) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    SimBus &bus = simBus();
+    bus.imu.Configure(config, bus.config.seed, NowNanos());
+}
+
+/**
+ * @brief   Cut the receiver's power; see SimSamM8q::PowerCycle().
+ */
+void I2cSim::PowerCycleGps(void) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    SimBus &bus = simBus();
+    bus.gps.PowerCycle(NowNanos());
+    bus.gpsRegister = SIM_GPS_REG_STREAM;
+}
+
+SimSamM8qStats I2cSim::GetGpsStats(void) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    return simBus().gps.GetStats();
+}
+
+SimIcm20948Stats I2cSim::GetImuStats(void) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    return simBus().imu.GetStats();
+}
+
+/**
+ * @brief   The virtual CLOCK_MONOTONIC in nanoseconds, as EpochScheduler::NowNanos() sees it.
+ */
+uint64_t I2cSim::NowNanos(void) {
+    return virtualNanos(realMonotonicNanos());
+}
+
+/**
+ * Interposed libc and libi2c functions. Descriptors that are not a simulated bus, and
+ * clocks other than CLOCK_MONOTONIC, go to the next definition.
+ */
+extern "C" {
+
+static int openBus(void) {
+    static OpenFunction function = next<OpenFunction>("open");
+    int fd = function(I2C_SIM_BACKING_DEVICE, O_RDWR);
+    if (fd < 0) {
+        return fd;
+    }
+    std::lock_guard<std::mutex> lock(busMutex);
+    simBus().slaves[fd] = 0;
+    openBuses++;
+    return fd;
+}
+
+int open(const char *path, int flags, ...) {
+    if (strncmp(path, I2C_SIM_DEVICE_PREFIX, strlen(I2C_SIM_DEVICE_PREFIX)) == 0) {
+        return openBus();
+    }
+
+    static OpenFunction function = next<OpenFunction>("open");
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = (flags & (O_CREAT | O_TMPFILE)) ? va_arg(args, mode_t) : 0;
+    va_end(args);
+    return function(path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...) {
+    if (strncmp(path, I2C_SIM_DEVICE_PREFIX, strlen(I2C_SIM_DEVICE_PREFIX)) == 0) {
+        return openBus();
+    }
+
+    static OpenFunction function = next<OpenFunction>("open64");
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = (flags & (O_CREAT | O_TMPFILE)) ? va_arg(args, mode_t) : 0;
+    va_end(args);
+    return function(path, flags, mode);
+}
+
+int close(int fd) {
+    static CloseFunction function = next<CloseFunction>("close");
+    if (openBuses.load() > 0) {
+        std::lock_guard<std::mutex> lock(busMutex);
+        if (simBus().slaves.erase(fd) > 0) {
+            openBuses--;
+        }
+    }
+    return function(fd);
+}
+
+int ioctl(int fd, unsigned long request, ...) __THROW {
+    va_list args;
+    va_start(args, request);
+    void *argument = va_arg(args, void *);
+    va_end(args);
+
+    uint16_t address;
+    if (!slaveAddress(fd, &address)) {
+        static IoctlFunction function = next<IoctlFunction>("ioctl");
+        return function(fd, request, argument);
+    }
+
+    switch (request) {
+        case I2C_SLAVE:
+        case I2C_SLAVE_FORCE: {
+            unsigned int slave = static_cast<unsigned int>(reinterpret_cast<unsigned long>(argument));
+            if (slave > 0x7F) {
+                errno = EINVAL;
+                return -1;
+            }
+            std::lock_guard<std::mutex> lock(busMutex);
+            simBus().slaves[fd] = static_cast<uint16_t>(slave);
+            return 0;
+        }
+        case I2C_FUNCS:
+            *static_cast<unsigned long *>(argument) = I2C_SIM_FUNCTIONALITY;
+            return 0;
+        case I2C_RDWR: {
+            struct i2c_rdwr_ioctl_data *transfer = static_cast<struct i2c_rdwr_ioctl_data *>(argument);
+            if (transfer == nullptr || transfer->nmsgs > I2C_RDWR_IOCTL_MAX_MSGS) {
+                errno = EINVAL;
+                return -1;
+            }
+            return transact(transfer->msgs, transfer->nmsgs);
+        }
+        case I2C_SMBUS:
+            return smbusTransfer(address, static_cast<struct i2c_smbus_ioctl_data *>(argument));
+        default:
+            errno = ENOTTY;
+            return -1;
+    }
+}
+
+ssize_t read(int fd, void *buf, size_t count) {
+    uint16_t address;
+    if (!slaveAddress(fd, &address)) {
+        static ReadFunction function = next<ReadFunction>("read");
+        return function(fd, buf, count);
+    }
+
+    struct i2c_msg msg;
+    msg.addr = address;
+    msg.flags = I2C_M_RD;
+    msg.len = static_cast<uint16_t>(count > I2C_SIM_MAX_TRANSFER ? I2C_SIM_MAX_TRANSFER : count);
+    msg.buf = static_cast<uint8_t *>(buf);
+    return transact(&msg, 1) < 0 ? -1 : msg.len;
+}
+
+ssize_t write(int fd, const void *buf, size_t count) {
+    uint16_t address;
+    if (!slaveAddress(fd, &address)) {
+        static WriteFunction function = next<WriteFunction>("write");
+        return function(fd, buf, count);
+    }
+
+    struct i2c_msg msg;
+    msg.addr = address;
+    msg.flags = 0;
+    msg.len = static_cast<uint16_t>(count > I2C_SIM_MAX_TRANSFER ? I2C_SIM_MAX_TRANSFER : count);
+    msg.buf = static_cast<uint8_t *>(const_cast<void *>(buf));
+    return transact(&msg, 1) < 0 ? -1 : msg.len;
+}
+
+int clock_gettime(clockid_t clock, struct timespec *ts) __THROW {
+    int result = realClockGettime(clock, ts);
+    if (result == 0 && clock == CLOCK_MONOTONIC && !clockIdentity.load()) {
+        *ts = toTimespec(virtualNanos(toNanos(*ts)));
+    }
+    return result;
+}
+
+int clock_nanosleep(clockid_t clock, int flags, const struct timespec *request, struct timespec *remaining) {
+    static ClockNanosleepFunction function = next<ClockNanosleepFunction>("clock_nanosleep");
+    if (clock != CLOCK_MONOTONIC || clockIdentity.load()) {
+        return function(clock, flags, request, remaining);
+    }
+
+    uint64_t duration = toNanos(*request);
+    if (flags & TIMER_ABSTIME) {
+        uint64_t now = I2cSim::NowNanos();
+        if (duration <= now) {
+            return 0;
+        }
+        duration -= now;
+        remaining = nullptr;
+    }
+    return sleepVirtual(duration, remaining) == 0 ? 0 : errno;
+}
+
+int nanosleep(const struct timespec *request, struct timespec *remaining) {
+    if (clockIdentity.load()) {
+        return realNanosleep(request, remaining);
+    }
+    return sleepVirtual(toNanos(*request), remaining);
+}
+
+int usleep(useconds_t micros) {
+    struct timespec request = toTimespec(static_cast<uint64_t>(micros) * 1000);
+    return nanosleep(&request, nullptr);
+}
+
+unsigned int sleep(unsigned int seconds) {
+    struct timespec request = toTimespec(static_cast<uint64_t>(seconds) * NANOS_PER_SECOND);
+    struct timespec remaining;
+    if (nanosleep(&request, &remaining) != 0) {
+        return static_cast<unsigned int>(remaining.tv_sec + (remaining.tv_nsec > 0 ? 1 : 0));
+    }
+    return 0;
+}
+
+/** libi2c, on top of I2C_SMBUS (the simulated bus or a real one) */
+__s32 i2c_smbus_access(int file, char read_write, __u8 command, int size, union i2c_smbus_data *data) {
+    struct i2c_smbus_ioctl_data request;
+    request.read_write = read_write;
+    request.command = command;
+    request.size = size;
+    request.data = data;
+    return ioctl(file, I2C_SMBUS, &request) < 0 ? -errno : 0;
+}
+
+__s32 i2c_smbus_read_byte_data(int file, __u8 command) {
+    union i2c_smbus_data data;
+    __s32 result = i2c_smbus_access(file, I2C_SMBUS_READ, command, I2C_SMBUS_BYTE_DATA, &data);
+    return result < 0 ? result : data.byte;
+}
+
+__s32 i2c_smbus_write_byte_data(int file, __u8 command, __u8 value) {
+    union i2c_smbus_data data;
+    data.byte = value;
+    return i2c_smbus_access(file, I2C_SMBUS_WRITE, command, I2C_SMBUS_BYTE_DATA, &data);
+}
+
+__s32 i2c_smbus_read_word_data(int file, __u8 command) {
+    union i2c_smbus_data data;
+    __s32 result = i2c_smbus_access(file, I2C_SMBUS_READ, command, I2C_SMBUS_WORD_DATA, &data);
+    return result < 0 ? result : data.word;
+}
+
+__s32 i2c_smbus_write_word_data(int file, __u8 command, __u16 value) {
+    union i2c_smbus_data data;
+    data.word = value;
+    return i2c_smbus_access(file, I2C_SMBUS_WRITE, command, I2C_SMBUS_WORD_DATA, &data);
+}
+
+__s32 i2c_smbus_read_i2c_block_data(int file, __u8 command, __u8 length, __u8 *values) {
+    union i2c_smbus_data data;
+    data.block[0] = length > I2C_SMBUS_BLOCK_MAX ? I2C_SMBUS_BLOCK_MAX : length;
+    __s32 result = i2c_smbus_access(file, I2C_SMBUS_READ, command, I2C_SMBUS_I2C_BLOCK_DATA, &data);
+    if (result < 0) {
+        return result;
+    }
+    memcpy(values, &data.block[1], data.block[0]);
+    return data.block[0];
+}
+
+__s32 i2c_smbus_write_i2c_block_data(int file, __u8 command, __u8 length, const __u8 *values) {
+    union i2c_smbus_data data;
+    data.block[0] = length > I2C_SMBUS_BLOCK_MAX ? I2C_SMBUS_BLOCK_MAX : length;
+    memcpy(&data.block[1], values, data.block[0]);
+    return i2c_smbus_access(file, I2C_SMBUS_WRITE, command, I2C_SMBUS_I2C_BLOCK_DATA, &data);
+}
+
+}
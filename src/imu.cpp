@@ -1,22 +1,38 @@
 #include "imu.h"
+#include "epoch_scheduler.h"
+#include <string.h>
 
 /**
- * @brief   Constructor for the Imu class.
+ * @brief   Constructor for the IMU driver.
  *
- * Initializes the I2C communication with the IMU sensor, sets its address, and performs an initial identification check.
+ * Attaches the IMU to the shared bus manager at high priority, and performs an initial identification check.
+ *
+ * @param   gyroFsSel   GYRO_FS_SEL_* the BasicImu type scales for.
+ * @param   accelFsSel  ACCEL_FS_SEL_*.
  */
-Imu::Imu() {
-	const char *deviceName = IMU_I2C_BUS;
-	i2c_fd = open(deviceName, O_RDWR);
-	if (i2c_fd < 0) {
-		perror("Unable to open I2C device");
-	}
-
-	if (ioctl(i2c_fd, I2C_SLAVE, IMU_I2C_ADDRESS) < 0) {
-		perror("Failed to acquire bus access and/or talk to slave");
+ImuDevice::ImuDevice(uint8_t gyroFsSel, uint8_t accelFsSel) {
+	readMode = DEFAULT_IMU_READ_MODE;
+	bank = BANK_UNKNOWN;
+	this->gyroFsSel = gyroFsSel;
+	this->accelFsSel = accelFsSel;
+	config = ImuConfig DEFAULT_IMU_CONFIG;
+	gyroDivider = 0;
+	accelDivider = 0;
+	fifoEnabled = false;
+	fifoStartNanos = 0;
+	fifoFrames = 0;
+	memset(&fifoStats, 0, sizeof(fifoStats));
+	SetMagCalibration(MagCalibration MAG_CALIBRATION_IDENTITY);
+	biases = ImuBiases DEFAULT_IMU_BIASES;
+	temperature = 0;
+	I2cDeviceConfig deviceConfig = IMU_I2C_DEVICE_CONFIG;
+	bus = &I2cBus::Shared(IMU_I2C_BUS);
+	busDevice = bus->Attach(deviceConfig);
+	if (busDevice < 0) {
+		fprintf(stderr, "Unable to attach the IMU to %s\n", IMU_I2C_BUS);
 	}
 
-	if (i2c_smbus_read_byte_data(i2c_fd, WHO_AM_I) != IMU_ID) {
+	if (readRegister(WHO_AM_I) != IMU_ID) {
 		perror("Failed to identify chip");
 	}
 
@@ -24,13 +40,109 @@ Imu::Imu() {
 }
 
 /**
- * @brief   Destructor for the Imu class.
+ * @brief   Destructor for the IMU driver.
  *
- * Closes the I2C device when the Imu object is destroyed.
+ * Detaches the IMU from the bus; the adapter is closed with its last device.
  */
-Imu::~Imu() {
+ImuDevice::~ImuDevice() {
 	printf("About to close fd\n");
-	close(i2c_fd);
+	bus->Detach(busDevice);
+}
+
+/**
+ * @brief   Read one register in a single bus transaction.
+ *
+ * @return  The register value, or -1 if the transfer failed.
+ */
+int32_t ImuDevice::readRegister(uint8_t reg) {
+	uint8_t value;
+	if (!bus->ReadRegisters(busDevice, reg, &value, 1)) {
+		return -1;
+	}
+	return value;
+}
+
+/**
+ * @brief   Write one register in a single bus transaction.
+ */
+bool ImuDevice::writeRegister(uint8_t reg, uint8_t value) {
+	return bus->WriteRegister(busDevice, reg, value);
+}
+
+/**
+ * @brief   Select a register bank, skipping the write when it is already selected.
+ *
+ * Only this driver writes BANK_SEL, so the last value written is the bank the chip
+ * is in. A failed write leaves the bank unknown and the next call writes again.
+ */
+bool ImuDevice::selectBank(uint8_t value) {
+	if (bank == value) {
+		return true;
+	}
+	if (!writeRegister(BANK_SEL, value)) {
+		bank = BANK_UNKNOWN;
+		return false;
+	}
+	bank = value;
+	return true;
+}
+
+/**
+ * @brief   Read the sample block starting at SAMPLE_BLOCK_START (bank 0 selected).
+ *
+ * In IMU_READ_MODE_BLOCK the block is one I2C_RDWR transaction; the chip increments
+ * the register address, and the bytes come from a single sample. In IMU_READ_MODE_BYTE
+ * the registers of each sensor and the temperature are read one transaction at a time.
+ *
+ * @param   block   SAMPLE_BLOCK_LENGTH bytes.
+ * @return  true if every transfer succeeded.
+ */
+bool ImuDevice::readSampleBlock(uint8_t *block) {
+	if (readMode == IMU_READ_MODE_BLOCK) {
+		return bus->ReadRegisters(busDevice, SAMPLE_BLOCK_START, block, SAMPLE_BLOCK_LENGTH);
+	}
+
+	static const uint8_t sensors[][2] = {{ACCEL_XOUT_H, SENSOR_DATA_SIZE}, {GYRO_XOUT_H, SENSOR_DATA_SIZE},
+		{TEMP_OUT_H, TEMP_DATA_SIZE}, {MAGNETO_XOUT_H, SENSOR_DATA_SIZE}};
+	for (const uint8_t *sensor : sensors) {
+		for (uint8_t reg = sensor[0]; reg < sensor[0] + sensor[1]; reg++) {
+			int32_t value = readRegister(reg);
+			if (value < 0) {
+				return false;
+			}
+			block[reg - SAMPLE_BLOCK_START] = static_cast<uint8_t>(value);
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief   Read only the temperature, for FIFO users (the FIFO frames do not hold it).
+ *
+ * The die temperature changes slowly; one read per FIFO drain or per second is plenty.
+ *
+ * @return  true if the temperature was read; GetTemperature() keeps the last one otherwise.
+ */
+bool ImuDevice::ReadTemperature(void) {
+	uint8_t temp[TEMP_DATA_SIZE];
+	I2cBusSession session(*bus, busDevice);
+	if (!selectBank(BANK_REG_0) || !bus->ReadRegisters(busDevice, TEMP_OUT_H, temp, sizeof(temp))) {
+		return false;
+	}
+	temperature = (temp[0] << BITS_PER_BYTE) | (temp[1] & BYTE_MASK);
+	return true;
+}
+
+/**
+ * @brief   Tell the bus how often ReadSensorData() is called.
+ *
+ * The bus then keeps a slot free for each sample and lower priority transfers (GPS
+ * drains) are fitted in between, so samples are not delayed by them.
+ *
+ * @param   periodMicros    The sample period, or 0 if reads are not periodic.
+ */
+void ImuDevice::SetSamplePeriod(uint32_t periodMicros) {
+	bus->SetPeriod(busDevice, periodMicros);
 }
 
 /**
@@ -39,98 +151,394 @@ Imu::~Imu() {
  * Sets up the IMU sensor by configuring registers and settings
  * for accelerometer, gyroscope, and magnetometer communication.
  */
-void Imu::begin() {
+void ImuDevice::begin() {
 	// Select Clock to Automatic (Init Accel and Gyro)
-	i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, BANK_REG_0); //set bank
-	i2c_smbus_write_byte_data(i2c_fd, PWR_MGMT_1, 0x01);
+	selectBank(BANK_REG_0); //set bank
+	writeRegister(PWR_MGMT_1, 0x01);
 
 	/* Init Magnometer */
 	// Master Pass Through set to false (For Magnometer)
-	i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, BANK_REG_0); //set bank
-	i2c_smbus_write_byte_data(i2c_fd, INT_PIN_CFG, 0x00);
+	selectBank(BANK_REG_0); //set bank
+	writeRegister(INT_PIN_CFG, 0x00);
 
 	// Enable Master (For Magnometer)
-	i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, BANK_REG_3); //set bank
-	i2c_smbus_write_byte_data(i2c_fd, I2C_MST_CTRL, 0x17);
-	i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, 0x00); //set bank
-	i2c_smbus_write_byte_data(i2c_fd, I2C_SLV0_ADDR, 0x20);
+	selectBank(BANK_REG_3); //set bank
+	writeRegister(I2C_MST_CTRL, 0x17);
+	selectBank(0x00); //set bank
+	writeRegister(I2C_SLV0_ADDR, 0x20);
 
 	// Transact directly with an I2C device, one byte at a time (For Magnometer)
-	i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, BANK_REG_3); //set bank
-	i2c_smbus_write_byte_data(i2c_fd, I2C_SLV4_ADDR, 0x0C);
-	i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, BANK_REG_3); //set bank
-	i2c_smbus_write_byte_data(i2c_fd, I2C_SLV4_REG, 0x31);
-	i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, BANK_REG_3); //set bank
-	i2c_smbus_write_byte_data(i2c_fd, I2C_SLV4_DO, 0x08);
-	i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, BANK_REG_3); //set bank
-	i2c_smbus_write_byte_data(i2c_fd, I2C_SLV4_CTRL, 0x80);
+	selectBank(BANK_REG_3); //set bank
+	writeRegister(I2C_SLV4_ADDR, 0x0C);
+	selectBank(BANK_REG_3); //set bank
+	writeRegister(I2C_SLV4_REG, 0x31);
+	selectBank(BANK_REG_3); //set bank
+	writeRegister(I2C_SLV4_DO, 0x08);
+	selectBank(BANK_REG_3); //set bank
+	writeRegister(I2C_SLV4_CTRL, 0x80);
 
 	// Set up Slaves with Master (For Magnometer)
-	i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, BANK_REG_3); //set bank
-	i2c_smbus_write_byte_data(i2c_fd, I2C_SLV0_ADDR, 0x8C);
-	i2c_smbus_write_byte_data(i2c_fd, I2C_SLV0_REG, 0x10);
-	i2c_smbus_write_byte_data(i2c_fd, I2C_SLV0_CTRL, 0x89);
+	selectBank(BANK_REG_3); //set bank
+	writeRegister(I2C_SLV0_ADDR, 0x8C);
+	writeRegister(I2C_SLV0_REG, 0x10);
+	writeRegister(I2C_SLV0_CTRL, 0x89);
+
+	// Full scale of the Imu type, reset filters and rates
+	if (!Configure(config)) {
+		perror("Failed to configure the IMU");
+	}
 
 	/* Reset Bank to Zero 0 For Reading Data */
-	i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, BANK_REG_0); //set bank
-}
-
-/**
- * @brief   Read sensor data from IMU over I2C.
- *          Replace this section with your actual I2C communication to read
- * 			sensor data. For example: accelerometer[0] = <read accelerometer X value>;
- *          accelerometer[1] = <read accelerometer Y value>;
- *          accelerometer[2] = <read accelerometer Z value>;
- *          gyroscope[0] = <read gyroscope X value>;
- *          gyroscope[1] = <read gyroscope Y value>;
- *          gyroscope[2] = <read gyroscope Z value>;
- *          magnetometer[0] = <read magnetometer X value>;
- *          magnetometer[1] = <read magnetometer Y value>;
- *          magnetometer[2] = <read magnetometer Z value>;
- */
-void Imu::ReadSensorData(void) {
-    /* Reset bank to 0 on every read */
-    i2c_smbus_write_byte_data(i2c_fd, BANK_SEL, BANK_REG_0); //set bank
-
-    /* Read accelerometer data */
-    uint8_t accel_x_h, accel_x_l, accel_y_h, accel_y_l, accel_z_h, accel_z_l;
-    accel_x_h = i2c_smbus_read_byte_data(i2c_fd, ACCEL_XOUT_H);
-    accel_x_l = i2c_smbus_read_byte_data(i2c_fd, ACCEL_XOUT_L);
-    accel_y_h = i2c_smbus_read_byte_data(i2c_fd, ACCEL_YOUT_H);
-    accel_y_l = i2c_smbus_read_byte_data(i2c_fd, ACCEL_YOUT_L);
-    accel_z_h = i2c_smbus_read_byte_data(i2c_fd, ACCEL_ZOUT_H);
-    accel_z_l = i2c_smbus_read_byte_data(i2c_fd, ACCEL_ZOUT_L);
-
-    // Converting Raw Accel Data to Readable data
-    accelerometer[0] = (accel_x_h << BITS_PER_BYTE) | (accel_x_l & BYTE_MASK);
-    accelerometer[1] = (accel_y_h << BITS_PER_BYTE) | (accel_y_l & BYTE_MASK);
-    accelerometer[2] = (accel_z_h << BITS_PER_BYTE) | (accel_z_l & BYTE_MASK);
-
-    /* Read gyroscope data */
-    uint8_t gyro_x_h, gyro_x_l, gyro_y_h, gyro_y_l, gyro_z_h, gyro_z_l;
-    gyro_x_h = i2c_smbus_read_byte_data(i2c_fd, GYRO_XOUT_H);
-    gyro_x_l = i2c_smbus_read_byte_data(i2c_fd, GYRO_XOUT_L);
-    gyro_y_h = i2c_smbus_read_byte_data(i2c_fd, GYRO_YOUT_H);
-    gyro_y_l = i2c_smbus_read_byte_data(i2c_fd, GYRO_YOUT_L);
-    gyro_z_h = i2c_smbus_read_byte_data(i2c_fd, GYRO_ZOUT_H);
-    gyro_z_l = i2c_smbus_read_byte_data(i2c_fd, GYRO_ZOUT_L);
-
-    // Converting Raw Gyro Data to Readable data
-    gyroscope[0] = (gyro_x_h << BITS_PER_BYTE) | (gyro_x_l & BYTE_MASK);
-    gyroscope[1] = (gyro_y_h << BITS_PER_BYTE) | (gyro_y_l & BYTE_MASK);
-    gyroscope[2] = (gyro_z_h << BITS_PER_BYTE) | (gyro_z_l & BYTE_MASK);
-
-    /* Read magentometer data */
-	uint8_t mag_x_h, mag_x_l, mag_y_h, mag_y_l, mag_z_h, mag_z_l;
-    mag_x_h = i2c_smbus_read_byte_data(i2c_fd, MAGNETO_XOUT_H);
-    mag_x_l = i2c_smbus_read_byte_data(i2c_fd, MAGNETO_XOUT_L);
-    mag_y_h = i2c_smbus_read_byte_data(i2c_fd, MAGNETO_YOUT_H);
-    mag_y_l = i2c_smbus_read_byte_data(i2c_fd, MAGNETO_YOUT_L);
-    mag_z_h = i2c_smbus_read_byte_data(i2c_fd, MAGNETO_ZOUT_H);
-    mag_z_l = i2c_smbus_read_byte_data(i2c_fd, MAGNETO_ZOUT_L);
-
-    // Converting Raw Mag Data to Readable data
-    magnetometer[0] = (mag_x_l << BITS_PER_BYTE) | (mag_x_h & BYTE_MASK);
-    magnetometer[1] = (mag_y_l << BITS_PER_BYTE) | (mag_y_h & BYTE_MASK);
-    magnetometer[2] = (mag_z_l << BITS_PER_BYTE) | (mag_z_h & BYTE_MASK);
+	selectBank(BANK_REG_0); //set bank
+}
+
+/**
+ * @brief   The divider that brings an output data rate nearest to the requested rate.
+ */
+static uint32_t rateDivider(uint32_t odrHz, uint32_t rateHz, uint32_t maxDivider) {
+	uint32_t divider = (odrHz + rateHz / 2) / rateHz - 1;
+	return divider > maxDivider ? maxDivider : divider;
+}
+
+/**
+ * @brief   Write GYRO_CONFIG_1, ACCEL_CONFIG and the sample rate dividers (bank 2), then
+ *          select bank 0 again.
+ */
+bool ImuDevice::writeConfig(void) {
+	uint8_t gyroConfig = gyroFsSel << SENSOR_CONFIG_FS_SEL_SHIFT;
+	if (config.gyroDlpf != IMU_DLPF_OFF) {
+		gyroConfig |= (config.gyroDlpf << SENSOR_CONFIG_DLPFCFG_SHIFT) | SENSOR_CONFIG_FCHOICE;
+	}
+	uint8_t accelConfig = accelFsSel << SENSOR_CONFIG_FS_SEL_SHIFT;
+	if (config.accelDlpf != IMU_DLPF_OFF) {
+		accelConfig |= (config.accelDlpf << SENSOR_CONFIG_DLPFCFG_SHIFT) | SENSOR_CONFIG_FCHOICE;
+	}
+
+	I2cBusSession session(*bus, busDevice);
+	return selectBank(BANK_REG_2) &&
+		writeRegister(GYRO_SMPLRT_DIV, gyroDivider) &&
+		writeRegister(GYRO_CONFIG_1, gyroConfig) &&
+		writeRegister(ACCEL_SMPLRT_DIV_1, static_cast<uint8_t>(accelDivider >> BITS_PER_BYTE)) &&
+		writeRegister(ACCEL_SMPLRT_DIV_2, static_cast<uint8_t>(accelDivider & BYTE_MASK)) &&
+		writeRegister(ACCEL_CONFIG, accelConfig) &&
+		selectBank(BANK_REG_0);
+}
+
+/**
+ * @brief   Set the low pass filters and output data rates of the gyro and accelerometer.
+ *
+ * The full-scale ranges are part of the BasicImu type, so that the getters scale with
+ * constants, and are written here as well. The rates apply while the sensor's filter
+ * is on; with IMU_DLPF_OFF the sensor runs unfiltered at 9 kHz (gyro) or 4.5 kHz
+ * (accel). The FIFO rate follows the gyro rate, and StartFifo() sets both rates.
+ *
+ * @param   requested   Filters and rates, see DEFAULT_IMU_CONFIG.
+ * @return  true if the configuration was valid and written.
+ */
+bool ImuDevice::Configure(const ImuConfig &requested) {
+	bool validDlpf = (requested.gyroDlpf <= SENSOR_CONFIG_DLPFCFG_MAX || requested.gyroDlpf == IMU_DLPF_OFF) &&
+		(requested.accelDlpf <= SENSOR_CONFIG_DLPFCFG_MAX || requested.accelDlpf == IMU_DLPF_OFF);
+	if (!validDlpf) {
+		fprintf(stderr, "IMU DLPF settings must be 0 to %d or IMU_DLPF_OFF\n", SENSOR_CONFIG_DLPFCFG_MAX);
+		return false;
+	}
+	if (requested.gyroRateHz == 0 || requested.gyroRateHz > GYRO_ODR_HZ ||
+		requested.accelRateHz == 0 || requested.accelRateHz > ACCEL_ODR_HZ) {
+		fprintf(stderr, "IMU rates must be 1 to %d Hz (gyro) and 1 to %d Hz (accel)\n", GYRO_ODR_HZ, ACCEL_ODR_HZ);
+		return false;
+	}
+	if (fifoEnabled && requested.gyroDlpf == IMU_DLPF_OFF) {
+		fprintf(stderr, "The IMU FIFO needs the gyro DLPF\n");
+		return false;
+	}
+
+	config = requested;
+	gyroDivider = static_cast<uint8_t>(rateDivider(GYRO_ODR_HZ, requested.gyroRateHz, 0xFF));
+	accelDivider = static_cast<uint16_t>(rateDivider(ACCEL_ODR_HZ, requested.accelRateHz, ACCEL_SMPLRT_DIV_MAX));
+	if (!writeConfig()) {
+		perror("Failed to configure the IMU");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief   The gyro output data rate in Hz.
+ */
+double ImuDevice::GetGyroRate(void) const {
+	if (config.gyroDlpf == IMU_DLPF_OFF) {
+		return GYRO_UNFILTERED_ODR_HZ;
+	}
+	return static_cast<double>(GYRO_ODR_HZ) / (1 + gyroDivider);
+}
+
+/**
+ * @brief   The accelerometer output data rate in Hz.
+ */
+double ImuDevice::GetAccelRate(void) const {
+	if (config.accelDlpf == IMU_DLPF_OFF) {
+		return ACCEL_UNFILTERED_ODR_HZ;
+	}
+	return static_cast<double>(ACCEL_ODR_HZ) / (1 + accelDivider);
+}
+
+/**
+ * @brief   Read accelerometer, gyroscope, temperature and magnetometer data from the
+ *          IMU over I2C.
+ *
+ * The bus is held for the whole sample. Bank 0 is selected only if it is not already,
+ * so in IMU_READ_MODE_BLOCK a sample is normally one transaction of SAMPLE_BLOCK_LENGTH
+ * bytes instead of a bank write and 20 single-byte reads. The temperature lies between
+ * the gyro and the magnetometer in the block, so it comes at no extra transfer.
+ *
+ * @return  true if the sample was read; the previous sample is kept otherwise.
+ */
+bool ImuDevice::ReadSensorData(void) {
+	uint8_t block[SAMPLE_BLOCK_LENGTH];
+	{
+		/* Hold the bus for the whole sample so nothing lands between its registers */
+		I2cBusSession session(*bus, busDevice, SAMPLE_BLOCK_LENGTH + 1);
+		if (!selectBank(BANK_REG_0) || !readSampleBlock(block)) {
+			return false;
+		}
+	}
+
+	// Converting Raw Accel and Gyro Data to Readable data (big endian)
+	const uint8_t *accel = &block[ACCEL_XOUT_H - SAMPLE_BLOCK_START];
+	const uint8_t *gyro = &block[GYRO_XOUT_H - SAMPLE_BLOCK_START];
+	for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+		accelerometer[axis] = (accel[2 * axis] << BITS_PER_BYTE) | (accel[2 * axis + 1] & BYTE_MASK);
+		gyroscope[axis] = (gyro[2 * axis] << BITS_PER_BYTE) | (gyro[2 * axis + 1] & BYTE_MASK);
+	}
+	const uint8_t *temp = &block[TEMP_OUT_H - SAMPLE_BLOCK_START];
+	temperature = (temp[0] << BITS_PER_BYTE) | (temp[1] & BYTE_MASK);
+
+	// Converting Raw Mag Data to Readable data (the AK09916 is little endian)
+	const uint8_t *mag = &block[MAGNETO_XOUT_H - SAMPLE_BLOCK_START];
+	for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+		magnetometer[axis] = (mag[2 * axis + 1] << BITS_PER_BYTE) | (mag[2 * axis] & BYTE_MASK);
+	}
+	return true;
+}
+
+/**
+ * @brief   Empty the FIFO, clear its overflow flag and restart the sample timestamps
+ *          from now (bank 0 selected).
+ */
+bool ImuDevice::resetFifo(void) {
+	// The sensor restarts its frames when the reset is written, not when this returns
+	uint64_t start = EpochScheduler::NowNanos();
+	if (!writeRegister(FIFO_RST, FIFO_RST_ALL) || !writeRegister(FIFO_RST, 0x00) || readRegister(INT_STATUS_2) < 0) {
+		return false;
+	}
+	fifoStartNanos = start;
+	fifoFrames = 0;
+	return true;
+}
+
+/**
+ * @brief   Let the sensor sample itself into its FIFO at a fixed rate.
+ *
+ * Sets the gyro and accel output data rates (see Configure(); the gyro filter must be
+ * on), selects accel, gyro and the SLV0 magnetometer read in FIFO_EN_1/FIFO_EN_2 in
+ * stream mode, and starts from an empty FIFO. The FIFO holds FIFO_MAX_FRAMES frames,
+ * so ReadFifo() must be called at least that often per rate.
+ *
+ * @param   rateHz  Requested rate; the nearest of 1.1 kHz / (1 + divider) is used,
+ *                  see GetFifoRate().
+ * @return  true if the FIFO was started.
+ */
+bool ImuDevice::StartFifo(uint16_t rateHz) {
+	if (rateHz == 0 || rateHz > GYRO_ODR_HZ) {
+		fprintf(stderr, "IMU FIFO rate must be 1 to %d Hz\n", GYRO_ODR_HZ);
+		return false;
+	}
+	if (config.gyroDlpf == IMU_DLPF_OFF) {
+		fprintf(stderr, "The IMU FIFO needs the gyro DLPF\n");
+		return false;
+	}
+	// The accelerometer follows the gyro's period, so the frames hold matching samples
+	gyroDivider = static_cast<uint8_t>(rateDivider(GYRO_ODR_HZ, rateHz, 0xFF));
+	uint32_t period = 1 + gyroDivider;
+	uint32_t accel = (ACCEL_ODR_HZ * period + GYRO_ODR_HZ / 2) / GYRO_ODR_HZ - 1;
+	accelDivider = static_cast<uint16_t>(accel > ACCEL_SMPLRT_DIV_MAX ? ACCEL_SMPLRT_DIV_MAX : accel);
+	config.gyroRateHz = static_cast<uint16_t>((GYRO_ODR_HZ + period / 2) / period);
+	config.accelRateHz = config.gyroRateHz;
+
+	I2cBusSession session(*bus, busDevice);
+	bool ok = writeConfig() &&
+		selectBank(BANK_REG_0) &&
+		writeRegister(USER_CTRL, USER_CTRL_I2C_MST_EN) &&
+		writeRegister(FIFO_EN_1, FIFO_EN_1_SLV0) &&
+		writeRegister(FIFO_EN_2, FIFO_EN_2_ACCEL_GYRO) &&
+		writeRegister(FIFO_MODE, FIFO_MODE_STREAM) &&
+		writeRegister(USER_CTRL, USER_CTRL_I2C_MST_EN | USER_CTRL_FIFO_EN) &&
+		resetFifo();
+	if (!ok) {
+		perror("Failed to start the IMU FIFO");
+		return false;
+	}
+	fifoEnabled = true;
+	return true;
+}
+
+/**
+ * @brief   Stop writing to the FIFO and empty it; ReadSensorData() keeps working.
+ */
+bool ImuDevice::StopFifo(void) {
+	I2cBusSession session(*bus, busDevice);
+	fifoEnabled = false;
+	return selectBank(BANK_REG_0) &&
+		writeRegister(USER_CTRL, USER_CTRL_I2C_MST_EN) &&
+		writeRegister(FIFO_EN_1, 0x00) &&
+		writeRegister(FIFO_EN_2, 0x00) &&
+		resetFifo();
+}
+
+void ImuDevice::ResetFifoStats(void) {
+	memset(&fifoStats, 0, sizeof(fifoStats));
+}
+
+/**
+ * @brief   Check INT_STATUS_2 and, after an overflow, reset the FIFO and count the
+ *          frames lost since the last drain (bank 0 selected).
+ *
+ * @return  1 if the FIFO had overflowed and was reset, 0 if not, -1 on a failed transfer.
+ */
+int ImuDevice::recoverFifoOverflow(uint64_t nowNanos) {
+	int32_t status = readRegister(INT_STATUS_2);
+	if (status < 0) {
+		return -1;
+	}
+	if (!(status & INT_STATUS_2_FIFO_OVERFLOW)) {
+		return 0;
+	}
+	uint64_t expected = (nowNanos - fifoStartNanos) * GYRO_ODR_HZ / ((1 + gyroDivider) * NANOS_PER_SECOND);
+	fifoStats.overflows++;
+	fifoStats.samplesLost += expected > fifoFrames ? static_cast<uint32_t>(expected - fifoFrames) : 0;
+	return resetFifo() ? 1 : -1;
+}
+
+/**
+ * @brief   Drain the whole frames in the FIFO as a batch of samples.
+ *
+ * One transaction reads FIFO_COUNT and one block read takes the frames; INT_STATUS_2
+ * is read as well only when the FIFO may have filled up before the block read. Frame n after the FIFO (re)started
+ * is stamped (n + 1) periods after the start. The start is moved when the newest frame
+ * would fall outside the period before the count was read, so a late start or the
+ * sensor's clock error does not accumulate. On an overflow the FIFO contents are no
+ * longer frame aligned: the FIFO is reset, nothing is returned, and the samples missed
+ * since the last drain are counted. The newest sample is also what GetAccelX() and the
+ * other getters return.
+ *
+ * @param   samples     Where to store the batch.
+ * @param   maxSamples  Capacity of samples; frames beyond it (or FIFO_MAX_FRAMES) stay
+ *                      for the next call.
+ * @return  The number of samples stored, 0 if none were ready (or after an overflow),
+ *          or -1 if the FIFO is not running or a transfer failed.
+ */
+int ImuDevice::ReadFifo(ImuSample *samples, uint16_t maxSamples) {
+	if (!fifoEnabled) {
+		return -1;
+	}
+
+	I2cBusSession session(*bus, busDevice);
+	uint8_t countBytes[2];
+	if (!selectBank(BANK_REG_0)) {
+		return -1;
+	}
+	uint64_t countStart = EpochScheduler::NowNanos();
+	if (!bus->ReadRegisters(busDevice, FIFO_COUNTH, countBytes, sizeof(countBytes))) {
+		return -1;
+	}
+	uint64_t now = EpochScheduler::NowNanos();
+	uint16_t count = ((countBytes[0] << BITS_PER_BYTE) | countBytes[1]) & FIFO_COUNT_MASK;
+	if (count + FIFO_FRAME_SIZE > FIFO_SIZE) {
+		int overflow = recoverFifoOverflow(now);
+		if (overflow != 0) {
+			return overflow > 0 ? 0 : -1;
+		}
+	}
+
+	// A count past FIFO_SIZE (a corrupted transfer) must not overrun data[]
+	uint16_t frames = count / FIFO_FRAME_SIZE;
+	frames = frames > FIFO_MAX_FRAMES ? FIFO_MAX_FRAMES : frames;
+	frames = frames > maxSamples ? maxSamples : frames;
+	if (frames == 0) {
+		return 0;
+	}
+	uint8_t data[FIFO_MAX_FRAMES * FIFO_FRAME_SIZE];
+	if (!bus->ReadRegisters(busDevice, FIFO_R_W, data, frames * FIFO_FRAME_SIZE)) {
+		return -1;
+	}
+
+	// Frames written after the count (a slow transfer, or this thread preempted) may
+	// have overflowed the FIFO before the block read, leaving it misaligned
+	uint64_t periodScaled = (1 + gyroDivider) * NANOS_PER_SECOND;
+	uint64_t readEnd = EpochScheduler::NowNanos();
+	uint64_t arrived = (readEnd - countStart) * GYRO_ODR_HZ / periodScaled + 1;
+	if (count + arrived * FIFO_FRAME_SIZE > FIFO_SIZE) {
+		int overflow = recoverFifoOverflow(readEnd);
+		if (overflow != 0) {
+			return overflow > 0 ? 0 : -1;
+		}
+	}
+
+	// The newest frame counted was written within one period before the count was read
+	uint64_t newest = fifoStartNanos + (fifoFrames + frames) * periodScaled / GYRO_ODR_HZ;
+	uint64_t earliest = countStart - periodScaled / GYRO_ODR_HZ;
+	if (newest > now) {
+		fifoStartNanos -= newest - now;
+	} else if (frames == count / FIFO_FRAME_SIZE && newest < earliest) {
+		fifoStartNanos += earliest - newest;
+	}
+	for (uint16_t i = 0; i < frames; i++) {
+		const uint8_t *frame = &data[i * FIFO_FRAME_SIZE];
+		ImuSample &sample = samples[i];
+		sample.timeNanos = fifoStartNanos + (fifoFrames + i + 1) * periodScaled / GYRO_ODR_HZ;
+		for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+			sample.accelerometer[axis] = (frame[2 * axis] << BITS_PER_BYTE) | (frame[2 * axis + 1] & BYTE_MASK);
+			sample.gyroscope[axis] = (frame[SENSOR_DATA_SIZE + 2 * axis] << BITS_PER_BYTE) |
+				(frame[SENSOR_DATA_SIZE + 2 * axis + 1] & BYTE_MASK);
+			sample.magnetometer[axis] = (frame[FIFO_MAG_OFFSET + 2 * axis + 1] << BITS_PER_BYTE) |
+				(frame[FIFO_MAG_OFFSET + 2 * axis] & BYTE_MASK);
+		}
+	}
+	fifoFrames += frames;
+	fifoStats.samples += frames;
+	fifoStats.drains++;
+
+	const ImuSample &last = samples[frames - 1];
+	memcpy(accelerometer, last.accelerometer, sizeof(accelerometer));
+	memcpy(gyroscope, last.gyroscope, sizeof(gyroscope));
+	memcpy(magnetometer, last.magnetometer, sizeof(magnetometer));
+	return frames;
+}
+
+/**
+ * @brief   Correct the magnetometer with a hard-iron bias and soft-iron matrix.
+ *
+ * The scale from counts to uT and the bias are folded into one matrix and offset,
+ * so GetMagX() and the others stay three multiply-adds per axis.
+ *
+ * @param   calibration     MAG_CALIBRATION_IDENTITY for the uncorrected field.
+ */
+void ImuDevice::SetMagCalibration(const MagCalibration &calibration) {
+	magCalibration = calibration;
+	for (int row = X_AXIS; row <= Z_AXIS; row++) {
+		magOffset[row] = 0.0F;
+		for (int column = X_AXIS; column <= Z_AXIS; column++) {
+			magMatrix[row][column] = static_cast<float>(calibration.softIron[row][column] * MAG_UT_LSB);
+			magOffset[row] -= calibration.softIron[row][column] * calibration.hardIron[column];
+		}
+	}
+}
+
+/**
+ * @brief   Correct raw magnetometer counts (of a FIFO sample, say) into uT.
+ */
+void ImuDevice::CalibrateMag(const int16_t *raw, float *mag) const {
+	for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+		mag[axis] = calibratedMag(raw, axis);
+	}
 }
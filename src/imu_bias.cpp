@@ -0,0 +1,172 @@
+#include "imu_bias.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * @brief   Constructor for the ImuBiasEstimator class.
+ *
+ * @param   initial     Biases until the first still window, DEFAULT_IMU_BIASES or the
+ *                      last ones saved.
+ * @param   config      Window length and standstill thresholds, see DEFAULT_IMU_BIAS_CONFIG.
+ */
+ImuBiasEstimator::ImuBiasEstimator(const ImuBiases &initial, const ImuBiasConfig &config) {
+    this->config = config;
+    if (this->config.windowSamples < 2) {
+        this->config.windowSamples = 2;
+    }
+    Reset(initial);
+}
+
+/**
+ * @brief   Drop the windows and the temperature model, and start again from initial.
+ */
+void ImuBiasEstimator::Reset(const ImuBiases &initial) {
+    memset(&stats, 0, sizeof(stats));
+    stats.temperatureC = IMU_BIAS_REFERENCE_C;
+    still = false;
+    count = 0;
+    temperatureSum = 0.0;
+    weight = sumT = sumTT = 0.0;
+    for (int channel = 0; channel < IMU_BIAS_CHANNELS; channel++) {
+        mean[channel] = m2[channel] = 0.0;
+        sumY[channel] = sumTY[channel] = 0.0;
+        slope[channel] = 0.0;
+    }
+    for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+        offset[axis] = initial.accel[axis];
+        offset[3 + axis] = initial.gyro[axis];
+    }
+}
+
+/**
+ * @brief   Add a sample; a window is evaluated every windowSamples samples.
+ *
+ * @param   accel           Body axes in g without the biases (BasicImu::GetUncorrected()).
+ * @param   gyro            Body axes in rad/s without the biases.
+ * @param   temperatureC    Die temperature (ImuDevice::GetTemperature()).
+ * @return  true when a window was completed; GetBiases() is then at its temperature,
+ *          refitted if it was still (IsStill()).
+ */
+bool ImuBiasEstimator::AddSample(const float accel[3], const float gyro[3], float temperatureC) {
+    stats.samples++;
+    count++;
+    for (int channel = 0; channel < IMU_BIAS_CHANNELS; channel++) {
+        double value = channel < 3 ? accel[channel] : gyro[channel - 3];
+        double delta = value - mean[channel];
+        mean[channel] += delta / count;
+        m2[channel] += delta * (value - mean[channel]);
+    }
+    temperatureSum += temperatureC;
+    if (count < config.windowSamples) {
+        return false;
+    }
+    endWindow();
+    return true;
+}
+
+/**
+ * @brief   Whether the window just completed was at standstill.
+ */
+bool ImuBiasEstimator::isStill(void) const {
+    double deltaT = stats.temperatureC - IMU_BIAS_REFERENCE_C;
+    double accelVariance = static_cast<double>(config.accelStillG) * config.accelStillG * (count - 1);
+    double gyroVariance = static_cast<double>(config.gyroStillRadS) * config.gyroStillRadS * (count - 1);
+    for (int channel = 0; channel < IMU_BIAS_CHANNELS; channel++) {
+        if (m2[channel] > (channel < 3 ? accelVariance : gyroVariance)) {
+            return false;
+        }
+        if (channel >= 3 && fabs(mean[channel] - (offset[channel] + slope[channel] * deltaT)) > config.gyroRateRadS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief   Close the current window: refit the biases if it was still, then start the next.
+ */
+void ImuBiasEstimator::endWindow(void) {
+    stats.windows++;
+    stats.temperatureC = static_cast<float>(temperatureSum / count);
+    double deltaT = stats.temperatureC - IMU_BIAS_REFERENCE_C;
+    still = isStill();
+    if (still) {
+        double observed[IMU_BIAS_CHANNELS];
+        // Accel: move the bias along the measured direction until gravity is 1 g
+        double direction[3];
+        double norm = 0.0;
+        for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+            direction[axis] = mean[axis] - (offset[axis] + slope[axis] * deltaT);
+            norm += direction[axis] * direction[axis];
+        }
+        norm = sqrt(norm);
+        for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+            double bias = offset[axis] + slope[axis] * deltaT;
+            observed[axis] = norm > 0.0 ? bias + (norm - 1.0) * direction[axis] / norm : bias;
+            observed[3 + axis] = mean[3 + axis];
+        }
+        addObservation(observed, deltaT);
+        stats.stillWindows++;
+        fit();
+    }
+
+    count = 0;
+    temperatureSum = 0.0;
+    for (int channel = 0; channel < IMU_BIAS_CHANNELS; channel++) {
+        mean[channel] = m2[channel] = 0.0;
+    }
+}
+
+/**
+ * @brief   Add a still window to the weighted sums, after fading the past ones.
+ */
+void ImuBiasEstimator::addObservation(const double observed[IMU_BIAS_CHANNELS], double deltaT) {
+    weight = config.forgetting * weight + 1.0;
+    sumT = config.forgetting * sumT + deltaT;
+    sumTT = config.forgetting * sumTT + deltaT * deltaT;
+    for (int channel = 0; channel < IMU_BIAS_CHANNELS; channel++) {
+        sumY[channel] = config.forgetting * sumY[channel] + observed[channel];
+        sumTY[channel] = config.forgetting * sumTY[channel] + deltaT * observed[channel];
+    }
+}
+
+/**
+ * @brief   Weighted least squares of each axis' bias over the temperature.
+ */
+void ImuBiasEstimator::fit(void) {
+    double meanT = sumT / weight;
+    double variance = sumTT / weight - meanT * meanT;
+    stats.temperatureSpreadC = static_cast<float>(variance > 0.0 ? sqrt(variance) : 0.0);
+    stats.temperatureModel = stats.temperatureSpreadC >= IMU_BIAS_MIN_TEMP_SPREAD_C;
+    for (int channel = 0; channel < IMU_BIAS_CHANNELS; channel++) {
+        double meanY = sumY[channel] / weight;
+        slope[channel] = stats.temperatureModel ? (sumTY[channel] / weight - meanT * meanY) / variance : 0.0;
+        offset[channel] = meanY - slope[channel] * meanT;
+    }
+}
+
+/**
+ * @brief   The biases at a temperature, to pass to ImuDevice::SetBiases().
+ */
+ImuBiases ImuBiasEstimator::GetBiases(float temperatureC) const {
+    double deltaT = temperatureC - IMU_BIAS_REFERENCE_C;
+    ImuBiases biases;
+    for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+        biases.accel[axis] = static_cast<float>(offset[axis] + slope[axis] * deltaT);
+        biases.gyro[axis] = static_cast<float>(offset[3 + axis] + slope[3 + axis] * deltaT);
+    }
+    return biases;
+}
+
+/**
+ * @brief   The fitted temperature coefficients, in g and rad/s per degree C; zero until
+ *          stats.temperatureModel.
+ */
+ImuBiases ImuBiasEstimator::GetSlopes(void) const {
+    ImuBiases slopes;
+    for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+        slopes.accel[axis] = static_cast<float>(slope[axis]);
+        slopes.gyro[axis] = static_cast<float>(slope[3 + axis]);
+    }
+    return slopes;
+}
@@ -0,0 +1,529 @@
+#include "mag_calibration.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define JACOBI_MAX_SWEEPS 50
+
+/**
+ * @brief   Eigenvalues and eigenvectors (columns) of a symmetric 3x3 matrix by Jacobi rotations.
+ */
+static void symmetricEigen(const double matrix[3][3], double values[3], double vectors[3][3]) {
+    double a[3][3];
+    memcpy(a, matrix, sizeof(a));
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            vectors[row][column] = row == column ? 1.0 : 0.0;
+        }
+    }
+
+    for (int sweep = 0; sweep < JACOBI_MAX_SWEEPS; sweep++) {
+        double off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+        double diagonal = fabs(a[0][0]) + fabs(a[1][1]) + fabs(a[2][2]);
+        if (off <= 1e-15 * diagonal) {
+            break;
+        }
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (a[p][q] == 0.0) {
+                    continue;
+                }
+                // Rotate the (p, q) element to zero
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0);
+                double s = t * c;
+                for (int k = 0; k < 3; k++) {
+                    double kp = a[k][p];
+                    double kq = a[k][q];
+                    a[k][p] = c * kp - s * kq;
+                    a[k][q] = s * kp + c * kq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double pk = a[p][k];
+                    double qk = a[q][k];
+                    a[p][k] = c * pk - s * qk;
+                    a[q][k] = s * pk + c * qk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double kp = vectors[k][p];
+                    double kq = vectors[k][q];
+                    vectors[k][p] = c * kp - s * kq;
+                    vectors[k][q] = s * kp + c * kq;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        values[i] = a[i][i];
+    }
+}
+
+/**
+ * @brief   Constructor for the MagCalibrator class; starts without samples.
+ *
+ * @param   forgetting  Weight of the samples so far when one is added (0 to 1):
+ *                      MAG_CAL_NO_FORGETTING fits every sample alike, 0.999 follows
+ *                      about the last thousand.
+ */
+MagCalibrator::MagCalibrator(double forgetting) {
+    this->forgetting = forgetting;
+    Reset();
+}
+
+/**
+ * @brief   Drop every sample and the calibration.
+ */
+void MagCalibrator::Reset(void) {
+    memset(information, 0, sizeof(information));
+    memset(projection, 0, sizeof(projection));
+    pending = 0;
+    valid = false;
+    calibration = MagCalibration MAG_CALIBRATION_IDENTITY;
+    memset(&stats, 0, sizeof(stats));
+    residualSum = 0.0;
+    residualCount = 0;
+}
+
+/**
+ * @brief   Add one sample, in units of MAG_CAL_SCALE_UT, to the normal equations.
+ *
+ * The model is x^2 + y^2 + z^2 = u . (x^2 + y^2 - 2z^2, x^2 + z^2 - 2y^2, 2xy, 2xz,
+ * 2yz, 2x, 2y, 2z, 1).
+ */
+void MagCalibrator::accumulate(double x, double y, double z) {
+    double xx = x * x;
+    double yy = y * y;
+    double zz = z * z;
+    double row[MAG_CAL_PARAMETERS] = {xx + yy - 2.0 * zz, xx + zz - 2.0 * yy, 2.0 * x * y, 2.0 * x * z, 2.0 * y * z,
+        2.0 * x, 2.0 * y, 2.0 * z, 1.0};
+    double target = xx + yy + zz;
+
+    if (forgetting < MAG_CAL_NO_FORGETTING) {
+        for (int i = 0; i < MAG_CAL_PARAMETERS; i++) {
+            for (int j = i; j < MAG_CAL_PARAMETERS; j++) {
+                information[i][j] *= forgetting;
+            }
+            projection[i] *= forgetting;
+        }
+    }
+    for (int i = 0; i < MAG_CAL_PARAMETERS; i++) {
+        for (int j = i; j < MAG_CAL_PARAMETERS; j++) {
+            information[i][j] += row[i] * row[j];
+        }
+        projection[i] += row[i] * target;
+    }
+    stats.samples++;
+    pending++;
+}
+
+/**
+ * @brief   Track how far the current calibration puts a sample (uT) from the field strength.
+ */
+void MagCalibrator::trackResidual(double x, double y, double z) {
+    double offset[3] = {x - calibration.hardIron[X_AXIS], y - calibration.hardIron[Y_AXIS], z - calibration.hardIron[Z_AXIS]};
+    double squared = 0.0;
+    for (int row = X_AXIS; row <= Z_AXIS; row++) {
+        double corrected = calibration.softIron[row][X_AXIS] * offset[X_AXIS] +
+            calibration.softIron[row][Y_AXIS] * offset[Y_AXIS] + calibration.softIron[row][Z_AXIS] * offset[Z_AXIS];
+        squared += corrected * corrected;
+    }
+    double error = sqrt(squared) - calibration.fieldUt;
+    residualSum += error * error;
+    residualCount++;
+    stats.residualUt = sqrt(residualSum / residualCount);
+}
+
+/**
+ * @brief   Add a magnetometer sample and refit every MAG_CAL_REFIT_SAMPLES samples.
+ *
+ * A sample of (0, 0, 0), read before the AK09916 has measured, is skipped.
+ *
+ * @param   raw     The three raw counts, as GetRawMagnetometerData().
+ * @return  true if this sample completed a fit that was accepted.
+ */
+bool MagCalibrator::AddSample(const int16_t *raw) {
+    if (raw[X_AXIS] == 0 && raw[Y_AXIS] == 0 && raw[Z_AXIS] == 0) {
+        return false;
+    }
+    double x = raw[X_AXIS] * MAG_UT_LSB;
+    double y = raw[Y_AXIS] * MAG_UT_LSB;
+    double z = raw[Z_AXIS] * MAG_UT_LSB;
+    accumulate(x / MAG_CAL_SCALE_UT, y / MAG_CAL_SCALE_UT, z / MAG_CAL_SCALE_UT);
+    if (valid) {
+        trackResidual(x, y, z);
+    }
+    if (stats.samples < MAG_CAL_MIN_SAMPLES || pending < MAG_CAL_REFIT_SAMPLES) {
+        return false;
+    }
+    return Fit();
+}
+
+/**
+ * @brief   Add a log of samples without refitting; call Fit() after the last one.
+ *
+ * @param   raw     count samples of three raw counts (x, y, z), as AddSample().
+ */
+void MagCalibrator::AddSamples(const int16_t *raw, size_t count) {
+    const double scale = MAG_UT_LSB / MAG_CAL_SCALE_UT;
+    for (size_t i = 0; i < count; i++, raw += 3) {
+        if (raw[X_AXIS] != 0 || raw[Y_AXIS] != 0 || raw[Z_AXIS] != 0) {
+            accumulate(raw[X_AXIS] * scale, raw[Y_AXIS] * scale, raw[Z_AXIS] * scale);
+        }
+    }
+}
+
+/**
+ * @brief   Map a whole file for reading.
+ *
+ * @return  true with data and size set (release with munmap), false with an error printed.
+ */
+static bool mapFile(const char *path, const uint8_t *&data, size_t &size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open magnetometer log");
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size == 0) {
+        printf("Error: %s is empty.\n", path);
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Failed to map magnetometer log");
+        return false;
+    }
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t *>(mapping);
+    size = info.st_size;
+    return true;
+}
+
+/**
+ * @brief   Parse a decimal number ("-123", "4.56") without strtod or the locale.
+ *
+ * @return  The character after the number, or nullptr if there is no number at text.
+ */
+static const char *parseNumber(const char *text, const char *end, double &value) {
+    while (text < end && (*text == ' ' || *text == '\t')) {
+        text++;
+    }
+    bool negative = text < end && *text == '-';
+    if (text < end && (*text == '-' || *text == '+')) {
+        text++;
+    }
+    const char *digits = text;
+    int64_t mantissa = 0;
+    while (text < end && *text >= '0' && *text <= '9') {
+        mantissa = mantissa * 10 + (*text++ - '0');
+    }
+    double divisor = 1.0;
+    if (text < end && *text == '.') {
+        text++;
+        while (text < end && *text >= '0' && *text <= '9') {
+            mantissa = mantissa * 10 + (*text++ - '0');
+            divisor *= 10.0;
+        }
+    }
+    if (text == digits || (text == digits + 1 && *digits == '.')) {
+        return nullptr;
+    }
+    value = (negative ? -mantissa : mantissa) / divisor;
+    return text;
+}
+
+/**
+ * @brief   Add a CSV log of raw counts, one "x,y,z" line per sample, without refitting.
+ *
+ * Lines that do not start with three numbers (a header) are skipped.
+ *
+ * @return  true if the file was read.
+ */
+bool MagCalibrator::AddCsvFile(const char *path) {
+    const uint8_t *data;
+    size_t size;
+    if (!mapFile(path, data, size)) {
+        return false;
+    }
+
+    const double scale = MAG_UT_LSB / MAG_CAL_SCALE_UT;
+    const char *text = reinterpret_cast<const char *>(data);
+    const char *end = text + size;
+    while (text < end) {
+        const char *lineEnd = static_cast<const char *>(memchr(text, '\n', end - text));
+        lineEnd = lineEnd != nullptr ? lineEnd : end;
+        double values[3];
+        const char *cursor = text;
+        int parsed = 0;
+        while (parsed < 3 && cursor != nullptr) {
+            cursor = parseNumber(cursor, lineEnd, values[parsed]);
+            if (cursor != nullptr) {
+                parsed++;
+                cursor = cursor < lineEnd && *cursor == ',' ? cursor + 1 : (parsed < 3 ? nullptr : cursor);
+            }
+        }
+        if (parsed == 3 && (values[X_AXIS] != 0.0 || values[Y_AXIS] != 0.0 || values[Z_AXIS] != 0.0)) {
+            accumulate(values[X_AXIS] * scale, values[Y_AXIS] * scale, values[Z_AXIS] * scale);
+        }
+        text = lineEnd + 1;
+    }
+    munmap(const_cast<uint8_t *>(data), size);
+    return true;
+}
+
+/**
+ * @brief   Add a binary log of raw counts, little endian int16 x, y, z per sample,
+ *          without refitting. A partial sample at the end is ignored.
+ *
+ * @return  true if the file was read.
+ */
+bool MagCalibrator::AddBinaryFile(const char *path) {
+    const uint8_t *data;
+    size_t size;
+    if (!mapFile(path, data, size)) {
+        return false;
+    }
+
+    const double scale = MAG_UT_LSB / MAG_CAL_SCALE_UT;
+    size_t count = size / (3 * sizeof(int16_t));
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *sample = &data[i * 3 * sizeof(int16_t)];
+        int16_t raw[3];
+        for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+            raw[axis] = static_cast<int16_t>(sample[2 * axis] | (sample[2 * axis + 1] << BITS_PER_BYTE));
+        }
+        if (raw[X_AXIS] != 0 || raw[Y_AXIS] != 0 || raw[Z_AXIS] != 0) {
+            accumulate(raw[X_AXIS] * scale, raw[Y_AXIS] * scale, raw[Z_AXIS] * scale);
+        }
+    }
+    munmap(const_cast<uint8_t *>(data), size);
+    return true;
+}
+
+/**
+ * @brief   Fit the ellipsoid to the samples so far.
+ *
+ * Solves the normal equations, moves the quadric to its centre (the hard-iron bias)
+ * and takes the symmetric square root of its matrix as the soft-iron correction.
+ * The calibration is kept unchanged if the fit is refused.
+ *
+ * @return  true if the fit was accepted and GetCalibration() returns it.
+ */
+bool MagCalibrator::Fit(void) {
+    pending = 0;
+    if (stats.samples < MAG_CAL_MIN_SAMPLES) {
+        stats.rejected++;
+        return false;
+    }
+
+    // Spread of the samples: the columns 2x, 2y, 2z and 1 hold their moments
+    const int first = MAG_CAL_PARAMETERS - 4;
+    const int one = MAG_CAL_PARAMETERS - 1;
+    double weight = information[one][one];
+    double mean[3];
+    double covariance[3][3];
+    for (int i = 0; i < 3; i++) {
+        mean[i] = information[first + i][one] / (2.0 * weight);
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = i; j < 3; j++) {
+            covariance[i][j] = information[first + i][first + j] / (4.0 * weight) - mean[i] * mean[j];
+            covariance[j][i] = covariance[i][j];
+        }
+    }
+    double variances[3];
+    double axes[3][3];
+    symmetricEigen(covariance, variances, axes);
+    double smallest = fmin(variances[0], fmin(variances[1], variances[2]));
+    double largest = fmax(variances[0], fmax(variances[1], variances[2]));
+    double spread = largest > 0.0 ? smallest / largest : 0.0;
+    stats.spread = spread;
+    if (spread < MAG_CAL_MIN_SPREAD) {
+        stats.rejected++;
+        return false;
+    }
+
+    // Cholesky factor of the normal equations, then u by forward and back substitution
+    double lower[MAG_CAL_PARAMETERS][MAG_CAL_PARAMETERS] = {};
+    for (int j = 0; j < MAG_CAL_PARAMETERS; j++) {
+        double pivot = information[j][j];
+        for (int k = 0; k < j; k++) {
+            pivot -= lower[j][k] * lower[j][k];
+        }
+        if (pivot <= MAG_CAL_PIVOT_EPSILON * information[j][j]) {
+            stats.rejected++;
+            return false;
+        }
+        lower[j][j] = sqrt(pivot);
+        for (int i = j + 1; i < MAG_CAL_PARAMETERS; i++) {
+            double sum = information[j][i];
+            for (int k = 0; k < j; k++) {
+                sum -= lower[i][k] * lower[j][k];
+            }
+            lower[i][j] = sum / lower[j][j];
+        }
+    }
+    double u[MAG_CAL_PARAMETERS];
+    for (int i = 0; i < MAG_CAL_PARAMETERS; i++) {
+        double sum = projection[i];
+        for (int k = 0; k < i; k++) {
+            sum -= lower[i][k] * u[k];
+        }
+        u[i] = sum / lower[i][i];
+    }
+    for (int i = MAG_CAL_PARAMETERS - 1; i >= 0; i--) {
+        double sum = u[i];
+        for (int k = i + 1; k < MAG_CAL_PARAMETERS; k++) {
+            sum -= lower[k][i] * u[k];
+        }
+        u[i] = sum / lower[i][i];
+    }
+
+    // Quadric s' Q s + 2 g' s + h = 0
+    double quadric[3][3] = {
+        {u[0] + u[1] - 1.0, u[2], u[3]},
+        {u[2], u[0] - 2.0 * u[1] - 1.0, u[4]},
+        {u[3], u[4], u[1] - 2.0 * u[0] - 1.0}};
+    double linear[3] = {u[5], u[6], u[7]};
+    double constant = u[8];
+
+    // Centre c = -Q^-1 g, by the adjugate
+    double cofactor[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            int r0 = (i + 1) % 3, r1 = (i + 2) % 3, c0 = (j + 1) % 3, c1 = (j + 2) % 3;
+            cofactor[i][j] = quadric[r0][c0] * quadric[r1][c1] - quadric[r0][c1] * quadric[r1][c0];
+        }
+    }
+    double determinant = quadric[0][0] * cofactor[0][0] + quadric[0][1] * cofactor[0][1] + quadric[0][2] * cofactor[0][2];
+    if (determinant == 0.0) {
+        stats.rejected++;
+        return false;
+    }
+    double centre[3];
+    for (int i = 0; i < 3; i++) {
+        centre[i] = -(cofactor[0][i] * linear[0] + cofactor[1][i] * linear[1] + cofactor[2][i] * linear[2]) / determinant;
+    }
+
+    // At the centre: (s - c)' Q (s - c) = -(g' c + h), so M = Q / -(g' c + h)
+    double level = -(linear[0] * centre[0] + linear[1] * centre[1] + linear[2] * centre[2] + constant);
+    double shape[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            shape[i][j] = quadric[i][j] / level;
+        }
+    }
+    double eigenvalues[3];
+    double eigenvectors[3][3];
+    symmetricEigen(shape, eigenvalues, eigenvectors);
+    if (eigenvalues[0] <= 0.0 || eigenvalues[1] <= 0.0 || eigenvalues[2] <= 0.0) {
+        stats.rejected++;
+        return false;
+    }
+    double radii[3];
+    for (int i = 0; i < 3; i++) {
+        radii[i] = 1.0 / sqrt(eigenvalues[i]);
+    }
+    double ratio = fmax(radii[0], fmax(radii[1], radii[2])) / fmin(radii[0], fmin(radii[1], radii[2]));
+    if (ratio > MAG_CAL_MAX_AXIS_RATIO) {
+        stats.rejected++;
+        return false;
+    }
+
+    // softIron = (field / scale) * V sqrt(L) V', so |softIron (m - b)| = field
+    double field = MAG_CAL_SCALE_UT * cbrt(radii[0] * radii[1] * radii[2]);
+    if (field < MAG_CAL_MIN_FIELD_UT || field > MAG_CAL_MAX_FIELD_UT) {
+        stats.rejected++;
+        return false;
+    }
+    for (int i = 0; i < 3; i++) {
+        calibration.hardIron[i] = static_cast<float>(centre[i] * MAG_CAL_SCALE_UT);
+        for (int j = 0; j < 3; j++) {
+            double sum = 0.0;
+            for (int k = 0; k < 3; k++) {
+                sum += eigenvectors[i][k] * sqrt(eigenvalues[k]) * eigenvectors[j][k];
+            }
+            calibration.softIron[i][j] = static_cast<float>(sum * field / MAG_CAL_SCALE_UT);
+        }
+    }
+    calibration.fieldUt = static_cast<float>(field);
+    valid = true;
+    stats.fits++;
+    stats.fieldUt = field;
+    stats.axisRatio = ratio;
+    residualSum = 0.0;
+    residualCount = 0;
+    return true;
+}
+
+/**
+ * @brief   Write a calibration as one line of text: field strength, hard iron, soft
+ *          iron by rows. The file is replaced atomically.
+ *
+ * @return  true if the file was written.
+ */
+bool MagCalibrator::Save(const MagCalibration &calibration, const char *path) {
+    std::string temporary = std::string(path) + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "w");
+    if (file == nullptr) {
+        perror("Failed to create magnetometer calibration file");
+        return false;
+    }
+
+    const float *soft = &calibration.softIron[0][0];
+    bool written = fprintf(file, "# fieldUt hardIron[3] softIron[3][3]\n%.9g %.9g %.9g %.9g"
+        " %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n", calibration.fieldUt,
+        calibration.hardIron[X_AXIS], calibration.hardIron[Y_AXIS], calibration.hardIron[Z_AXIS],
+        soft[0], soft[1], soft[2], soft[3], soft[4], soft[5], soft[6], soft[7], soft[8]) > 0;
+    written &= fflush(file) == 0 && fsync(fileno(file)) == 0;
+    written &= fclose(file) == 0;
+
+    if (!written || rename(temporary.c_str(), path) != 0) {
+        perror("Failed to write magnetometer calibration file");
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief   Read a calibration written by Save().
+ *
+ * @return  true if the file held a calibration; calibration is unchanged otherwise.
+ */
+bool MagCalibrator::Load(MagCalibration &calibration, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        perror("Failed to open magnetometer calibration file");
+        return false;
+    }
+
+    char line[512];
+    bool loaded = false;
+    while (!loaded && fgets(line, sizeof(line), file) != nullptr) {
+        if (line[0] == '#') {
+            continue;
+        }
+        MagCalibration read;
+        float *soft = &read.softIron[0][0];
+        loaded = sscanf(line, "%f %f %f %f %f %f %f %f %f %f %f %f %f", &read.fieldUt,
+            &read.hardIron[X_AXIS], &read.hardIron[Y_AXIS], &read.hardIron[Z_AXIS],
+            &soft[0], &soft[1], &soft[2], &soft[3], &soft[4], &soft[5], &soft[6], &soft[7], &soft[8]) == MAG_CAL_FILE_VALUES;
+        if (loaded) {
+            calibration = read;
+        }
+    }
+    fclose(file);
+    if (!loaded) {
+        printf("Error: %s is not a magnetometer calibration.\n", path);
+    }
+    return loaded;
+}
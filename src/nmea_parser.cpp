@@ -0,0 +1,864 @@
+#include "nmea_parser.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define NMEA_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NMEA_SIMD_NEON
+#endif
+
+#define NMEA_MAX_DECIMALS 9
+#define NMEA_MAX_DIGITS 18
+#define MILLIS_PER_DAY 86400000LL
+#define MILLIS_PER_WEEK 604800000LL
+#define KNOTS_TO_MM_PER_SECOND_NUM 4630      // 1852 m / 3600 s = 4630 / 9 mm/s per knot
+#define KNOTS_TO_MM_PER_SECOND_DEN 9
+#define KMH_TO_MM_PER_SECOND_NUM 2500        // 1e6 mm / 3600 s = 2500 / 9 mm/s per km/h
+#define KMH_TO_MM_PER_SECOND_DEN 9
+#define DEGREES_SCALE 10000000LL             // 1e-7 degrees, as NAV-PVT
+#define DEG_TO_RAD (M_PI / 180.0)
+
+static const int64_t POW10[NMEA_MAX_DIGITS + 1] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+    1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+    100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+    1000000000000000000LL
+};
+
+static uint8_t scanMode = NMEA_SCAN_SIMD;
+
+/**
+ * @brief   Bit i of the result is set where block[i] is first or second.
+ *
+ * @param   block   NMEA_SCAN_BLOCK_LENGTH readable bytes.
+ */
+static inline uint32_t matchMask(const uint8_t *block, uint8_t first, uint8_t second) {
+#if defined(NMEA_SIMD_SSE2)
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+    __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(first))),
+        _mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(second))));
+    return static_cast<uint32_t>(_mm_movemask_epi8(matches));
+#elif defined(NMEA_SIMD_NEON)
+    // NEON has no movemask: weight each matching lane by its bit and add pairwise
+    static const uint8_t weights[NMEA_SCAN_BLOCK_LENGTH] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t bytes = vld1q_u8(block);
+    uint8x16_t matches = vorrq_u8(vceqq_u8(bytes, vdupq_n_u8(first)), vceqq_u8(bytes, vdupq_n_u8(second)));
+    uint8x16_t bits = vandq_u8(matches, vld1q_u8(weights));
+    uint8x8_t sum = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+    sum = vpadd_u8(sum, sum);
+    sum = vpadd_u8(sum, sum);
+    return vget_lane_u8(sum, 0) | (static_cast<uint32_t>(vget_lane_u8(sum, 1)) << 8);
+#else
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < NMEA_SCAN_BLOCK_LENGTH; i++) {
+        mask |= static_cast<uint32_t>(block[i] == first || block[i] == second) << i;
+    }
+    return mask;
+#endif
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline int8_t hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief   Rescale a fixed point number to a number of decimals, rounding half away from zero.
+ */
+static int64_t rescale(int64_t mantissa, uint8_t decimals, uint8_t target) {
+    if (decimals <= target) {
+        return mantissa * POW10[target - decimals];
+    }
+    int64_t divisor = POW10[decimals - target];
+    int64_t half = divisor / 2;
+    return mantissa >= 0 ? (mantissa + half) / divisor : (mantissa - half) / divisor;
+}
+
+/**
+ * @brief   Divide, rounding half away from zero.
+ */
+static int64_t roundedDivide(int64_t numerator, int64_t denominator) {
+    int64_t half = denominator / 2;
+    return numerator >= 0 ? (numerator + half) / denominator : (numerator - half) / denominator;
+}
+
+/**
+ * @brief   Days from 1970-01-01 to a date of the proleptic Gregorian calendar.
+ */
+static int64_t daysFromCivil(int32_t year, uint32_t month, uint32_t day) {
+    year -= month <= 2;
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    uint32_t yearOfEra = static_cast<uint32_t>(year - era * 400);
+    uint32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return static_cast<int64_t>(era) * 146097 + dayOfEra - 719468;
+}
+
+/** One field of the sentence being handled */
+typedef struct {
+    const char *text;
+    uint16_t length;
+} NmeaField;
+
+static inline NmeaField field(const char *fields, const uint16_t *starts, uint8_t index) {
+    NmeaField f = {&fields[starts[index]], static_cast<uint16_t>(starts[index + 1] - starts[index] - 1)};
+    return f;
+}
+
+/**
+ * @brief   Parse a field holding a fixed point number.
+ *
+ * @param   f           The field; must not be empty.
+ * @param   target      Decimals of the result.
+ * @param   value       The number times 10^target.
+ * @return  true if the field is a number, false otherwise.
+ */
+static bool parseScaled(const NmeaField &f, uint8_t target, int64_t &value) {
+    int64_t mantissa;
+    uint8_t decimals;
+    if (!NmeaParser::ParseFixed(f.text, f.length, mantissa, decimals)) {
+        return false;
+    }
+    value = rescale(mantissa, decimals, target);
+    return true;
+}
+
+/**
+ * @brief   Parse a latitude (ddmm.mmmm) or longitude (dddmm.mmmm) with its hemisphere.
+ *
+ * The conversion to degrees is done in integers, so the result is exact to 1e-7
+ * degrees whatever the number of decimals of the minutes.
+ *
+ * @param   f           The coordinate field.
+ * @param   hemisphere  The N/S or E/W field.
+ * @param   negative    'S' or 'W'.
+ * @param   degrees     The coordinate in degrees.
+ * @return  true if both fields are valid, false otherwise.
+ */
+static bool parseCoordinate(const NmeaField &f, const NmeaField &hemisphere, char negative, double &degrees) {
+    int64_t mantissa;
+    uint8_t decimals;
+    if (hemisphere.length != 1 || !NmeaParser::ParseFixed(f.text, f.length, mantissa, decimals) || mantissa < 0) {
+        return false;
+    }
+    int64_t unit = POW10[decimals];
+    int64_t wholeDegrees = mantissa / (100 * unit);
+    int64_t minutes = mantissa - wholeDegrees * 100 * unit;   // Minutes times 10^decimals
+    int64_t scaled = wholeDegrees * DEGREES_SCALE + roundedDivide(minutes * DEGREES_SCALE, 60 * unit);
+    if (hemisphere.text[0] == negative) {
+        scaled = -scaled;
+    }
+    degrees = static_cast<int32_t>(scaled) * 1e-7;
+    return true;
+}
+
+/**
+ * @brief   Parse a UTC time field (hhmmss with optional fraction).
+ *
+ * @param   f           The time field.
+ * @param   timeMillis  Milliseconds of the day.
+ * @param   data        Receives hour, min, sec and nano.
+ * @return  true if the field is a valid time, false otherwise.
+ */
+static bool parseTime(const NmeaField &f, int32_t &timeMillis, PVTData &data) {
+    int64_t mantissa;
+    uint8_t decimals;
+    if (f.length < 6 || !NmeaParser::ParseFixed(f.text, f.length, mantissa, decimals) || mantissa < 0) {
+        return false;
+    }
+    int64_t unit = POW10[decimals];
+    int64_t hhmmss = mantissa / unit;
+    int64_t fraction = mantissa - hhmmss * unit;
+    uint32_t hour = static_cast<uint32_t>(hhmmss / 10000);
+    uint32_t min = static_cast<uint32_t>(hhmmss / 100 % 100);
+    uint32_t sec = static_cast<uint32_t>(hhmmss % 100);
+    if (hour > 23 || min > 59 || sec > 60) {
+        return false;
+    }
+    data.hour = hour;
+    data.min = min;
+    data.sec = sec;
+    data.nano = static_cast<int32_t>(fraction * POW10[NMEA_MAX_DECIMALS - decimals]);
+    timeMillis = static_cast<int32_t>(((hour * 60 + min) * 60 + sec) * 1000 + data.nano / 1000000);
+    return true;
+}
+
+/**
+ * @brief   Set the global scan mode (NMEA_SCAN_SIMD or NMEA_SCAN_SCALAR).
+ *
+ * The scalar scan is kept for comparison in benchmarks; both find the same delimiters.
+ */
+void NmeaParser::SetScanMode(uint8_t mode) {
+    scanMode = mode;
+}
+
+uint8_t NmeaParser::GetScanMode(void) {
+    return scanMode;
+}
+
+/**
+ * @brief   Find the first occurrence of either of two bytes.
+ *
+ * @param   data    The bytes to search.
+ * @param   length  The number of bytes in data.
+ * @param   first   A byte to look for.
+ * @param   second  The other byte to look for (may equal first).
+ * @return  The offset of the first match, or length if there is none.
+ */
+size_t NmeaParser::FindEither(const uint8_t *data, size_t length, uint8_t first, uint8_t second) {
+    size_t offset = 0;
+    if (scanMode == NMEA_SCAN_SIMD) {
+        for (; offset + NMEA_SCAN_BLOCK_LENGTH <= length; offset += NMEA_SCAN_BLOCK_LENGTH) {
+            uint32_t mask = matchMask(&data[offset], first, second);
+            if (mask != 0) {
+                return offset + __builtin_ctz(mask);
+            }
+        }
+    }
+    for (; offset < length; offset++) {
+        if (data[offset] == first || data[offset] == second) {
+            return offset;
+        }
+    }
+    return length;
+}
+
+/**
+ * @brief   Split a sentence body (the part between '$' and '*') at its commas.
+ *
+ * Field i runs from starts[i] to starts[i + 1] - 2; starts[count] is length + 1 so
+ * the last field needs no special case. Field 0 is the address (e.g. "GPRMC"). Any
+ * fields past maxFields stay part of the last one.
+ *
+ * @param   sentence    The sentence body.
+ * @param   length      The number of characters in the body.
+ * @param   starts      Receives maxFields + 1 offsets.
+ * @param   maxFields   The capacity of starts, minus one.
+ * @return  The number of fields.
+ */
+uint8_t NmeaParser::SplitFields(const char *sentence, uint16_t length, uint16_t *starts, uint8_t maxFields) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(sentence);
+    uint8_t count = 1;
+    starts[0] = 0;
+    uint16_t offset = 0;
+    if (scanMode == NMEA_SCAN_SIMD) {
+        for (; offset + NMEA_SCAN_BLOCK_LENGTH <= length; offset += NMEA_SCAN_BLOCK_LENGTH) {
+            uint32_t mask = matchMask(&bytes[offset], NMEA_FIELD_SEPARATOR, NMEA_FIELD_SEPARATOR);
+            while (mask != 0) {
+                if (count == maxFields) {
+                    starts[count] = length + 1;
+                    return count;
+                }
+                starts[count++] = offset + __builtin_ctz(mask) + 1;
+                mask &= mask - 1;
+            }
+        }
+    }
+    for (; offset < length; offset++) {
+        if (bytes[offset] == NMEA_FIELD_SEPARATOR) {
+            if (count == maxFields) {
+                break;
+            }
+            starts[count++] = offset + 1;
+        }
+    }
+    starts[count] = length + 1;
+    return count;
+}
+
+/**
+ * @brief   The NMEA checksum: XOR of every character between '$' and '*'.
+ *
+ * XOR has no carries, so eight characters are combined per step and folded at the end.
+ */
+uint8_t NmeaParser::Checksum(const char *data, uint16_t length) {
+    uint64_t words = 0;
+    uint16_t i = 0;
+    for (; i + sizeof(words) <= length; i += sizeof(words)) {
+        uint64_t word;
+        memcpy(&word, &data[i], sizeof(word));
+        words ^= word;
+    }
+    words ^= words >> 32;
+    words ^= words >> 16;
+    words ^= words >> 8;
+    uint8_t checksum = static_cast<uint8_t>(words);
+    for (; i < length; i++) {
+        checksum ^= static_cast<uint8_t>(data[i]);
+    }
+    return checksum;
+}
+
+/**
+ * @brief   Parse a decimal number as a fixed point integer.
+ *
+ * Accepts an optional sign, digits and an optional fraction, with no exponent, and
+ * does not depend on the locale. Digits past NMEA_MAX_DECIMALS decimals are dropped.
+ *
+ * @param   field       The characters of the number.
+ * @param   length      The number of characters.
+ * @param   mantissa    The number times 10^decimals.
+ * @param   decimals    The number of decimals kept.
+ * @return  true if the field is a number of at most NMEA_MAX_DIGITS digits, false otherwise.
+ */
+bool NmeaParser::ParseFixed(const char *field, uint16_t length, int64_t &mantissa, uint8_t &decimals) {
+    uint16_t i = 0;
+    bool negative = false;
+    if (i < length && (field[i] == '-' || field[i] == '+')) {
+        negative = field[i] == '-';
+        i++;
+    }
+
+    int64_t value = 0;
+    uint8_t digits = 0;
+    uint8_t fractionDigits = 0;
+    bool fraction = false;
+    for (; i < length; i++) {
+        char c = field[i];
+        if (isDigit(c)) {
+            if (fraction && fractionDigits == NMEA_MAX_DECIMALS) {
+                continue;
+            }
+            if (digits == NMEA_MAX_DIGITS) {
+                return false;
+            }
+            value = value * 10 + (c - '0');
+            digits++;
+            if (fraction) {
+                fractionDigits++;
+            }
+        } else if (c == '.' && !fraction) {
+            fraction = true;
+        } else {
+            return false;
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+
+    mantissa = negative ? -value : value;
+    decimals = fractionDigits;
+    return true;
+}
+
+/**
+ * @brief   Constructor for the NmeaParser class.
+ */
+NmeaParser::NmeaParser(void) {
+    Reset();
+    ResetStats();
+}
+
+/**
+ * @brief   Drop the partial sentence and epoch and forget the learned epoch terminator.
+ *
+ * Counters are kept; use ResetStats() to clear them.
+ */
+void NmeaParser::Reset(void) {
+    sentenceLength = 0;
+    inSentence = false;
+    overrun = false;
+    terminator = NMEA_SENTENCE_NONE;
+    afterTerminator = false;
+    lastEpochValid = false;
+    lastEpochTimeMillis = 0;
+    epochReady = false;
+    memset(&epoch, 0, sizeof(epoch));
+    startEpoch();
+}
+
+void NmeaParser::ResetStats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * @brief   Feed a chunk of the byte stream into the parser.
+ *
+ * Consumption stops right after the sentence that completes an epoch so it can be
+ * read through Epoch() before it is overwritten. Call again with the remaining
+ * bytes (data + returned count) until EpochReady() is false.
+ *
+ * @param   data    The received bytes.
+ * @param   length  The number of bytes in data.
+ * @return  The number of bytes of data that were consumed.
+ */
+size_t NmeaParser::Consume(const uint8_t *data, size_t length) {
+    epochReady = false;
+
+    size_t offset = 0;
+    while (offset < length && !epochReady) {
+        if (!inSentence) {
+            size_t start = FindEither(&data[offset], length - offset, NMEA_START_CHAR, NMEA_START_CHAR);
+            stats.bytesDiscarded += start;
+            offset += start;
+            if (offset == length) {
+                break;
+            }
+            offset++;
+            inSentence = true;
+            overrun = false;
+            sentenceLength = 0;
+            continue;
+        }
+
+        size_t end = FindEither(&data[offset], length - offset, NMEA_END_CHAR, NMEA_START_CHAR);
+        if (!overrun) {
+            if (sentenceLength + end > NMEA_MAX_SENTENCE_LENGTH) {
+                overrun = true;
+            } else {
+                memcpy(&sentence[sentenceLength], &data[offset], end);
+                sentenceLength += end;
+            }
+        }
+        offset += end;
+        if (offset == length) {
+            break;
+        }
+
+        if (data[offset] == NMEA_START_CHAR) {
+            // The line was cut off; the new '$' starts the next sentence
+            stats.truncated++;
+            overrun = false;
+            sentenceLength = 0;
+            offset++;
+            continue;
+        }
+
+        offset++;
+        inSentence = false;
+        if (overrun) {
+            stats.overruns++;
+        } else {
+            handleSentence();
+        }
+    }
+    return offset;
+}
+
+/**
+ * @brief   Complete the epoch in progress, e.g. at the end of a log.
+ *
+ * @post    EpochReady() is true if an epoch with a UTC time was pending.
+ */
+void NmeaParser::Flush(void) {
+    epochReady = false;
+    if (currentHasData) {
+        completeEpoch();
+    }
+}
+
+/**
+ * @brief   Verify the sentence in the buffer and merge it into the epoch in progress.
+ */
+void NmeaParser::handleSentence(void) {
+    uint16_t length = sentenceLength;
+    if (length > 0 && sentence[length - 1] == '\r') {
+        length--;
+    }
+    if (length < 3 || sentence[length - 3] != NMEA_CHECKSUM_CHAR) {
+        stats.checksumFailures++;
+        return;
+    }
+    int8_t high = hexValue(sentence[length - 2]);
+    int8_t low = hexValue(sentence[length - 1]);
+    uint16_t bodyLength = length - 3;
+    if (high < 0 || low < 0 || Checksum(sentence, bodyLength) != ((high << 4) | low)) {
+        stats.checksumFailures++;
+        return;
+    }
+    stats.sentences++;
+
+    // Talker "G?" (GP, GN, GL, GA, GB) followed by the sentence formatter; only the
+    // sentences merged into epochs are split into fields
+    uint8_t type = NMEA_SENTENCE_NONE;
+    if (bodyLength > 5 && sentence[0] == 'G' && sentence[5] == NMEA_FIELD_SEPARATOR) {
+        const char *formatter = &sentence[2];
+        if (memcmp(formatter, "RMC", 3) == 0) {
+            type = NMEA_SENTENCE_RMC;
+        } else if (memcmp(formatter, "GGA", 3) == 0) {
+            type = NMEA_SENTENCE_GGA;
+        } else if (memcmp(formatter, "VTG", 3) == 0) {
+            type = NMEA_SENTENCE_VTG;
+        } else if (memcmp(formatter, "GSA", 3) == 0) {
+            type = NMEA_SENTENCE_GSA;
+        }
+    }
+    if (type == NMEA_SENTENCE_NONE) {
+        stats.ignored++;
+        return;
+    }
+    uint16_t starts[NMEA_MAX_FIELDS + 1];
+    uint8_t count = SplitFields(sentence, bodyLength, starts, NMEA_MAX_FIELDS);
+
+    if (afterTerminator) {
+        // Timed repeats are caught by startTime()
+        if (type == terminator && (type == NMEA_SENTENCE_VTG || type == NMEA_SENTENCE_GSA)) {
+            return;
+        }
+        afterTerminator = false;
+    }
+
+    bool merged;
+    switch (type) {
+        case NMEA_SENTENCE_RMC:
+            merged = mergeRmc(sentence, starts, count);
+            break;
+        case NMEA_SENTENCE_GGA:
+            merged = mergeGga(sentence, starts, count);
+            break;
+        case NMEA_SENTENCE_VTG:
+            merged = mergeVtg(sentence, starts, count);
+            break;
+        default:
+            merged = mergeGsa(sentence, starts, count);
+            break;
+    }
+    if (!merged) {
+        return;
+    }
+
+    currentHasData = true;
+    lastSentence = type;
+    if (type == terminator) {
+        completeEpoch();
+        afterTerminator = true;
+    }
+}
+
+/**
+ * @brief   Place a timed sentence: complete the epoch in progress if its UTC time changed.
+ *
+ * @param   timeMillis  The sentence's UTC milliseconds of the day.
+ * @return  true if the sentence belongs to the epoch in progress (now), false if it
+ *          repeats the time of the epoch just completed.
+ */
+bool NmeaParser::startTime(int32_t timeMillis) {
+    if (currentHasTime && timeMillis != currentTimeMillis) {
+        // Time moved on without the terminator: it is the last type seen before
+        terminator = lastSentence;
+        completeEpoch();
+    } else if (!currentHasTime && lastEpochValid && timeMillis == lastEpochTimeMillis) {
+        stats.late++;
+        return false;
+    }
+    currentHasTime = true;
+    currentTimeMillis = timeMillis;
+    return true;
+}
+
+/**
+ * @brief   Clear the epoch in progress.
+ */
+void NmeaParser::startEpoch(void) {
+    memset(&current, 0, sizeof(current));
+    currentHasData = false;
+    currentHasTime = false;
+    currentTimeMillis = 0;
+    currentHasDate = false;
+    gsaNavMode = 0;
+    ggaQuality = NMEA_QUALITY_UNKNOWN;
+    rmcStatus = 0;
+    modeIndicator = 0;
+    hasSpeed = false;
+    hasCourse = false;
+    lastSentence = NMEA_SENTENCE_NONE;
+}
+
+/**
+ * @brief   Derive the remaining PVTData fields and publish the epoch in progress.
+ *
+ * An epoch without a UTC time (only VTG/GSA after a dropped sentence) is discarded.
+ */
+void NmeaParser::completeEpoch(void) {
+    if (!currentHasTime) {
+        startEpoch();
+        return;
+    }
+    PVTData &data = current;
+
+    // Fix type: GSA has the dimension, GGA and RMC only whether there is a fix
+    if (gsaNavMode == 2) {
+        data.gnssFix = TWO_D_FIX;
+    } else if (gsaNavMode == 3) {
+        data.gnssFix = THREE_D_FIX;
+    } else if (gsaNavMode == 0 && ((ggaQuality != NMEA_QUALITY_UNKNOWN && ggaQuality != 0) || rmcStatus == 'A')) {
+        data.gnssFix = THREE_D_FIX;
+    } else {
+        data.gnssFix = NO_FIX;
+    }
+    if (ggaQuality == 6 || modeIndicator == 'E') {
+        data.gnssFix = DEAD_RECKONING_ONLY;
+    }
+    bool fixOk = (data.gnssFix == TWO_D_FIX || data.gnssFix == THREE_D_FIX) && rmcStatus != 'V' && ggaQuality != 0
+        && modeIndicator != 'N';
+    bool differential = ggaQuality == 2 || ggaQuality == 4 || ggaQuality == 5
+        || modeIndicator == 'D' || modeIndicator == 'F' || modeIndicator == 'R';
+    data.fixStatusFlags = (fixOk ? NAV_PVT_FLAGS_GNSS_FIX_OK : 0) | (fixOk && differential ? NAV_PVT_FLAGS_DIFF_SOLN : 0);
+
+    if (hasSpeed && hasCourse) {
+        double course = data.motionHeading * DEG_TO_RAD;
+        data.velocityNorth = static_cast<int32_t>(lround(data.groundSpeed * cos(course)));
+        data.velocityEast = static_cast<int32_t>(lround(data.groundSpeed * sin(course)));
+    }
+
+    data.validTimeFlag = 1;
+    data.validDateFlag = currentHasDate ? 1 : 0;
+    data.fullyResolved = currentHasDate ? 1 : 0;
+    if (currentHasDate) {
+        int64_t gpsEpochDays = daysFromCivil(1980, 1, 6);
+        int64_t millis = (daysFromCivil(data.year, data.month, data.day) - gpsEpochDays) * MILLIS_PER_DAY
+            + currentTimeMillis + NMEA_GPS_LEAP_SECONDS * 1000LL;
+        data.iTOW = static_cast<uint32_t>(millis % MILLIS_PER_WEEK);
+    }
+    data.newFix = 1;
+
+    epoch = data;
+    epochReady = true;
+    stats.epochs++;
+    lastEpochValid = true;
+    lastEpochTimeMillis = currentTimeMillis;
+    startEpoch();
+}
+
+/**
+ * @brief   RMC: time, status, position, speed, course, date and magnetic variation.
+ */
+bool NmeaParser::mergeRmc(const char *fields, const uint16_t *starts, uint8_t count) {
+    if (count < 10) {
+        stats.malformed++;
+        return false;
+    }
+    PVTData parsed = current;
+    int32_t timeMillis;
+    NmeaField time = field(fields, starts, 1);
+    if (time.length == 0) {
+        // The receiver does not know the time yet
+        stats.ignored++;
+        return false;
+    }
+    if (!parseTime(time, timeMillis, parsed)) {
+        stats.malformed++;
+        return false;
+    }
+
+    NmeaField status = field(fields, starts, 2);
+    NmeaField latitude = field(fields, starts, 3);
+    NmeaField longitude = field(fields, starts, 5);
+    NmeaField speed = field(fields, starts, 7);
+    NmeaField course = field(fields, starts, 8);
+    NmeaField date = field(fields, starts, 9);
+    int64_t value;
+    bool ok = status.length == 1;
+    if (ok && latitude.length > 0) {
+        ok = parseCoordinate(latitude, field(fields, starts, 4), 'S', parsed.latitude)
+            && parseCoordinate(longitude, field(fields, starts, 6), 'W', parsed.longitude);
+    }
+    bool speedPresent = speed.length > 0;
+    if (ok && speedPresent && (ok = parseScaled(speed, 3, value))) {
+        parsed.groundSpeed = static_cast<int32_t>(roundedDivide(value * KNOTS_TO_MM_PER_SECOND_NUM,
+            KNOTS_TO_MM_PER_SECOND_DEN * 1000));
+    }
+    bool coursePresent = course.length > 0;
+    if (ok && coursePresent && (ok = parseScaled(course, 5, value))) {
+        parsed.motionHeading = value * 1e-5;
+    }
+    bool datePresent = date.length > 0;
+    if (ok && datePresent) {
+        ok = date.length == 6 && parseScaled(date, 0, value);
+        uint32_t day = static_cast<uint32_t>(value / 10000);
+        uint32_t month = static_cast<uint32_t>(value / 100 % 100);
+        uint32_t year = static_cast<uint32_t>(value % 100);
+        ok = ok && day >= 1 && day <= 31 && month >= 1 && month <= 12;
+        parsed.day = day;
+        parsed.month = month;
+        parsed.year = year + (year < 80 ? 2000 : 1900);
+    }
+    if (ok && count > 11 && starts[11] - starts[10] > 1) {
+        ok = parseScaled(field(fields, starts, 10), 5, value) && field(fields, starts, 11).length == 1;
+        parsed.magneticDeclination = (field(fields, starts, 11).text[0] == 'W' ? -value : value) * 1e-5;
+        parsed.validMagFlag = 1;
+    }
+    if (!ok) {
+        stats.malformed++;
+        return false;
+    }
+
+    if (!startTime(timeMillis)) {
+        return false;
+    }
+    // startTime() may have completed the previous epoch: carry only this sentence's fields over
+    PVTData &data = current;
+    data.hour = parsed.hour;
+    data.min = parsed.min;
+    data.sec = parsed.sec;
+    data.nano = parsed.nano;
+    rmcStatus = status.text[0];
+    if (latitude.length > 0) {
+        data.latitude = parsed.latitude;
+        data.longitude = parsed.longitude;
+    }
+    if (speedPresent) {
+        data.groundSpeed = parsed.groundSpeed;
+        hasSpeed = true;
+    }
+    if (coursePresent) {
+        data.motionHeading = parsed.motionHeading;
+        hasCourse = true;
+    }
+    if (datePresent) {
+        data.year = parsed.year;
+        data.month = parsed.month;
+        data.day = parsed.day;
+        currentHasDate = true;
+    }
+    if (parsed.validMagFlag) {
+        data.magneticDeclination = parsed.magneticDeclination;
+        data.validMagFlag = 1;
+    }
+    if (count > 12 && field(fields, starts, 12).length == 1) {
+        modeIndicator = field(fields, starts, 12).text[0];
+    }
+    return true;
+}
+
+/**
+ * @brief   GGA: time, position, fix quality, satellites and altitudes.
+ */
+bool NmeaParser::mergeGga(const char *fields, const uint16_t *starts, uint8_t count) {
+    if (count < 12) {
+        stats.malformed++;
+        return false;
+    }
+    PVTData parsed = current;
+    int32_t timeMillis;
+    NmeaField time = field(fields, starts, 1);
+    if (time.length == 0) {
+        // The receiver does not know the time yet
+        stats.ignored++;
+        return false;
+    }
+    if (!parseTime(time, timeMillis, parsed)) {
+        stats.malformed++;
+        return false;
+    }
+
+    NmeaField latitude = field(fields, starts, 2);
+    NmeaField quality = field(fields, starts, 6);
+    NmeaField satellites = field(fields, starts, 7);
+    NmeaField altitude = field(fields, starts, 9);
+    NmeaField separation = field(fields, starts, 11);
+    int64_t value = 0;
+    int64_t qualityValue = 0;
+    int64_t satellitesValue = 0;
+    int64_t separationValue = 0;
+    bool ok = quality.length == 1 && parseScaled(quality, 0, qualityValue);
+    if (ok && latitude.length > 0) {
+        ok = parseCoordinate(latitude, field(fields, starts, 3), 'S', parsed.latitude)
+            && parseCoordinate(field(fields, starts, 4), field(fields, starts, 5), 'W', parsed.longitude);
+    }
+    if (ok && satellites.length > 0) {
+        ok = parseScaled(satellites, 0, satellitesValue) && satellitesValue >= 0 && satellitesValue <= 255;
+    }
+    if (ok && altitude.length > 0) {
+        ok = parseScaled(altitude, 3, value);
+    }
+    if (ok && separation.length > 0) {
+        ok = parseScaled(separation, 3, separationValue);
+    }
+    if (!ok) {
+        stats.malformed++;
+        return false;
+    }
+
+    if (!startTime(timeMillis)) {
+        return false;
+    }
+    PVTData &data = current;
+    data.hour = parsed.hour;
+    data.min = parsed.min;
+    data.sec = parsed.sec;
+    data.nano = parsed.nano;
+    ggaQuality = static_cast<uint8_t>(qualityValue);
+    if (latitude.length > 0) {
+        data.latitude = parsed.latitude;
+        data.longitude = parsed.longitude;
+    }
+    data.numberOfSatellites = static_cast<uint8_t>(satellitesValue);
+    if (altitude.length > 0) {
+        data.heightMSL = static_cast<int32_t>(value);
+        data.height = static_cast<int32_t>(value + separationValue);
+    }
+    return true;
+}
+
+/**
+ * @brief   VTG: course over ground and speed, in knots or else km/h.
+ */
+bool NmeaParser::mergeVtg(const char *fields, const uint16_t *starts, uint8_t count) {
+    if (count < 9) {
+        stats.malformed++;
+        return false;
+    }
+    NmeaField course = field(fields, starts, 1);
+    NmeaField knots = field(fields, starts, 5);
+    NmeaField kmh = field(fields, starts, 7);
+    int64_t courseValue = 0;
+    int64_t speedValue = 0;
+    bool ok = true;
+    if (course.length > 0) {
+        ok = parseScaled(course, 5, courseValue);
+    }
+    if (ok && knots.length > 0) {
+        ok = parseScaled(knots, 3, speedValue);
+        speedValue = roundedDivide(speedValue * KNOTS_TO_MM_PER_SECOND_NUM, KNOTS_TO_MM_PER_SECOND_DEN * 1000);
+    } else if (ok && kmh.length > 0) {
+        ok = parseScaled(kmh, 3, speedValue);
+        speedValue = roundedDivide(speedValue * KMH_TO_MM_PER_SECOND_NUM, KMH_TO_MM_PER_SECOND_DEN * 1000);
+    }
+    if (!ok) {
+        stats.malformed++;
+        return false;
+    }
+
+    if (course.length > 0) {
+        current.motionHeading = courseValue * 1e-5;
+        hasCourse = true;
+    }
+    if (knots.length > 0 || kmh.length > 0) {
+        current.groundSpeed = static_cast<int32_t>(speedValue);
+        hasSpeed = true;
+    }
+    if (count > 9 && field(fields, starts, 9).length == 1 && modeIndicator == 0) {
+        modeIndicator = field(fields, starts, 9).text[0];
+    }
+    return true;
+}
+
+/**
+ * @brief   GSA: fix dimension. Several GSA (one per GNSS) may follow each other.
+ */
+bool NmeaParser::mergeGsa(const char *fields, const uint16_t *starts, uint8_t count) {
+    NmeaField navMode = count >= 3 ? field(fields, starts, 2) : NmeaField{nullptr, 0};
+    if (navMode.length != 1 || navMode.text[0] < '1' || navMode.text[0] > '3') {
+        stats.malformed++;
+        return false;
+    }
+    gsaNavMode = static_cast<uint8_t>(navMode.text[0] - '0');
+    return true;
+}
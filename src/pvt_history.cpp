@@ -0,0 +1,313 @@
+#include "pvt_history.h"
+#include <math.h>
+
+#define DEGREES_PER_RADIAN (180.0 / M_PI)
+
+/**
+ * @brief   Meridian (north) and prime-vertical (east) radii of curvature at a latitude.
+ */
+static void earthRadii(double latitude, double &meridian, double &primeVertical) {
+    double sinLatitude = sin(latitude / DEGREES_PER_RADIAN);
+    double denominator = 1.0 - WGS84_ECCENTRICITY_SQUARED * sinLatitude * sinLatitude;
+    primeVertical = WGS84_SEMI_MAJOR_AXIS / sqrt(denominator);
+    meridian = primeVertical * (1.0 - WGS84_ECCENTRICITY_SQUARED) / denominator;
+}
+
+/**
+ * @brief   Rate of change of latitude and longitude (degrees/s) for a NED velocity.
+ */
+static void angularRates(double latitude, double height, double velocityNorth, double velocityEast,
+    double &latitudeRate, double &longitudeRate) {
+    double meridian;
+    double primeVertical;
+    earthRadii(latitude, meridian, primeVertical);
+    latitudeRate = velocityNorth / (meridian + height) * DEGREES_PER_RADIAN;
+    longitudeRate = velocityEast / ((primeVertical + height) * cos(latitude / DEGREES_PER_RADIAN)) * DEGREES_PER_RADIAN;
+}
+
+/**
+ * @brief   Bring a longitude back into (-180, 180].
+ */
+static double wrapLongitude(double longitude) {
+    while (longitude > 180.0) {
+        longitude -= 360.0;
+    }
+    while (longitude <= -180.0) {
+        longitude += 360.0;
+    }
+    return longitude;
+}
+
+/**
+ * @brief   Constructor for the PvtHistory class; starts empty.
+ */
+PvtHistory::PvtHistory(void) {
+    Clear();
+}
+
+/**
+ * @brief   Forget every fix.
+ */
+void PvtHistory::Clear(void) {
+    head = 0;
+    count = 0;
+    lastITow = 0;
+    weekNanos = 0;
+}
+
+/**
+ * @brief   Append a fix; the oldest one is overwritten once the history is full.
+ *
+ * Both keys must increase: a host time at or before the newest fix's (the clock model
+ * was reset or refitted backwards) would leave AtHostTime() searching an unsorted key.
+ *
+ * @param   sample  The fix. iTOW is rounded to whole milliseconds; extrapolated is ignored.
+ * @return  true if stored, false if it is not newer than the newest fix in GNSS or host time.
+ */
+bool PvtHistory::Push(const PvtSample &sample) {
+    uint32_t iTow = static_cast<uint32_t>(llround(sample.iTOW));
+    int64_t week = weekNanos;
+    if (count > 0 && iTow < lastITow &&
+        static_cast<int64_t>(lastITow) - static_cast<int64_t>(iTow) > PVT_HISTORY_WEEK_MILLIS / 2) {
+        week += PVT_HISTORY_WEEK_MILLIS * static_cast<int64_t>(NANOS_PER_MILLI);
+    }
+    int64_t gnss = week + static_cast<int64_t>(iTow) * static_cast<int64_t>(NANOS_PER_MILLI);
+    if (count > 0 && (gnss <= gnssNanos[slot(count - 1)] || sample.hostNanos <= hostNanos[slot(count - 1)])) {
+        return false;
+    }
+
+    size_t index;
+    if (count < PVT_HISTORY_CAPACITY) {
+        index = slot(count);
+        count++;
+    } else {
+        index = head;
+        head = slot(1);
+    }
+
+    gnssNanos[index] = gnss;
+    hostNanos[index] = sample.hostNanos;
+    latitude[index] = sample.latitude;
+    longitude[index] = sample.longitude;
+    height[index] = sample.height;
+    velocityNorth[index] = sample.velocityNorth;
+    velocityEast[index] = sample.velocityEast;
+    velocityDown[index] = sample.velocityDown;
+    horizontalAccuracy[index] = sample.horizontalAccuracy;
+    verticalAccuracy[index] = sample.verticalAccuracy;
+    gnssFix[index] = sample.gnssFix;
+
+    lastITow = iTow;
+    weekNanos = week;
+    return true;
+}
+
+/**
+ * @brief   Append a NAV-PVT fix.
+ *
+ * @param   pvt         A valid NAV-PVT view.
+ * @param   hostNanos   Host time of the epoch (e.g. from the clock model).
+ * @return  true if stored, false if the receiver did not flag it gnssFixOK or it is
+ *          not newer than the newest fix in GNSS or host time.
+ */
+bool PvtHistory::Push(const NavPvtView &pvt, uint64_t hostNanos) {
+    if ((pvt.Flags() & NAV_PVT_FLAGS_GNSS_FIX_OK) == 0) {
+        return false;
+    }
+
+    PvtSample sample;
+    sample.iTOW = pvt.ITow();
+    sample.hostNanos = hostNanos;
+    sample.latitude = pvt.Latitude();
+    sample.longitude = pvt.Longitude();
+    sample.height = pvt.Height() / 1000.0;
+    sample.velocityNorth = pvt.VelocityNorth() / 1000.0;
+    sample.velocityEast = pvt.VelocityEast() / 1000.0;
+    sample.velocityDown = pvt.VelocityDown() / 1000.0;
+    sample.horizontalAccuracy = pvt.HorizontalAccuracy() / 1000.0;
+    sample.verticalAccuracy = pvt.VerticalAccuracy() / 1000.0;
+    sample.gnssFix = pvt.FixType();
+    sample.extrapolated = 0;
+    return Push(sample);
+}
+
+/**
+ * @brief   Number of fixes (oldest first) whose key is not after key.
+ */
+template<typename T>
+size_t PvtHistory::upperBound(const T *keys, T key) const {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (keys[slot(middle)] <= key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief   Interpolate between fix index and the one after it.
+ *
+ * @param   index       Fix before the query (0 = oldest).
+ * @param   fraction    Position of the query between the two fixes, 0 to 1.
+ * @param   mode        PVT_INTERPOLATE_LINEAR or PVT_INTERPOLATE_HERMITE.
+ * @param   sample      Receives the result.
+ */
+void PvtHistory::fill(size_t index, double fraction, uint8_t mode, PvtSample &sample) const {
+    size_t i0 = slot(index);
+    size_t i1 = slot(index + 1);
+    double s = fraction;
+    double seconds = (gnssNanos[i1] - gnssNanos[i0]) / 1e9;
+
+    // Longitude is interpolated as a continuous angle across the antimeridian
+    double longitude0 = longitude[i0];
+    double longitude1 = longitude0 + wrapLongitude(longitude[i1] - longitude0);
+
+    if (mode == PVT_INTERPOLATE_HERMITE) {
+        double h00 = 2 * s * s * s - 3 * s * s + 1;
+        double h10 = s * s * s - 2 * s * s + s;
+        double h01 = -2 * s * s * s + 3 * s * s;
+        double h11 = s * s * s - s * s;
+
+        double latitudeRate0, longitudeRate0, latitudeRate1, longitudeRate1;
+        angularRates(latitude[i0], height[i0], velocityNorth[i0], velocityEast[i0], latitudeRate0, longitudeRate0);
+        angularRates(latitude[i1], height[i1], velocityNorth[i1], velocityEast[i1], latitudeRate1, longitudeRate1);
+
+        sample.latitude = h00 * latitude[i0] + h10 * seconds * latitudeRate0 +
+            h01 * latitude[i1] + h11 * seconds * latitudeRate1;
+        sample.longitude = h00 * longitude0 + h10 * seconds * longitudeRate0 +
+            h01 * longitude1 + h11 * seconds * longitudeRate1;
+        sample.height = h00 * height[i0] - h10 * seconds * velocityDown[i0] +
+            h01 * height[i1] - h11 * seconds * velocityDown[i1];
+    } else {
+        sample.latitude = latitude[i0] + s * (latitude[i1] - latitude[i0]);
+        sample.longitude = longitude0 + s * (longitude1 - longitude0);
+        sample.height = height[i0] + s * (height[i1] - height[i0]);
+    }
+    sample.longitude = wrapLongitude(sample.longitude);
+
+    sample.velocityNorth = velocityNorth[i0] + s * (velocityNorth[i1] - velocityNorth[i0]);
+    sample.velocityEast = velocityEast[i0] + s * (velocityEast[i1] - velocityEast[i0]);
+    sample.velocityDown = velocityDown[i0] + s * (velocityDown[i1] - velocityDown[i0]);
+    sample.horizontalAccuracy = horizontalAccuracy[i0] + s * (horizontalAccuracy[i1] - horizontalAccuracy[i0]);
+    sample.verticalAccuracy = verticalAccuracy[i0] + s * (verticalAccuracy[i1] - verticalAccuracy[i0]);
+    sample.hostNanos = hostNanos[i0] + static_cast<uint64_t>(llround(s * (hostNanos[i1] - hostNanos[i0])));
+    sample.gnssFix = gnssFix[i0] < gnssFix[i1] ? gnssFix[i0] : gnssFix[i1];
+    sample.extrapolated = 0;
+}
+
+/**
+ * @brief   Dead-reckon from the newest fix with its velocity.
+ *
+ * @param   nanos   Time past the newest fix.
+ * @param   sample  Receives the result.
+ */
+void PvtHistory::extrapolate(int64_t nanos, PvtSample &sample) const {
+    size_t newest = slot(count - 1);
+    double seconds = nanos / 1e9;
+
+    double latitudeRate, longitudeRate;
+    angularRates(latitude[newest], height[newest], velocityNorth[newest], velocityEast[newest],
+        latitudeRate, longitudeRate);
+
+    sample.latitude = latitude[newest] + seconds * latitudeRate;
+    sample.longitude = wrapLongitude(longitude[newest] + seconds * longitudeRate);
+    sample.height = height[newest] - seconds * velocityDown[newest];
+    sample.velocityNorth = velocityNorth[newest];
+    sample.velocityEast = velocityEast[newest];
+    sample.velocityDown = velocityDown[newest];
+    sample.horizontalAccuracy = horizontalAccuracy[newest];
+    sample.verticalAccuracy = verticalAccuracy[newest];
+    sample.hostNanos = hostNanos[newest] + nanos;
+    sample.gnssFix = gnssFix[newest];
+    sample.extrapolated = nanos > 0 ? 1 : 0;
+}
+
+/**
+ * @brief   State at GNSS time gnss, given the fix at or before it.
+ */
+bool PvtHistory::at(int64_t gnss, size_t index, uint8_t mode, PvtSample &sample) const {
+    if (index + 1 == count) {
+        int64_t past = gnss - gnssNanos[slot(index)];
+        if (past > static_cast<int64_t>(PVT_HISTORY_MAX_EXTRAPOLATION_NANOS)) {
+            return false;
+        }
+        extrapolate(past, sample);
+    } else {
+        int64_t gnss0 = gnssNanos[slot(index)];
+        int64_t gnss1 = gnssNanos[slot(index + 1)];
+        if (gnss1 - gnss0 > static_cast<int64_t>(PVT_HISTORY_MAX_GAP_NANOS)) {
+            return false;
+        }
+        fill(index, static_cast<double>(gnss - gnss0) / (gnss1 - gnss0), mode, sample);
+    }
+
+    double iTow = (gnss - weekNanos) / 1e6;
+    sample.iTOW = iTow < 0 ? iTow + PVT_HISTORY_WEEK_MILLIS : iTow;
+    return true;
+}
+
+/**
+ * @brief   State at a GPS time of week.
+ *
+ * @param   iTowMillis  GPS time of week in milliseconds, within half a week of the newest fix.
+ * @param   sample      Receives the result.
+ * @param   mode        PVT_INTERPOLATE_LINEAR or PVT_INTERPOLATE_HERMITE.
+ * @return  false if the time is before the oldest fix, in a gap, or too far past the newest.
+ */
+bool PvtHistory::AtGnssTime(double iTowMillis, PvtSample &sample, uint8_t mode) const {
+    if (count == 0) {
+        return false;
+    }
+
+    double delta = iTowMillis - lastITow;
+    if (delta > PVT_HISTORY_WEEK_MILLIS / 2) {
+        delta -= PVT_HISTORY_WEEK_MILLIS;
+    } else if (delta < -PVT_HISTORY_WEEK_MILLIS / 2) {
+        delta += PVT_HISTORY_WEEK_MILLIS;
+    }
+    int64_t gnss = gnssNanos[slot(count - 1)] + llround(delta * NANOS_PER_MILLI);
+
+    size_t after = upperBound(gnssNanos, gnss);
+    if (after == 0) {
+        return false;
+    }
+    return at(gnss, after - 1, mode, sample);
+}
+
+/**
+ * @brief   State at a host CLOCK_MONOTONIC time, e.g. the timestamp of an IMU sample.
+ *
+ * The host time is mapped to GNSS time linearly between the two fixes around it, so
+ * host clock drift between fixes does not bend the result.
+ *
+ * @param   hostNanos   Host time in nanoseconds.
+ * @param   sample      Receives the result.
+ * @param   mode        PVT_INTERPOLATE_LINEAR or PVT_INTERPOLATE_HERMITE.
+ * @return  false if the time is before the oldest fix, in a gap, or too far past the newest.
+ */
+bool PvtHistory::AtHostTime(uint64_t hostNanos, PvtSample &sample, uint8_t mode) const {
+    if (count == 0) {
+        return false;
+    }
+
+    size_t after = upperBound(this->hostNanos, hostNanos);
+    if (after == 0) {
+        return false;
+    }
+
+    size_t index = after - 1;
+    size_t i0 = slot(index);
+    int64_t gnss = gnssNanos[i0] + static_cast<int64_t>(hostNanos - this->hostNanos[i0]);
+    if (after < count) {
+        size_t i1 = slot(after);
+        double fraction = static_cast<double>(hostNanos - this->hostNanos[i0]) /
+            (this->hostNanos[i1] - this->hostNanos[i0]);
+        gnss = gnssNanos[i0] + llround(fraction * (gnssNanos[i1] - gnssNanos[i0]));
+    }
+    return at(gnss, index, mode, sample);
+}
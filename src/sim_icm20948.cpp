@@ -0,0 +1,456 @@
+#include "sim_icm20948.h"
+#include "epoch_scheduler.h"
+#include <math.h>
+#include <string.h>
+
+/** Bank 0 */
+#define ICM_WHO_AM_I 0x00
+#define ICM_USER_CTRL 0x03
+#define ICM_PWR_MGMT_1 0x06
+#define ICM_I2C_MST_STATUS 0x17
+#define ICM_INT_STATUS_1 0x1A
+#define ICM_INT_STATUS_2 0x1B
+#define ICM_ACCEL_XOUT_H 0x2D
+#define ICM_GYRO_XOUT_H 0x33
+#define ICM_TEMP_OUT_H 0x39
+#define ICM_EXT_SLV_SENS_DATA_00 0x3B
+#define ICM_EXT_SLV_SENS_DATA_COUNT 24
+#define ICM_DATA_END (ICM_EXT_SLV_SENS_DATA_00 + ICM_EXT_SLV_SENS_DATA_COUNT)
+#define ICM_FIFO_EN_1 0x66
+#define ICM_FIFO_EN_2 0x67
+#define ICM_FIFO_RST 0x68
+#define ICM_FIFO_MODE 0x69
+#define ICM_FIFO_COUNTH 0x70
+#define ICM_FIFO_COUNTL 0x71
+#define ICM_FIFO_R_W 0x72
+
+/** Bank 2 */
+#define ICM_GYRO_SMPLRT_DIV 0x00
+#define ICM_GYRO_CONFIG_1 0x01
+#define ICM_ACCEL_SMPLRT_DIV_1 0x10
+#define ICM_ACCEL_SMPLRT_DIV_2 0x11
+#define ICM_ACCEL_CONFIG 0x14
+
+/** Bank 3 */
+#define ICM_I2C_SLV0_ADDR 0x03
+#define ICM_I2C_SLV0_REG 0x04
+#define ICM_I2C_SLV0_CTRL 0x05
+#define ICM_I2C_SLV4_ADDR 0x13
+#define ICM_I2C_SLV4_REG 0x14
+#define ICM_I2C_SLV4_CTRL 0x15
+#define ICM_I2C_SLV4_DO 0x16
+#define ICM_I2C_SLV4_DI 0x17
+
+#define ICM_PWR_MGMT_1_RESET_VALUE 0x41
+#define ICM_PWR_MGMT_1_DEVICE_RESET 0x80
+#define ICM_PWR_MGMT_1_SLEEP 0x40
+#define ICM_USER_CTRL_FIFO_EN 0x40
+#define ICM_USER_CTRL_I2C_MST_EN 0x20
+#define ICM_INT_STATUS_1_RAW_DATA_0_RDY 0x01
+#define ICM_INT_STATUS_2_FIFO_OVERFLOW 0x01
+#define ICM_FIFO_EN_1_SLV0 0x01
+#define ICM_FIFO_EN_2_ACCEL 0x10
+#define ICM_FIFO_EN_2_GYRO_X 0x02   // Y and Z in the next two bits
+#define ICM_FIFO_EN_2_GYRO 0x0E
+#define ICM_FIFO_EN_2_TEMP 0x01
+#define ICM_FIFO_RST_MASK 0x1F
+#define ICM_FIFO_MODE_SNAPSHOT 0x01
+#define ICM_FIFO_COUNTH_MASK 0x1F
+#define ICM_FIFO_EMPTY_VALUE 0xFF
+#define ICM_ACCEL_SMPLRT_DIV_1_MASK 0x0F
+#define ICM_GYRO_ODR_HZ 1100
+#define ICM_ACCEL_ODR_HZ 1125
+#define ICM_FIFO_MAX_FRAME_LENGTH 29  // Accel, gyro, temperature and 15 SLV0 bytes
+#define ICM_I2C_MST_STATUS_SLV4_DONE 0x40
+#define ICM_SLV_READ 0x80
+#define ICM_SLV_ENABLE 0x80
+#define ICM_SLV_LENGTH_MASK 0x0F
+#define ICM_FS_SEL_SHIFT 1
+#define ICM_FS_SEL_MASK 0x03
+#define ICM_CONFIG_RESET_VALUE 0x01   // DLPF on, smallest full scale
+
+#define ICM_ACCEL_LSB_PER_G_2G 16384.0
+#define ICM_GYRO_LSB_PER_DPS_250 131.0
+#define ICM_TEMP_LSB_PER_C 333.87
+#define ICM_TEMP_OFFSET_C 21.0
+#define ICM_GRAVITY 9.807
+
+/** AK09916 */
+#define AK_WIA1 0x00
+#define AK_WIA1_VALUE 0x48
+#define AK_WIA2 0x01
+#define AK_ST1 0x10
+#define AK_HXL 0x11
+#define AK_ST2 0x18
+#define AK_CNTL2 0x31
+#define AK_CNTL3 0x32
+#define AK_ST1_DRDY 0x01
+#define AK_CNTL3_SRST 0x01
+#define AK_UT_PER_LSB 0.15
+
+/**
+ * @brief   Constructor for the SimIcm20948 class; reset values and the default motion.
+ */
+SimIcm20948::SimIcm20948(void) : noise(0.0, 1.0) {
+    Configure(SimIcm20948Config SIM_ICM20948_DEFAULT_CONFIG, 1, 0);
+}
+
+/**
+ * @brief   Apply a motion model and reset the device at nowNanos.
+ *
+ * @param   config      The motion and noise model.
+ * @param   seed        Seed of the noise generator.
+ * @param   nowNanos    Virtual time of the reset; the yaw angle starts at zero.
+ */
+void SimIcm20948::Configure(const SimIcm20948Config &config, uint32_t seed, uint64_t nowNanos) {
+    this->config = config;
+    random.seed(seed);
+    powerOnNanos = nowNanos;
+    memset(&stats, 0, sizeof(stats));
+    reset();
+}
+
+/**
+ * @brief   Register reset values of the ICM-20948 and the AK09916.
+ */
+void SimIcm20948::reset(void) {
+    memset(banks, 0, sizeof(banks));
+    banks[0][ICM_WHO_AM_I] = SIM_ICM_WHO_AM_I_VALUE;
+    banks[0][ICM_PWR_MGMT_1] = ICM_PWR_MGMT_1_RESET_VALUE;
+    banks[2][ICM_GYRO_CONFIG_1] = ICM_CONFIG_RESET_VALUE;
+    banks[2][ICM_ACCEL_CONFIG] = ICM_CONFIG_RESET_VALUE;
+    bank = 0;
+    registerPointer = 0;
+    fifoHead = 0;
+    fifoCount = 0;
+    fifoNextNanos = 0;
+
+    memset(magnetometer, 0, sizeof(magnetometer));
+    magnetometer[AK_WIA1] = AK_WIA1_VALUE;
+    magnetometer[AK_WIA2] = SIM_AK09916_WIA2_VALUE;
+}
+
+double SimIcm20948::AccelScale(void) const {
+    uint8_t fs = (banks[2][ICM_ACCEL_CONFIG] >> ICM_FS_SEL_SHIFT) & ICM_FS_SEL_MASK;
+    return ICM_GRAVITY / (ICM_ACCEL_LSB_PER_G_2G / (1 << fs));
+}
+
+double SimIcm20948::GyroScale(void) const {
+    uint8_t fs = (banks[2][ICM_GYRO_CONFIG_1] >> ICM_FS_SEL_SHIFT) & ICM_FS_SEL_MASK;
+    return M_PI / 180.0 / (ICM_GYRO_LSB_PER_DPS_250 / (1 << fs));
+}
+
+/** Saturate and store a big-endian 16-bit sample */
+static void storeBigEndian(uint8_t *reg, double counts) {
+    long value = lround(counts);
+    value = value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : value);
+    reg[0] = static_cast<uint8_t>(static_cast<uint16_t>(value) >> 8);
+    reg[1] = static_cast<uint8_t>(value);
+}
+
+/**
+ * @brief   Evaluate the motion model at nowNanos into the output registers.
+ */
+void SimIcm20948::sample(uint64_t nowNanos) {
+    uint8_t *bank0 = banks[0];
+    if (bank0[ICM_PWR_MGMT_1] & ICM_PWR_MGMT_1_SLEEP) {
+        return;
+    }
+    stats.samples++;
+
+    double seconds = (nowNanos - powerOnNanos) / 1e9;
+    double yaw = config.yawRate * seconds;
+    double accel[3] = {0.0, 0.0, ICM_GRAVITY};
+    double gyro[3] = {0.0, 0.0, config.yawRate};
+    double accelScale = AccelScale();
+    double gyroScale = GyroScale();
+    for (int axis = 0; axis < 3; axis++) {
+        storeBigEndian(&bank0[ICM_ACCEL_XOUT_H + 2 * axis],
+            (accel[axis] + config.accelBias[axis] + config.accelNoise * noise(random)) / accelScale);
+        storeBigEndian(&bank0[ICM_GYRO_XOUT_H + 2 * axis],
+            (gyro[axis] + config.gyroBias[axis] + config.gyroNoise * noise(random)) / gyroScale);
+    }
+    storeBigEndian(&bank0[ICM_TEMP_OUT_H], (config.temperature - ICM_TEMP_OFFSET_C) * ICM_TEMP_LSB_PER_C);
+
+    // The AK09916 measures in its continuous modes (CNTL2 0x02..0x08)
+    if (magnetometer[AK_CNTL2] != 0) {
+        const double *field = config.magField;
+        double body[3] = {
+            field[0] * cos(yaw) + field[1] * sin(yaw),
+            -field[0] * sin(yaw) + field[1] * cos(yaw),
+            field[2]
+        };
+        for (int axis = 0; axis < 3; axis++) {
+            double counts = (body[axis] + config.magHardIron[axis] + config.magNoise * noise(random)) / AK_UT_PER_LSB;
+            long value = lround(counts);
+            value = value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : value);
+            magnetometer[AK_HXL + 2 * axis] = static_cast<uint8_t>(value);
+            magnetometer[AK_HXL + 2 * axis + 1] = static_cast<uint8_t>(static_cast<uint16_t>(value) >> 8);
+        }
+        magnetometer[AK_ST1] |= AK_ST1_DRDY;
+    }
+
+    if (bank0[ICM_USER_CTRL] & ICM_USER_CTRL_I2C_MST_EN) {
+        slave0Read();
+    }
+}
+
+/**
+ * @brief   SLV0: copy the configured AK09916 registers into EXT_SLV_SENS_DATA.
+ */
+void SimIcm20948::slave0Read(void) {
+    const uint8_t *bank3 = banks[3];
+    uint8_t address = bank3[ICM_I2C_SLV0_ADDR];
+    uint8_t control = bank3[ICM_I2C_SLV0_CTRL];
+    if (!(control & ICM_SLV_ENABLE) || !(address & ICM_SLV_READ) ||
+        (address & ~ICM_SLV_READ) != SIM_AK09916_ADDRESS) {
+        return;
+    }
+
+    uint8_t start = bank3[ICM_I2C_SLV0_REG];
+    uint8_t length = control & ICM_SLV_LENGTH_MASK;
+    for (uint8_t i = 0; i < length; i++) {
+        uint8_t magRegister = static_cast<uint8_t>(start + i);
+        banks[0][ICM_EXT_SLV_SENS_DATA_00 + i] = magRegister < sizeof(magnetometer) ? magnetometer[magRegister] : 0;
+    }
+    if (start <= AK_ST2 && start + length > AK_ST2) {
+        // Reading ST2 ends the measurement
+        magnetometer[AK_ST1] &= ~AK_ST1_DRDY;
+    }
+    stats.slaveTransfers++;
+}
+
+/**
+ * @brief   SLV4: one register write or read on the AK09916, flagged done in I2C_MST_STATUS.
+ */
+void SimIcm20948::slave4Transfer(void) {
+    uint8_t *bank3 = banks[3];
+    bank3[ICM_I2C_SLV4_CTRL] &= ~ICM_SLV_ENABLE;
+    if (!(banks[0][ICM_USER_CTRL] & ICM_USER_CTRL_I2C_MST_EN)) {
+        return;
+    }
+
+    uint8_t address = bank3[ICM_I2C_SLV4_ADDR];
+    uint8_t magRegister = bank3[ICM_I2C_SLV4_REG];
+    if ((address & ~ICM_SLV_READ) == SIM_AK09916_ADDRESS && magRegister < sizeof(magnetometer)) {
+        if (address & ICM_SLV_READ) {
+            bank3[ICM_I2C_SLV4_DI] = magnetometer[magRegister];
+        } else if (magRegister == AK_CNTL3 && (bank3[ICM_I2C_SLV4_DO] & AK_CNTL3_SRST)) {
+            magnetometer[AK_CNTL2] = 0;
+            magnetometer[AK_ST1] = 0;
+        } else if (magRegister == AK_CNTL2) {
+            magnetometer[AK_CNTL2] = bank3[ICM_I2C_SLV4_DO];
+        }
+        stats.slaveTransfers++;
+    }
+    banks[0][ICM_I2C_MST_STATUS] |= ICM_I2C_MST_STATUS_SLV4_DONE;
+}
+
+/**
+ * @brief   Whether frames are being written: FIFO_EN set, a source selected and awake.
+ */
+bool SimIcm20948::fifoEnabled(void) const {
+    const uint8_t *bank0 = banks[0];
+    return (bank0[ICM_USER_CTRL] & ICM_USER_CTRL_FIFO_EN) && !(bank0[ICM_PWR_MGMT_1] & ICM_PWR_MGMT_1_SLEEP) &&
+        ((bank0[ICM_FIFO_EN_1] & ICM_FIFO_EN_1_SLV0) || (bank0[ICM_FIFO_EN_2] & (ICM_FIFO_EN_2_ACCEL | ICM_FIFO_EN_2_GYRO | ICM_FIFO_EN_2_TEMP)));
+}
+
+/**
+ * @brief   Bytes per FIFO frame with the sources selected in FIFO_EN_1 and FIFO_EN_2.
+ */
+uint8_t SimIcm20948::fifoFrameLength(void) const {
+    uint8_t sources = banks[0][ICM_FIFO_EN_2];
+    uint8_t length = (sources & ICM_FIFO_EN_2_ACCEL) ? 6 : 0;
+    for (int axis = 0; axis < 3; axis++) {
+        length += (sources & (ICM_FIFO_EN_2_GYRO_X << axis)) ? 2 : 0;
+    }
+    length += (sources & ICM_FIFO_EN_2_TEMP) ? 2 : 0;
+    uint8_t control = banks[3][ICM_I2C_SLV0_CTRL];
+    if ((banks[0][ICM_FIFO_EN_1] & ICM_FIFO_EN_1_SLV0) && (control & ICM_SLV_ENABLE)) {
+        length += control & ICM_SLV_LENGTH_MASK;
+    }
+    return length;
+}
+
+/**
+ * @brief   Time between FIFO frames: the gyro rate, or the accel rate without gyro data.
+ */
+uint64_t SimIcm20948::fifoPeriodNanos(void) const {
+    const uint8_t *bank2 = banks[2];
+    uint8_t sources = banks[0][ICM_FIFO_EN_2];
+    if ((sources & ICM_FIFO_EN_2_ACCEL) && !(sources & ICM_FIFO_EN_2_GYRO)) {
+        uint16_t divider = ((bank2[ICM_ACCEL_SMPLRT_DIV_1] & ICM_ACCEL_SMPLRT_DIV_1_MASK) << 8) | bank2[ICM_ACCEL_SMPLRT_DIV_2];
+        return (1ULL + divider) * NANOS_PER_SECOND / ICM_ACCEL_ODR_HZ;
+    }
+    return (1ULL + bank2[ICM_GYRO_SMPLRT_DIV]) * NANOS_PER_SECOND / ICM_GYRO_ODR_HZ;
+}
+
+/**
+ * @brief   Write the frames due up to nowNanos, each sampled at its own time.
+ */
+void SimIcm20948::updateFifo(uint64_t nowNanos) {
+    uint64_t period = fifoPeriodNanos();
+    while (fifoNextNanos != 0 && fifoNextNanos <= nowNanos) {
+        uint64_t due = (nowNanos - fifoNextNanos) / period + 1;
+        bool snapshot = banks[0][ICM_FIFO_MODE] & ICM_FIFO_MODE_SNAPSHOT;
+        bool full = fifoCount + fifoFrameLength() > SIM_ICM_FIFO_SIZE;
+        uint64_t dropped = 0;
+        if (snapshot && full) {
+            dropped = due;                            // Nothing more fits until it is read
+        } else if (!snapshot && due > SIM_ICM_FIFO_SIZE) {
+            dropped = due - SIM_ICM_FIFO_SIZE;        // Overwritten before they could be read
+        }
+        if (dropped > 0) {
+            stats.fifoOverflows += dropped;
+            banks[0][ICM_INT_STATUS_2] |= ICM_INT_STATUS_2_FIFO_OVERFLOW;
+            fifoNextNanos += dropped * period;
+            continue;
+        }
+        sample(fifoNextNanos);
+        pushFifoFrame();
+        banks[0][ICM_INT_STATUS_1] |= ICM_INT_STATUS_1_RAW_DATA_0_RDY;
+        fifoNextNanos += period;
+    }
+}
+
+/**
+ * @brief   Append one frame from the output registers; a full stream FIFO drops its oldest bytes.
+ */
+void SimIcm20948::pushFifoFrame(void) {
+    const uint8_t *bank0 = banks[0];
+    uint8_t sources = bank0[ICM_FIFO_EN_2];
+    uint8_t frame[ICM_FIFO_MAX_FRAME_LENGTH];
+    uint8_t length = 0;
+    if (sources & ICM_FIFO_EN_2_ACCEL) {
+        memcpy(&frame[length], &bank0[ICM_ACCEL_XOUT_H], 6);
+        length += 6;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        if (sources & (ICM_FIFO_EN_2_GYRO_X << axis)) {
+            memcpy(&frame[length], &bank0[ICM_GYRO_XOUT_H + 2 * axis], 2);
+            length += 2;
+        }
+    }
+    if (sources & ICM_FIFO_EN_2_TEMP) {
+        memcpy(&frame[length], &bank0[ICM_TEMP_OUT_H], 2);
+        length += 2;
+    }
+    uint8_t control = banks[3][ICM_I2C_SLV0_CTRL];
+    if ((bank0[ICM_FIFO_EN_1] & ICM_FIFO_EN_1_SLV0) && (control & ICM_SLV_ENABLE)) {
+        memcpy(&frame[length], &bank0[ICM_EXT_SLV_SENS_DATA_00], control & ICM_SLV_LENGTH_MASK);
+        length += control & ICM_SLV_LENGTH_MASK;
+    }
+
+    bool overflow = false;
+    for (uint8_t i = 0; i < length; i++) {
+        if (fifoCount == SIM_ICM_FIFO_SIZE) {
+            fifoHead = (fifoHead + 1) % SIM_ICM_FIFO_SIZE;
+            fifoCount--;
+            overflow = true;
+        }
+        fifo[(fifoHead + fifoCount) % SIM_ICM_FIFO_SIZE] = frame[i];
+        fifoCount++;
+    }
+    if (overflow) {
+        stats.fifoOverflows++;
+        banks[0][ICM_INT_STATUS_2] |= ICM_INT_STATUS_2_FIFO_OVERFLOW;
+    }
+    stats.fifoFrames++;
+}
+
+/**
+ * @brief   Take the oldest FIFO byte (ICM_FIFO_EMPTY_VALUE when empty).
+ */
+uint8_t SimIcm20948::popFifo(void) {
+    if (fifoCount == 0) {
+        return ICM_FIFO_EMPTY_VALUE;
+    }
+    uint8_t value = fifo[fifoHead];
+    fifoHead = (fifoHead + 1) % SIM_ICM_FIFO_SIZE;
+    fifoCount--;
+    return value;
+}
+
+/**
+ * @brief   Store one register, with the side effects of the registers that have any.
+ */
+void SimIcm20948::writeRegister(uint8_t address, uint8_t value, uint64_t nowNanos) {
+    if (address == SIM_ICM_REG_BANK_SEL) {
+        bank = (value >> 4) & (SIM_ICM_BANKS - 1);
+        return;
+    }
+    if (bank == 0 && (address == ICM_WHO_AM_I || (address >= ICM_ACCEL_XOUT_H && address < ICM_DATA_END) ||
+            address == ICM_FIFO_COUNTH || address == ICM_FIFO_COUNTL || address == ICM_FIFO_R_W)) {
+        return;   // Read only (FIFO writes are not modelled)
+    }
+    if (bank == 0 && address == ICM_PWR_MGMT_1 && (value & ICM_PWR_MGMT_1_DEVICE_RESET)) {
+        reset();
+        powerOnNanos = nowNanos;
+        return;
+    }
+
+    reg(address) = value;
+    if (bank == 3 && address == ICM_I2C_SLV4_CTRL && (value & ICM_SLV_ENABLE)) {
+        slave4Transfer();
+    }
+    if (bank == 0 && address == ICM_FIFO_RST && (value & ICM_FIFO_RST_MASK)) {
+        fifoHead = 0;
+        fifoCount = 0;
+        fifoNextNanos = 0;
+    }
+    if (bank == 0 && (address == ICM_USER_CTRL || address == ICM_PWR_MGMT_1 || address == ICM_FIFO_EN_1 ||
+            address == ICM_FIFO_EN_2 || address == ICM_FIFO_RST)) {
+        // The first frame follows one period after the FIFO starts (or restarts after a reset)
+        if (!fifoEnabled()) {
+            fifoNextNanos = 0;
+        } else if (fifoNextNanos == 0) {
+            fifoNextNanos = nowNanos + fifoPeriodNanos();
+        }
+    }
+}
+
+/**
+ * @brief   Handle one I2C write transaction: a register address, then data for
+ *          consecutive registers.
+ */
+void SimIcm20948::Write(const uint8_t *data, uint16_t length, uint64_t nowNanos) {
+    if (length == 0) {
+        return;
+    }
+    updateFifo(nowNanos);
+    registerPointer = data[0] & 0x7F;
+    for (uint16_t i = 1; i < length; i++) {
+        writeRegister(registerPointer, data[i], nowNanos);
+        stats.registerWrites++;
+        registerPointer = (registerPointer + 1) & 0x7F;
+    }
+}
+
+/**
+ * @brief   Handle one I2C read transaction from the current register address.
+ *
+ * The sensor registers are sampled once per transaction, so a burst read returns one
+ * consistent sample. A burst that reaches FIFO_R_W stays there and drains the FIFO.
+ */
+void SimIcm20948::Read(uint8_t *data, uint16_t length, uint64_t nowNanos) {
+    updateFifo(nowNanos);
+    if (bank == 0 && registerPointer >= ICM_ACCEL_XOUT_H && registerPointer < ICM_DATA_END) {
+        sample(nowNanos);
+    }
+    banks[0][ICM_FIFO_COUNTH] = static_cast<uint8_t>(fifoCount >> 8) & ICM_FIFO_COUNTH_MASK;
+    banks[0][ICM_FIFO_COUNTL] = static_cast<uint8_t>(fifoCount);
+
+    for (uint16_t i = 0; i < length; i++) {
+        stats.registerReads++;
+        if (bank == 0 && registerPointer == ICM_FIFO_R_W) {
+            data[i] = popFifo();
+            continue;
+        }
+        data[i] = registerPointer == SIM_ICM_REG_BANK_SEL ? static_cast<uint8_t>(bank << 4) : reg(registerPointer);
+        if (bank == 0 && (registerPointer == ICM_I2C_MST_STATUS || registerPointer == ICM_INT_STATUS_1 ||
+            registerPointer == ICM_INT_STATUS_2)) {
+            reg(registerPointer) = 0;   // Cleared on read
+        }
+        registerPointer = (registerPointer + 1) & 0x7F;
+    }
+}
@@ -0,0 +1,730 @@
+#include "sim_sam_m8q.h"
+#include "ubx_assist.h"
+#include "epoch_scheduler.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SIM_GPS_ADDRESS_MODE (0x42 << 1)       // CFG-PRT mode of the DDC port
+#define SIM_GPS_DEFAULT_IN_PROTOCOLS 0x0007    // UBX, NMEA, RTCM
+#define SIM_GPS_DEFAULT_OUT_PROTOCOLS 0x0003   // UBX, NMEA
+#define SIM_GPS_UART_MODE 0x000008D0           // CFG-PRT mode of UART1: 8N1
+#define SIM_GPS_UART_BAUD 9600
+#define SIM_GPS_DEFAULT_MEAS_RATE 1000
+#define SIM_GPS_DEFAULT_TIME_REF 1              // GPS time
+#define SIM_GPS_MIN_MEAS_RATE 25
+#define SIM_GPS_CATCH_UP_NANOS NANOS_PER_SECOND   // Solutions further behind than this are skipped
+#define SIM_GPS_METRES_PER_DEGREE 111320.0
+#define SIM_GPS_HACC_MM 1500
+#define SIM_GPS_VACC_MM 2500
+#define SIM_GPS_SACC_MM_S 200
+#define SIM_GPS_TACC_NS 20
+#define SIM_GPS_PDOP 120                       // 1.2
+#define NAV_STATUS_GPS_FIX_OK 0x01
+#define NAV_STATUS_WKN_TOW_SET 0x0C
+#define NAV_PVT_VALID_DATE_TIME_RESOLVED 0x07
+#define SIM_GPS_GEOID_SEPARATION_MM 33000      // Ellipsoid above mean sea level
+#define SIM_GPS_KNOTS_PER_M_S (3600.0 / 1852.0)
+#define SIM_GPS_MAX_SENTENCE_LENGTH 96
+
+/** CFG-GNSS blocks the M8 firmware reports by default: GPS, SBAS, QZSS and GLONASS enabled */
+static const uint8_t SIM_GNSS_DEFAULTS[GNSS_ID_COUNT][4] = {
+    // gnssId, resTrkCh, maxTrkCh, enabled | sigCfgMask << 4
+    {GNSS_ID_GPS, 8, 16, 0x11},
+    {GNSS_ID_SBAS, 1, 3, 0x11},
+    {GNSS_ID_GALILEO, 4, 8, 0x10},
+    {GNSS_ID_BEIDOU, 8, 16, 0x10},
+    {GNSS_ID_IMES, 0, 8, 0x10},
+    {GNSS_ID_QZSS, 0, 3, 0x51},
+    {GNSS_ID_GLONASS, 8, 14, 0x11}
+};
+
+/**
+ * @brief   Constructor for the SimSamM8q class; powered up at virtual time 0 with the
+ *          default configuration.
+ */
+SimSamM8q::SimSamM8q(void) {
+    port = PORT_ID_DDC;
+    Configure(SimSamM8qConfig SIM_SAM_M8Q_DEFAULT_CONFIG, 0);
+}
+
+/**
+ * @brief   Apply a model configuration and power the receiver up at nowNanos.
+ */
+void SimSamM8q::Configure(const SimSamM8qConfig &config, uint64_t nowNanos) {
+    this->config = config;
+    startGpsNanos = static_cast<uint64_t>(config.startUtcSeconds - SIM_GPS_EPOCH_UNIX_SECONDS + SIM_GPS_LEAP_SECONDS) *
+        NANOS_PER_SECOND;
+    powerOnNanos = nowNanos;
+    PowerCycle(nowNanos);
+}
+
+/**
+ * @brief   Cut power and restart: configuration, time, position, database and queued
+ *          output are lost (no backup battery); GPS time keeps running.
+ */
+void SimSamM8q::PowerCycle(uint64_t nowNanos) {
+    startGpsNanos = gpsNanos(nowNanos);
+    powerOnNanos = nowNanos;
+    fixDueNanos = nowNanos + static_cast<uint64_t>(config.ttffColdSeconds) * NANOS_PER_SECOND;
+    timeKnown = false;
+    positionKnown = false;
+    registerPointer = SIM_GPS_REG_STREAM;
+    framer.Reset();
+    output.clear();
+    database.clear();
+    memset(&stats, 0, sizeof(stats));
+    loadDefaults();
+}
+
+/**
+ * @brief   Key of a stored CFG payload: the message id and the poll key bytes.
+ */
+uint32_t SimSamM8q::cfgKey(uint8_t msgId, const uint8_t *key, uint16_t keyLength) {
+    uint32_t result = static_cast<uint32_t>(msgId) << 16;
+    if (keyLength > 0) {
+        result |= static_cast<uint32_t>(key[0]) << 8;
+    }
+    if (keyLength > 1) {
+        result |= key[1];
+    }
+    return result;
+}
+
+/**
+ * @brief   Factory configuration of the messages the model stores.
+ */
+void SimSamM8q::loadDefaults(void) {
+    cfg.clear();
+
+    uint8_t ddc = PORT_ID_DDC;
+    std::vector<uint8_t> &prt = cfg[cfgKey(CFG_PRT, &ddc, 1)];
+    prt.resize(CFG_PRT_PAYLOAD_LENGTH);
+    CfgPrt::Schema::Encode(prt.data(), PORT_ID_DDC, 0, SIM_GPS_ADDRESS_MODE, 0,
+        SIM_GPS_DEFAULT_IN_PROTOCOLS, SIM_GPS_DEFAULT_OUT_PROTOCOLS, 0);
+
+    uint8_t uart = PORT_ID_UART1;
+    std::vector<uint8_t> &uartPrt = cfg[cfgKey(CFG_PRT, &uart, 1)];
+    uartPrt.resize(CFG_PRT_PAYLOAD_LENGTH);
+    CfgPrt::Schema::Encode(uartPrt.data(), PORT_ID_UART1, 0, SIM_GPS_UART_MODE, SIM_GPS_UART_BAUD,
+        SIM_GPS_DEFAULT_IN_PROTOCOLS, SIM_GPS_DEFAULT_OUT_PROTOCOLS, 0);
+
+    std::vector<uint8_t> &rate = cfg[cfgKey(CFG_RATE, nullptr, 0)];
+    rate.resize(CFG_RATE_PAYLOAD_LENGTH);
+    CfgRate::Schema::Encode(rate.data(), SIM_GPS_DEFAULT_MEAS_RATE, 1, SIM_GPS_DEFAULT_TIME_REF);
+
+    std::vector<uint8_t> &gnss = cfg[cfgKey(CFG_GNSS, nullptr, 0)];
+    gnss.resize(CFG_GNSS_HEADER_LENGTH + GNSS_ID_COUNT * CFG_GNSS_BLOCK_LENGTH);
+    CfgGnss::Schema::Encode(gnss.data(), 0, 32, 32, GNSS_ID_COUNT);
+    for (uint8_t i = 0; i < GNSS_ID_COUNT; i++) {
+        const uint8_t *block = SIM_GNSS_DEFAULTS[i];
+        uint32_t flags = 0x01000000 | static_cast<uint32_t>(block[3] >> 4) << 16 | (block[3] & 0x01);
+        CfgGnss::Block::Schema::Encode(&gnss[CFG_GNSS_HEADER_LENGTH + i * CFG_GNSS_BLOCK_LENGTH],
+            block[0], block[1], block[2], flags);
+    }
+
+    std::vector<uint8_t> &navx5 = cfg[cfgKey(CFG_NAVX5, nullptr, 0)];
+    navx5.assign(CFG_NAVX5_PAYLOAD_LENGTH, 0);
+    CfgNavx5::Version::Put(navx5.data(), CFG_NAVX5_VERSION);
+
+    nextEpochGpsNanos = 0;
+    lastEpochGpsNanos = 0;
+}
+
+/**
+ * @brief   The stored payload for key; CFG-MSG of a message never configured reads as rate 0.
+ */
+const std::vector<uint8_t> &SimSamM8q::cfgPayload(uint32_t key) {
+    std::vector<uint8_t> &payload = cfg[key];
+    if (payload.empty() && (key >> 16) == CFG_MSG) {
+        payload.assign(CFG_MSG_PAYLOAD_LENGTH, 0);
+        payload[0] = static_cast<uint8_t>(key >> 8);
+        payload[1] = static_cast<uint8_t>(key);
+    }
+    return payload;
+}
+
+uint64_t SimSamM8q::gpsNanos(uint64_t nowNanos) const {
+    return startGpsNanos + (nowNanos - powerOnNanos);
+}
+
+uint64_t SimSamM8q::solutionPeriodNanos(void) {
+    const uint8_t *rate = cfgPayload(cfgKey(CFG_RATE, nullptr, 0)).data();
+    return static_cast<uint64_t>(CfgRate::MeasRate::Get(rate)) * CfgRate::NavRate::Get(rate) * NANOS_PER_MILLI;
+}
+
+uint8_t SimSamM8q::outputRate(uint8_t msgClass, uint8_t msgId) {
+    uint8_t key[] = {msgClass, msgId};
+    return cfgPayload(cfgKey(CFG_MSG, key, sizeof(key)))[CfgMsg::RateDdc::offset + port];
+}
+
+/**
+ * @brief   UART1 baud rate, as last set with CFG-PRT.
+ */
+uint32_t SimSamM8q::BaudRate(void) {
+    uint8_t uart = PORT_ID_UART1;
+    return CfgPrt::BaudRate::Get(cfgPayload(cfgKey(CFG_PRT, &uart, 1)).data());
+}
+
+bool SimSamM8q::outputsProtocol(uint16_t protocol) {
+    return (CfgPrt::OutProtoMask::Get(cfgPayload(cfgKey(CFG_PRT, &port, 1)).data()) & protocol) != 0;
+}
+
+bool SimSamM8q::ackAiding(void) {
+    return CfgNavx5::AckAiding::Get(cfgPayload(cfgKey(CFG_NAVX5, nullptr, 0)).data()) != 0;
+}
+
+/**
+ * @brief   Compute every solution due by nowNanos and queue its periodic output.
+ */
+void SimSamM8q::Advance(uint64_t nowNanos) {
+    uint64_t period = solutionPeriodNanos();
+    uint64_t gps = gpsNanos(nowNanos);
+    if (nextEpochGpsNanos == 0 || gps > nextEpochGpsNanos + SIM_GPS_CATCH_UP_NANOS) {
+        nextEpochGpsNanos = (gps / period + 1) * period;
+    }
+
+    while (nextEpochGpsNanos + config.outputLatencyNanos <= gps) {
+        uint64_t epoch = nextEpochGpsNanos;
+        uint64_t index = epoch / period;
+        lastEpochGpsNanos = epoch;
+        nextEpochGpsNanos += period;
+        stats.solutions++;
+
+        uint8_t pvtRate = outputRate(NAV_CLASS, NAV_PVT);
+        if (pvtRate != 0 && index % pvtRate == 0) {
+            sendNavPvt(epoch, nowNanos);
+        }
+        uint8_t statusRate = outputRate(NAV_CLASS, NAV_STATUS);
+        if (statusRate != 0 && index % statusRate == 0) {
+            sendNavStatus(epoch, nowNanos);
+        }
+        if (outputsProtocol(PORT_PROTOCOL_NMEA)) {
+            sendNmea(epoch, index);
+        }
+    }
+}
+
+/**
+ * @brief   Queue a frame for output, or drop it if the output buffer is full.
+ */
+void SimSamM8q::send(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t length) {
+    uint8_t frame[UBX_MAX_FRAME_LENGTH];
+    uint16_t frameLength = ComposeFrame(frame, msgClass, msgId, length, payload);
+    if (output.size() + frameLength > config.bufferBytes) {
+        stats.messagesDropped++;
+        return;
+    }
+    output.insert(output.end(), frame, frame + frameLength);
+    stats.messagesOut++;
+}
+
+void SimSamM8q::sendAck(uint8_t msgClass, uint8_t msgId, bool ack) {
+    uint8_t payload[] = {msgClass, msgId};
+    send(ACK_CLASS, ack ? ACK_ACK : ACK_NAK, payload, sizeof(payload));
+    if (ack) {
+        stats.acks++;
+    } else {
+        stats.naks++;
+    }
+}
+
+void SimSamM8q::sendMgaAck(uint8_t msgId, bool accepted, const uint8_t *payload) {
+    uint8_t ack[MGA_ACK_PAYLOAD_LENGTH];
+    MgaAck::Schema::Encode(ack, accepted ? MGA_ACK_TYPE_ACCEPTED : 0, 0, 0, msgId, UbxReadU4(payload));
+    send(MGA_CLASS, MGA_ACK, ack, sizeof(ack));
+}
+
+/**
+ * @brief   Whether the solution at epochGpsNanos has a fix; the first one sets the
+ *          time, position and TTFF and generates the navigation database.
+ */
+bool SimSamM8q::noteFix(uint64_t epochGpsNanos) {
+    uint64_t epochHostNanos = powerOnNanos + (epochGpsNanos - startGpsNanos);
+    bool fix = epochHostNanos >= fixDueNanos;
+    if (fix && stats.ttffMillis == 0) {
+        stats.ttffMillis = static_cast<uint32_t>((epochHostNanos - powerOnNanos) / NANOS_PER_MILLI);
+        timeKnown = true;
+        positionKnown = true;
+        if (database.empty()) {
+            uint8_t payload[SIM_GPS_DBD_PAYLOAD_LENGTH];
+            uint8_t frame[UBX_FRAME_OVERHEAD + SIM_GPS_DBD_PAYLOAD_LENGTH];
+            for (int i = 0; i < SIM_GPS_DBD_MESSAGES; i++) {
+                memset(payload, 0, MGA_DBD_HEADER_LENGTH);
+                for (int j = MGA_DBD_HEADER_LENGTH; j < SIM_GPS_DBD_PAYLOAD_LENGTH; j++) {
+                    payload[j] = static_cast<uint8_t>(rand());
+                }
+                uint16_t length = ComposeFrame(frame, MGA_CLASS, MGA_DBD, sizeof(payload), payload);
+                database.push_back(std::vector<uint8_t>(frame, frame + length));
+            }
+        }
+    }
+    return fix;
+}
+
+/**
+ * @brief   Position and velocity on the simulated drive at epochGpsNanos.
+ */
+SimSamM8q::Solution SimSamM8q::solutionAt(uint64_t epochGpsNanos) const {
+    Solution solution;
+    double seconds = (epochGpsNanos - startGpsNanos) / 1e9;
+    double angle = config.radius > 0 ? config.speed / config.radius * seconds : 0.0;
+    double north = config.radius * sin(angle);
+    double east = config.radius * (1.0 - cos(angle));
+    solution.fix = powerOnNanos + (epochGpsNanos - startGpsNanos) >= fixDueNanos;
+    solution.velocityNorth = config.radius > 0 ? config.speed * cos(angle) : 0.0;
+    solution.velocityEast = config.radius > 0 ? config.speed * sin(angle) : 0.0;
+    solution.speed = config.radius > 0 ? config.speed : 0.0;
+    solution.latitude = config.latitude + north / SIM_GPS_METRES_PER_DEGREE;
+    solution.longitude = config.longitude + east / (SIM_GPS_METRES_PER_DEGREE * cos(config.latitude * M_PI / 180.0));
+    double heading = atan2(solution.velocityEast, solution.velocityNorth) * 180.0 / M_PI;
+    solution.heading = heading < 0 ? heading + 360.0 : heading;
+    return solution;
+}
+
+/**
+ * @brief   Queue the NAV-PVT of the solution at epochGpsNanos.
+ */
+void SimSamM8q::sendNavPvt(uint64_t epochGpsNanos, uint64_t nowNanos) {
+    bool fix = noteFix(epochGpsNanos);
+
+    uint8_t payload[NAV_PVT_PAYLOAD_LENGTH];
+    memset(payload, 0, sizeof(payload));
+    NavPvt::ITow::Put(payload, static_cast<uint32_t>((epochGpsNanos / NANOS_PER_MILLI) % SIM_GPS_WEEK_MILLIS));
+
+    if (timeKnown) {
+        time_t utc = static_cast<time_t>(epochGpsNanos / NANOS_PER_SECOND + SIM_GPS_EPOCH_UNIX_SECONDS - SIM_GPS_LEAP_SECONDS);
+        struct tm calendar;
+        gmtime_r(&utc, &calendar);
+        NavPvt::Year::Put(payload, calendar.tm_year + 1900);
+        NavPvt::Month::Put(payload, calendar.tm_mon + 1);
+        NavPvt::Day::Put(payload, calendar.tm_mday);
+        NavPvt::Hour::Put(payload, calendar.tm_hour);
+        NavPvt::Min::Put(payload, calendar.tm_min);
+        NavPvt::Sec::Put(payload, calendar.tm_sec);
+        NavPvt::Valid::Put(payload, NAV_PVT_VALID_DATE_TIME_RESOLVED);
+        NavPvt::TAcc::Put(payload, SIM_GPS_TACC_NS);
+        NavPvt::Nano::Put(payload, static_cast<int32_t>(epochGpsNanos % NANOS_PER_SECOND));
+    } else {
+        // The RTC has not been set: the receiver counts from the GPS epoch
+        NavPvt::Year::Put(payload, 1980);
+        NavPvt::Month::Put(payload, 1);
+        NavPvt::Day::Put(payload, 6);
+    }
+
+    if (fix) {
+        Solution solution = solutionAt(epochGpsNanos);
+        NavPvt::FixType::Put(payload, THREE_D_FIX);
+        NavPvt::Flags::Put(payload, NAV_PVT_FLAGS_GNSS_FIX_OK);
+        NavPvt::NumSv::Put(payload, SIM_GPS_SATELLITES);
+        NavPvt::Lat::Put(payload, static_cast<int32_t>(lround(solution.latitude * 1e7)));
+        NavPvt::Lon::Put(payload, static_cast<int32_t>(lround(solution.longitude * 1e7)));
+        NavPvt::Height::Put(payload, static_cast<int32_t>(lround(config.height * 1000.0)));
+        NavPvt::HMsl::Put(payload, static_cast<int32_t>(lround(config.height * 1000.0)) - SIM_GPS_GEOID_SEPARATION_MM);
+        NavPvt::HAcc::Put(payload, SIM_GPS_HACC_MM);
+        NavPvt::VAcc::Put(payload, SIM_GPS_VACC_MM);
+        NavPvt::VelN::Put(payload, static_cast<int32_t>(lround(solution.velocityNorth * 1000.0)));
+        NavPvt::VelE::Put(payload, static_cast<int32_t>(lround(solution.velocityEast * 1000.0)));
+        NavPvt::GSpeed::Put(payload, static_cast<int32_t>(lround(solution.speed * 1000.0)));
+        NavPvt::HeadMot::Put(payload, static_cast<int32_t>(lround(solution.heading * 1e5)));
+        NavPvt::SAcc::Put(payload, SIM_GPS_SACC_MM_S);
+        NavPvt::HeadAcc::Put(payload, 5000000);
+        NavPvt::PDop::Put(payload, SIM_GPS_PDOP);
+    } else {
+        NavPvt::NumSv::Put(payload, static_cast<uint8_t>((nowNanos - powerOnNanos) / (4 * NANOS_PER_SECOND) % 4));
+        NavPvt::HAcc::Put(payload, 0xFFFFFFFF);
+        NavPvt::VAcc::Put(payload, 0xFFFFFFFF);
+        NavPvt::PDop::Put(payload, 9999);
+    }
+
+    send(NAV_CLASS, NAV_PVT, payload, sizeof(payload));
+}
+
+/**
+ * @brief   Format a coordinate as NMEA (d)ddmm.mmmmm plus hemisphere, rounded in integers
+ *          so the minutes never read 60.
+ */
+static int formatCoordinate(char *text, size_t size, double degrees, int degreeDigits, char positive, char negative) {
+    long long minutes = llround(fabs(degrees) * 60.0 * 100000.0);   // 1e-5 minutes
+    return snprintf(text, size, "%0*lld%02lld.%05lld,%c", degreeDigits, minutes / 6000000, minutes / 100000 % 60,
+        minutes % 100000, degrees < 0 ? negative : positive);
+}
+
+/**
+ * @brief   Whether a body formatted into SIM_GPS_MAX_SENTENCE_LENGTH bytes was written whole.
+ */
+static bool fitsSentence(int length) {
+    return length >= 0 && length < SIM_GPS_MAX_SENTENCE_LENGTH;
+}
+
+/**
+ * @brief   Queue the RMC, VTG, GGA and GSA sentences of the solution at epochGpsNanos.
+ *
+ * Before the time is known the time and date fields are empty, as on the receiver. A
+ * sentence that does not fit SIM_GPS_MAX_SENTENCE_LENGTH is not sent rather than cut.
+ */
+void SimSamM8q::sendNmea(uint64_t epochGpsNanos, uint64_t index) {
+    bool fix = noteFix(epochGpsNanos);
+    Solution solution = solutionAt(epochGpsNanos);
+
+    char time[32] = "";
+    char date[32] = "";
+    if (timeKnown) {
+        time_t utc = static_cast<time_t>(epochGpsNanos / NANOS_PER_SECOND + SIM_GPS_EPOCH_UNIX_SECONDS - SIM_GPS_LEAP_SECONDS);
+        struct tm calendar;
+        gmtime_r(&utc, &calendar);
+        snprintf(time, sizeof(time), "%02d%02d%02d.%02d", calendar.tm_hour, calendar.tm_min, calendar.tm_sec,
+            static_cast<int>(epochGpsNanos % NANOS_PER_SECOND / (10 * NANOS_PER_MILLI)));
+        snprintf(date, sizeof(date), "%02d%02d%02d", calendar.tm_mday, calendar.tm_mon + 1, calendar.tm_year % 100);
+    }
+    char position[40] = ",,,";
+    if (fix) {
+        int length = formatCoordinate(position, sizeof(position), solution.latitude, 2, 'N', 'S');
+        position[length++] = ',';
+        formatCoordinate(&position[length], sizeof(position) - length, solution.longitude, 3, 'E', 'W');
+    }
+    double knots = solution.speed * SIM_GPS_KNOTS_PER_M_S;
+    double kmh = solution.speed * 3.6;
+
+    char body[SIM_GPS_MAX_SENTENCE_LENGTH];
+    uint8_t rate = outputRate(NMEA_CLASS, NMEA_RMC);
+    if (rate != 0 && index % rate == 0) {
+        int length;
+        if (fix) {
+            length = snprintf(body, sizeof(body), "GNRMC,%s,A,%s,%.3f,%.2f,%s,,,A", time, position, knots,
+                solution.heading, date);
+        } else {
+            length = snprintf(body, sizeof(body), "GNRMC,%s,V,%s,,,%s,,,N", time, position, date);
+        }
+        if (fitsSentence(length)) {
+            sendSentence(body);
+        }
+    }
+    rate = outputRate(NMEA_CLASS, NMEA_VTG);
+    if (rate != 0 && index % rate == 0) {
+        int length;
+        if (fix) {
+            length = snprintf(body, sizeof(body), "GNVTG,%.2f,T,,M,%.3f,N,%.3f,K,A", solution.heading, knots, kmh);
+        } else {
+            length = snprintf(body, sizeof(body), "GNVTG,,T,,M,,N,,K,N");
+        }
+        if (fitsSentence(length)) {
+            sendSentence(body);
+        }
+    }
+    rate = outputRate(NMEA_CLASS, NMEA_GGA);
+    if (rate != 0 && index % rate == 0) {
+        int length;
+        if (fix) {
+            length = snprintf(body, sizeof(body), "GNGGA,%s,%s,1,%02d,0.60,%.1f,M,%.1f,M,,", time, position,
+                SIM_GPS_SATELLITES, config.height - SIM_GPS_GEOID_SEPARATION_MM / 1000.0,
+                SIM_GPS_GEOID_SEPARATION_MM / 1000.0);
+        } else {
+            length = snprintf(body, sizeof(body), "GNGGA,%s,%s,0,00,99.99,,,,,,", time, position);
+        }
+        if (fitsSentence(length)) {
+            sendSentence(body);
+        }
+    }
+    rate = outputRate(NMEA_CLASS, NMEA_GSA);
+    if (rate != 0 && index % rate == 0) {
+        // One GSA per GNSS in use, each listing its satellites
+        if (fix) {
+            sendSentence("GNGSA,A,3,02,05,12,15,18,24,25,,,,,,1.20,0.60,1.00");
+            sendSentence("GNGSA,A,3,65,66,72,81,82,,,,,,,,1.20,0.60,1.00");
+        } else {
+            sendSentence("GNGSA,A,1,,,,,,,,,,,,,99.99,99.99,99.99");
+            sendSentence("GNGSA,A,1,,,,,,,,,,,,,99.99,99.99,99.99");
+        }
+    }
+}
+
+/**
+ * @brief   Queue "$body*hh\r\n", or drop it if the output buffer is full.
+ */
+void SimSamM8q::sendSentence(const char *body) {
+    uint8_t checksum = 0;
+    for (const char *c = body; *c != '\0'; c++) {
+        checksum ^= static_cast<uint8_t>(*c);
+    }
+    char sentence[SIM_GPS_MAX_SENTENCE_LENGTH + 8];
+    int length = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+    if (output.size() + length > config.bufferBytes) {
+        stats.messagesDropped++;
+        return;
+    }
+    output.insert(output.end(), sentence, sentence + length);
+    stats.sentencesOut++;
+}
+
+/**
+ * @brief   Queue the NAV-STATUS of the solution at epochGpsNanos.
+ */
+void SimSamM8q::sendNavStatus(uint64_t epochGpsNanos, uint64_t nowNanos) {
+    uint64_t epochHostNanos = powerOnNanos + (epochGpsNanos - startGpsNanos);
+    bool fix = epochHostNanos >= fixDueNanos;
+
+    uint8_t payload[NAV_STATUS_PAYLOAD_LENGTH];
+    NavStatus::Schema::Encode(payload,
+        static_cast<uint32_t>((epochGpsNanos / NANOS_PER_MILLI) % SIM_GPS_WEEK_MILLIS),
+        fix ? THREE_D_FIX : NO_FIX,
+        (fix ? NAV_STATUS_GPS_FIX_OK : 0) | (timeKnown ? NAV_STATUS_WKN_TOW_SET : 0), 0, 0,
+        fix ? stats.ttffMillis : 0,
+        static_cast<uint32_t>((nowNanos - powerOnNanos) / NANOS_PER_MILLI));
+    send(NAV_CLASS, NAV_STATUS, payload, sizeof(payload));
+}
+
+/**
+ * @brief   Handle one I2C write transaction.
+ *
+ * @param   data        The bytes written after the address.
+ * @param   length      The number of bytes.
+ * @param   nowNanos    Virtual time of the transaction.
+ */
+void SimSamM8q::Write(const uint8_t *data, uint16_t length, uint64_t nowNanos) {
+    if (length == 1) {
+        Advance(nowNanos);
+        registerPointer = data[0];
+        return;
+    }
+    WriteStream(data, length, nowNanos);
+}
+
+/**
+ * @brief   Handle one I2C read transaction from the current register pointer.
+ *
+ * @param   data        Receives length bytes.
+ * @param   length      The number of bytes.
+ * @param   nowNanos    Virtual time of the transaction.
+ */
+void SimSamM8q::Read(uint8_t *data, uint16_t length, uint64_t nowNanos) {
+    Advance(nowNanos);
+    uint16_t count = output.size() > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(output.size());
+
+    for (uint16_t i = 0; i < length; i++) {
+        if (registerPointer == SIM_GPS_REG_STREAM) {
+            if (output.empty()) {
+                data[i] = SIM_GPS_EMPTY_STREAM_BYTE;
+            } else {
+                data[i] = output.front();
+                output.pop_front();
+            }
+            continue;
+        }
+
+        if (registerPointer == SIM_GPS_REG_COUNT_MSB) {
+            data[i] = static_cast<uint8_t>(count >> 8);
+        } else if (registerPointer == SIM_GPS_REG_COUNT_MSB + 1) {
+            data[i] = static_cast<uint8_t>(count);
+        } else {
+            data[i] = 0;
+        }
+        registerPointer++;
+    }
+}
+
+/**
+ * @brief   Bytes received on UART1.
+ *
+ * @param   data        The bytes received.
+ * @param   length      The number of bytes.
+ * @param   nowNanos    Virtual time the bytes arrived.
+ */
+void SimSamM8q::WriteStream(const uint8_t *data, uint16_t length, uint64_t nowNanos) {
+    Advance(nowNanos);
+    size_t offset = 0;
+    while (offset < length) {
+        offset += framer.Consume(&data[offset], length - offset);
+        if (framer.FrameReady()) {
+            stats.framesIn++;
+            receive(UbxMessageView(framer.Frame()), nowNanos);
+        }
+    }
+}
+
+/**
+ * @brief   Take queued output for UART1.
+ *
+ * @param   data        Receives up to length bytes.
+ * @param   length      Room in data.
+ * @param   nowNanos    Virtual time of the read.
+ * @return  The number of bytes taken; 0 when nothing is queued.
+ */
+uint16_t SimSamM8q::ReadStream(uint8_t *data, uint16_t length, uint64_t nowNanos) {
+    Advance(nowNanos);
+    uint16_t count = 0;
+    while (count < length && !output.empty()) {
+        data[count++] = output.front();
+        output.pop_front();
+    }
+    return count;
+}
+
+/**
+ * @brief   Act on a UBX frame written to the receiver.
+ */
+void SimSamM8q::receive(const UbxMessageView &msg, uint64_t nowNanos) {
+    switch (msg.MsgClass()) {
+        case CFG_CLASS:
+            receiveCfg(msg);
+            break;
+        case MGA_CLASS:
+            receiveMga(msg, nowNanos);
+            break;
+        case NAV_CLASS:
+            // Polls are answered with the latest solution
+            if (msg.PayloadLength() == 0 && lastEpochGpsNanos != 0) {
+                if (msg.MsgId() == NAV_PVT) {
+                    sendNavPvt(lastEpochGpsNanos, nowNanos);
+                } else if (msg.MsgId() == NAV_STATUS) {
+                    sendNavStatus(lastEpochGpsNanos, nowNanos);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief   Store or report a CFG message and acknowledge it.
+ */
+void SimSamM8q::receiveCfg(const UbxMessageView &msg) {
+    uint8_t msgId = msg.MsgId();
+    uint16_t length = msg.PayloadLength();
+    const uint8_t *payload = msg.Payload().data();
+
+    uint16_t keyLength = 0;
+    uint16_t setLength = 0;
+    switch (msgId) {
+        case CFG_PRT:
+            keyLength = 1;
+            setLength = CFG_PRT_PAYLOAD_LENGTH;
+            break;
+        case CFG_MSG:
+            keyLength = 2;
+            setLength = CFG_MSG_PAYLOAD_LENGTH;
+            break;
+        case CFG_RATE:
+            setLength = CFG_RATE_PAYLOAD_LENGTH;
+            break;
+        case CFG_NAVX5:
+            setLength = CFG_NAVX5_PAYLOAD_LENGTH;
+            break;
+        case CFG_GNSS:
+            setLength = length >= CFG_GNSS_HEADER_LENGTH ?
+                CFG_GNSS_HEADER_LENGTH + CfgGnss::NumConfigBlocks::Get(payload) * CFG_GNSS_BLOCK_LENGTH : 0;
+            break;
+        default:
+            // CFG-CFG and anything not modelled is accepted and forgotten
+            sendAck(CFG_CLASS, msgId, true);
+            return;
+    }
+
+    if (length == keyLength) {
+        // Poll: answer with the stored payload, then acknowledge
+        const std::vector<uint8_t> &current = cfgPayload(cfgKey(msgId, payload, keyLength));
+        send(CFG_CLASS, msgId, current.data(), static_cast<uint16_t>(current.size()));
+        sendAck(CFG_CLASS, msgId, true);
+        return;
+    }
+
+    if (msgId == CFG_MSG && length == 3) {
+        // Short form: rate on the port the message arrived on
+        uint8_t key[] = {payload[0], payload[1]};
+        std::vector<uint8_t> updated = cfgPayload(cfgKey(CFG_MSG, key, sizeof(key)));
+        updated[CfgMsg::RateDdc::offset + port] = payload[2];
+        cfg[cfgKey(CFG_MSG, key, sizeof(key))] = updated;
+        sendAck(CFG_CLASS, msgId, true);
+        return;
+    }
+
+    bool valid = length == setLength;
+    if (valid && msgId == CFG_RATE) {
+        valid = CfgRate::MeasRate::Get(payload) >= SIM_GPS_MIN_MEAS_RATE && CfgRate::NavRate::Get(payload) >= 1;
+    }
+    if (!valid) {
+        sendAck(CFG_CLASS, msgId, false);
+        return;
+    }
+
+    std::vector<uint8_t> &stored = cfg[cfgKey(msgId, payload, keyLength)];
+    if (msgId == CFG_NAVX5) {
+        // Only the masked fields change; ackAiding is the one modelled
+        stored = cfgPayload(cfgKey(CFG_NAVX5, nullptr, 0));
+        if (CfgNavx5::Mask1::Get(payload) & CFG_NAVX5_MASK1_ACK_AIDING) {
+            CfgNavx5::AckAiding::Put(stored.data(), CfgNavx5::AckAiding::Get(payload));
+        }
+    } else {
+        stored.assign(payload, payload + length);
+    }
+    if (msgId == CFG_RATE) {
+        nextEpochGpsNanos = 0;   // Realign to the new period
+    }
+    sendAck(CFG_CLASS, msgId, true);
+}
+
+/**
+ * @brief   Dump or apply assistance data (MGA-DBD, MGA-INI).
+ */
+void SimSamM8q::receiveMga(const UbxMessageView &msg, uint64_t nowNanos) {
+    uint16_t length = msg.PayloadLength();
+    const uint8_t *payload = msg.Payload().data();
+
+    if (msg.MsgId() == MGA_DBD && length == 0) {
+        for (const std::vector<uint8_t> &frame : database) {
+            if (output.size() + frame.size() > config.bufferBytes) {
+                stats.messagesDropped++;
+                continue;
+            }
+            output.insert(output.end(), frame.begin(), frame.end());
+            stats.messagesOut++;
+        }
+        uint8_t count[4];
+        UbxU4::Store(count, static_cast<uint32_t>(database.size()));
+        sendMgaAck(MGA_DBD, true, count);
+        return;
+    }
+    if (length < 4) {
+        return;
+    }
+
+    bool accepted = true;
+    if (msg.MsgId() == MGA_DBD && length >= MGA_DBD_HEADER_LENGTH) {
+        if (database.size() < SIM_GPS_DBD_MESSAGES) {
+            database.push_back(std::vector<uint8_t>(msg.Data(), msg.Data() + msg.FrameLength()));
+        }
+    } else if (MgaIniTimeUtc::Schema::Matches(MGA_CLASS, msg.MsgId(), length) &&
+        MgaIniTimeUtc::Type::Get(payload) == MGA_INI_TYPE_TIME_UTC) {
+        timeKnown = true;
+    } else if (MgaIniPosLlh::Schema::Matches(MGA_CLASS, msg.MsgId(), length) &&
+        MgaIniPosLlh::Type::Get(payload) == MGA_INI_TYPE_POS_LLH) {
+        positionKnown = true;
+    } else {
+        accepted = false;
+    }
+
+    if (accepted) {
+        stats.mgaAccepted++;
+        if (timeKnown && positionKnown && database.size() == SIM_GPS_DBD_MESSAGES) {
+            shortenTtff(nowNanos, SIM_GPS_TTFF_HOT_SECONDS);
+        } else if (timeKnown || positionKnown) {
+            shortenTtff(nowNanos, SIM_GPS_TTFF_AIDED_SECONDS);
+        }
+    }
+    if (ackAiding()) {
+        sendMgaAck(msg.MsgId(), accepted, payload);
+    }
+}
+
+/**
+ * @brief   Move the first fix earlier once enough assistance has arrived.
+ */
+void SimSamM8q::shortenTtff(uint64_t nowNanos, uint16_t seconds) {
+    uint64_t due = nowNanos + static_cast<uint64_t>(seconds) * NANOS_PER_SECOND;
+    if (stats.ttffMillis == 0 && due < fixDueNanos) {
+        fixDueNanos = due;
+    }
+}
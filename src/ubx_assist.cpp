@@ -0,0 +1,293 @@
+#include "ubx_assist.h"
+#include "ubx_schema.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+/**
+ * @brief   Constructor for the UbxNavDatabase class; starts empty.
+ */
+UbxNavDatabase::UbxNavDatabase(void) {
+    Clear();
+}
+
+/**
+ * @brief   Forget the MGA-DBD messages and the last fix.
+ */
+void UbxNavDatabase::Clear(void) {
+    dbd.clear();
+    dbdCount = 0;
+    lastFixValid = false;
+}
+
+/**
+ * @brief   Append one MGA-DBD message of a dump, unchanged.
+ *
+ * @param   msg A received frame.
+ * @return  true if it was an MGA-DBD message and was stored.
+ */
+bool UbxNavDatabase::AddDbd(const UbxMessageView &msg) {
+    if (!msg.Is(MGA_CLASS, MGA_DBD) || msg.PayloadLength() < MGA_DBD_HEADER_LENGTH ||
+        dbdCount >= ASSIST_MAX_DBD_MESSAGES) {
+        return false;
+    }
+
+    dbd.insert(dbd.end(), msg.Data(), msg.Data() + msg.FrameLength());
+    dbdCount++;
+    return true;
+}
+
+/**
+ * @brief   Keep a NAV-PVT as the position to start from next time.
+ *
+ * @param   pvt A valid NAV-PVT view.
+ * @return  true if the fix was stored, false if the receiver did not flag it gnssFixOK.
+ */
+bool UbxNavDatabase::SetLastFix(const NavPvtView &pvt) {
+    if (!pvt.IsValid() || (pvt.Flags() & NAV_PVT_FLAGS_GNSS_FIX_OK) == 0 ||
+        pvt.Message().FrameLength() != ASSIST_NAV_PVT_FRAME_LENGTH) {
+        return false;
+    }
+
+    memcpy(lastFix, pvt.Message().Data(), ASSIST_NAV_PVT_FRAME_LENGTH);
+    lastFixValid = true;
+    return true;
+}
+
+/**
+ * @brief   Write the database as a UBX file: the MGA-DBD frames, then the last fix.
+ *
+ * The file is written next to path, flushed to disk and renamed over path, so path
+ * always holds either the old or the new database.
+ *
+ * @param   path    The file to write.
+ * @return  true if the database was saved.
+ */
+bool UbxNavDatabase::Save(const char *path) const {
+    std::string temporary = std::string(path) + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        perror("Failed to create navigation database file");
+        return false;
+    }
+
+    bool written = fwrite(dbd.data(), 1, dbd.size(), file) == dbd.size();
+    if (lastFixValid) {
+        written &= fwrite(lastFix, 1, sizeof(lastFix), file) == sizeof(lastFix);
+    }
+    written &= fflush(file) == 0 && fsync(fileno(file)) == 0;
+    written &= fclose(file) == 0;
+
+    if (!written || rename(temporary.c_str(), path) != 0) {
+        perror("Failed to write navigation database file");
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief   Read a database written by Save() (or any UBX file with MGA-DBD messages).
+ *
+ * Frames are checked with UbxFramer; MGA-DBD messages are kept in file order and the
+ * last NAV-PVT with gnssFixOK becomes the last fix. Other messages are ignored.
+ *
+ * @param   path    The file to read.
+ * @return  true if the file was read and held at least one MGA-DBD message or a fix.
+ */
+bool UbxNavDatabase::Load(const char *path) {
+    Clear();
+
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    UbxFramer framer;
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        size_t offset = 0;
+        while (offset < length) {
+            offset += framer.Consume(&buffer[offset], length - offset);
+            if (!framer.FrameReady()) {
+                continue;
+            }
+            UbxMessageView msg(framer.Frame());
+            if (!AddDbd(msg)) {
+                SetLastFix(NavPvtView(msg));
+            }
+        }
+    }
+    fclose(file);
+
+    return dbdCount > 0 || lastFixValid;
+}
+
+/**
+ * @brief   Constructor for the UbxAssistUpload class; nothing queued.
+ */
+UbxAssistUpload::UbxAssistUpload(void) {
+    Clear();
+}
+
+/**
+ * @brief   Drop every queued frame and reset the statistics.
+ */
+void UbxAssistUpload::Clear(void) {
+    frames.clear();
+    offsets.clear();
+    next = 0;
+    answered = 0;
+    paced = false;
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * @brief   Queue one complete MGA frame.
+ *
+ * @param   frame   The frame, sync characters to checksum.
+ * @param   length  The number of bytes in frame.
+ * @return  true if queued, false if it is not an MGA frame.
+ */
+bool UbxAssistUpload::Add(const uint8_t *frame, uint16_t length) {
+    if (length < UBX_FRAME_OVERHEAD || frame[UBX_VIEW_CLASS_OFFSET] != MGA_CLASS) {
+        return false;
+    }
+
+    offsets.push_back(static_cast<uint32_t>(frames.size()));
+    frames.insert(frames.end(), frame, frame + length);
+    return true;
+}
+
+/**
+ * @brief   Queue complete frames stored back to back (e.g. UbxNavDatabase::DbdFrames()).
+ *
+ * @param   data    The frames.
+ * @param   length  The number of bytes in data.
+ * @return  The number of frames queued; stops at the first truncated or non-MGA frame.
+ */
+size_t UbxAssistUpload::AddFrames(const uint8_t *data, size_t length) {
+    size_t added = 0;
+    size_t offset = 0;
+    while (length - offset >= UBX_FRAME_OVERHEAD) {
+        UbxMessageView msg(&data[offset]);
+        uint16_t frameLength = msg.FrameLength();
+        if (frameLength > length - offset || !Add(&data[offset], frameLength)) {
+            break;
+        }
+        offset += frameLength;
+        added++;
+    }
+    return added;
+}
+
+/**
+ * @brief   Whether the next frame may be written now.
+ *
+ * @return  true if frames remain and fewer than ASSIST_ACK_WINDOW are waiting for an
+ *          ACK (or the upload is paced, in which case the caller spaces the writes).
+ */
+bool UbxAssistUpload::CanSend(void) const {
+    return next < Count() && (paced || next - answered < ASSIST_ACK_WINDOW);
+}
+
+/**
+ * @brief   Take the next frame to write and count it as sent.
+ *
+ * @param   length  Set to the number of bytes in the frame.
+ * @return  The frame, or nullptr if none remain.
+ */
+const uint8_t *UbxAssistUpload::Next(uint16_t &length) {
+    if (next >= Count()) {
+        length = 0;
+        return nullptr;
+    }
+
+    uint32_t start = offsets[next];
+    uint32_t end = next + 1 < Count() ? offsets[next + 1] : static_cast<uint32_t>(frames.size());
+    length = static_cast<uint16_t>(end - start);
+    next++;
+    stats.sent++;
+    stats.bytes += length;
+    if (paced) {
+        // Nobody will answer this one
+        answered = next;
+        stats.unconfirmed++;
+    }
+    return &frames[start];
+}
+
+/**
+ * @brief   Match a UBX-MGA-ACK-DATA0 to the oldest frame waiting for one.
+ *
+ * @param   msg The received message.
+ * @return  true if the message acknowledged a frame of this upload.
+ */
+bool UbxAssistUpload::OnAck(const UbxMessageView &msg) {
+    if (!MgaAck::Schema::Matches(msg.MsgClass(), msg.MsgId(), msg.PayloadLength()) || !AcksOutstanding()) {
+        return false;
+    }
+
+    const uint8_t *payload = msg.Payload().data();
+    const uint8_t *oldest = &frames[offsets[answered]];
+    if (MgaAck::MsgId::Get(payload) != oldest[UBX_VIEW_ID_OFFSET]) {
+        return false;
+    }
+
+    if (MgaAck::Type::Get(payload) == MGA_ACK_TYPE_ACCEPTED) {
+        stats.accepted++;
+    } else {
+        stats.rejected++;
+        stats.lastInfoCode = MgaAck::InfoCode::Get(payload);
+    }
+    answered++;
+    return true;
+}
+
+/**
+ * @brief   Give up on ACKs: frames in flight count as unconfirmed and the rest is paced.
+ */
+void UbxAssistUpload::StopWaitingForAcks(void) {
+    stats.unconfirmed += static_cast<uint16_t>(next - answered);
+    answered = next;
+    paced = true;
+}
+
+/**
+ * @brief   Compose MGA-INI-POS_LLH from a saved fix.
+ *
+ * @param   frame       Destination, at least UBX_FRAME_OVERHEAD + MGA_INI_POS_LLH_PAYLOAD_LENGTH bytes.
+ * @param   fix         A valid NAV-PVT.
+ * @param   marginCm    Added to the fix's horizontal accuracy, for movement while switched off.
+ * @return  The number of bytes written to frame.
+ */
+uint16_t ComposeIniPosition(uint8_t *frame, const NavPvtView &fix, uint32_t marginCm) {
+    uint8_t payload[MGA_INI_POS_LLH_PAYLOAD_LENGTH];
+    uint32_t accuracyCm = fix.HorizontalAccuracy() / 10 + marginCm;
+    MgaIniPosLlh::Schema::Encode(payload, MGA_INI_TYPE_POS_LLH, 0,
+        NavPvt::Lat::Raw(fix.Message().Payload().data()), NavPvt::Lon::Raw(fix.Message().Payload().data()),
+        fix.Height() / 10, accuracyCm);
+    return ComposeFrame(frame, MGA_CLASS, MGA_INI, sizeof(payload), payload);
+}
+
+/**
+ * @brief   Compose MGA-INI-TIME_UTC, valid on receipt, from a CLOCK_REALTIME time.
+ *
+ * @param   frame           Destination, at least UBX_FRAME_OVERHEAD + MGA_INI_TIME_UTC_PAYLOAD_LENGTH bytes.
+ * @param   utc             The current UTC time.
+ * @param   accuracyMillis  How far utc may be off.
+ * @return  The number of bytes written to frame.
+ */
+uint16_t ComposeIniTime(uint8_t *frame, const struct timespec &utc, uint32_t accuracyMillis) {
+    struct tm calendar;
+    gmtime_r(&utc.tv_sec, &calendar);
+
+    uint8_t payload[MGA_INI_TIME_UTC_PAYLOAD_LENGTH];
+    MgaIniTimeUtc::Schema::Encode(payload, MGA_INI_TYPE_TIME_UTC, 0, 0, ASSIST_LEAP_SECONDS_UNKNOWN,
+        calendar.tm_year + 1900, calendar.tm_mon + 1, calendar.tm_mday,
+        calendar.tm_hour, calendar.tm_min, calendar.tm_sec, static_cast<uint32_t>(utc.tv_nsec),
+        accuracyMillis / 1000, (accuracyMillis % 1000) * 1000000);
+    return ComposeFrame(frame, MGA_CLASS, MGA_INI, sizeof(payload), payload);
+}
@@ -0,0 +1,477 @@
+#include "ubx_batch.h"
+#include "ubx_capture.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief   Drop every row.
+ */
+void PvtColumns::Clear(void) {
+#define PVT_COLUMN_CLEAR(type, name, dtype) name.clear();
+    PVT_COLUMN_LIST(PVT_COLUMN_CLEAR)
+#undef PVT_COLUMN_CLEAR
+}
+
+/**
+ * @brief   Reserve room for rows in every column.
+ */
+void PvtColumns::Reserve(size_t rows) {
+#define PVT_COLUMN_RESERVE(type, name, dtype) name.reserve(rows);
+    PVT_COLUMN_LIST(PVT_COLUMN_RESERVE)
+#undef PVT_COLUMN_RESERVE
+}
+
+/**
+ * @brief   Append one decoded fix as a new row.
+ */
+void PvtColumns::Append(const PVTData &data) {
+#define PVT_COLUMN_PUSH(type, name, dtype) name.push_back(data.name);
+    PVT_COLUMN_LIST(PVT_COLUMN_PUSH)
+#undef PVT_COLUMN_PUSH
+}
+
+/**
+ * @brief   Append the rows of another set of columns, starting at row first.
+ */
+void PvtColumns::Append(const PvtColumns &other, size_t first) {
+#define PVT_COLUMN_INSERT(type, name, dtype) name.insert(name.end(), other.name.begin() + first, other.name.end());
+    PVT_COLUMN_LIST(PVT_COLUMN_INSERT)
+#undef PVT_COLUMN_INSERT
+}
+
+/**
+ * @brief   Constructor for the UbxBatchDecoder class; no file is mapped.
+ */
+UbxBatchDecoder::UbxBatchDecoder(void) {
+    data = nullptr;
+    size = 0;
+    streamLength = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * @brief   Destructor for the UbxBatchDecoder class; unmaps the file.
+ */
+UbxBatchDecoder::~UbxBatchDecoder(void) {
+    Close();
+}
+
+/**
+ * @brief   Map a capture or raw UBX file and index its byte stream.
+ *
+ * @param   path    A capture written by UbxCaptureWriter, or any file of raw UBX bytes.
+ * @return  true if the file is mapped, false otherwise.
+ */
+bool UbxBatchDecoder::Open(const char *path) {
+    Close();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open capture file");
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size == 0) {
+        printf("Error: %s is empty.\n", path);
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Failed to map capture file");
+        return false;
+    }
+
+    data = static_cast<const uint8_t *>(mapping);
+    size = info.st_size;
+
+    if (size >= UBX_CAPTURE_HEADER_LENGTH && memcmp(data, UBX_CAPTURE_MAGIC, UBX_CAPTURE_MAGIC_LENGTH) == 0) {
+        if (!indexCapture()) {
+            printf("Error: %s has an invalid capture header.\n", path);
+            Close();
+            return false;
+        }
+    } else {
+        UbxStreamSpan span = {0, data, size, 0};
+        spans.push_back(span);
+        streamLength = size;
+    }
+
+    stats.spans = spans.size();
+    stats.streamBytes = streamLength;
+    return true;
+}
+
+/**
+ * @brief   Unmap the file and forget the index.
+ */
+void UbxBatchDecoder::Close(void) {
+    if (data != nullptr) {
+        munmap(const_cast<uint8_t *>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+    spans.clear();
+    streamLength = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * @brief   Index the RX records of a capture as consecutive spans of one stream.
+ *
+ * Hops over record headers only; a record cut short by the end of the file ends
+ * the stream.
+ *
+ * @return  true unless the header length is invalid.
+ */
+bool UbxBatchDecoder::indexCapture(void) {
+    uint32_t headerLength = UbxU4::Load(&data[8]);
+    if (headerLength < UBX_CAPTURE_HEADER_LENGTH || headerLength > size) {
+        return false;
+    }
+
+    size_t offset = headerLength;
+    streamLength = 0;
+    while (size - offset >= UBX_CAPTURE_RECORD_HEADER_LENGTH) {
+        uint16_t length = UbxU2::Load(&data[offset + 8]);
+        if (size - offset - UBX_CAPTURE_RECORD_HEADER_LENGTH < length) {
+            break;
+        }
+        if (data[offset + 10] == CAPTURE_RECORD_RX && length > 0) {
+            UbxStreamSpan span;
+            span.streamOffset = streamLength;
+            span.bytes = &data[offset + UBX_CAPTURE_RECORD_HEADER_LENGTH];
+            span.length = length;
+            span.hostNanos = UbxWire<uint64_t>::Load(&data[offset]);
+            spans.push_back(span);
+            streamLength += length;
+        }
+        offset += UBX_CAPTURE_RECORD_HEADER_LENGTH + length;
+    }
+    return true;
+}
+
+/**
+ * @brief   Index of the span holding the stream byte at position.
+ */
+size_t UbxBatchDecoder::findSpan(uint64_t position) const {
+    size_t low = 0;
+    size_t high = spans.size();
+    while (high - low > 1) {
+        size_t middle = (low + high) / 2;
+        if (spans[middle].streamOffset <= position) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief   Position of the next SYNC_CHAR_1 at or after position.
+ *
+ * @param   position    Where to start looking.
+ * @param   span        In: a span at or before position. Out: the span holding the result.
+ * @return  The stream position, or streamLength if there is none.
+ */
+uint64_t UbxBatchDecoder::findSync(uint64_t position, size_t &span) const {
+    while (span < spans.size()) {
+        const UbxStreamSpan &current = spans[span];
+        uint64_t offset = position - current.streamOffset;
+        if (position >= current.streamOffset && offset < current.length) {
+            const void *found = memchr(current.bytes + offset, SYNC_CHAR_1, current.length - offset);
+            if (found != nullptr) {
+                return current.streamOffset + (static_cast<const uint8_t *>(found) - current.bytes);
+            }
+            position = current.streamOffset + current.length;
+        }
+        span++;
+    }
+    return streamLength;
+}
+
+/**
+ * @brief   Contiguous view of length stream bytes starting at position.
+ *
+ * Points into the mapping when the bytes lie in one span, otherwise copies them
+ * into scratch. The caller guarantees position + length <= streamLength.
+ *
+ * @param   position    First stream byte.
+ * @param   length      Number of bytes, at most UBX_MAX_FRAME_LENGTH.
+ * @param   span        The span holding position.
+ * @param   scratch     Buffer of UBX_MAX_FRAME_LENGTH bytes.
+ */
+const uint8_t *UbxBatchDecoder::gather(uint64_t position, size_t length, size_t span, uint8_t *scratch) const {
+    const UbxStreamSpan &first = spans[span];
+    uint64_t offset = position - first.streamOffset;
+    if (offset + length <= first.length) {
+        return first.bytes + offset;
+    }
+
+    size_t copied = 0;
+    while (copied < length) {
+        const UbxStreamSpan &current = spans[span++];
+        size_t available = current.length - offset;
+        size_t chunk = std::min(available, length - copied);
+        memcpy(&scratch[copied], current.bytes + offset, chunk);
+        copied += chunk;
+        offset = 0;
+    }
+    return scratch;
+}
+
+/**
+ * @brief   Decode every frame that starts inside the chunk.
+ *
+ * A candidate that fails the length or checksum test is skipped by one byte, so a
+ * real frame behind a false sync character is still found.
+ */
+void UbxBatchDecoder::scanChunk(ChunkResult &chunk) const {
+    uint8_t scratch[UBX_MAX_FRAME_LENGTH];
+    size_t span = findSpan(chunk.start);
+    uint64_t position = chunk.start;
+
+    while (true) {
+        uint64_t start = findSync(position, span);
+        if (start >= chunk.end || start + UBX_FRAME_OVERHEAD > streamLength) {
+            break;
+        }
+        position = start + 1;
+
+        const uint8_t *header = gather(start, UBX_HEADER_LENGTH, span, scratch);
+        if (header[1] != SYNC_CHAR_2) {
+            continue;
+        }
+        uint16_t payloadLength = UbxReadU2(&header[UBX_VIEW_LENGTH_OFFSET]);
+        uint64_t end = start + payloadLength + UBX_FRAME_OVERHEAD;
+        if (payloadLength > MAX_MESSAGE_LENGTH || end > streamLength) {
+            continue;
+        }
+
+        const uint8_t *frame = gather(start, end - start, span, scratch);
+        uint8_t checksumA = 0;
+        uint8_t checksumB = 0;
+        UpdateChecksum(&frame[UBX_VIEW_CLASS_OFFSET], payloadLength + 4, checksumA, checksumB);
+        if (checksumA != frame[UBX_HEADER_LENGTH + payloadLength] ||
+            checksumB != frame[UBX_HEADER_LENGTH + payloadLength + 1]) {
+            chunk.checksumFailures++;
+            continue;
+        }
+
+        chunk.frames++;
+        NavPvtView pvt((UbxMessageView(frame)));
+        if (pvt.IsValid()) {
+            PVTData row;
+            memset(&row, 0, sizeof(row));
+            Gps::DecodePvtFields(pvt, row);
+            row.hostReceiveNanos = spans[findSpan(end - 1)].hostNanos;
+            chunk.columns.Append(row);
+        }
+
+        // Only frames this close to the start can overlap the previous chunk's last frame
+        if (start < chunk.start + UBX_MAX_FRAME_LENGTH) {
+            LeadFrame lead = {start, end, chunk.columns.Rows(), chunk.frames};
+            chunk.lead.push_back(lead);
+        }
+        chunk.lastEnd = end;
+        position = end;
+    }
+}
+
+/**
+ * @brief   Fill newFix and hostEpochNanos in stream order.
+ *
+ * The clock model only sees fixes up to each row, as it would have on the receiver.
+ */
+void UbxBatchDecoder::fillHostTiming(PvtColumns &columns) const {
+    GnssClockEstimator clock;
+    for (size_t i = 0; i < columns.Rows(); i++) {
+        bool isNew = i == 0 || columns.iTOW[i] != columns.iTOW[i - 1];
+        columns.newFix[i] = isNew ? 1 : 0;
+        if (columns.hostReceiveNanos[i] == 0) {
+            continue;
+        }
+        if (isNew) {
+            clock.AddSample(columns.iTOW[i], columns.hostReceiveNanos[i]);
+        }
+        columns.hostEpochNanos[i] = clock.HostNanos(columns.iTOW[i]);
+    }
+}
+
+/**
+ * @brief   Decode every NAV-PVT in the mapped file into columns.
+ *
+ * @param   columns The columns to fill; previous rows are dropped.
+ * @param   threads Worker threads, 0 for one per core; 1 scans the stream in one piece.
+ * @return  true if a file is mapped, false otherwise.
+ */
+bool UbxBatchDecoder::Decode(PvtColumns &columns, uint32_t threads) {
+    columns.Clear();
+    if (data == nullptr) {
+        return false;
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    uint64_t chunkCount = std::max<uint64_t>(1, streamLength / UBX_BATCH_MIN_CHUNK_LENGTH);
+    chunkCount = std::min<uint64_t>(chunkCount, static_cast<uint64_t>(threads) * UBX_BATCH_CHUNKS_PER_THREAD);
+    if (threads == 1) {
+        chunkCount = 1;
+    }
+    threads = std::min<uint64_t>(threads, chunkCount);
+
+    std::vector<ChunkResult> chunks(chunkCount);
+    for (uint64_t i = 0; i < chunkCount; i++) {
+        chunks[i].start = streamLength * i / chunkCount;
+        chunks[i].end = streamLength * (i + 1) / chunkCount;
+        chunks[i].lastEnd = 0;
+        chunks[i].frames = 0;
+        chunks[i].checksumFailures = 0;
+    }
+
+    // Workers take the next unscanned chunk until none are left
+    std::atomic<uint64_t> next(0);
+    auto worker = [&]() {
+        for (uint64_t i = next++; i < chunkCount; i = next++) {
+            scanChunk(chunks[i]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (uint32_t i = 1; i < threads; i++) {
+        pool.push_back(std::thread(worker));
+    }
+    worker();
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+
+    // Reconcile chunk edges in stream order, then concatenate
+    stats.chunks = chunkCount;
+    stats.threads = threads;
+    stats.rescannedChunks = 0;
+    stats.frames = 0;
+    stats.checksumFailures = 0;
+
+    std::vector<size_t> firstRow(chunkCount, 0);
+    uint64_t previousEnd = 0;
+    size_t rows = 0;
+    for (uint64_t i = 0; i < chunkCount; i++) {
+        ChunkResult &chunk = chunks[i];
+        uint64_t droppedFrames = 0;
+
+        if (previousEnd > chunk.start) {
+            bool lostSync = false;
+            for (const LeadFrame &lead : chunk.lead) {
+                if (lead.start < previousEnd && lead.end > previousEnd) {
+                    lostSync = true;
+                } else if (lead.start < previousEnd) {
+                    firstRow[i] = lead.rowsAfter;
+                    droppedFrames = lead.framesAfter;
+                }
+            }
+
+            if (lostSync) {
+                chunk.start = previousEnd;
+                chunk.columns.Clear();
+                chunk.lead.clear();
+                chunk.lastEnd = 0;
+                chunk.frames = 0;
+                chunk.checksumFailures = 0;
+                scanChunk(chunk);
+                firstRow[i] = 0;
+                droppedFrames = 0;
+                stats.rescannedChunks++;
+            }
+        }
+
+        stats.frames += chunk.frames - droppedFrames;
+        stats.checksumFailures += chunk.checksumFailures;
+        rows += chunk.columns.Rows() - firstRow[i];
+        previousEnd = std::max(previousEnd, chunk.lastEnd);
+    }
+
+    columns.Reserve(rows);
+    for (uint64_t i = 0; i < chunkCount; i++) {
+        columns.Append(chunks[i].columns, firstRow[i]);
+        chunks[i].columns = PvtColumns();
+    }
+    fillHostTiming(columns);
+
+    stats.rows = columns.Rows();
+    return true;
+}
+
+/**
+ * @brief   Write columns to a flat file that numpy.memmap can open.
+ *
+ * @param   path    The file to create; an existing file is overwritten.
+ * @param   columns The columns to write.
+ * @return  true if the whole file was written, false otherwise.
+ */
+bool WritePvtColumns(const char *path, const PvtColumns &columns) {
+    struct ColumnRef {
+        const char *name;
+        const char *dtype;
+        const void *bytes;
+        size_t length;
+    };
+    const ColumnRef refs[] = {
+#define PVT_COLUMN_REF(type, name, dtype) {#name, dtype, columns.name.data(), columns.name.size() * sizeof(type)},
+        PVT_COLUMN_LIST(PVT_COLUMN_REF)
+#undef PVT_COLUMN_REF
+    };
+    const uint32_t count = sizeof(refs) / sizeof(refs[0]);
+
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        perror("Failed to create column file");
+        return false;
+    }
+
+    uint32_t headerLength = PVT_COLUMNS_HEADER_LENGTH + count * PVT_COLUMN_DESCRIPTOR_LENGTH;
+    std::vector<uint8_t> header(headerLength, 0);
+    memcpy(&header[0], PVT_COLUMNS_MAGIC, PVT_COLUMNS_MAGIC_LENGTH);
+    UbxU4::Store(&header[8], count);
+    UbxU4::Store(&header[12], headerLength);
+    UbxWire<uint64_t>::Store(&header[16], columns.Rows());
+
+    std::vector<uint64_t> offsets(count);
+    uint64_t offset = headerLength;
+    for (uint32_t i = 0; i < count; i++) {
+        offset = (offset + PVT_COLUMNS_ALIGNMENT - 1) / PVT_COLUMNS_ALIGNMENT * PVT_COLUMNS_ALIGNMENT;
+        offsets[i] = offset;
+        offset += refs[i].length;
+
+        uint8_t *descriptor = &header[PVT_COLUMNS_HEADER_LENGTH + i * PVT_COLUMN_DESCRIPTOR_LENGTH];
+        strncpy(reinterpret_cast<char *>(descriptor), refs[i].name, PVT_COLUMN_NAME_LENGTH - 1);
+        strncpy(reinterpret_cast<char *>(&descriptor[PVT_COLUMN_NAME_LENGTH]), refs[i].dtype, PVT_COLUMN_DTYPE_LENGTH - 1);
+        UbxWire<uint64_t>::Store(&descriptor[PVT_COLUMN_NAME_LENGTH + PVT_COLUMN_DTYPE_LENGTH], offsets[i]);
+    }
+
+    bool ok = fwrite(header.data(), 1, headerLength, file) == headerLength;
+    uint64_t written = headerLength;
+    static const uint8_t padding[PVT_COLUMNS_ALIGNMENT] = {0};
+    for (uint32_t i = 0; ok && i < count; i++) {
+        size_t pad = offsets[i] - written;
+        ok = fwrite(padding, 1, pad, file) == pad &&
+            fwrite(refs[i].bytes, 1, refs[i].length, file) == refs[i].length;
+        written = offsets[i] + refs[i].length;
+    }
+
+    if (fclose(file) != 0 || !ok) {
+        perror("Failed to write column file");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,269 @@
+#include "ubx_capture.h"
+#include "ubx_schema.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief   Constructor for the UbxCaptureWriter class; no file is open.
+ */
+UbxCaptureWriter::UbxCaptureWriter(void) {
+    file = nullptr;
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * @brief   Destructor for the UbxCaptureWriter class; flushes and closes the file.
+ */
+UbxCaptureWriter::~UbxCaptureWriter(void) {
+    Close();
+}
+
+/**
+ * @brief   Create (or truncate) a capture file and write its header.
+ *
+ * @param   path    The file to write.
+ * @return  true if the file is ready for records, false otherwise.
+ */
+bool UbxCaptureWriter::Open(const char *path) {
+    Close();
+    memset(&stats, 0, sizeof(stats));
+
+    file = fopen(path, "wb");
+    if (file == nullptr) {
+        perror("Failed to create capture file");
+        return false;
+    }
+    setvbuf(file, nullptr, _IOFBF, UBX_CAPTURE_FILE_BUFFER);
+
+    uint8_t header[UBX_CAPTURE_HEADER_LENGTH] = {0};
+    memcpy(header, UBX_CAPTURE_MAGIC, UBX_CAPTURE_MAGIC_LENGTH);
+    UbxU4::Store(&header[8], UBX_CAPTURE_HEADER_LENGTH);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        perror("Failed to write capture header");
+        Close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief   Flush buffered records and close the file.
+ */
+void UbxCaptureWriter::Close(void) {
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+/**
+ * @brief   Append one record.
+ *
+ * @param   direction   CAPTURE_RECORD_RX or CAPTURE_RECORD_TX.
+ * @param   hostNanos   CLOCK_MONOTONIC time of the transfer.
+ * @param   data        The bytes transferred.
+ * @param   length      The number of bytes in data.
+ * @return  true if the record was buffered, false if no file is open or the write failed.
+ */
+bool UbxCaptureWriter::Write(uint8_t direction, uint64_t hostNanos, const uint8_t *data, uint16_t length) {
+    if (file == nullptr) {
+        return false;
+    }
+
+    uint8_t header[UBX_CAPTURE_RECORD_HEADER_LENGTH] = {0};
+    UbxWire<uint64_t>::Store(&header[0], hostNanos);
+    UbxU2::Store(&header[8], length);
+    header[10] = direction;
+
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header) ||
+        fwrite(data, 1, length, file) != length) {
+        stats.errors++;
+        return false;
+    }
+
+    stats.records++;
+    stats.bytes += length;
+    return true;
+}
+
+/**
+ * @brief   Constructor for the UbxCaptureReader class; no file is mapped.
+ */
+UbxCaptureReader::UbxCaptureReader(void) {
+    data = nullptr;
+    size = 0;
+    mode = CAPTURE_REPLAY_REALTIME;
+    Rewind();
+}
+
+/**
+ * @brief   Destructor for the UbxCaptureReader class; unmaps the file.
+ */
+UbxCaptureReader::~UbxCaptureReader(void) {
+    Close();
+}
+
+/**
+ * @brief   Map a capture file for replay.
+ *
+ * @param   path    The capture file.
+ * @param   mode    CAPTURE_REPLAY_REALTIME or CAPTURE_REPLAY_FAST.
+ * @return  true if the file is a capture and is mapped, false otherwise.
+ */
+bool UbxCaptureReader::Open(const char *path, uint8_t mode) {
+    Close();
+    this->mode = mode;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open capture file");
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size < UBX_CAPTURE_HEADER_LENGTH) {
+        printf("Error: %s is not a capture file.\n", path);
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Failed to map capture file");
+        return false;
+    }
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+    const uint8_t *bytes = static_cast<const uint8_t *>(mapping);
+    uint32_t headerLength = UbxU4::Load(&bytes[8]);
+    if (memcmp(bytes, UBX_CAPTURE_MAGIC, UBX_CAPTURE_MAGIC_LENGTH) != 0 ||
+        headerLength < UBX_CAPTURE_HEADER_LENGTH || headerLength > static_cast<uint64_t>(info.st_size)) {
+        printf("Error: %s is not a capture file.\n", path);
+        munmap(mapping, info.st_size);
+        return false;
+    }
+
+    data = bytes;
+    size = info.st_size;
+    Rewind();
+    return true;
+}
+
+/**
+ * @brief   Unmap the file.
+ */
+void UbxCaptureReader::Close(void) {
+    if (data != nullptr) {
+        munmap(const_cast<uint8_t *>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+    Rewind();
+}
+
+/**
+ * @brief   Start the replay again from the first record.
+ */
+void UbxCaptureReader::Rewind(void) {
+    offset = data != nullptr ? UbxU4::Load(&data[8]) : 0;
+    consumed = 0;
+    startNanos = 0;
+    memset(&stats, 0, sizeof(stats));
+    skipToRx();
+    firstNanos = AtEnd() ? 0 : recordNanos();
+}
+
+/**
+ * @brief   Advance past TX records; a truncated record ends the replay.
+ */
+void UbxCaptureReader::skipToRx(void) {
+    while (offset < size) {
+        if (size - offset < UBX_CAPTURE_RECORD_HEADER_LENGTH ||
+            size - offset - UBX_CAPTURE_RECORD_HEADER_LENGTH < recordLength()) {
+            offset = size;
+            return;
+        }
+        if (data[offset + 10] == CAPTURE_RECORD_RX && recordLength() > 0) {
+            return;
+        }
+        offset += UBX_CAPTURE_RECORD_HEADER_LENGTH + recordLength();
+    }
+}
+
+uint64_t UbxCaptureReader::recordNanos(void) const {
+    return UbxWire<uint64_t>::Load(&data[offset]);
+}
+
+uint16_t UbxCaptureReader::recordLength(void) const {
+    return UbxU2::Load(&data[offset + 8]);
+}
+
+/**
+ * @brief   Bytes of the current record that may be read now.
+ *
+ * The first call starts the replay clock.
+ *
+ * @param   nowNanos    The current CLOCK_MONOTONIC time.
+ * @return  Remaining bytes of the current record, 0 at the end or if it is not due yet.
+ */
+uint16_t UbxCaptureReader::Available(uint64_t nowNanos) {
+    if (AtEnd()) {
+        return 0;
+    }
+    if (startNanos == 0) {
+        startNanos = nowNanos;
+    }
+    if (nowNanos < NextReadableNanos(nowNanos)) {
+        return 0;
+    }
+    return recordLength() - consumed;
+}
+
+/**
+ * @brief   Copy bytes from the current record, moving to the next record once it is used up.
+ *
+ * @param   buf         Destination buffer, at least length bytes long.
+ * @param   length      The largest number of bytes to copy.
+ * @param   hostNanos   Set to the recorded time of the record the bytes came from.
+ * @return  The number of bytes copied.
+ */
+uint16_t UbxCaptureReader::Read(uint8_t *buf, uint16_t length, uint64_t &hostNanos) {
+    if (AtEnd()) {
+        return 0;
+    }
+
+    uint16_t remaining = recordLength() - consumed;
+    if (length > remaining) {
+        length = remaining;
+    }
+    memcpy(buf, &data[offset + UBX_CAPTURE_RECORD_HEADER_LENGTH + consumed], length);
+    hostNanos = recordNanos();
+    consumed += length;
+    stats.bytes += length;
+
+    if (consumed == recordLength()) {
+        stats.records++;
+        offset += UBX_CAPTURE_RECORD_HEADER_LENGTH + recordLength();
+        consumed = 0;
+        skipToRx();
+    }
+    return length;
+}
+
+/**
+ * @brief   Host time at which the current record becomes readable.
+ *
+ * @param   nowNanos    The current CLOCK_MONOTONIC time.
+ * @return  nowNanos in fast mode or before the replay started, otherwise the start of
+ *          the replay plus the record's recorded distance from the first record.
+ */
+uint64_t UbxCaptureReader::NextReadableNanos(uint64_t nowNanos) const {
+    if (mode == CAPTURE_REPLAY_FAST || startNanos == 0 || AtEnd()) {
+        return nowNanos;
+    }
+    return startNanos + (recordNanos() - firstNanos);
+}
@@ -0,0 +1,178 @@
+#include "ubx_config.h"
+#include <string.h>
+
+/**
+ * @brief   Queue a CFG message for the transaction.
+ *
+ * @param   msgClass        The message class (normally CFG_CLASS).
+ * @param   msgId           The message ID.
+ * @param   payload         The desired configuration payload.
+ * @param   payloadLength   The number of bytes in payload.
+ * @param   poll            The payload of the poll request; its response starts with these bytes.
+ * @param   pollLength      The number of bytes in poll (0 for messages polled without payload).
+ * @param   pollable        false for messages that cannot be read back (e.g. CFG-CFG).
+ * @return  true if the entry was added, false if the transaction or payload is too large.
+ */
+bool UbxConfigTransaction::Add(uint8_t msgClass, uint8_t msgId, const uint8_t *payload, uint16_t payloadLength,
+    const uint8_t *poll, uint16_t pollLength, bool pollable) {
+    if (count >= CONFIG_MAX_ENTRIES || payloadLength > CONFIG_MAX_PAYLOAD_LENGTH ||
+        pollLength > CONFIG_MAX_POLL_LENGTH) {
+        return false;
+    }
+
+    UbxConfigEntry &entry = entries[count++];
+    entry.msgClass = msgClass;
+    entry.msgId = msgId;
+    memcpy(entry.payload, payload, payloadLength);
+    entry.payloadLength = payloadLength;
+    if (pollLength > 0) {
+        memcpy(entry.poll, poll, pollLength);
+    }
+    entry.pollLength = pollLength;
+    entry.pollable = pollable;
+    entry.polled = false;
+    entry.outstandingAcks = 0;
+    entry.status = CONFIG_STATUS_PENDING;
+    return true;
+}
+
+/**
+ * @brief   Match a received message against the outstanding poll requests.
+ *
+ * @param   msg The received message.
+ * @return  true if the message answered one of this transaction's polls.
+ */
+bool UbxConfigTransaction::OnPollResponse(const UbxMessageView &msg) {
+    UbxSpan current = msg.Payload();
+
+    for (uint8_t i = 0; i < count; i++) {
+        UbxConfigEntry &entry = entries[i];
+        if (!entry.pollable || entry.polled || !msg.Is(entry.msgClass, entry.msgId) ||
+            current.size() < entry.pollLength || memcmp(current.data(), entry.poll, entry.pollLength) != 0) {
+            continue;
+        }
+
+        entry.polled = true;
+        if (current.size() == entry.payloadLength &&
+            memcmp(current.data(), entry.payload, entry.payloadLength) == 0) {
+            entry.status = CONFIG_STATUS_SKIPPED;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Match a UBX-ACK-ACK / UBX-ACK-NAK to the oldest outstanding entry of its class/id.
+ *
+ * @param   msg The received message.
+ * @return  true if the message was an ACK/NAK for this transaction.
+ */
+bool UbxConfigTransaction::OnAck(const UbxMessageView &msg) {
+    bool ack = msg.Is(ACK_CLASS, ACK_ACK);
+    if ((!ack && !msg.Is(ACK_CLASS, ACK_NAK)) || msg.PayloadLength() < 2) {
+        return false;
+    }
+
+    uint8_t ackedClass = msg.U1(0);
+    uint8_t ackedId = msg.U1(1);
+    for (uint8_t i = 0; i < count; i++) {
+        UbxConfigEntry &entry = entries[i];
+        if (entry.outstandingAcks == 0 || entry.msgClass != ackedClass || entry.msgId != ackedId) {
+            continue;
+        }
+
+        entry.outstandingAcks--;
+        if (entry.status == CONFIG_STATUS_PENDING) {
+            // Answer to the poll; a NAK'd or unanswered poll will not get a response
+            entry.polled = true;
+        } else if (entry.status == CONFIG_STATUS_SENT && entry.outstandingAcks == 0) {
+            entry.status = ack ? CONFIG_STATUS_ACKED : CONFIG_STATUS_NAKED;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Check whether every pollable entry has been answered.
+ */
+bool UbxConfigTransaction::PollsAnswered(void) const {
+    for (uint8_t i = 0; i < count; i++) {
+        if (entries[i].pollable && !entries[i].polled) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief   Check whether any ACK/NAK is still expected.
+ */
+bool UbxConfigTransaction::AcksOutstanding(void) const {
+    for (uint8_t i = 0; i < count; i++) {
+        if (entries[i].outstandingAcks > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief   Give up on any answers still outstanding; unanswered writes time out.
+ */
+void UbxConfigTransaction::ExpireOutstanding(void) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (entries[i].status == CONFIG_STATUS_SENT) {
+            entries[i].status = CONFIG_STATUS_TIMEOUT;
+        }
+        entries[i].outstandingAcks = 0;
+    }
+}
+
+/**
+ * @brief   Check whether every entry is now in effect on the receiver.
+ */
+bool UbxConfigTransaction::Succeeded(void) const {
+    for (uint8_t i = 0; i < count; i++) {
+        if (entries[i].status != CONFIG_STATUS_ACKED && entries[i].status != CONFIG_STATUS_SKIPPED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief   Count the entries by outcome.
+ *
+ * @return  The counters; elapsedMillis is left at 0 for the caller to fill in.
+ */
+UbxConfigStats UbxConfigTransaction::Summarize(void) const {
+    UbxConfigStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    for (uint8_t i = 0; i < count; i++) {
+        switch (entries[i].status) {
+            case CONFIG_STATUS_ACKED:
+                stats.written++;
+                stats.acked++;
+                break;
+            case CONFIG_STATUS_NAKED:
+                stats.written++;
+                stats.naked++;
+                break;
+            case CONFIG_STATUS_TIMEOUT:
+                stats.written++;
+                stats.timeouts++;
+                break;
+            case CONFIG_STATUS_SKIPPED:
+                stats.skipped++;
+                break;
+            default:
+                break;
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,151 @@
+#include "ubx_decode.h"
+
+/**
+ * @brief   Check that a view holds the message described by a schema.
+ */
+template<typename Schema>
+static inline bool matches(const UbxMessageView &msg) {
+    return msg.IsValid() && Schema::Matches(msg.MsgClass(), msg.MsgId(), msg.PayloadLength());
+}
+
+/**
+ * @brief   Decode a NAV-SAT message.
+ *
+ * Satellites beyond NAV_SAT_MAX_SVS are counted in numSvs but not stored.
+ *
+ * @param   msg     The received message.
+ * @param   data    The structure to fill.
+ * @return  true if msg is a complete NAV-SAT message, false otherwise.
+ */
+bool DecodeNavSat(const UbxMessageView &msg, NavSatData &data) {
+    if (!matches<NavSat::Schema>(msg)) {
+        return false;
+    }
+
+    const uint8_t *payload = msg.Payload().data();
+    uint8_t numSvs = NavSat::NumSvs::Get(payload);
+    if (msg.PayloadLength() < NAV_SAT_HEADER_LENGTH + numSvs * NAV_SAT_BLOCK_LENGTH) {
+        return false;
+    }
+
+    data.iTOW = NavSat::ITow::Get(payload);
+    data.numSvs = numSvs;
+    data.numDecoded = numSvs < NAV_SAT_MAX_SVS ? numSvs : NAV_SAT_MAX_SVS;
+    data.numUsed = 0;
+
+    for (uint8_t i = 0; i < data.numDecoded; i++) {
+        const uint8_t *block = payload + NAV_SAT_HEADER_LENGTH + i * NAV_SAT_BLOCK_LENGTH;
+        NavSatInfo &sv = data.svs[i];
+
+        sv.gnssId = NavSat::Sv::GnssId::Get(block);
+        sv.svId = NavSat::Sv::SvId::Get(block);
+        sv.cno = NavSat::Sv::Cno::Get(block);
+        sv.elevation = NavSat::Sv::Elev::Get(block);
+        sv.azimuth = NavSat::Sv::Azim::Get(block);
+        sv.pseudorangeResidual = NavSat::Sv::PrRes::Get(block);
+        sv.flags = NavSat::Sv::Flags::Get(block);
+        sv.qualityIndicator = sv.flags & NAV_SAT_QUALITY_MASK;
+        sv.used = (sv.flags & NAV_SAT_SV_USED_FLAG) != 0;
+        sv.health = (sv.flags >> NAV_SAT_HEALTH_SHIFT) & NAV_SAT_HEALTH_MASK;
+        data.numUsed += sv.used ? 1 : 0;
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Decode a NAV-DOP message.
+ *
+ * @param   msg     The received message.
+ * @param   data    The structure to fill.
+ * @return  true if msg is a complete NAV-DOP message, false otherwise.
+ */
+bool DecodeNavDop(const UbxMessageView &msg, NavDopData &data) {
+    if (!matches<NavDop::Schema>(msg)) {
+        return false;
+    }
+
+    const uint8_t *payload = msg.Payload().data();
+    data.iTOW = NavDop::ITow::Get(payload);
+    data.geometricDop = NavDop::GDop::Get(payload);
+    data.positionDop = NavDop::PDop::Get(payload);
+    data.timeDop = NavDop::TDop::Get(payload);
+    data.verticalDop = NavDop::VDop::Get(payload);
+    data.horizontalDop = NavDop::HDop::Get(payload);
+    data.northingDop = NavDop::NDop::Get(payload);
+    data.eastingDop = NavDop::EDop::Get(payload);
+    return true;
+}
+
+/**
+ * @brief   Decode a NAV-STATUS message.
+ *
+ * @param   msg     The received message.
+ * @param   data    The structure to fill.
+ * @return  true if msg is a complete NAV-STATUS message, false otherwise.
+ */
+bool DecodeNavStatus(const UbxMessageView &msg, NavStatusData &data) {
+    if (!matches<NavStatus::Schema>(msg)) {
+        return false;
+    }
+
+    const uint8_t *payload = msg.Payload().data();
+    data.iTOW = NavStatus::ITow::Get(payload);
+    data.gpsFix = NavStatus::GpsFix::Get(payload);
+    data.flags = NavStatus::Flags::Get(payload);
+    data.fixStatus = NavStatus::FixStat::Get(payload);
+    data.flags2 = NavStatus::Flags2::Get(payload);
+    data.timeToFirstFix = NavStatus::Ttff::Get(payload);
+    data.millisSinceStartup = NavStatus::Msss::Get(payload);
+    return true;
+}
+
+/**
+ * @brief   Decode a NAV-TIMEUTC message.
+ *
+ * @param   msg     The received message.
+ * @param   data    The structure to fill.
+ * @return  true if msg is a complete NAV-TIMEUTC message, false otherwise.
+ */
+bool DecodeNavTimeUtc(const UbxMessageView &msg, NavTimeUtcData &data) {
+    if (!matches<NavTimeUtc::Schema>(msg)) {
+        return false;
+    }
+
+    const uint8_t *payload = msg.Payload().data();
+    data.iTOW = NavTimeUtc::ITow::Get(payload);
+    data.timeAccuracy = NavTimeUtc::TAcc::Get(payload);
+    data.nano = NavTimeUtc::Nano::Get(payload);
+    data.year = NavTimeUtc::Year::Get(payload);
+    data.month = NavTimeUtc::Month::Get(payload);
+    data.day = NavTimeUtc::Day::Get(payload);
+    data.hour = NavTimeUtc::Hour::Get(payload);
+    data.min = NavTimeUtc::Min::Get(payload);
+    data.sec = NavTimeUtc::Sec::Get(payload);
+    data.valid = NavTimeUtc::Valid::Get(payload);
+    return true;
+}
+
+/**
+ * @brief   Decode a MON-HW message.
+ *
+ * @param   msg     The received message.
+ * @param   data    The structure to fill.
+ * @return  true if msg is a complete MON-HW message, false otherwise.
+ */
+bool DecodeMonHw(const UbxMessageView &msg, MonHwData &data) {
+    if (!matches<MonHw::Schema>(msg)) {
+        return false;
+    }
+
+    const uint8_t *payload = msg.Payload().data();
+    data.noisePerMS = MonHw::NoisePerMs::Get(payload);
+    data.agcCount = MonHw::AgcCnt::Get(payload);
+    data.agcPercent = data.agcCount * 100.0 / MON_HW_AGC_MAX;
+    data.antennaStatus = MonHw::AStatus::Get(payload);
+    data.antennaPower = MonHw::APower::Get(payload);
+    data.flags = MonHw::Flags::Get(payload);
+    data.jammingState = (data.flags >> MON_HW_JAMMING_SHIFT) & MON_HW_JAMMING_MASK;
+    data.jammingIndicator = MonHw::JamInd::Get(payload);
+    return true;
+}
@@ -0,0 +1,90 @@
+#include "ubx_dispatch.h"
+#include <string.h>
+
+/**
+ * @brief   Constructor for the UbxDispatcher class; starts with no handlers.
+ */
+UbxDispatcher::UbxDispatcher(void) {
+    memset(classSlot, 0, sizeof(classSlot));
+    memset(tables, 0, sizeof(tables));
+    classesUsed = 0;
+    ResetStats();
+}
+
+/**
+ * @brief   Route every message with the given class and id to a handler.
+ *
+ * Registering again for the same class/id replaces the previous handler.
+ *
+ * @param   msgClass    The message class.
+ * @param   msgId       The message ID.
+ * @param   handler     The function to call for each matching message.
+ * @param   context     Passed through to the handler unchanged.
+ * @return  true if registered, false if handler is null or UBX_DISPATCH_MAX_CLASSES
+ *          classes already have handlers.
+ */
+bool UbxDispatcher::Register(uint8_t msgClass, uint8_t msgId, UbxHandler handler, void *context) {
+    if (handler == nullptr) {
+        return false;
+    }
+
+    if (classSlot[msgClass] == 0) {
+        if (classesUsed >= UBX_DISPATCH_MAX_CLASSES) {
+            return false;
+        }
+        classSlot[msgClass] = ++classesUsed;
+    }
+
+    UbxHandlerEntry &entry = tables[classSlot[msgClass] - 1][msgId];
+    entry.handler = handler;
+    entry.context = context;
+    return true;
+}
+
+/**
+ * @brief   Stop routing messages with the given class and id.
+ *
+ * @param   msgClass    The message class.
+ * @param   msgId       The message ID.
+ */
+void UbxDispatcher::Unregister(uint8_t msgClass, uint8_t msgId) {
+    if (classSlot[msgClass] == 0) {
+        return;
+    }
+
+    UbxHandlerEntry &entry = tables[classSlot[msgClass] - 1][msgId];
+    entry.handler = nullptr;
+    entry.context = nullptr;
+}
+
+/**
+ * @brief   Pass a message to the handler registered for its class and id.
+ *
+ * @param   msg The received message.
+ * @return  true if a handler was called, false if none is registered.
+ */
+bool UbxDispatcher::Dispatch(const UbxMessageView &msg) {
+    if (!msg.IsValid()) {
+        return false;
+    }
+
+    uint8_t slot = classSlot[msg.MsgClass()];
+    if (slot != 0) {
+        const UbxHandlerEntry &entry = tables[slot - 1][msg.MsgId()];
+        if (entry.handler != nullptr) {
+            stats.dispatched++;
+            entry.handler(msg, entry.context);
+            return true;
+        }
+    }
+
+    stats.unhandled++;
+    return false;
+}
+
+/**
+ * @brief   Clear the dispatch counters.
+ */
+void UbxDispatcher::ResetStats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
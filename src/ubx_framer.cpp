@@ -0,0 +1,189 @@
+#include "ubx_framer.h"
+#include <string.h>
+
+/**
+ * @brief   Constructor for the UbxFramer class.
+ *
+ * Starts out hunting for SYNC_CHAR_1 with all counters cleared.
+ */
+UbxFramer::UbxFramer(void) {
+    Reset();
+    ResetStats();
+}
+
+/**
+ * @brief   Drop any partial frame and pending rescan bytes.
+ *
+ * Counters are kept; use ResetStats() to clear them.
+ */
+void UbxFramer::Reset(void) {
+    state = STATE_SYNC1;
+    frameLength = 0;
+    expectedLength = 0;
+    frameReady = false;
+    discarding = false;
+    rescanHead = 0;
+    rescanLength = 0;
+}
+
+/**
+ * @brief   Clear the frame, resync and error counters.
+ */
+void UbxFramer::ResetStats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * @brief   Feed a chunk of the byte stream into the framer.
+ *
+ * Consumption stops right after the first complete, checksum-valid frame so it can
+ * be read through Frame() before it is overwritten. Call again with the remaining
+ * bytes (data + returned count) until FrameReady() is false.
+ *
+ * @param   data    The received bytes.
+ * @param   length  The number of bytes in data.
+ * @return  The number of bytes of data that were consumed.
+ */
+size_t UbxFramer::Consume(const uint8_t *data, size_t length) {
+    frameReady = false;
+
+    size_t consumed = 0;
+    while (true) {
+        bool complete;
+        // Bytes left over from a dropped frame always come before any further input
+        if (rescanHead < rescanLength) {
+            complete = pushByte(rescan[rescanHead++]);
+        } else if (consumed < length) {
+            complete = pushByte(data[consumed++]);
+        } else {
+            return consumed;
+        }
+
+        if (complete) {
+            frameReady = true;
+            return consumed;
+        }
+    }
+}
+
+/**
+ * @brief   Advance the state machine by one byte.
+ *
+ * @param   byte    The next byte of the stream.
+ * @return  true if the byte completed a checksum-valid frame, false otherwise.
+ */
+bool UbxFramer::pushByte(uint8_t byte) {
+    switch (state) {
+        case STATE_SYNC1:
+            if (byte == SYNC_CHAR_1) {
+                frame[0] = byte;
+                frameLength = 1;
+                discarding = false;
+                state = STATE_SYNC2;
+            } else {
+                if (!discarding) {
+                    stats.resyncs++;
+                    discarding = true;
+                }
+                stats.bytesDiscarded++;
+            }
+            return false;
+
+        case STATE_SYNC2:
+            if (byte == SYNC_CHAR_2) {
+                frame[1] = byte;
+                frameLength = 2;
+                state = STATE_HEADER;
+                return false;
+            }
+            // False SYNC_CHAR_1; this byte may itself start the next frame
+            stats.resyncs++;
+            stats.bytesDiscarded++;
+            discarding = true;
+            state = STATE_SYNC1;
+            return pushByte(byte);
+
+        case STATE_HEADER:
+            frame[frameLength++] = byte;
+            if (frameLength == UBX_HEADER_LENGTH) {
+                expectedLength = static_cast<uint16_t>(frame[5] << 8 | frame[4]);
+                if (expectedLength > MAX_MESSAGE_LENGTH) {
+                    stats.lengthErrors++;
+                    dropFrame();
+                    return false;
+                }
+                state = (expectedLength > 0) ? STATE_PAYLOAD : STATE_CHECKSUM;
+            }
+            return false;
+
+        case STATE_PAYLOAD:
+            frame[frameLength++] = byte;
+            if (frameLength == UBX_HEADER_LENGTH + expectedLength) {
+                state = STATE_CHECKSUM;
+            }
+            return false;
+
+        case STATE_CHECKSUM: {
+            frame[frameLength++] = byte;
+            if (frameLength < UBX_HEADER_LENGTH + expectedLength + UBX_CHECKSUM_LENGTH) {
+                return false;
+            }
+
+            // Checksum covers class, id, length and payload
+            uint8_t checksumA = 0;
+            uint8_t checksumB = 0;
+            UpdateChecksum(&frame[2], UBX_HEADER_LENGTH - 2 + expectedLength, checksumA, checksumB);
+
+            state = STATE_SYNC1;
+            if (checksumA == frame[frameLength - 2] && checksumB == frame[frameLength - 1]) {
+                stats.frames++;
+                return true;
+            }
+
+            stats.checksumFailures++;
+            dropFrame();
+            return false;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Abandon the current frame and queue its bytes (minus the sync char) for rescanning.
+ *
+ * The rescan buffer can never overflow: a frame that is dropped while being rebuilt
+ * from the rescan buffer only ever shrinks what is left to rescan, and a frame built
+ * from fresh input leaves nothing pending.
+ */
+void UbxFramer::dropFrame(void) {
+    stats.resyncs++;
+    stats.bytesDiscarded++;
+    discarding = true;
+
+    uint16_t pending = rescanLength - rescanHead;
+    uint16_t tail = frameLength - 1;
+    memmove(&rescan[tail], &rescan[rescanHead], pending);
+    memcpy(rescan, &frame[1], tail);
+    rescanHead = 0;
+    rescanLength = tail + pending;
+
+    frameLength = 0;
+    state = STATE_SYNC1;
+}
+
+/**
+ * @brief   Copy the current frame into a UbxMessage.
+ *
+ * @param   msg The message to fill; only valid while FrameReady() is true.
+ */
+void UbxFramer::ToUbxMessage(UbxMessage &msg) const {
+    msg.sync1 = frame[0];
+    msg.sync2 = frame[1];
+    msg.msgClass = frame[2];
+    msg.msgId = frame[3];
+    msg.payloadLength = expectedLength;
+    memcpy(msg.payload, &frame[UBX_HEADER_LENGTH], expectedLength);
+    msg.checksumA = frame[frameLength - 2];
+    msg.checksumB = frame[frameLength - 1];
+}
@@ -1,4 +1,19 @@
 #include "ubx_msg.h"
+#include <string.h>
+#include <time.h>
+
+// Fletcher sums of eight bytes at once: bytes split into 16-bit lanes (even and odd
+// positions), and one multiply adds the lanes, weighted, into the top lane
+#define CHECKSUM_LANE_MASK 0x00FF00FF00FF00FFULL
+#define CHECKSUM_LANE_SUM 0x0001000100010001ULL        // Weight 1 for every lane
+#define CHECKSUM_EVEN_WEIGHTS 0x0008000600040002ULL    // Bytes 0, 2, 4, 6 count 8, 6, 4, 2 times in B
+#define CHECKSUM_ODD_WEIGHTS 0x0007000500030001ULL     // Bytes 1, 3, 5, 7 count 7, 5, 3, 1 times in B
+#define CHECKSUM_TOP_LANE_SHIFT 48
+
+typedef void (*ChecksumFunction)(const uint8_t *, uint16_t, uint8_t &, uint8_t &);
+
+static ChecksumFunction checksumFunction = UpdateChecksumScalar;
+static uint8_t checksumImplementation = UBX_CHECKSUM_SCALAR;
 
 /**
  * @brief   Compose a UBX message with the given message class, message ID, optional payloadLength, and payload.
@@ -31,39 +46,87 @@ UbxMessage ComposeMessage(uint8_t msg_class, uint8_t msg_id, uint16_t payloadLen
     return message;
 }
 
+/**
+ * @brief   Serialize a UBX message straight into a caller-provided frame buffer.
+ *
+ * Unlike ComposeMessage this never touches a full UbxMessage, so small messages
+ * (polls, CFG writes) cost only their own length on the stack.
+ *
+ * @param   frame       Destination buffer, at least payloadLength + 8 bytes long.
+ * @param   msg_class   The message class of the UBX message.
+ * @param   msg_id      The message ID of the UBX message.
+ * @param   payloadLength      The payloadLength of the payload.
+ * @param   payload     The payload data (may be nullptr when payloadLength is 0).
+ * @return  The total number of bytes written to frame.
+ */
+uint16_t ComposeFrame(uint8_t *frame, uint8_t msg_class, uint8_t msg_id, uint16_t payloadLength, const uint8_t* payload) {
+    frame[0] = SYNC_CHAR_1;
+    frame[1] = SYNC_CHAR_2;
+    frame[2] = msg_class;
+    frame[3] = msg_id;
+    frame[4] = static_cast<uint8_t>(payloadLength % (1 << 8));
+    frame[5] = static_cast<uint8_t>(payloadLength >> 8);
+    for (int i = 0; i < payloadLength; i++) {
+        frame[6 + i] = payload[i];
+    }
+
+    uint8_t checksumA = 0;
+    uint8_t checksumB = 0;
+    UpdateChecksum(&frame[2], 4 + payloadLength, checksumA, checksumB);
+    frame[6 + payloadLength] = checksumA;
+    frame[7 + payloadLength] = checksumB;
+
+    return 8 + payloadLength;
+}
+
+/** Message class names indexed by class byte; nullptr where no class is defined */
+static const char *const MSG_CLASS_NAMES[HNR_CLASS + 1] = {
+    nullptr,                                // 0x00
+    "Navigation",                           // NAV_CLASS 0x01
+    "Receiver Manager",                     // RXM_CLASS 0x02
+    nullptr,                                // 0x03
+    "Information",                          // INF_CLASS 0x04
+    "ACK/NAK",                              // ACK_CLASS 0x05
+    "Configuration",                        // CFG_CLASS 0x06
+    nullptr, nullptr,                       // 0x07 - 0x08
+    "Firmware update",                      // UPD_CLASS 0x09
+    "Monitoring",                           // MON_CLASS 0x0A
+    "AssistNow messages",                   // AID_CLASS 0x0B
+    nullptr,                                // 0x0C
+    "Timing",                               // TIM_CLASS 0x0D
+    nullptr, nullptr,                       // 0x0E - 0x0F
+    "External Sensor Fusion Messages",      // ESF_CLASS 0x10
+    nullptr, nullptr,                       // 0x11 - 0x12
+    "Multiple GNSS Assistance Messages",    // MGA_CLASS 0x13
+    nullptr, nullptr, nullptr, nullptr,     // 0x14 - 0x17
+    nullptr, nullptr, nullptr, nullptr,     // 0x18 - 0x1B
+    nullptr, nullptr, nullptr, nullptr,     // 0x1C - 0x1F
+    nullptr,                                // 0x20
+    "Logging",                              // LOG_CLASS 0x21
+    nullptr, nullptr, nullptr, nullptr,     // 0x22 - 0x25
+    nullptr,                                // 0x26
+    "Security",                             // SEC_CLASS 0x27
+    "High rate navigation results"          // HNR_CLASS 0x28
+};
+
+/** Fix type names indexed by the NAV-PVT / NAV-STATUS fix type */
+static const char *const GNSS_FIX_TYPE_NAMES[TIME_ONLY_FIX + 1] = {
+    "no fix",                               // NO_FIX
+    "dead reckoning only",                  // DEAD_RECKONING_ONLY
+    "2D-fix",                               // TWO_D_FIX
+    "3D-fix",                               // THREE_D_FIX
+    "GNSS + dead reckoning combined",       // GNSS_DEAD_RECKONING_COMBINED
+    "time only fix"                         // TIME_ONLY_FIX
+};
+
 /**
  * @brief   Convert a message class (msgClass) to its corresponding string representation.
  * @param   msgClass    The message class to convert.
  * @return  The string representation of the message class.
  */
 std::string MsgClassToString(uint8_t msgClass) {
-    if (msgClass == NAV_CLASS)
-        return "Navigation";
-    else if (msgClass == RXM_CLASS)
-        return "Receiver Manager";
-    else if (msgClass == INF_CLASS)
-        return "Information";
-    else if (msgClass == ACK_CLASS)
-        return "ACK/NAK";
-    else if (msgClass == CFG_CLASS)
-        return "Configuration";
-    else if (msgClass == UPD_CLASS)
-        return "Firmware update";
-    else if (msgClass == MON_CLASS)
-        return "Monitoring";
-    else if (msgClass == AID_CLASS)
-        return "AssistNow messages"; else if (msgClass == TIM_CLASS)
-        return "Timing";
-    else if (msgClass == ESF_CLASS)
-        return "External Sensor Fusion Messages";
-    else if (msgClass == MGA_CLASS)
-        return "Multiple GNSS Assistance Messages";
-    else if (msgClass == LOG_CLASS)
-        return "Logging";
-    else if (msgClass == SEC_CLASS)
-        return "Security";
-    else if (msgClass == HNR_CLASS)
-        return "High rate navigation results";
+    if (msgClass <= HNR_CLASS && MSG_CLASS_NAMES[msgClass] != nullptr)
+        return MSG_CLASS_NAMES[msgClass];
 
     return "Couldn't find class";
 }
@@ -74,20 +137,10 @@ std::string MsgClassToString(uint8_t msgClass) {
  * @return  The string representation of the GNSS fix type.
  */
 std::string GetGNSSFixType(uint8_t fixFlag) {
-    if (fixFlag == NO_FIX)
-        return "no fix";
-    else if (fixFlag == DEAD_RECKONING_ONLY)
-        return "dead reckoning only";
-    else if (fixFlag == TWO_D_FIX)
-        return "2D-fix";
-    else if (fixFlag == THREE_D_FIX)
-        return "3D-fix";
-    else if (fixFlag == GNSS_DEAD_RECKONING_COMBINED)
-        return "GNSS + dead reckoning combined";
-    else if (fixFlag == TIME_ONLY_FIX)
-        return "time only fix";
-    else
-        return "reserved / no fix";
+    if (fixFlag <= TIME_ONLY_FIX)
+        return GNSS_FIX_TYPE_NAMES[fixFlag];
+
+    return "reserved / no fix";
 }
 
 /**
@@ -95,24 +148,141 @@ std::string GetGNSSFixType(uint8_t fixFlag) {
  * @param   msg The UbxMessage struct for which to calculate the checksum.
  */
 void ComputeChecksum(UbxMessage &msg) {
-    msg.checksumA = msg.msgClass;
-    msg.checksumB = msg.checksumA;
+    uint8_t header[] = {
+        msg.msgClass,
+        msg.msgId,
+        static_cast<uint8_t>(msg.payloadLength % (1 << 8)),
+        static_cast<uint8_t>(msg.payloadLength >> 8)
+    };
 
-    msg.checksumA += msg.msgId;
-    msg.checksumB += msg.checksumA;
+    msg.checksumA = 0;
+    msg.checksumB = 0;
+    UpdateChecksum(header, sizeof(header), msg.checksumA, msg.checksumB);
+    UpdateChecksum(msg.payload, msg.payloadLength, msg.checksumA, msg.checksumB);
+}
 
-    msg.checksumA += msg.payloadLength % (1 << 8);
-    msg.checksumB += msg.checksumA;
+/**
+ * @brief   Run the 8-Bit Fletcher algorithm over raw bytes, continuing from the given sums.
+ *
+ * Every received frame is verified with this, so it uses whichever of
+ * UpdateChecksumScalar() and UpdateChecksumBlocked() SelectChecksum() picked; both
+ * give identical sums.
+ *
+ * @param   data        The bytes to add to the checksum.
+ * @param   length      The number of bytes in data.
+ * @param   checksumA   Running checksum A (start from 0 for a new message).
+ * @param   checksumB   Running checksum B (start from 0 for a new message).
+ */
+void UpdateChecksum(const uint8_t *data, uint16_t length, uint8_t &checksumA, uint8_t &checksumB) {
+    checksumFunction(data, length, checksumA, checksumB);
+}
 
-    msg.checksumA += msg.payloadLength >> 8;
-    msg.checksumB += msg.checksumA;
+/**
+ * @brief   8-Bit Fletcher, one byte at a time.
+ */
+void UpdateChecksumScalar(const uint8_t *data, uint16_t length, uint8_t &checksumA, uint8_t &checksumB) {
+    for (int i = 0; i < length; i++) {
+        checksumA += data[i];
+        checksumB += checksumA;
+    }
+}
 
-    for (int i = 0; i < msg.payloadLength; i++) {
-        msg.checksumA += msg.payload[i];
-        msg.checksumB += msg.checksumA;
+/**
+ * @brief   8-Bit Fletcher, eight bytes per step.
+ *
+ * Over a block d0..d7, A grows by the sum of the bytes and B by 8 * A plus the
+ * prefix sums of the block, i.e. sum((8 - i) * di). Both are taken modulo 256, so
+ * 32-bit accumulators may wrap freely. The two sums come from SWAR multiplies on
+ * 16-bit lanes, which never carry into each other (a lane holds at most 10200).
+ * The tail, and big-endian hosts, use the scalar loop.
+ */
+void UpdateChecksumBlocked(const uint8_t *data, uint16_t length, uint8_t &checksumA, uint8_t &checksumB) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint32_t a = checksumA;
+    uint32_t b = checksumB;
+    uint16_t i = 0;
+    for (; length - i >= UBX_CHECKSUM_BLOCK_LENGTH; i += UBX_CHECKSUM_BLOCK_LENGTH) {
+        uint64_t word;
+        memcpy(&word, &data[i], sizeof(word));
+        uint64_t even = word & CHECKSUM_LANE_MASK;
+        uint64_t odd = (word >> 8) & CHECKSUM_LANE_MASK;
+
+        uint32_t sum = static_cast<uint32_t>(((even + odd) * CHECKSUM_LANE_SUM) >> CHECKSUM_TOP_LANE_SHIFT);
+        uint32_t weighted = static_cast<uint32_t>(
+            (even * CHECKSUM_EVEN_WEIGHTS + odd * CHECKSUM_ODD_WEIGHTS) >> CHECKSUM_TOP_LANE_SHIFT);
+        b += UBX_CHECKSUM_BLOCK_LENGTH * a + weighted;
+        a += sum;
+    }
+    for (; i < length; i++) {
+        a += data[i];
+        b += a;
+    }
+    checksumA = static_cast<uint8_t>(a);
+    checksumB = static_cast<uint8_t>(b);
+#else
+    UpdateChecksumScalar(data, length, checksumA, checksumB);
+#endif
+}
+
+/**
+ * @brief   Best time (ns) of one checksum implementation over a NAV-PVT sized frame.
+ */
+static uint64_t timeChecksum(ChecksumFunction function) {
+    uint8_t frame[UBX_CHECKSUM_CALIBRATION_LENGTH];
+    for (int i = 0; i < UBX_CHECKSUM_CALIBRATION_LENGTH; i++) {
+        frame[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+
+    uint64_t best = UINT64_MAX;
+    volatile uint8_t sink = 0;
+    for (int round = 0; round < UBX_CHECKSUM_CALIBRATION_ROUNDS; round++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int run = 0; run < UBX_CHECKSUM_CALIBRATION_RUNS; run++) {
+            uint8_t checksumA = 0;
+            uint8_t checksumB = 0;
+            function(frame, sizeof(frame), checksumA, checksumB);
+            sink = sink + checksumB;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        uint64_t nanos = (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+        best = nanos < best ? nanos : best;
     }
+    return best;
 }
 
+/**
+ * @brief   Choose the implementation behind UpdateChecksum().
+ *
+ * Runs once before main() with UBX_CHECKSUM_AUTO. Not safe to call while another
+ * thread is computing checksums.
+ *
+ * @param   implementation  UBX_CHECKSUM_SCALAR, UBX_CHECKSUM_BLOCKED, or UBX_CHECKSUM_AUTO
+ *                          to time both and keep the faster one.
+ * @return  The implementation now in use.
+ */
+uint8_t SelectChecksum(uint8_t implementation) {
+    if (implementation == UBX_CHECKSUM_AUTO) {
+        uint64_t scalarNanos = timeChecksum(UpdateChecksumScalar);
+        uint64_t blockedNanos = timeChecksum(UpdateChecksumBlocked);
+        implementation = blockedNanos < scalarNanos ? UBX_CHECKSUM_BLOCKED : UBX_CHECKSUM_SCALAR;
+    }
+
+    checksumFunction = implementation == UBX_CHECKSUM_BLOCKED ? UpdateChecksumBlocked : UpdateChecksumScalar;
+    checksumImplementation = implementation == UBX_CHECKSUM_BLOCKED ? UBX_CHECKSUM_BLOCKED : UBX_CHECKSUM_SCALAR;
+    return checksumImplementation;
+}
+
+/**
+ * @brief   The implementation behind UpdateChecksum(): UBX_CHECKSUM_SCALAR or UBX_CHECKSUM_BLOCKED.
+ */
+uint8_t GetChecksumImplementation(void) {
+    return checksumImplementation;
+}
+
+// Pick the faster checksum once, before any frame is verified
+static const uint8_t startupChecksum = SelectChecksum(UBX_CHECKSUM_AUTO);
+
 /**
  * @brief   Reset the payload of a UBX message to all zeros.
  * @param   msg The UbxMessage struct for which to reset the payload.
@@ -1,23 +1,26 @@
+/*
+ * imu_mag_calibrate.cpp - Magnetometer hard-iron and soft-iron calibration on the rover
+ *
+ * Without arguments, reads the IMU and fits the calibration online (MagCalibrator)
+ * while the rover is turned through as many orientations as possible: rolled,
+ * pitched and yawed, not only driven in circles. Every accepted fit is printed and
+ * applied; Ctrl+C saves the last one to MAG_CALIBRATION_PATH and the raw samples to
+ * RAW_MAG_PATH. With a log argument (.csv as written here, or packed little endian
+ * int16 x, y, z) the log is fitted instead.
+ */
+
 #include "imu.h"
-#include <fcntl.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string>
-#include <sys/ioctl.h>
-#include <time.h>
-#include <unistd.h>
-#include <math.h>
+#include "mag_calibration.h"
 #include <chrono>
-#include <thread>
 #include <csignal>
 #include <iostream>
 #include <fstream>
-#include <unistd.h>
+#include <string.h>
+#include <thread>
 
-extern "C" {
-#include <i2c/smbus.h>
-#include <linux/i2c-dev.h>
-}
+#define MAG_CALIBRATION_PATH "tests/calibration/mag_calibration.txt"
+#define RAW_MAG_PATH "tests/calibration/raw_mag_data.csv"
+#define SAMPLE_PERIOD_MILLIS 10
 
 volatile bool exit_flag = false;
 
@@ -28,33 +31,72 @@ void signal_handler(int signum) {
     }
 }
 
-int main(void) {
+static void print_calibration(const MagCalibrator &calibrator) {
+    MagCalibration calibration = calibrator.GetCalibration();
+    MagCalibrationStats stats = calibrator.GetStats();
+    printf("Field %.2f uT, hard iron (%.2f, %.2f, %.2f) uT, axis ratio %.3f, spread %.2f, %u samples\n",
+        calibration.fieldUt, calibration.hardIron[X_AXIS], calibration.hardIron[Y_AXIS], calibration.hardIron[Z_AXIS],
+        stats.axisRatio, stats.spread, stats.samples);
+    for (int row = X_AXIS; row <= Z_AXIS; row++) {
+        printf("  soft iron [%8.5f %8.5f %8.5f]\n", calibration.softIron[row][X_AXIS], calibration.softIron[row][Y_AXIS],
+            calibration.softIron[row][Z_AXIS]);
+    }
+}
+
+/**
+ * @brief   Fit a recorded log in one pass.
+ */
+static int calibrate_log(const char *path) {
+    MagCalibrator calibrator;
+    size_t length = strlen(path);
+    bool csv = length > 4 && strcmp(&path[length - 4], ".csv") == 0;
+    if (!(csv ? calibrator.AddCsvFile(path) : calibrator.AddBinaryFile(path))) {
+        return 1;
+    }
+    if (!calibrator.Fit()) {
+        printf("%s: %u samples do not cover enough orientations (spread %.2f)\n", path,
+            calibrator.GetStats().samples, calibrator.GetStats().spread);
+        return 1;
+    }
+    print_calibration(calibrator);
+    return MagCalibrator::Save(calibrator.GetCalibration(), MAG_CALIBRATION_PATH) ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) {
+    return calibrate_log(argv[1]);
+  }
   signal(SIGINT, signal_handler);
 
   Imu imu_module;
-  std::ofstream mag_data_file("tests/calibration/raw_mag_data.csv");
+  MagCalibrator calibrator;
+  std::ofstream mag_data_file(RAW_MAG_PATH);
 
   // Check if the file is open
   if (!mag_data_file.is_open()) {
-    std::cerr << "Failed to open raw_mag_data.csv for writing." << std::endl;
+    std::cerr << "Failed to open " << RAW_MAG_PATH << " for writing." << std::endl;
     return 1;
   }
 
-  // Write CSV header
-  // mag_data_file << "MagX,MagY,MagZ\n";
-
+  std::cout << "Turn the rover through every orientation; Ctrl+C saves the calibration." << std::endl;
   while (!exit_flag) {
-    imu_module.readSensorData();
-
-    const int16_t *mag_data = imu_module.getMagnetometerData();
-    if (mag_data[0] != MAG_MAX_THRESHOLD && mag_data[1] != MAG_MAX_THRESHOLD && mag_data[2] != MAG_MAX_THRESHOLD) {
+    if (imu_module.ReadSensorData()) {
+      const int16_t *mag_data = imu_module.GetRawMagnetometerData();
       mag_data_file << mag_data[0] << "," << mag_data[1] << "," << mag_data[2] << std::endl;
+      if (calibrator.AddSample(mag_data)) {
+        imu_module.SetMagCalibration(calibrator.GetCalibration());
+        print_calibration(calibrator);
+      }
     }
 
-    sleep(0.1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(SAMPLE_PERIOD_MILLIS));
   }
 
   mag_data_file.close();
-  std::cout << "Exiting program and closing file." << std::endl;
-  return 0;
+  if (!calibrator.IsValid()) {
+    std::cout << "No calibration: the samples did not cover enough orientations." << std::endl;
+    return 1;
+  }
+  std::cout << "Saving the calibration to " << MAG_CALIBRATION_PATH << std::endl;
+  return MagCalibrator::Save(calibrator.GetCalibration(), MAG_CALIBRATION_PATH) ? 0 : 1;
 }
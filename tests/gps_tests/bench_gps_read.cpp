@@ -0,0 +1,68 @@
+#include "gps.h"
+#include <stdio.h>
+#include <csignal>
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#define CURRENT_YEAR 2024
+#define FIXES_PER_MODE 50
+
+// Define a flag to indicate if the program should exit gracefully.
+volatile bool exit_flag = false;
+
+// Signal handler function for Ctrl+C (SIGINT)
+void signal_handler(int signum) {
+    if (signum == SIGINT) {
+        std::cout << "Ctrl+C received. Cleaning up..." << std::endl;
+        exit_flag = true;
+    }
+}
+
+/**
+ * @brief   Collect FIXES_PER_MODE NAV-PVT fixes with the given read mode and
+ *          report the bus cost and time spent inside the driver per fix.
+ */
+void benchmark_mode(Gps &gps_module, uint8_t mode, const char *name) {
+    gps_module.SetReadMode(mode);
+    gps_module.ResetBusStats();
+
+    int fixes = 0;
+    double driverMicros = 0.0;
+    while (!exit_flag && fixes < FIXES_PER_MODE) {
+        auto start = std::chrono::steady_clock::now();
+        PVTData data = gps_module.GetPvt(false, 0);
+        auto end = std::chrono::steady_clock::now();
+        driverMicros += std::chrono::duration<double, std::micro>(end - start).count();
+
+        if (data.year == CURRENT_YEAR) {
+            fixes++;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    if (fixes == 0) {
+        printf("%-6s: no fixes received\n", name);
+        return;
+    }
+
+    GpsBusStats stats = gps_module.GetBusStats();
+    printf("%-6s: %d fixes, %.1f transactions/fix, %.1f bytes/fix, %.1f us/fix in driver\n",
+        name, fixes,
+        static_cast<double>(stats.transactions) / fixes,
+        static_cast<double>(stats.bytesRead + stats.bytesWritten) / fixes,
+        driverMicros / fixes);
+}
+
+int main(void) {
+    // Register the signal handler for SIGINT (Ctrl+C)
+    signal(SIGINT, signal_handler);
+
+    Gps gps_module(CURRENT_YEAR);
+
+    benchmark_mode(gps_module, GPS_READ_MODE_BYTE, "byte");
+    benchmark_mode(gps_module, GPS_READ_MODE_BLOCK, "block");
+
+    return 0;
+}
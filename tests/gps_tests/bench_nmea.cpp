@@ -0,0 +1,501 @@
+/*
+ * bench_nmea.cpp - Throughput and exactness of the NMEA parser
+ *
+ * Without hardware:
+ *
+ * - exactness: a generated 10 Hz log (RMC, VTG, GGA, two GSA, GSV, GLL and a UBX
+ *              NAV-PVT frame per epoch, some GSV corrupted) is parsed and every epoch
+ *              compared with the values it was generated from; the SIMD and scalar
+ *              delimiter scans must find the same delimiters on random input
+ * - parse:     NmeaParser over the whole log with the SIMD and the scalar scan, and a
+ *              strsep/strtod parser of the same sentences as the baseline
+ * - replay:    Gps::GetNmeaPvt end to end, replaying the log as a capture
+ * - receiver:  a simulated receiver with NMEA enabled; each epoch returned by
+ *              GetNmeaPvt must match the NAV-PVT of the same solution
+ *
+ * Pass a recorded NMEA log as the first argument to time the parser on it instead of
+ * the generated one (exactness is then only checked on the generated log).
+ * Build with optimization (e.g. make CXX1FLAGS="-O2 -std=c++17 -I include/") for numbers
+ * that mean anything.
+ */
+
+#include "gps.h"
+#include "i2c_sim.h"
+#include "nmea_parser.h"
+#include "../test_check.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#define BENCH_CURRENT_YEAR 2024
+#define BENCH_MIN_NANOS (200 * NANOS_PER_MILLI)     // Each measurement runs at least this long
+#define BENCH_EPOCHS 50000                           // 10 Hz: about 1.4 hours of output
+#define BENCH_EPOCH_MILLIS 100
+#define BENCH_START_UNIX_SECONDS 1717286399LL        // 2024-06-01T23:59:59Z: crosses midnight
+#define BENCH_CORRUPT_EVERY 97                       // One GSV in this many epochs is corrupted
+#define BENCH_SCAN_RUNS 100000
+#define BENCH_DEGREES_TOLERANCE 0.6e-7               // Half an NAV-PVT unit, plus rounding
+#define SIM_TIME_SCALE 50.0
+#define SIM_WAIT_SECONDS 40
+#define SIM_EPOCHS 50
+#define SIM_SENTENCES_PER_EPOCH 5                    // RMC, VTG, GGA and two GSA
+
+static volatile uint32_t sink;
+/**
+ * @brief   Repeat body until BENCH_MIN_NANOS have passed and print the throughput.
+ *
+ * @param   name        Label of the measurement.
+ * @param   bytes       Bytes processed by one call.
+ * @param   sentences   Sentences handled by one call of body.
+ * @param   body        The code to time.
+ */
+template<typename Body>
+static double measure(const char *name, double bytes, uint32_t sentences, Body body) {
+    uint64_t iterations = 0;
+    uint64_t start = EpochScheduler::NowNanos();
+    uint64_t elapsed = 0;
+    for (uint32_t batch = 1; elapsed < BENCH_MIN_NANOS; batch *= 2) {
+        for (uint32_t i = 0; i < batch; i++) {
+            body();
+        }
+        iterations += batch;
+        elapsed = EpochScheduler::NowNanos() - start;
+    }
+
+    double seconds = elapsed / 1e9;
+    double megabytesPerSecond = bytes * iterations / seconds / 1e6;
+    printf("  %-36s %8.1f ns/sentence %8.1f MB/s %6.2f M sentences/s\n", name,
+        static_cast<double>(elapsed) / (iterations * sentences), megabytesPerSecond,
+        sentences * iterations / seconds / 1e6);
+    return megabytesPerSecond;
+}
+
+/** What one generated epoch should parse to */
+typedef struct {
+    int64_t unixMillis;
+    double latitude;             // Exact value of the printed minutes
+    double longitude;
+    int32_t heightMSL;           // mm
+    int32_t height;
+    int32_t groundSpeed;         // mm/s
+    double heading;
+    uint8_t satellites;
+} Truth;
+
+static void appendSentence(std::string &log, const char *body) {
+    uint8_t checksum = NmeaParser::Checksum(body, strlen(body));
+    char sentence[NMEA_MAX_SENTENCE_LENGTH + 8];
+    snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+    log += sentence;
+}
+
+static void formatCoordinate(char *text, size_t size, long long minutes, int degreeDigits, char hemisphere) {
+    snprintf(text, size, "%0*lld%02lld.%05lld,%c", degreeDigits, minutes / 6000000, minutes / 100000 % 60,
+        minutes % 100000, hemisphere);
+}
+
+/**
+ * @brief   A receiver-like NMEA log with known values; a UBX frame and corrupted GSV
+ *          sentences in between must not disturb the parser.
+ */
+static std::string buildLog(std::vector<Truth> &truth, uint32_t &sentences, uint32_t &corrupted) {
+    std::string log;
+    sentences = 0;
+    corrupted = 0;
+    uint8_t payload[NAV_PVT_PAYLOAD_LENGTH] = {0};
+    uint8_t frame[UBX_FRAME_OVERHEAD + NAV_PVT_PAYLOAD_LENGTH];
+    uint16_t frameLength = ComposeFrame(frame, NAV_CLASS, NAV_PVT, sizeof(payload), payload);
+
+    for (uint32_t i = 0; i < BENCH_EPOCHS; i++) {
+        Truth t;
+        t.unixMillis = BENCH_START_UNIX_SECONDS * 1000 + static_cast<int64_t>(i) * BENCH_EPOCH_MILLIS;
+        // Southern and western hemisphere, 1e-5 minute steps
+        long long latMinutes = 34LL * 6000000 + 123456 + rand() % 200000;
+        long long lonMinutes = 118LL * 6000000 + 1712345 + rand() % 200000;
+        t.latitude = -(latMinutes / 1e5) / 60.0;
+        t.longitude = -(lonMinutes / 1e5) / 60.0;
+        int32_t knotsMilli = rand() % 60000;
+        int32_t headingCenti = rand() % 36000;
+        int32_t altitudeDeci = 500 + rand() % 2000;
+        t.heightMSL = altitudeDeci * 100;
+        t.height = t.heightMSL - 33400;
+        t.groundSpeed = static_cast<int32_t>(llround(knotsMilli * 1852.0 / 3600.0));
+        t.heading = headingCenti / 100.0;
+        t.satellites = 4 + rand() % 20;
+        truth.push_back(t);
+
+        time_t seconds = static_cast<time_t>(t.unixMillis / 1000);
+        struct tm calendar;
+        gmtime_r(&seconds, &calendar);
+        char time[16];
+        char date[16];
+        char lat[32];
+        char lon[32];
+        snprintf(time, sizeof(time), "%02d%02d%02d.%02d", calendar.tm_hour, calendar.tm_min, calendar.tm_sec,
+            static_cast<int>(t.unixMillis % 1000 / 10));
+        // ddmmyy as one number: any int fits the buffer, so the date is never cut
+        int dayMonthYear = calendar.tm_mday * 10000 + (calendar.tm_mon + 1) * 100 + calendar.tm_year % 100;
+        snprintf(date, sizeof(date), "%06d", dayMonthYear);
+        formatCoordinate(lat, sizeof(lat), latMinutes, 2, 'S');
+        formatCoordinate(lon, sizeof(lon), lonMinutes, 3, 'W');
+
+        char body[NMEA_MAX_SENTENCE_LENGTH];
+        snprintf(body, sizeof(body), "GNRMC,%s,A,%s,%s,%d.%03d,%d.%02d,%s,,,A", time, lat, lon,
+            knotsMilli / 1000, knotsMilli % 1000, headingCenti / 100, headingCenti % 100, date);
+        appendSentence(log, body);
+        snprintf(body, sizeof(body), "GNVTG,%d.%02d,T,,M,%d.%03d,N,%.3f,K,A", headingCenti / 100, headingCenti % 100,
+            knotsMilli / 1000, knotsMilli % 1000, knotsMilli * 1.852 / 1000.0);
+        appendSentence(log, body);
+        snprintf(body, sizeof(body), "GNGGA,%s,%s,%s,1,%02u,0.78,%d.%d,M,-33.4,M,,", time, lat, lon, t.satellites,
+            altitudeDeci / 10, altitudeDeci % 10);
+        appendSentence(log, body);
+        appendSentence(log, "GNGSA,A,3,10,23,18,15,24,13,20,,,,,,1.32,0.78,1.07");
+        appendSentence(log, "GNGSA,A,3,79,80,69,,,,,,,,,,1.32,0.78,1.07");
+        appendSentence(log, "GPGSV,3,1,11,10,63,137,17,13,34,247,31,15,49,057,24,18,67,316,30");
+        appendSentence(log, "GPGSV,3,2,11,20,29,302,26,23,17,216,33,24,72,097,28,32,05,040,");
+        appendSentence(log, "GPGSV,3,3,11,46,49,199,,48,44,189,,51,49,161,");
+        snprintf(body, sizeof(body), "GNGLL,%s,%s,%s,A,A", lat, lon, time);
+        appendSentence(log, body);
+        sentences += 9;
+        log.append(reinterpret_cast<const char *>(frame), frameLength);
+
+        if (i % BENCH_CORRUPT_EVERY == BENCH_CORRUPT_EVERY - 1) {
+            // Flip a digit of the last GSV of this epoch, like a bit error on the line
+            size_t gsv = log.rfind("$GPGSV,3,3");
+            log[gsv + 20] ^= 0x01;
+            corrupted++;
+        }
+    }
+    return log;
+}
+
+static uint32_t expectedITow(int64_t unixMillis) {
+    int64_t gpsMillis = unixMillis - 315964800000LL + NMEA_GPS_LEAP_SECONDS * 1000LL;
+    return static_cast<uint32_t>(gpsMillis % 604800000LL);
+}
+
+static bool matches(const PVTData &data, const Truth &t) {
+    time_t seconds = static_cast<time_t>(t.unixMillis / 1000);
+    struct tm calendar;
+    gmtime_r(&seconds, &calendar);
+    return data.year == calendar.tm_year + 1900 && data.month == calendar.tm_mon + 1 && data.day == calendar.tm_mday
+        && data.hour == calendar.tm_hour && data.min == calendar.tm_min && data.sec == calendar.tm_sec
+        && data.nano == t.unixMillis % 1000 * 1000000 && data.iTOW == expectedITow(t.unixMillis)
+        && fabs(data.latitude - t.latitude) <= BENCH_DEGREES_TOLERANCE
+        && fabs(data.longitude - t.longitude) <= BENCH_DEGREES_TOLERANCE
+        && data.heightMSL == t.heightMSL && data.height == t.height
+        && abs(data.groundSpeed - t.groundSpeed) <= 1 && fabs(data.motionHeading - t.heading) < 1e-9
+        && data.numberOfSatellites == t.satellites && data.gnssFix == THREE_D_FIX
+        && (data.fixStatusFlags & NAV_PVT_FLAGS_GNSS_FIX_OK) && data.validDateFlag && data.validTimeFlag;
+}
+
+/**
+ * @brief   Parse the log in chunks of chunkLength and collect the epochs.
+ */
+static std::vector<PVTData> parseAll(NmeaParser &parser, const std::string &log, size_t chunkLength) {
+    std::vector<PVTData> epochs;
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(log.data());
+    for (size_t chunk = 0; chunk < log.size(); chunk += chunkLength) {
+        size_t length = log.size() - chunk < chunkLength ? log.size() - chunk : chunkLength;
+        size_t offset = 0;
+        while (true) {
+            offset += parser.Consume(&data[chunk + offset], length - offset);
+            if (!parser.EpochReady()) {
+                break;
+            }
+            epochs.push_back(parser.Epoch());
+        }
+    }
+    parser.Flush();
+    if (parser.EpochReady()) {
+        epochs.push_back(parser.Epoch());
+    }
+    return epochs;
+}
+
+static void checkExactness(const std::string &log, const std::vector<Truth> &truth, uint32_t corrupted) {
+    // Odd chunk sizes split sentences everywhere
+    const size_t chunks[] = {1, 7, 1024, log.size()};
+    for (size_t chunk : chunks) {
+        NmeaParser parser;
+        std::vector<PVTData> epochs = parseAll(parser, log, chunk);
+        uint32_t mismatches = 0;
+        for (size_t i = 0; i < epochs.size() && i < truth.size(); i++) {
+            if (!matches(epochs[i], truth[i])) {
+                mismatches++;
+            }
+        }
+        NmeaParserStats stats = parser.GetStats();
+        printf("Chunks of %zu bytes: %zu epochs, %u mismatches, %u checksum failures, %u malformed, %u truncated\n",
+            chunk, epochs.size(), mismatches, stats.checksumFailures, stats.malformed, stats.truncated);
+        char description[96];
+        snprintf(description, sizeof(description), "every epoch parsed exactly (chunks of %zu bytes)", chunk);
+        check(epochs.size() == truth.size() && mismatches == 0 && stats.malformed == 0, description);
+        snprintf(description, sizeof(description), "corrupted sentences rejected (chunks of %zu bytes)", chunk);
+        check(stats.checksumFailures == corrupted, description);
+    }
+}
+
+// The SIMD and scalar scans must agree on every delimiter position
+static void checkScan(void) {
+    char text[NMEA_MAX_SENTENCE_LENGTH + NMEA_SCAN_BLOCK_LENGTH];
+    const char alphabet[] = "0123456789.,$*\nGNRMC";
+    uint32_t mismatches = 0;
+    for (uint32_t run = 0; run < BENCH_SCAN_RUNS; run++) {
+        uint16_t length = rand() % NMEA_MAX_SENTENCE_LENGTH;
+        uint16_t offset = rand() % NMEA_SCAN_BLOCK_LENGTH;
+        for (uint16_t i = 0; i < length; i++) {
+            text[offset + i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        }
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&text[offset]);
+        uint16_t simdStarts[NMEA_MAX_FIELDS + 1];
+        uint16_t scalarStarts[NMEA_MAX_FIELDS + 1];
+
+        NmeaParser::SetScanMode(NMEA_SCAN_SIMD);
+        size_t simdFind = NmeaParser::FindEither(bytes, length, NMEA_END_CHAR, NMEA_START_CHAR);
+        uint8_t simdCount = NmeaParser::SplitFields(&text[offset], length, simdStarts, NMEA_MAX_FIELDS);
+        NmeaParser::SetScanMode(NMEA_SCAN_SCALAR);
+        size_t scalarFind = NmeaParser::FindEither(bytes, length, NMEA_END_CHAR, NMEA_START_CHAR);
+        uint8_t scalarCount = NmeaParser::SplitFields(&text[offset], length, scalarStarts, NMEA_MAX_FIELDS);
+        if (simdFind != scalarFind || simdCount != scalarCount
+            || memcmp(simdStarts, scalarStarts, (simdCount + 1) * sizeof(uint16_t)) != 0) {
+            mismatches++;
+        }
+    }
+    NmeaParser::SetScanMode(NMEA_SCAN_SIMD);
+    printf("Delimiter scan: %u random runs, %u mismatches\n", BENCH_SCAN_RUNS, mismatches);
+    check(mismatches == 0, "SIMD and scalar scans find the same delimiters");
+}
+
+/**
+ * @brief   The obvious parser: memchr for lines, strtol for the checksum, strsep and
+ *          strtod for the fields. Same sentences and outputs as NmeaParser, no epochs.
+ */
+static uint32_t parseBaseline(const std::string &log) {
+    uint32_t parsed = 0;
+    char line[NMEA_MAX_SENTENCE_LENGTH + 8];
+    const char *text = log.c_str();
+    const char *end = text + log.size();
+    while (text < end) {
+        const char *start = static_cast<const char *>(memchr(text, '$', end - text));
+        if (start == nullptr) {
+            break;
+        }
+        const char *newline = static_cast<const char *>(memchr(start, '\n', end - start));
+        if (newline == nullptr) {
+            break;
+        }
+        text = newline + 1;
+        size_t length = newline - start - 1;
+        if (length >= sizeof(line)) {
+            continue;
+        }
+        memcpy(line, start + 1, length);
+        line[length] = '\0';
+        char *star = strchr(line, '*');
+        if (star == nullptr) {
+            continue;
+        }
+        *star = '\0';
+        if (NmeaParser::Checksum(line, star - line) != strtol(star + 1, nullptr, 16)) {
+            continue;
+        }
+
+        char *fields[NMEA_MAX_FIELDS];
+        int count = 0;
+        // strtok_r skips empty fields, so split with strsep instead
+        char *cursor = line;
+        while (cursor != nullptr && count < NMEA_MAX_FIELDS) {
+            fields[count++] = strsep(&cursor, ",");
+        }
+        const char *type = &fields[0][2];
+        PVTData data;
+        if (strcmp(type, "RMC") == 0 && count >= 10) {
+            double lat = strtod(fields[3], nullptr);
+            double lon = strtod(fields[5], nullptr);
+            data.latitude = static_cast<int>(lat / 100) + fmod(lat, 100.0) / 60.0;
+            data.longitude = static_cast<int>(lon / 100) + fmod(lon, 100.0) / 60.0;
+            data.groundSpeed = static_cast<int32_t>(strtod(fields[7], nullptr) * 514.444);
+            data.motionHeading = strtod(fields[8], nullptr);
+            sink += data.groundSpeed;
+        } else if (strcmp(type, "GGA") == 0 && count >= 12) {
+            double lat = strtod(fields[2], nullptr);
+            data.latitude = static_cast<int>(lat / 100) + fmod(lat, 100.0) / 60.0;
+            data.numberOfSatellites = atoi(fields[7]);
+            data.heightMSL = static_cast<int32_t>(strtod(fields[9], nullptr) * 1000);
+            sink += data.heightMSL;
+        } else if (strcmp(type, "VTG") == 0 && count >= 9) {
+            sink += static_cast<uint32_t>(strtod(fields[5], nullptr));
+        } else if (strcmp(type, "GSA") == 0 && count >= 3) {
+            sink += atoi(fields[2]);
+        }
+        parsed++;
+    }
+    return parsed;
+}
+
+static void benchParse(const std::string &log, uint32_t sentences) {
+    printf("Parse %.1f MB, %u sentences\n", log.size() / 1e6, sentences);
+    NmeaParser parser;
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(log.data());
+    const uint8_t modes[] = {NMEA_SCAN_SIMD, NMEA_SCAN_SCALAR};
+    double simd = 0;
+    double scalar = 0;
+    for (uint8_t mode : modes) {
+        NmeaParser::SetScanMode(mode);
+        double rate = measure(mode == NMEA_SCAN_SIMD ? "NmeaParser, SIMD scan" : "NmeaParser, scalar scan",
+            log.size(), sentences, [&]() {
+            size_t offset = 0;
+            while (offset < log.size()) {
+                offset += parser.Consume(&data[offset], log.size() - offset);
+                if (parser.EpochReady()) {
+                    sink += parser.Epoch().iTOW;
+                }
+            }
+        });
+        (mode == NMEA_SCAN_SIMD ? simd : scalar) = rate;
+    }
+    NmeaParser::SetScanMode(NMEA_SCAN_SIMD);
+    double baseline = measure("strsep/strtod baseline", log.size(), sentences, [&]() {
+        sink += parseBaseline(log);
+    });
+    printf("  SIMD scan %.2fx the scalar scan, %.2fx the baseline\n", simd / scalar, simd / baseline);
+}
+
+// Replay the log through the whole driver: read, frame, dispatch, parse
+static void benchReplay(const std::string &log, uint32_t expectedEpochs) {
+    char path[] = "/tmp/bench_nmea_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("Failed to create temporary capture");
+        return;
+    }
+    close(fd);
+
+    UbxCaptureWriter writer;
+    writer.Open(path);
+    const size_t recordLength = 4096;
+    for (size_t offset = 0; offset < log.size(); offset += recordLength) {
+        size_t length = log.size() - offset < recordLength ? log.size() - offset : recordLength;
+        writer.Write(CAPTURE_RECORD_RX, offset * 1000, reinterpret_cast<const uint8_t *>(&log[offset]), length);
+    }
+    writer.Close();
+
+    UbxCaptureReader reader;
+    if (reader.Open(path, CAPTURE_REPLAY_FAST)) {
+        Gps gps(BENCH_CURRENT_YEAR, reader);
+        gps.EnableNmea();
+        uint32_t epochs = 0;
+        uint64_t start = EpochScheduler::NowNanos();
+        while (gps.GetNmeaPvt(0).newFix) {
+            epochs++;
+        }
+        uint64_t elapsed = EpochScheduler::NowNanos() - start;
+        printf("Replay\n  %-36s %8.1f ns/epoch %10.1f MB/s   (%u of %u epochs)\n", "GetNmeaPvt replay",
+            static_cast<double>(elapsed) / epochs, log.size() / (elapsed / 1e9) / 1e6, epochs, expectedEpochs);
+        check(epochs == expectedEpochs && gps.GetNmeaOverruns() == 0, "GetNmeaPvt returns every epoch of the capture");
+    }
+    unlink(path);
+}
+
+// NAV-PVT of the simulated receiver by iTOW, collected from the dispatcher
+static void onNavPvt(const UbxMessageView &msg, void *context) {
+    std::map<uint32_t, PVTData> *fixes = static_cast<std::map<uint32_t, PVTData> *>(context);
+    NavPvtView pvt(msg);
+    if (pvt.IsValid()) {
+        PVTData data;
+        Gps::DecodePvtFields(pvt, data);
+        (*fixes)[data.iTOW] = data;
+    }
+}
+
+static void checkReceiver(void) {
+    printf("Simulated receiver\n");
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    config.timeScale = SIM_TIME_SCALE;
+    I2cSim::Configure(config);
+
+    Gps gps(BENCH_CURRENT_YEAR);
+    std::map<uint32_t, PVTData> fixes;
+    check(gps.EnableNmea(), "NMEA output enabled next to UBX");
+    gps.RegisterHandler(NAV_CLASS, NAV_PVT, onNavPvt, &fixes);
+
+    // An epoch completes as its bytes are read, before the NAV-PVT read with it is
+    // dispatched, so the two are matched once the run is over
+    std::vector<PVTData> epochs;
+    double end = I2cSim::NowNanos() / 1e9 + SIM_WAIT_SECONDS;
+    while (epochs.size() < SIM_EPOCHS && I2cSim::NowNanos() / 1e9 < end) {
+        PVTData data = gps.GetNmeaPvt(DEFAULT_TIMEOUT_MILLS);
+        if (data.newFix && data.gnssFix == THREE_D_FIX) {
+            epochs.push_back(data);
+        }
+    }
+    gps.GetNmeaPvt(DEFAULT_TIMEOUT_MILLS);
+
+    uint32_t matched = 0;
+    for (const PVTData &data : epochs) {
+        std::map<uint32_t, PVTData>::const_iterator fix = fixes.find(data.iTOW);
+        if (fix != fixes.end() && fix->second.hour == data.hour && fix->second.sec == data.sec
+            && fabs(fix->second.latitude - data.latitude) < 2e-7 && fabs(fix->second.longitude - data.longitude) < 2e-7
+            && abs(fix->second.heightMSL - data.heightMSL) <= 50 && abs(fix->second.groundSpeed - data.groundSpeed) <= 1
+            && abs(fix->second.velocityNorth - data.velocityNorth) <= 2 && abs(fix->second.velocityEast - data.velocityEast) <= 2) {
+            matched++;
+        }
+    }
+    printf("  %zu NMEA epochs with a fix, %u matching the NAV-PVT of the same iTOW\n", epochs.size(), matched);
+    check(epochs.size() == SIM_EPOCHS && matched == epochs.size(), "NMEA epochs match NAV-PVT");
+
+    // '$' bytes inside UBX frames start false sentences that fail the checksum; every real one parses
+    NmeaParserStats stats = gps.GetNmeaParser()->GetStats();
+    uint32_t sent = I2cSim::GetGpsStats().sentencesOut;
+    printf("  %u sentences sent, %u parsed, %u malformed, %u false starts in UBX frames\n", sent, stats.sentences,
+        stats.malformed, stats.checksumFailures + stats.truncated);
+    check(stats.sentences <= sent && sent - stats.sentences <= 2 * SIM_SENTENCES_PER_EPOCH && stats.malformed == 0,
+        "every receiver sentence read is parsed");
+    check(gps.EnableNmea(false), "NMEA output disabled again");
+}
+
+static std::string readFile(const char *path) {
+    std::string contents;
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        perror("Failed to open NMEA log");
+        return contents;
+    }
+    char buffer[65536];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        contents.append(buffer, length);
+    }
+    fclose(file);
+    return contents;
+}
+
+int main(int argc, char **argv) {
+    srand(1);
+    std::vector<Truth> truth;
+    uint32_t sentences;
+    uint32_t corrupted;
+    std::string log = buildLog(truth, sentences, corrupted);
+    checkScan();
+    checkExactness(log, truth, corrupted);
+
+    if (argc > 1) {
+        std::string recorded = readFile(argv[1]);
+        NmeaParser parser;
+        parseAll(parser, recorded, recorded.size());
+        benchParse(recorded, parser.GetStats().sentences + parser.GetStats().checksumFailures);
+    } else {
+        benchParse(log, sentences);
+    }
+    benchReplay(log, BENCH_EPOCHS);
+    checkReceiver();
+
+    return checkSummary();
+}
@@ -0,0 +1,208 @@
+/*
+ * bench_poll_push.cpp - Poll vs. push NAV-PVT delivery on the simulated receiver
+ *
+ * Runs the unmodified Gps driver against the SAM-M8Q simulator (see i2c_sim.h), so
+ * no hardware is needed, with three read strategies:
+ *
+ * - poll:      a NAV-PVT poll is written before every read while the periodic output
+ *              configured by the Gps constructor is still running (GetPvt(true, ...))
+ * - poll-only: the same with the periodic output disabled (EnableMessage rate 0)
+ * - push:      no writes; reads are scheduled by EpochScheduler on the periodic output
+ *              and repeated epochs are dropped (GetPvt(false, ...))
+ *
+ * The simulated receiver makes each solution readable outputLatencyNanos after its
+ * epoch and answers a poll with the latest solution, which may be an epoch that was
+ * already delivered. With polling the consumer calls once per period, half a period
+ * after a solution became readable, like a control loop running at the navigation
+ * rate at a phase unrelated to the receiver's; with push it
+ * reads back to back like the acquisition thread. Push runs first, as the polled runs
+ * leave the scheduler's latency estimate at the polling phase. For each strategy the
+ * benchmark reports the receiver's bus traffic and utilization, how many new and
+ * repeated epochs the driver saw (GetFixStats), and how old each new fix was when
+ * GetPvt returned it.
+ *
+ * The clock runs only TIME_SCALE times faster than real time: every oversleep of the
+ * host is scaled with it and would show up as fix age. A poll the host wakes up more
+ * than half a period late misses an epoch; the checks allow one for each.
+ */
+
+#include "gps.h"
+#include "i2c_sim.h"
+#include "../test_check.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+
+#define TIME_SCALE 2.0
+#define SIM_YEAR 2024
+#define BENCH_SECONDS 5              // Virtual seconds per strategy
+#define FIX_WAIT_SECONDS 10
+#define SIM_TTFF_SECONDS 1
+
+#define STRATEGY_POLL 0
+#define STRATEGY_POLL_ONLY 1
+#define STRATEGY_PUSH 2
+
+typedef struct {
+    uint64_t busNanos;           // Time the bus was busy with the receiver
+    uint64_t busBytes;           // Bytes read and written, addressing excluded
+    uint32_t framesWritten;      // UBX frames written to the receiver
+    uint32_t transactions;
+    uint32_t fixes;              // New epochs handed to the consumer
+    uint32_t duplicates;         // Repeated epochs seen (returned with polling, dropped with push)
+    uint64_t ageSumNanos;        // Epoch to delivery, summed over new fixes
+    uint64_t ageMaxNanos;
+    uint32_t lost;               // Receiver output lost to a full buffer
+    uint32_t lateCalls;          // Polls that started after the next solution was readable
+} BenchResult;
+
+static uint64_t powerOnNanos;    // Virtual time the receiver started, at its startUtcSeconds
+static uint64_t startGpsNanos;   // GPS time at powerOnNanos
+
+/**
+ * @brief   Virtual time at which the receiver computed the solution of an epoch.
+ */
+static uint64_t epochHostNanos(uint32_t iTow) {
+    uint64_t weekNanos = SIM_GPS_WEEK_MILLIS * NANOS_PER_MILLI;
+    return powerOnNanos + (static_cast<uint64_t>(iTow) * NANOS_PER_MILLI + weekNanos - startGpsNanos % weekNanos) % weekNanos;
+}
+
+/**
+ * @brief   Virtual time of the first epoch after nanos; epochs are whole periods of GPS time.
+ */
+static uint64_t nextEpochNanos(uint64_t nanos, uint64_t periodNanos) {
+    uint64_t gps = startGpsNanos + (nanos - powerOnNanos);
+    return nanos + periodNanos - gps % periodNanos;
+}
+
+static void sleepUntil(uint64_t nanos) {
+    uint64_t now = I2cSim::NowNanos();
+    if (nanos > now) {
+        usleep(static_cast<useconds_t>((nanos - now) / 1000));
+    }
+}
+
+/**
+ * @brief   Run one strategy for BENCH_SECONDS of virtual time.
+ */
+static BenchResult run(Gps &gps, uint8_t strategy, uint16_t periodMillis, uint32_t latencyNanos) {
+    bool polling = strategy != STRATEGY_PUSH;
+    if (strategy == STRATEGY_POLL_ONLY) {
+        gps.EnableMessage(NAV_CLASS, NAV_PVT, 0);
+    }
+    gps.GetPvt(polling, periodMillis);
+
+    BenchResult result = {};
+    SimSamM8qStats receiverBefore = I2cSim::GetGpsStats();
+    I2cSim::ResetStats();
+    gps.ResetFixStats();
+    uint64_t periodNanos = periodMillis * NANOS_PER_MILLI;
+    uint64_t start = I2cSim::NowNanos();
+    uint64_t end = start + BENCH_SECONDS * NANOS_PER_SECOND;
+    uint64_t phase = nextEpochNanos(start, periodNanos) + latencyNanos + periodNanos / 2;
+
+    for (uint64_t call = 0; I2cSim::NowNanos() < end; call++) {
+        if (polling) {
+            // A poll woken past the next solution skips an epoch, and the next one repeats it
+            uint64_t slot = phase + call * periodNanos;
+            sleepUntil(slot);
+            result.lateCalls += I2cSim::NowNanos() > slot + periodNanos / 2 ? 1 : 0;
+        }
+        PVTData data = gps.GetPvt(polling, polling ? periodMillis : ACQUISITION_WAIT_MILLS);
+        if (data.newFix) {
+            uint64_t age = I2cSim::NowNanos() - epochHostNanos(data.iTOW);
+            result.ageSumNanos += age;
+            result.ageMaxNanos = std::max(result.ageMaxNanos, age);
+        }
+    }
+
+    I2cSimStats bus = I2cSim::GetStats();
+    GpsFixStats fixes = gps.GetFixStats();
+    result.busNanos = bus.gps.busyNanos;
+    result.busBytes = bus.gps.bytesRead + bus.gps.bytesWritten;
+    result.framesWritten = I2cSim::GetGpsStats().framesIn - receiverBefore.framesIn;
+    result.transactions = bus.gps.transactions;
+    result.fixes = fixes.fixes;
+    result.duplicates = fixes.duplicates;
+    result.lost = I2cSim::GetGpsStats().messagesDropped - receiverBefore.messagesDropped;
+
+    if (strategy == STRATEGY_POLL_ONLY) {
+        gps.EnableMessage(NAV_CLASS, NAV_PVT, 1);
+    }
+    // Read away the epochs polling left queued, so the next configuration is answered
+    uint64_t drainEnd = I2cSim::NowNanos() + FIX_WAIT_SECONDS * NANOS_PER_SECOND;
+    while (strategy == STRATEGY_POLL && I2cSim::NowNanos() < drainEnd) {
+        PVTData data = gps.GetPvt(false, ACQUISITION_WAIT_MILLS);
+        if (data.newFix && I2cSim::NowNanos() - epochHostNanos(data.iTOW) < periodNanos) {
+            break;
+        }
+    }
+    return result;
+}
+
+static void report(const char *name, const BenchResult &result) {
+    double seconds = BENCH_SECONDS;
+    double fixes = result.fixes > 0 ? result.fixes : 1;
+    printf("%-10s %8.0f %8.2f %8.1f %6u %6u %6u %9.1f %9.1f\n", name,
+        result.busBytes / seconds,
+        100.0 * result.busNanos / (seconds * NANOS_PER_SECOND),
+        result.transactions / seconds,
+        result.fixes, result.duplicates, result.lost,
+        result.ageSumNanos / fixes / NANOS_PER_MILLI,
+        static_cast<double>(result.ageMaxNanos) / NANOS_PER_MILLI);
+    if (result.lateCalls > 0) {
+        printf("  %u polls woke up more than half a period late\n", result.lateCalls);
+    }
+}
+
+int main(void) {
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    config.timeScale = TIME_SCALE;
+    I2cSim::Configure(config);
+    SimSamM8qConfig receiver = SIM_SAM_M8Q_DEFAULT_CONFIG;
+    receiver.ttffColdSeconds = SIM_TTFF_SECONDS;
+    powerOnNanos = I2cSim::NowNanos();
+    I2cSim::ConfigureGps(receiver);
+    startGpsNanos = static_cast<uint64_t>(receiver.startUtcSeconds - SIM_GPS_EPOCH_UNIX_SECONDS + SIM_GPS_LEAP_SECONDS) *
+        NANOS_PER_SECOND;
+
+    Gps gps(SIM_YEAR);
+    uint64_t fixDeadline = I2cSim::NowNanos() + FIX_WAIT_SECONDS * NANOS_PER_SECOND;
+    PVTData data = {};
+    while (data.gnssFix != THREE_D_FIX && I2cSim::NowNanos() < fixDeadline) {
+        data = gps.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+    }
+    check(data.gnssFix == THREE_D_FIX, "the simulated receiver has a fix");
+
+    // 56 ms (about 18 Hz) needs a single major GNSS
+    const GpsNavigationConfig navigations[] = {
+        DEFAULT_NAVIGATION_CONFIG,
+        {MEASUREMENT_PERIOD_MILLIS_56_MS, 1, TIME_REF_UTC, GNSS_MASK_GPS}
+    };
+    for (const GpsNavigationConfig &navigation : navigations) {
+        uint16_t period = navigation.measurementPeriodMillis;
+        check(gps.SetNavigationConfig(navigation), "the navigation period is set");
+        printf("\nNavigation period %u ms, %d s simulated, %u ms output latency\n",
+            period, BENCH_SECONDS, receiver.outputLatencyNanos / static_cast<unsigned>(NANOS_PER_MILLI));
+        printf("%-10s %8s %8s %8s %6s %6s %6s %9s %9s\n", "strategy", "bytes/s", "bus %", "xfers/s",
+            "fixes", "dups", "lost", "age ms", "max ms");
+        BenchResult push = run(gps, STRATEGY_PUSH, period, receiver.outputLatencyNanos);
+        report("push", push);
+        BenchResult pollOnly = run(gps, STRATEGY_POLL_ONLY, period, receiver.outputLatencyNanos);
+        report("poll-only", pollOnly);
+        BenchResult poll = run(gps, STRATEGY_POLL, period, receiver.outputLatencyNanos);
+        report("poll", poll);
+
+        uint32_t epochs = BENCH_SECONDS * 1000 / period;
+        check(push.fixes >= epochs - 1 && push.duplicates == 0 && push.lost == 0, "push delivers every epoch once");
+        check(push.framesWritten == 0 && pollOnly.framesWritten >= pollOnly.fixes, "push writes no UBX frames to the receiver");
+        check(pollOnly.fixes + pollOnly.lateCalls >= epochs - 1 && pollOnly.lost == 0,
+            "poll-only gets a new epoch every period it polls on time");
+        check(push.ageSumNanos / (push.fixes ? push.fixes : 1) < pollOnly.ageSumNanos / (pollOnly.fixes ? pollOnly.fixes : 1),
+            "push hands fixes over younger than polling");
+        check(poll.lost > 0 && poll.ageMaxNanos > NANOS_PER_SECOND,
+            "polling on top of the periodic output falls behind the queued epochs");
+    }
+
+    return checkSummary();
+}
@@ -0,0 +1,256 @@
+/*
+ * bench_ubx_codec.cpp - Microbenchmarks of the UBX encode/decode path
+ *
+ * Times, without hardware, every step a message takes through the driver:
+ *
+ * - checksum:  UpdateChecksum with the scalar and the blocked Fletcher implementation,
+ *              after checking that both give identical sums on random input
+ * - compose:   ComposeMessage, ComposeFrame and ComputeChecksum of a NAV-PVT
+ * - string:    UbxMessageToString of a NAV-PVT
+ * - framing:   UbxFramer over a stream of NAV-PVT and NAV-STATUS frames
+ * - decode:    Gps::DecodePvtFields of a framed NAV-PVT
+ * - GetPvt:    Gps::GetPvt end to end, replaying a capture as fast as possible
+ *
+ * Each line reports ns per message (or per call) and the bytes per second that implies.
+ * Build with optimization (e.g. make CXX1FLAGS="-O2 -std=c++17 -I include/") for numbers
+ * that mean anything.
+ */
+
+#include "gps.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_CURRENT_YEAR 2024
+#define BENCH_MIN_NANOS (200 * NANOS_PER_MILLI)     // Each measurement runs at least this long
+#define BENCH_STREAM_FRAMES 20000                    // NAV-PVT frames in the framing stream
+#define BENCH_EXACTNESS_RUNS 100000
+#define BENCH_EXACTNESS_MAX_LENGTH (MAX_MESSAGE_LENGTH + 4)
+
+static volatile uint32_t sink;
+
+/**
+ * @brief   Repeat body until BENCH_MIN_NANOS have passed and print ns per call.
+ *
+ * @param   name    Label of the measurement.
+ * @param   bytes   Bytes processed by one call, for the throughput column.
+ * @param   calls   Messages handled by one call of body.
+ * @param   body    The code to time.
+ */
+template<typename Body>
+static double measure(const char *name, double bytes, uint32_t calls, Body body) {
+    uint64_t iterations = 0;
+    uint64_t start = EpochScheduler::NowNanos();
+    uint64_t elapsed = 0;
+    for (uint32_t batch = 1; elapsed < BENCH_MIN_NANOS; batch *= 2) {
+        for (uint32_t i = 0; i < batch; i++) {
+            body();
+        }
+        iterations += batch;
+        elapsed = EpochScheduler::NowNanos() - start;
+    }
+
+    double nanosPerMessage = static_cast<double>(elapsed) / (iterations * calls);
+    double megabytesPerSecond = bytes * iterations / (elapsed / 1e9) / 1e6;
+    printf("  %-36s %10.1f ns/msg %10.1f MB/s\n", name, nanosPerMessage, megabytesPerSecond);
+    return nanosPerMessage;
+}
+
+// A NAV-PVT payload with plausible values in every field
+static void fillNavPvt(uint8_t *payload, uint32_t iTow) {
+    memset(payload, 0, NAV_PVT_PAYLOAD_LENGTH);
+    NavPvt::ITow::Put(payload, iTow);
+    NavPvt::Year::Put(payload, BENCH_CURRENT_YEAR);
+    NavPvt::Month::Put(payload, 6);
+    NavPvt::Day::Put(payload, 15);
+    NavPvt::Valid::Put(payload, VALID_DATE_FLAG | VALID_TIME_FLAG | FULLY_RESOLVED_FLAG);
+    NavPvt::FixType::Put(payload, THREE_D_FIX);
+    NavPvt::Flags::Put(payload, NAV_PVT_FLAGS_GNSS_FIX_OK);
+    NavPvt::NumSv::Put(payload, 14);
+    NavPvt::Lon::Put(payload, 76868565);       // 1e-7 degrees
+    NavPvt::Lat::Put(payload, 450702388);
+    NavPvt::Height::Put(payload, 283000);
+    NavPvt::HAcc::Put(payload, 1500);
+    NavPvt::VelN::Put(payload, 12345);
+    NavPvt::VelE::Put(payload, -2345);
+}
+
+// Scalar and blocked Fletcher must agree for every length, alignment and starting sum
+static bool checkExactness(void) {
+    std::vector<uint8_t> data(BENCH_EXACTNESS_MAX_LENGTH + UBX_CHECKSUM_BLOCK_LENGTH);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = rand();
+    }
+
+    uint32_t mismatches = 0;
+    for (uint32_t run = 0; run < BENCH_EXACTNESS_RUNS; run++) {
+        uint16_t length = rand() % (BENCH_EXACTNESS_MAX_LENGTH + 1);
+        uint16_t offset = rand() % UBX_CHECKSUM_BLOCK_LENGTH;
+        uint8_t scalarA = rand();
+        uint8_t scalarB = rand();
+        uint8_t blockedA = scalarA;
+        uint8_t blockedB = scalarB;
+        UpdateChecksumScalar(&data[offset], length, scalarA, scalarB);
+        UpdateChecksumBlocked(&data[offset], length, blockedA, blockedB);
+        if (scalarA != blockedA || scalarB != blockedB) {
+            mismatches++;
+        }
+        data[rand() % data.size()] = rand();
+    }
+    printf("Fletcher bit-exactness: %u random runs, %u mismatches\n", BENCH_EXACTNESS_RUNS, mismatches);
+    return mismatches == 0;
+}
+
+static void benchChecksum(void) {
+    const uint16_t lengths[] = {4, 16, NAV_PVT_PAYLOAD_LENGTH + 4, MAX_MESSAGE_LENGTH + 4};
+    uint8_t data[MAX_MESSAGE_LENGTH + 4];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = rand();
+    }
+
+    printf("Checksum (selected at startup: %s)\n",
+        GetChecksumImplementation() == UBX_CHECKSUM_BLOCKED ? "blocked" : "scalar");
+    for (uint16_t length : lengths) {
+        char name[64];
+        snprintf(name, sizeof(name), "scalar  %4u bytes", length);
+        measure(name, length, 1, [&]() {
+            uint8_t a = 0, b = 0;
+            UpdateChecksumScalar(data, length, a, b);
+            sink += b;
+        });
+        snprintf(name, sizeof(name), "blocked %4u bytes", length);
+        measure(name, length, 1, [&]() {
+            uint8_t a = 0, b = 0;
+            UpdateChecksumBlocked(data, length, a, b);
+            sink += b;
+        });
+    }
+}
+
+static void benchCompose(void) {
+    uint8_t payload[NAV_PVT_PAYLOAD_LENGTH];
+    uint8_t frame[UBX_FRAME_OVERHEAD + NAV_PVT_PAYLOAD_LENGTH];
+    fillNavPvt(payload, 0);
+    const double frameLength = sizeof(frame);
+
+    printf("Compose\n");
+    measure("ComposeMessage NAV-PVT", frameLength, 1, [&]() {
+        UbxMessage message = ComposeMessage(NAV_CLASS, NAV_PVT, sizeof(payload), payload);
+        sink += message.checksumB;
+    });
+    measure("ComposeFrame NAV-PVT", frameLength, 1, [&]() {
+        sink += ComposeFrame(frame, NAV_CLASS, NAV_PVT, sizeof(payload), payload);
+    });
+
+    UbxMessage message = ComposeMessage(NAV_CLASS, NAV_PVT, sizeof(payload), payload);
+    measure("ComputeChecksum NAV-PVT", frameLength, 1, [&]() {
+        ComputeChecksum(message);
+        sink += message.checksumB;
+    });
+    measure("UbxMessageToString NAV-PVT", frameLength, 1, [&]() {
+        sink += UbxMessageToString(message).size();
+    });
+}
+
+// NAV-PVT frames, each followed by a NAV-STATUS, as the receiver streams them
+static std::vector<uint8_t> buildStream(uint32_t &navPvtFrames) {
+    std::vector<uint8_t> stream;
+    uint8_t payload[NAV_PVT_PAYLOAD_LENGTH];
+    uint8_t status[NAV_STATUS_PAYLOAD_LENGTH] = {0};
+    uint8_t frame[UBX_MAX_FRAME_LENGTH];
+    for (uint32_t i = 0; i < BENCH_STREAM_FRAMES; i++) {
+        fillNavPvt(payload, i * 100);
+        uint16_t length = ComposeFrame(frame, NAV_CLASS, NAV_PVT, sizeof(payload), payload);
+        stream.insert(stream.end(), frame, frame + length);
+        length = ComposeFrame(frame, NAV_CLASS, NAV_STATUS, sizeof(status), status);
+        stream.insert(stream.end(), frame, frame + length);
+    }
+    navPvtFrames = BENCH_STREAM_FRAMES;
+    return stream;
+}
+
+static void benchFraming(const std::vector<uint8_t> &stream) {
+    printf("Framing and decode\n");
+    UbxFramer framer;
+    measure("UbxFramer stream (per frame)", stream.size(), 2 * BENCH_STREAM_FRAMES, [&]() {
+        const uint8_t *data = stream.data();
+        size_t remaining = stream.size();
+        while (remaining > 0) {
+            size_t used = framer.Consume(data, remaining);
+            data += used;
+            remaining -= used;
+            if (framer.FrameReady()) {
+                sink += framer.FrameLength();
+            }
+        }
+    });
+
+    uint8_t payload[NAV_PVT_PAYLOAD_LENGTH];
+    uint8_t frame[UBX_FRAME_OVERHEAD + NAV_PVT_PAYLOAD_LENGTH];
+    fillNavPvt(payload, 0);
+    ComposeFrame(frame, NAV_CLASS, NAV_PVT, sizeof(payload), payload);
+    NavPvtView view((UbxMessageView(frame)));
+    PVTData data;
+    measure("DecodePvtFields NAV-PVT", sizeof(frame), 1, [&]() {
+        Gps::DecodePvtFields(view, data);
+        sink += data.iTOW;
+    });
+}
+
+// Replay the stream through the whole driver: read, frame, dispatch, decode.
+// Returns false if no NAV-PVT fix came out of the replay.
+static bool benchGetPvt(const std::vector<uint8_t> &stream, uint32_t navPvtFrames) {
+    char path[] = "/tmp/bench_ubx_codec_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("Failed to create temporary capture");
+        return false;
+    }
+    close(fd);
+
+    UbxCaptureWriter writer;
+    writer.Open(path);
+    const size_t recordLength = 4096;    // About one DDC read worth of bytes
+    for (size_t offset = 0; offset < stream.size(); offset += recordLength) {
+        size_t length = stream.size() - offset < recordLength ? stream.size() - offset : recordLength;
+        writer.Write(CAPTURE_RECORD_RX, offset * 1000, &stream[offset], length);
+    }
+    writer.Close();
+
+    uint32_t fixes = 0;
+    UbxCaptureReader reader;
+    if (reader.Open(path, CAPTURE_REPLAY_FAST)) {
+        Gps gps(BENCH_CURRENT_YEAR, reader);
+        uint64_t start = EpochScheduler::NowNanos();
+        while (gps.GetPvt(false, 0).newFix) {
+            fixes++;
+        }
+        uint64_t elapsed = EpochScheduler::NowNanos() - start;
+        if (fixes > 0) {
+            printf("  %-36s %10.1f ns/msg %10.1f MB/s   (%u of %u fixes)\n", "GetPvt replay NAV-PVT",
+                static_cast<double>(elapsed) / fixes, stream.size() / (elapsed / 1e9) / 1e6, fixes, navPvtFrames);
+        }
+    }
+    unlink(path);
+    if (fixes == 0) {
+        fprintf(stderr, "GetPvt replay returned no NAV-PVT fix\n");
+        return false;
+    }
+    return true;
+}
+
+int main(void) {
+    srand(1);
+    bool exact = checkExactness();
+    benchChecksum();
+    benchCompose();
+
+    uint32_t navPvtFrames;
+    std::vector<uint8_t> stream = buildStream(navPvtFrames);
+    benchFraming(stream);
+    bool replayed = benchGetPvt(stream, navPvtFrames);
+
+    return exact && replayed ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+#include "ubx_batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double decodeSeconds(UbxBatchDecoder &decoder, PvtColumns &columns, uint32_t threads) {
+    uint64_t start = EpochScheduler::NowNanos();
+    decoder.Decode(columns, threads);
+    return (EpochScheduler::NowNanos() - start) / 1e9;
+}
+
+// Parallel chunking must give exactly the rows of one sequential scan
+static bool sameRows(const PvtColumns &a, const PvtColumns &b) {
+    return a.Rows() == b.Rows() &&
+        memcmp(a.iTOW.data(), b.iTOW.data(), a.Rows() * sizeof(uint32_t)) == 0 &&
+        memcmp(a.latitude.data(), b.latitude.data(), a.Rows() * sizeof(double)) == 0 &&
+        memcmp(a.hostEpochNanos.data(), b.hostEpochNanos.data(), a.Rows() * sizeof(uint64_t)) == 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Usage: %s <capture or raw UBX file> [column file] [threads]\n", argv[0]);
+        return 1;
+    }
+    uint32_t threads = argc >= 4 ? atoi(argv[3]) : 0;
+
+    UbxBatchDecoder decoder;
+    if (!decoder.Open(argv[1])) {
+        return 1;
+    }
+
+    PvtColumns sequential;
+    PvtColumns parallel;
+    double sequentialSeconds = decodeSeconds(decoder, sequential, 1);
+    double parallelSeconds = decodeSeconds(decoder, parallel, threads);
+    UbxBatchStats stats = decoder.GetStats();
+
+    double megabytes = stats.streamBytes / 1e6;
+    printf("Stream: %.1f MB in %u records\n", megabytes, stats.spans);
+    printf("Frames: %llu  NAV-PVT rows: %llu  checksum failures: %llu\n",
+        static_cast<unsigned long long>(stats.frames), static_cast<unsigned long long>(stats.rows),
+        static_cast<unsigned long long>(stats.checksumFailures));
+    printf("1 thread:   %8.3f s  %8.1f MB/s\n", sequentialSeconds, megabytes / sequentialSeconds);
+    printf("%u threads: %8.3f s  %8.1f MB/s  (%u chunks, %u rescanned)\n", stats.threads,
+        parallelSeconds, megabytes / parallelSeconds, stats.chunks, stats.rescannedChunks);
+    printf("Parallel result %s the sequential scan\n", sameRows(sequential, parallel) ? "matches" : "DIFFERS FROM");
+
+    if (argc >= 3) {
+        if (!WritePvtColumns(argv[2], parallel)) {
+            return 1;
+        }
+        printf("Wrote %zu rows to %s\n", parallel.Rows(), argv[2]);
+    }
+    return sameRows(sequential, parallel) ? 0 : 1;
+}
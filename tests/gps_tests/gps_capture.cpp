@@ -0,0 +1,103 @@
+#include "gps.h"
+#include <stdio.h>
+#include <string.h>
+#include <csignal>
+#include <iostream>
+
+#define CURRENT_YEAR 2024
+
+// Define a flag to indicate if the program should exit gracefully.
+volatile bool exit_flag = false;
+
+// Signal handler function for Ctrl+C (SIGINT)
+void signal_handler(int signum) {
+    if (signum == SIGINT) {
+        std::cout << "Ctrl+C received. Cleaning up..." << std::endl;
+        exit_flag = true;
+    }
+}
+
+static void usage(const char *name) {
+    printf("Usage: %s record <capture file>\n", name);
+    printf("       %s replay <capture file> [fast]\n", name);
+}
+
+// Record the live module until Ctrl+C
+static int record(const char *path) {
+    Gps gps_module(CURRENT_YEAR);
+    if (!gps_module.StartRecording(path)) {
+        return 1;
+    }
+
+    while (!exit_flag) {
+        PVTData data = gps_module.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+        if (data.year != CURRENT_YEAR) {
+            printf("No data\n");
+            continue;
+        }
+        printf("iTOW %10u  Fix: %s  Lat: %.7f  Lon: %.7f\n",
+            data.iTOW, GetGNSSFixType(data.gnssFix).c_str(), data.latitude, data.longitude);
+    }
+
+    gps_module.StopRecording();
+    UbxCaptureStats stats = gps_module.GetRecordingStats();
+    printf("Recorded %u records, %llu bytes, %u write errors\n",
+        stats.records, static_cast<unsigned long long>(stats.bytes), stats.errors);
+    return 0;
+}
+
+// Run a capture through the driver, at the recorded pace or as fast as possible
+static int replay(const char *path, uint8_t mode) {
+    UbxCaptureReader capture;
+    if (!capture.Open(path, mode)) {
+        return 1;
+    }
+
+    Gps gps_module(CURRENT_YEAR, capture);
+    uint32_t fixes = 0;
+    uint32_t invalid = 0;
+    uint64_t start = EpochScheduler::NowNanos();
+
+    // The last records are drained before their frames are read; keep going until they are
+    while (!exit_flag && (!capture.AtEnd() || gps_module.HasPendingData())) {
+        PVTData data = gps_module.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+        if (data.year != CURRENT_YEAR) {
+            invalid++;
+            continue;
+        }
+        fixes++;
+        if (mode == CAPTURE_REPLAY_REALTIME) {
+            printf("iTOW %10u  Fix: %s  Lat: %.7f  Lon: %.7f\n",
+                data.iTOW, GetGNSSFixType(data.gnssFix).c_str(), data.latitude, data.longitude);
+        }
+    }
+
+    double seconds = (EpochScheduler::NowNanos() - start) / 1e9;
+    UbxCaptureStats stats = capture.GetStats();
+    GpsFixStats fixStats = gps_module.GetFixStats();
+    UbxFramerStats framerStats = gps_module.GetFramerStats();
+    GnssClockStats clock = gps_module.GetClockStats();
+    printf("Replayed %u records, %llu bytes in %.3f s (%.1f MB/s)\n", stats.records,
+        static_cast<unsigned long long>(stats.bytes), seconds, seconds > 0 ? stats.bytes / seconds / 1e6 : 0.0);
+    printf("Fixes: %u  invalid: %u  duplicates: %u  checksum errors: %u\n",
+        fixes, invalid, fixStats.duplicates, framerStats.checksumFailures);
+    printf("Clock: drift %+.1f ppb  jitter %.3f ms  max delay %.3f ms  resets %u\n",
+        clock.driftPpb, clock.jitterNanos / 1e6, clock.maxDelayNanos / 1e6, clock.resets);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // Register the signal handler for SIGINT (Ctrl+C)
+    signal(SIGINT, signal_handler);
+
+    if (argc >= 3 && strcmp(argv[1], "record") == 0) {
+        return record(argv[2]);
+    }
+    if (argc >= 3 && strcmp(argv[1], "replay") == 0) {
+        bool fast = argc >= 4 && strcmp(argv[3], "fast") == 0;
+        return replay(argv[2], fast ? CAPTURE_REPLAY_FAST : CAPTURE_REPLAY_REALTIME);
+    }
+
+    usage(argv[0]);
+    return 1;
+}
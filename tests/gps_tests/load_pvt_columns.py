@@ -0,0 +1,42 @@
+"""Load a column file written by gps_batch_decode into NumPy arrays without parsing.
+
+Usage:
+    columns = load_pvt_columns("field.pvtcol")
+    print(columns["latitude"][:10])
+"""
+
+import struct
+import sys
+
+import numpy as np
+
+MAGIC = b"PVTCOL01"
+HEADER_LENGTH = 24
+DESCRIPTOR_LENGTH = 40
+
+
+def load_pvt_columns(path):
+    """Return a dict of column name -> read-only memory-mapped array."""
+    with open(path, "rb") as f:
+        header = f.read(HEADER_LENGTH)
+        magic, count, header_length, rows = struct.unpack("<8sIIQ", header)
+        if magic != MAGIC:
+            raise ValueError(f"{path} is not a PVT column file")
+        descriptors = f.read(count * DESCRIPTOR_LENGTH)
+
+    columns = {}
+    for i in range(count):
+        name, dtype, offset = struct.unpack_from("<24s8sQ", descriptors, i * DESCRIPTOR_LENGTH)
+        name = name.rstrip(b"\0").decode()
+        dtype = dtype.rstrip(b"\0").decode()
+        columns[name] = np.memmap(path, dtype=dtype, mode="r", offset=offset, shape=(rows,))
+    return columns
+
+
+if __name__ == "__main__":
+    columns = load_pvt_columns(sys.argv[1])
+    rows = len(columns["iTOW"])
+    print(f"{rows} rows, {len(columns)} columns")
+    if rows:
+        print(f"iTOW {columns['iTOW'][0]} .. {columns['iTOW'][-1]}")
+        print(f"latitude {columns['latitude'].min():.7f} .. {columns['latitude'].max():.7f}")
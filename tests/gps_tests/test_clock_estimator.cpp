@@ -0,0 +1,112 @@
+/*
+ * test_clock_estimator.cpp - GnssClockEstimator on synthetic (iTOW, host stamp) pairs
+ *
+ * The host clock runs HOST_DRIFT_PPM fast with a known offset; every 10 Hz solution
+ * is stamped OUTPUT_LATENCY_NANOS after its epoch plus a positive, exponentially
+ * distributed scheduling delay (fixed seed). The run crosses a GPS week rollover,
+ * then the host clock is stepped. Checks the offset, drift, jitter and HostNanos()
+ * against the truth, that the rollover is unwrapped without a restart, that the step
+ * restarts the estimate once and that it converges again. No module needed.
+ */
+
+#include "clock_estimator.h"
+#include "epoch_scheduler.h"
+#include "../test_check.h"
+#include <math.h>
+#include <stdio.h>
+#include <random>
+
+#define FIX_PERIOD_MILLIS 100
+#define START_ITOW (CLOCK_WEEK_MILLIS - 40000)            // 40 s before the week rollover
+#define HOST_OFFSET_NANOS 5000000000000LL                 // Host time at the first epoch, before latency
+#define HOST_DRIFT_PPM 20.0
+#define OUTPUT_LATENCY_NANOS 30000000LL
+#define MEAN_DELAY_NANOS 1000000.0                        // Scheduling delay above the latency
+#define STEP_NANOS 3000000000LL                           // Host clock step after the first run
+#define FIRST_RUN_SECONDS 90                              // Crosses the rollover at 40 s
+#define SECOND_RUN_SECONDS 70
+#define OFFSET_TOLERANCE_NANOS 300000LL
+#define DRIFT_TOLERANCE_PPB 2000.0
+#define STEP_SETTLE_SECONDS 2                             // Offset holds again this soon after a restart
+
+typedef struct {
+    std::mt19937 random;
+    std::exponential_distribution<double> delay;
+    int64_t stepNanos;
+} Host;
+
+// Host time - unwrapped GNSS time when a solution is readable without scheduling delay
+static int64_t trueOffset(const Host &host, int64_t elapsedNanos) {
+    return HOST_OFFSET_NANOS + host.stepNanos + llround(elapsedNanos * HOST_DRIFT_PPM * 1e-6) + OUTPUT_LATENCY_NANOS -
+        (START_ITOW * static_cast<int64_t>(NANOS_PER_MILLI));
+}
+
+static uint32_t iTowAt(int64_t elapsedNanos) {
+    return static_cast<uint32_t>((START_ITOW + elapsedNanos / static_cast<int64_t>(NANOS_PER_MILLI)) % CLOCK_WEEK_MILLIS);
+}
+
+/**
+ * @brief   Feed every solution from fromSeconds to toSeconds.
+ *
+ * @return  The largest |HostNanos() - truth| over the solutions at least settleSeconds
+ *          after fromSeconds, predicted before each one is added.
+ */
+static int64_t feed(GnssClockEstimator &clock, Host &host, int fromSeconds, int toSeconds, int settleSeconds) {
+    int64_t maxError = 0;
+    for (int64_t millis = fromSeconds * 1000LL; millis < toSeconds * 1000LL; millis += FIX_PERIOD_MILLIS) {
+        int64_t elapsed = millis * static_cast<int64_t>(NANOS_PER_MILLI);
+        int64_t gnss = START_ITOW * static_cast<int64_t>(NANOS_PER_MILLI) + elapsed;
+        int64_t readable = gnss + trueOffset(host, elapsed);
+        if (millis >= (fromSeconds + settleSeconds) * 1000LL) {
+            int64_t error = static_cast<int64_t>(clock.HostNanos(iTowAt(elapsed))) - readable;
+            maxError = llabs(error) > maxError ? llabs(error) : maxError;
+        }
+        clock.AddSample(iTowAt(elapsed), static_cast<uint64_t>(readable + llround(host.delay(host.random))));
+    }
+    return maxError;
+}
+
+int main(void) {
+    Host host = {std::mt19937(11), std::exponential_distribution<double>(1.0 / MEAN_DELAY_NANOS), 0};
+    GnssClockEstimator clock;
+    check(!clock.IsValid() && clock.HostNanos(0) == 0, "no prediction before the first sample");
+
+    // Drift is fitted once CLOCK_MIN_FIT_BLOCKS seconds of envelope are in
+    int64_t predictionError = feed(clock, host, 0, FIRST_RUN_SECONDS, CLOCK_MIN_FIT_BLOCKS + 1);
+    int64_t lastElapsed = (FIRST_RUN_SECONDS * 1000LL - FIX_PERIOD_MILLIS) * static_cast<int64_t>(NANOS_PER_MILLI);
+    GnssClockStats stats = clock.GetStats();
+    int64_t offsetError = stats.offsetNanos - trueOffset(host, lastElapsed);
+    printf("Offset error %lld ns, drift %.0f ppb (true %.0f), jitter %u ns, max delay %u ns, prediction error %lld ns\n",
+        static_cast<long long>(offsetError), stats.driftPpb, HOST_DRIFT_PPM * 1000.0, stats.jitterNanos,
+        stats.maxDelayNanos, static_cast<long long>(predictionError));
+    check(clock.IsValid() && stats.resets == 0, "the week rollover is unwrapped without a restart");
+    check(stats.blocks == CLOCK_BLOCK_COUNT && stats.samples == CLOCK_WINDOW_LENGTH, "the envelope and window are full");
+    check(llabs(offsetError) < OFFSET_TOLERANCE_NANOS && offsetError > -static_cast<int64_t>(MEAN_DELAY_NANOS),
+        "offset is the lower envelope: latency included, scheduling delay not");
+    check(fabs(stats.driftPpb - HOST_DRIFT_PPM * 1000.0) < DRIFT_TOLERANCE_PPB, "drift is recovered");
+    check(stats.jitterNanos > MEAN_DELAY_NANOS / 2 && stats.jitterNanos < 3 * MEAN_DELAY_NANOS &&
+        stats.maxDelayNanos > stats.jitterNanos, "jitter reflects the scheduling delay");
+    check(predictionError < OFFSET_TOLERANCE_NANOS, "HostNanos predicts the next solutions");
+
+    uint32_t lastITow = iTowAt(lastElapsed);
+    uint64_t before = clock.HostNanos(lastITow);
+    clock.AddSample(lastITow, before + 200 * NANOS_PER_MILLI);
+    check(clock.HostNanos(lastITow) == before && clock.GetStats().samples == CLOCK_WINDOW_LENGTH,
+        "a repeated iTOW is ignored");
+
+    // The host clock is stepped (e.g. the program resumed on another clock source)
+    host.stepNanos = STEP_NANOS;
+    predictionError = feed(clock, host, FIRST_RUN_SECONDS, FIRST_RUN_SECONDS + SECOND_RUN_SECONDS, STEP_SETTLE_SECONDS);
+    stats = clock.GetStats();
+    lastElapsed = ((FIRST_RUN_SECONDS + SECOND_RUN_SECONDS) * 1000LL - FIX_PERIOD_MILLIS) * static_cast<int64_t>(NANOS_PER_MILLI);
+    // The restart unwraps GNSS time from the week it happened in, one week after the first
+    offsetError = stats.offsetNanos - (trueOffset(host, lastElapsed) + CLOCK_WEEK_MILLIS * static_cast<int64_t>(NANOS_PER_MILLI));
+    printf("After the step: %u resets, offset error %lld ns, drift %.0f ppb, prediction error %lld ns\n", stats.resets,
+        static_cast<long long>(offsetError), stats.driftPpb, static_cast<long long>(predictionError));
+    check(stats.resets == 1, "a step restarts the estimate once");
+    check(llabs(offsetError) < OFFSET_TOLERANCE_NANOS && fabs(stats.driftPpb - HOST_DRIFT_PPM * 1000.0) < DRIFT_TOLERANCE_PPB,
+        "offset and drift converge again");
+    check(predictionError < 2 * OFFSET_TOLERANCE_NANOS, "predictions hold shortly after the restart");
+
+    return checkSummary();
+}
@@ -27,7 +27,8 @@ int main(void) {
   Gps gps_module(CURRENT_YEAR);
   while(!exit_flag) {
 
-    PVTData data = gps_module.GetPvt(true, 1);
+    // Blocks until just after the next navigation epoch instead of polling on a fixed sleep
+    PVTData data = gps_module.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
     if (data.year == CURRENT_YEAR && data.numberOfSatellites > 0) {
       /* Use these times to plot on x-axis */
       printf("Year: %d\n", data.year);
@@ -56,21 +57,17 @@ int main(void) {
       printf("East Velocity: %d\n", data.velocityEast);
       printf("Down Velocity: %d\n", data.velocityDown);
       printf("Ground Speed: %d\n", data.groundSpeed);
-      printf("Vehicle Heading: %d\n", data.vehicalHeading);
-      printf("Motion Heading: %d\n", data.motionHeading);
+      printf("Vehicle Heading: %f\n", data.vehicalHeading);
+      printf("Motion Heading: %f\n", data.motionHeading);
       printf("Speed Accuracy: %u\n", data.speedAccuracy);
-      printf("Motion Heading Accuracy: %d\n", data.motionHeadingAccuracy);
+      printf("Motion Heading Accuracy: %f\n", data.motionHeadingAccuracy);
       /* Don't Plot These */
-      //printf("Magnetic Declination: %d\n", data.magneticDeclination);
-      //printf("Magnetic Declination Accuracy: %u\n", data.magnetDeclinationAccuracy);
+      //printf("Magnetic Declination: %f\n", data.magneticDeclination);
+      //printf("Magnetic Declination Accuracy: %f\n", data.magnetDeclinationAccuracy);
       printf("\n---------------------\n");
     } else {
       printf("No data\n");
     }
-
-    // Sleep for 10 milliseconds
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    // sleep(0.5);
   }
 
   return 0;
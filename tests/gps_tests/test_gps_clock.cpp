@@ -0,0 +1,49 @@
+#include "gps.h"
+#include <stdio.h>
+#include <csignal>
+#include <iostream>
+
+#define CURRENT_YEAR 2024
+
+// Define a flag to indicate if the program should exit gracefully.
+volatile bool exit_flag = false;
+
+// Signal handler function for Ctrl+C (SIGINT)
+void signal_handler(int signum) {
+    if (signum == SIGINT) {
+        std::cout << "Ctrl+C received. Cleaning up..." << std::endl;
+        exit_flag = true;
+    }
+}
+
+int main(void) {
+    // Register the signal handler for SIGINT (Ctrl+C)
+    signal(SIGINT, signal_handler);
+
+    Gps gps_module(CURRENT_YEAR);
+
+    uint64_t lastReceiveNanos = 0;
+    while (!exit_flag) {
+        PVTData data = gps_module.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+        if (data.year != CURRENT_YEAR) {
+            printf("No data\n");
+            continue;
+        }
+
+        // Receive stamp relative to the epoch predicted by the clock model: the delivery delay
+        GnssClockStats clock = gps_module.GetClockStats();
+        double intervalMillis = lastReceiveNanos == 0 ? 0.0 :
+            (data.hostReceiveNanos - lastReceiveNanos) / 1e6;
+        double delayMillis = (static_cast<int64_t>(data.hostReceiveNanos) -
+            static_cast<int64_t>(data.hostEpochNanos)) / 1e6;
+        lastReceiveNanos = data.hostReceiveNanos;
+
+        printf("iTOW %10u  nano %10d  tAcc %6u ns  rx %.6f s  interval %7.3f ms  delay %6.3f ms\n",
+            data.iTOW, data.nano, data.timeAccuracy, data.hostReceiveNanos / 1e9, intervalMillis, delayMillis);
+        printf("  offset %.6f s  drift %+.1f ppb  jitter %.3f ms  max delay %.3f ms  (%u samples, %u resets)\n",
+            clock.offsetNanos / 1e9, clock.driftPpb, clock.jitterNanos / 1e6, clock.maxDelayNanos / 1e6,
+            clock.samples, clock.resets);
+    }
+
+    return 0;
+}
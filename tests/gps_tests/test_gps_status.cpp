@@ -0,0 +1,79 @@
+#include "gps.h"
+#include <stdio.h>
+#include <csignal>
+#include <iostream>
+
+#define CURRENT_YEAR 2024
+
+// Define a flag to indicate if the program should exit gracefully.
+volatile bool exit_flag = false;
+
+// Signal handler function for Ctrl+C (SIGINT)
+void signal_handler(int signum) {
+    if (signum == SIGINT) {
+        std::cout << "Ctrl+C received. Cleaning up..." << std::endl;
+        exit_flag = true;
+    }
+}
+
+int main(void) {
+    // Register the signal handler for SIGINT (Ctrl+C)
+    signal(SIGINT, signal_handler);
+
+    Gps gps_module(CURRENT_YEAR);
+
+    // Have the receiver push the status messages with every solution
+    const uint8_t messages[][2] = {
+        {NAV_CLASS, NAV_SAT}, {NAV_CLASS, NAV_DOP}, {NAV_CLASS, NAV_STATUS},
+        {NAV_CLASS, NAV_TIMEUTC}, {MON_CLASS, MON_HW}
+    };
+    for (const auto &message : messages) {
+        if (!gps_module.EnableMessage(message[0], message[1], DEFAULT_SEND_RATE)) {
+            printf("Failed to enable message 0x%02X 0x%02X\n", message[0], message[1]);
+        }
+    }
+
+    while (!exit_flag) {
+        PVTData data = gps_module.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+        if (data.year != CURRENT_YEAR) {
+            printf("No data\n");
+            continue;
+        }
+
+        NavSatData sat;
+        NavDopData dop;
+        NavStatusData status;
+        NavTimeUtcData utc;
+        MonHwData hw;
+
+        printf("%02d:%02d:%02d  Fix: %s\n", data.hour, data.min, data.sec, GetGNSSFixType(data.gnssFix).c_str());
+        if (gps_module.GetNavStatus(status)) {
+            printf("TTFF: %u ms  Uptime: %u ms\n", status.timeToFirstFix, status.millisSinceStartup);
+        }
+        if (gps_module.GetNavTimeUtc(utc)) {
+            printf("UTC: %04u-%02u-%02u %02u:%02u:%02u (valid 0x%02X)\n",
+                utc.year, utc.month, utc.day, utc.hour, utc.min, utc.sec, utc.valid);
+        }
+        if (gps_module.GetNavDop(dop)) {
+            printf("DOP: G %.2f P %.2f H %.2f V %.2f T %.2f\n",
+                dop.geometricDop, dop.positionDop, dop.horizontalDop, dop.verticalDop, dop.timeDop);
+        }
+        if (gps_module.GetMonHw(hw)) {
+            printf("AGC: %.1f%%  Noise: %u  Jamming state: %u  CW jamming: %u  Antenna: %u\n",
+                hw.agcPercent, hw.noisePerMS, hw.jammingState, hw.jammingIndicator, hw.antennaStatus);
+        }
+        if (gps_module.GetNavSat(sat)) {
+            printf("Satellites: %u tracked, %u used\n", sat.numSvs, sat.numUsed);
+            for (uint8_t i = 0; i < sat.numDecoded; i++) {
+                const NavSatInfo &sv = sat.svs[i];
+                printf("  gnss %u sv %3u  C/N0 %2u dBHz  elev %3d  azim %3d  %s\n",
+                    sv.gnssId, sv.svId, sv.cno, sv.elevation, sv.azimuth, sv.used ? "used" : "");
+            }
+        }
+        printf("\n---------------------\n");
+    }
+
+    UbxDispatchStats stats = gps_module.GetDispatchStats();
+    printf("Dispatched %u messages, %u without a handler\n", stats.dispatched, stats.unhandled);
+    return 0;
+}
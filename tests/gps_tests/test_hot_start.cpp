@@ -0,0 +1,194 @@
+/*
+ * test_hot_start.cpp - Navigation database save/restore by the driver on the simulated receiver
+ *
+ * Runs the unmodified Gps driver against the SAM-M8Q simulator (see i2c_sim.h). The
+ * simulated receiver answers an MGA-DBD poll with its database and an MGA-ACK-DATA0
+ * carrying the message count, applies MGA-INI-TIME_UTC, MGA-INI-POS_LLH and MGA-DBD
+ * messages, answers each with MGA-ACK-DATA0 once CFG-NAVX5 ackAiding is on, and
+ * models the time to first fix from what it was given: cold (ttffColdSeconds), aided
+ * (SIM_GPS_TTFF_AIDED_SECONDS) or hot (SIM_GPS_TTFF_HOT_SECONDS).
+ *
+ * The receiver is tracked to a fix, its database is saved with SaveNavigationDatabase(),
+ * then it is power cycled and started cold, from the saved database
+ * (RestoreNavigationDatabase()), and from the last position only. A dump that overflows
+ * the receiver's output buffer must be refused without replacing the saved file, and
+ * autosave must save from the acquisition thread. No module needed.
+ */
+
+#include "gps.h"
+#include "i2c_sim.h"
+#include "../test_check.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#define TIME_SCALE 10.0
+#define SIM_YEAR 2024
+#define FIX_WAIT_SECONDS 60
+#define BUFFER_BYTES 16384               // Holds a whole dump; the default 4096 does not
+#define AUTOSAVE_SECONDS 2
+#define AUTOSAVE_RUN_SECONDS 5
+#define TTFF_MARGIN_MILLIS 500           // Output latency, polling and bus time after the fix is due
+#define POSITION_TOLERANCE_M 50.0        // The simulated drive circles the origin at 20 m
+#define DATABASE_PATH "/tmp/test_hot_start.ubx"
+#define POSITION_PATH "/tmp/test_hot_start_position.ubx"
+
+/**
+ * @brief   Read until the first fix with gnssFixOK.
+ *
+ * @return  The driver's TTFF in milliseconds, 0 if no fix came within FIX_WAIT_SECONDS.
+ */
+static uint32_t waitForFix(Gps &gps) {
+    uint64_t deadline = I2cSim::NowNanos() + FIX_WAIT_SECONDS * NANOS_PER_SECOND;
+    while (I2cSim::NowNanos() < deadline) {
+        PVTData data = gps.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+        if (data.newFix && (data.fixStatusFlags & NAV_PVT_FLAGS_GNSS_FIX_OK)) {
+            return gps.GetTtffStats().ttffMillis;
+        }
+    }
+    return 0;
+}
+
+static std::vector<uint8_t> readFile(const char *path) {
+    std::vector<uint8_t> bytes;
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        return bytes;
+    }
+    uint8_t buf[4096];
+    size_t length;
+    while ((length = fread(buf, 1, sizeof(buf), file)) > 0) {
+        bytes.insert(bytes.end(), buf, buf + length);
+    }
+    fclose(file);
+    return bytes;
+}
+
+static void report(const char *name, uint32_t ttffMillis, const GpsDatabaseStats &stats) {
+    const UbxAssistStats &upload = stats.restore;
+    printf("%-14s sent %4u (%6u B)  accepted %4u  rejected %3u  unconfirmed %4u  TTFF %6u ms (receiver %6u ms)\n",
+        name, upload.sent, upload.bytes, upload.accepted, upload.rejected, upload.unconfirmed, ttffMillis,
+        I2cSim::GetGpsStats().ttffMillis);
+}
+
+int main(void) {
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    config.timeScale = TIME_SCALE;
+    I2cSim::Configure(config);
+    SimSamM8qConfig receiver = SIM_SAM_M8Q_DEFAULT_CONFIG;
+    receiver.bufferBytes = BUFFER_BYTES;
+    I2cSim::ConfigureGps(receiver);
+    unlink(DATABASE_PATH);
+
+    // Save: track to a fix, then dump the database with the last fix
+    {
+        Gps gps(SIM_YEAR);
+        uint32_t ttff = waitForFix(gps);
+        check(ttff >= receiver.ttffColdSeconds * 1000U - TTFF_MARGIN_MILLIS, "the first start is cold");
+        check(gps.SaveNavigationDatabase(DATABASE_PATH), "the navigation database is saved");
+        GpsDatabaseStats stats = gps.GetDatabaseStats();
+        printf("Saved %u MGA-DBD messages (%u B) in %u ms\n", stats.savedMessages, stats.savedBytes, stats.saveMillis);
+        check(stats.saves == 1 && stats.saveFailures == 0 && stats.savedMessages == SIM_GPS_DBD_MESSAGES,
+            "the dump is complete and matches the receiver's count");
+    }
+
+    UbxNavDatabase saved;
+    check(saved.Load(DATABASE_PATH) && saved.DbdCount() == SIM_GPS_DBD_MESSAGES, "the file holds the dump");
+    double north = (saved.HasLastFix() ? saved.LastFix().Latitude() : 0.0) - receiver.latitude;
+    double east = ((saved.HasLastFix() ? saved.LastFix().Longitude() : 0.0) - receiver.longitude) *
+        cos(receiver.latitude * M_PI / 180.0);
+    check(saved.HasLastFix() && hypot(north, east) * 111320.0 < POSITION_TOLERANCE_M, "the file holds the last fix");
+
+    UbxNavDatabase positionOnly;
+    positionOnly.SetLastFix(saved.LastFix());
+    check(positionOnly.Save(POSITION_PATH), "a position-only file is written");
+
+    printf("Restart after a power cycle:\n");
+
+    // Cold: nothing restored
+    I2cSim::PowerCycleGps();
+    {
+        Gps gps(SIM_YEAR);
+        uint32_t ttff = waitForFix(gps);
+        report("cold", ttff, gps.GetDatabaseStats());
+        check(gps.GetTtffStats().start == GPS_START_COLD && ttff >= receiver.ttffColdSeconds * 1000U - TTFF_MARGIN_MILLIS,
+            "nothing restored is a cold start");
+    }
+
+    // Hot: time, position and the saved database
+    I2cSim::PowerCycleGps();
+    {
+        Gps gps(SIM_YEAR);
+        check(gps.RestoreNavigationDatabase(DATABASE_PATH), "the database is restored");
+        uint32_t ttff = waitForFix(gps);
+        GpsDatabaseStats stats = gps.GetDatabaseStats();
+        report("database", ttff, stats);
+        check(stats.restore.sent == SIM_GPS_DBD_MESSAGES + 2 && stats.restore.accepted == stats.restore.sent &&
+            stats.restore.unconfirmed == 0, "every MGA message is acknowledged");
+        check(I2cSim::GetGpsStats().mgaAccepted == SIM_GPS_DBD_MESSAGES + 2, "the receiver applied every MGA message");
+        check(gps.GetTtffStats().start == GPS_START_DATABASE && ttff > 0 &&
+            ttff <= SIM_GPS_TTFF_HOT_SECONDS * 1000U + TTFF_MARGIN_MILLIS, "the restored database gives a hot start");
+
+        // The receiver now hands out the restored database again
+        UbxNavDatabase dumped;
+        check(gps.SaveNavigationDatabase(DATABASE_PATH) && dumped.Load(DATABASE_PATH) &&
+            dumped.DbdBytes() == saved.DbdBytes() && memcmp(dumped.DbdFrames(), saved.DbdFrames(), saved.DbdBytes()) == 0,
+            "the restored receiver holds the saved MGA-DBD frames unchanged");
+    }
+
+    // Aided: the last position (and the host clock) only
+    I2cSim::PowerCycleGps();
+    {
+        Gps gps(SIM_YEAR);
+        check(gps.RestoreNavigationDatabase(POSITION_PATH), "the position is restored");
+        uint32_t ttff = waitForFix(gps);
+        report("position only", ttff, gps.GetDatabaseStats());
+        check(gps.GetTtffStats().start == GPS_START_AIDED && ttff > SIM_GPS_TTFF_HOT_SECONDS * 1000U + TTFF_MARGIN_MILLIS &&
+            ttff <= SIM_GPS_TTFF_AIDED_SECONDS * 1000U + TTFF_MARGIN_MILLIS, "the position alone gives an aided start");
+    }
+
+    // A dump that overflows the receiver's buffer loses frames and must not replace the file
+    SimSamM8qConfig defaults = SIM_SAM_M8Q_DEFAULT_CONFIG;
+    receiver.bufferBytes = defaults.bufferBytes;
+    I2cSim::ConfigureGps(receiver);
+    {
+        std::vector<uint8_t> before = readFile(DATABASE_PATH);
+        Gps gps(SIM_YEAR);
+        check(gps.RestoreNavigationDatabase(DATABASE_PATH) && waitForFix(gps) > 0, "the small-buffer receiver has a fix");
+        check(!gps.SaveNavigationDatabase(DATABASE_PATH) && gps.GetDatabaseStats().saveFailures == 1 &&
+            I2cSim::GetGpsStats().messagesDropped > 0, "a dump with lost frames is refused");
+        check(readFile(DATABASE_PATH) == before, "and keeps the previous file");
+    }
+
+    // Autosave runs on the acquisition thread while the stats are read here
+    receiver.bufferBytes = BUFFER_BYTES;
+    I2cSim::ConfigureGps(receiver);
+    {
+        Gps gps(SIM_YEAR);
+        check(gps.RestoreNavigationDatabase(DATABASE_PATH) && waitForFix(gps) > 0, "the receiver has a fix again");
+        gps.SetDatabaseAutosave(DATABASE_PATH, AUTOSAVE_SECONDS);
+        gps.StartAcquisition(false);
+        uint64_t end = I2cSim::NowNanos() + AUTOSAVE_RUN_SECONDS * NANOS_PER_SECOND;
+        uint32_t seen = 0;
+        while (I2cSim::NowNanos() < end) {
+            PVTData data;
+            gps.WaitPvt(data, ACQUISITION_WAIT_MILLS);
+            seen = gps.GetDatabaseStats().saves;
+        }
+        gps.StopAcquisition();
+        GpsDatabaseStats stats = gps.GetDatabaseStats();
+        printf("Autosave: %u saves, %u failures\n", stats.saves, stats.saveFailures);
+        check(seen >= AUTOSAVE_RUN_SECONDS / AUTOSAVE_SECONDS && stats.saves == seen + 1 && stats.saveFailures == 0,
+            "autosave saves periodically and once more at the stop");
+    }
+
+    UbxNavDatabase missing;
+    check(!missing.Load("/nonexistent/test_hot_start.ubx"), "a missing file is reported");
+    check(!Gps(SIM_YEAR).RestoreNavigationDatabase("/nonexistent/test_hot_start.ubx"), "and not restored");
+    unlink(DATABASE_PATH);
+    unlink(POSITION_PATH);
+
+    return checkSummary();
+}
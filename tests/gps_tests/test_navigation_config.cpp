@@ -0,0 +1,72 @@
+/*
+ * test_navigation_config.cpp - The SAM-M8Q limits checked by Gps::ValidateNavigationConfig
+ *
+ * Each case is a GpsNavigationConfig and the NAV_CONFIG_* code expected for it, at
+ * and on both sides of every limit: measurement period, navigation rate, time
+ * reference, GNSS selection, solution rate per GNSS count and the solution period
+ * that must fit the 16-bit navigation period. No module needed.
+ */
+
+#include "gps.h"
+#include "../test_check.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MAJOR_TWO (GNSS_MASK_GPS | GNSS_MASK_GLONASS)
+#define MAJOR_ALL GNSS_MASK_MAJOR
+
+typedef struct {
+    GpsNavigationConfig navigation;
+    uint8_t expected;
+    const char *description;
+} NavigationCase;
+
+static const NavigationCase CASES[] = {
+    {DEFAULT_NAVIGATION_CONFIG, NAV_CONFIG_OK, "default configuration"},
+    {{MIN_MEASUREMENT_PERIOD_MILLIS - 1, 1, TIME_REF_UTC, GNSS_MASK_GPS}, NAV_CONFIG_INVALID_PERIOD,
+        "measurement period below the minimum"},
+    {{100, 0, TIME_REF_UTC, GNSS_MASK_UNCHANGED}, NAV_CONFIG_INVALID_NAV_RATE, "navigation rate 0"},
+    {{100, MAX_NAVIGATION_RATE + 1, TIME_REF_UTC, GNSS_MASK_UNCHANGED}, NAV_CONFIG_INVALID_NAV_RATE,
+        "navigation rate above the maximum"},
+    {{100, 1, MAX_TIME_REFERENCE + 1, GNSS_MASK_UNCHANGED}, NAV_CONFIG_INVALID_TIME_REF, "unknown time reference"},
+    {{100, 1, TIME_REF_GPS, GNSS_MASK_SBAS}, NAV_CONFIG_INVALID_GNSS, "no major GNSS"},
+    {{100, 1, TIME_REF_GPS, GNSS_MASK_GPS | (1 << GNSS_ID_IMES)}, NAV_CONFIG_INVALID_GNSS, "IMES is not selectable"},
+    {{100, 1, TIME_REF_GPS, MAJOR_ALL}, NAV_CONFIG_TOO_MANY_GNSS, "four major GNSS"},
+    {{100, 1, TIME_REF_GPS, GNSS_MASK_GALILEO | GNSS_MASK_QZSS}, NAV_CONFIG_AUGMENTATION_WITHOUT_GPS,
+        "QZSS without GPS"},
+    {{100, 1, TIME_REF_GPS, GNSS_MASK_RECEIVER_DEFAULT}, NAV_CONFIG_OK, "receiver default GNSS at 10 Hz"},
+    {{99, 1, TIME_REF_UTC, MAJOR_TWO}, NAV_CONFIG_RATE_TOO_HIGH, "two GNSS above 10 Hz"},
+    {{99, 1, TIME_REF_UTC, GNSS_MASK_UNCHANGED}, NAV_CONFIG_RATE_TOO_HIGH,
+        "unchanged GNSS keep the concurrent limit"},
+    {{MEASUREMENT_PERIOD_MILLIS_56_MS, 1, TIME_REF_UTC, GNSS_MASK_GPS}, NAV_CONFIG_OK, "one GNSS at 18 Hz"},
+    {{55, 1, TIME_REF_UTC, GNSS_MASK_GLONASS}, NAV_CONFIG_RATE_TOO_HIGH, "one GNSS above 18 Hz"},
+    {{MIN_MEASUREMENT_PERIOD_MILLIS, 4, TIME_REF_UTC, MAJOR_TWO}, NAV_CONFIG_OK,
+        "fast measurements averaged to 10 Hz solutions"},
+    {{1000, 65, TIME_REF_UTC, GNSS_MASK_UNCHANGED}, NAV_CONFIG_OK, "65 s solution period"},
+    {{1000, 100, TIME_REF_UTC, GNSS_MASK_UNCHANGED}, NAV_CONFIG_PERIOD_TOO_LONG,
+        "100 s solution period does not fit 16 bits"},
+    {{MAX_SOLUTION_PERIOD_MILLIS, 1, TIME_REF_UTC, GNSS_MASK_UNCHANGED}, NAV_CONFIG_OK,
+        "longest measurement period"},
+    {{516, MAX_NAVIGATION_RATE, TIME_REF_UTC, GNSS_MASK_UNCHANGED}, NAV_CONFIG_OK, "65532 ms at the maximum rate"},
+    {{517, MAX_NAVIGATION_RATE, TIME_REF_UTC, GNSS_MASK_UNCHANGED}, NAV_CONFIG_PERIOD_TOO_LONG,
+        "65659 ms at the maximum rate"},
+};
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++) {
+        uint8_t result = Gps::ValidateNavigationConfig(CASES[i].navigation);
+        if (result != CASES[i].expected) {
+            printf("Expected \"%s\", got \"%s\"\n", Gps::NavigationConfigErrorToString(CASES[i].expected),
+                Gps::NavigationConfigErrorToString(result));
+        }
+        check(result == CASES[i].expected, CASES[i].description);
+    }
+
+    bool described = true;
+    for (uint8_t code = NAV_CONFIG_OK; code <= NAV_CONFIG_PERIOD_TOO_LONG; code++) {
+        described = described && strcmp(Gps::NavigationConfigErrorToString(code), "unknown error") != 0;
+    }
+    check(described, "every NAV_CONFIG_* code has a description");
+
+    return checkSummary();
+}
@@ -0,0 +1,137 @@
+#include "pvt_history.h"
+#include "epoch_scheduler.h"
+#include "../test_check.h"
+#include <math.h>
+#include <stdio.h>
+
+#define FIX_PERIOD_MILLIS 100        // 10 Hz fixes
+#define QUERY_PERIOD_MILLIS 1.0      // 1 kHz IMU
+#define FIX_COUNT 1000               // Wraps the ring several times
+#define CIRCLE_RADIUS 30.0           // m
+#define CIRCLE_SPEED 15.0            // m/s
+#define START_LATITUDE 45.0
+#define START_LONGITUDE 7.0
+#define START_ITOW (PVT_HISTORY_WEEK_MILLIS - 30000)   // Crosses the week rollover
+#define HOST_OFFSET_NANOS 123456789012ULL
+#define HOST_DRIFT 20e-6             // Host clock runs 20 ppm fast
+
+// Simulated vehicle driving a circle while climbing and descending
+static PvtSample truth(double seconds) {
+    const double degrees = 180.0 / M_PI;
+    double rate = CIRCLE_SPEED / CIRCLE_RADIUS;
+    double angle = rate * seconds;
+    double north = CIRCLE_RADIUS * sin(angle);
+    double east = CIRCLE_RADIUS * (1.0 - cos(angle));
+
+    double sinLatitude = sin(START_LATITUDE / degrees);
+    double denominator = 1.0 - WGS84_ECCENTRICITY_SQUARED * sinLatitude * sinLatitude;
+    double primeVertical = WGS84_SEMI_MAJOR_AXIS / sqrt(denominator);
+    double meridian = primeVertical * (1.0 - WGS84_ECCENTRICITY_SQUARED) / denominator;
+
+    PvtSample sample = {};
+    double iTow = fmod(START_ITOW + seconds * 1000.0, (double)PVT_HISTORY_WEEK_MILLIS);
+    sample.iTOW = iTow;
+    sample.hostNanos = HOST_OFFSET_NANOS + (uint64_t)llround(seconds * 1e9 * (1.0 + HOST_DRIFT));
+    sample.height = 100.0 + 5.0 * sin(0.2 * seconds);
+    sample.latitude = START_LATITUDE + north / (meridian + sample.height) * degrees;
+    sample.longitude = START_LONGITUDE + east / ((primeVertical + sample.height) * cos(START_LATITUDE / degrees)) * degrees;
+    sample.velocityNorth = CIRCLE_SPEED * cos(angle);
+    sample.velocityEast = CIRCLE_SPEED * sin(angle);
+    sample.velocityDown = -1.0 * cos(0.2 * seconds);
+    sample.horizontalAccuracy = 1.5;
+    sample.verticalAccuracy = 2.5;
+    sample.gnssFix = 3;
+    return sample;
+}
+
+// Horizontal and vertical distance (m) between two samples
+static double distance(const PvtSample &a, const PvtSample &b) {
+    const double metresPerDegree = WGS84_SEMI_MAJOR_AXIS * M_PI / 180.0;
+    double north = (a.latitude - b.latitude) * metresPerDegree;
+    double east = (a.longitude - b.longitude) * metresPerDegree * cos(a.latitude * M_PI / 180.0);
+    double up = a.height - b.height;
+    return sqrt(north * north + east * east + up * up);
+}
+
+int main(void) {
+    PvtHistory history;
+    double lastFixSeconds = (FIX_COUNT - 1) * FIX_PERIOD_MILLIS / 1000.0;
+
+    for (int i = 0; i < FIX_COUNT; i++) {
+        history.Push(truth(i * FIX_PERIOD_MILLIS / 1000.0));
+    }
+    printf("History: %zu of %d fixes kept, %.1f s\n", history.Size(), FIX_COUNT,
+        history.Size() * FIX_PERIOD_MILLIS / 1000.0);
+
+    // Query every IMU tick covered by the history, by host time and by GNSS time
+    double firstSeconds = lastFixSeconds - (history.Size() - 1) * FIX_PERIOD_MILLIS / 1000.0;
+    const uint8_t modes[] = {PVT_INTERPOLATE_LINEAR, PVT_INTERPOLATE_HERMITE};
+    const char *names[] = {"linear", "Hermite"};
+    double maxError[2] = {0, 0};
+
+    for (int m = 0; m < 2; m++) {
+        double sumSquares = 0;
+        uint32_t queries = 0;
+        uint32_t missed = 0;
+        uint64_t start = EpochScheduler::NowNanos();
+        for (double t = firstSeconds; t <= lastFixSeconds; t += QUERY_PERIOD_MILLIS / 1000.0) {
+            PvtSample expected = truth(t);
+            PvtSample byHost;
+            PvtSample byGnss;
+            if (!history.AtHostTime(expected.hostNanos, byHost, modes[m]) ||
+                !history.AtGnssTime(expected.iTOW, byGnss, modes[m])) {
+                missed++;
+                continue;
+            }
+            double error = distance(byHost, expected);
+            double gnssError = distance(byGnss, expected);
+            error = error > gnssError ? error : gnssError;
+            sumSquares += error * error;
+            maxError[m] = error > maxError[m] ? error : maxError[m];
+            queries++;
+        }
+        double nanosPerQuery = (EpochScheduler::NowNanos() - start) / (2.0 * (queries + missed));
+        printf("%-8s %u queries, %u missed: RMS error %.6f m, max %.6f m, %.0f ns per lookup\n",
+            names[m], queries, missed, sqrt(sumSquares / (queries ? queries : 1)), maxError[m], nanosPerQuery);
+    }
+
+    printf("Checks:\n");
+    check(history.Size() == PVT_HISTORY_CAPACITY, "ring keeps the newest PVT_HISTORY_CAPACITY fixes");
+    check(maxError[1] < maxError[0] / 10, "Hermite follows the circle 10x closer than linear");
+
+    PvtSample sample;
+    PvtSample newest = truth(lastFixSeconds);
+    check(history.AtGnssTime(newest.iTOW, sample, PVT_INTERPOLATE_HERMITE) &&
+        !sample.extrapolated && distance(sample, newest) < 1e-6, "exact fix time returns the fix");
+
+    PvtSample ahead = truth(lastFixSeconds + 0.05);
+    check(history.AtHostTime(ahead.hostNanos, sample, PVT_INTERPOLATE_HERMITE) &&
+        sample.extrapolated && distance(sample, ahead) < 0.1, "50 ms past the newest fix is extrapolated");
+
+    PvtSample tooFar = truth(lastFixSeconds + 1.0);
+    check(!history.AtHostTime(tooFar.hostNanos, sample, PVT_INTERPOLATE_HERMITE),
+        "1 s past the newest fix is refused");
+
+    PvtSample tooOld = truth(firstSeconds - 0.05);
+    check(!history.AtGnssTime(tooOld.iTOW, sample, PVT_INTERPOLATE_HERMITE), "before the oldest fix is refused");
+
+    check(!history.Push(truth(lastFixSeconds - 1.0)), "older fix is not stored");
+
+    // A clock model reset can stamp a newer fix with an earlier host time
+    PvtSample stepped = truth(lastFixSeconds + 0.1);
+    stepped.hostNanos = newest.hostNanos - 20 * NANOS_PER_MILLI;
+    check(!history.Push(stepped), "fix with an earlier host time is not stored");
+    stepped.hostNanos = newest.hostNanos;
+    check(!history.Push(stepped), "nor one with the same host time");
+    PvtSample between = truth(lastFixSeconds - 0.05);
+    check(history.AtHostTime(between.hostNanos, sample, PVT_INTERPOLATE_LINEAR) && distance(sample, between) < 0.05,
+        "host time lookups still bracket correctly");
+
+    // An outage longer than PVT_HISTORY_MAX_GAP_NANOS must not be bridged
+    double resumeSeconds = lastFixSeconds + 5.0;
+    history.Push(truth(resumeSeconds));
+    PvtSample inGap = truth(lastFixSeconds + 2.5);
+    check(!history.AtGnssTime(inGap.iTOW, sample, PVT_INTERPOLATE_LINEAR), "gap of 5 s is not interpolated");
+
+    return checkSummary();
+}
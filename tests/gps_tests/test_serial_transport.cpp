@@ -0,0 +1,133 @@
+/*
+ * test_serial_transport.cpp - SerialGps over a pseudo terminal
+ *
+ * SerialTransport opens the slave side of a GpsPty as if it were the receiver's
+ * UART; a pump thread moves bytes between the master side and a SimSamM8q set to
+ * UART1. Linked with the I2C simulator for its accelerated clock only, so the
+ * cold start takes about half a second. No hardware needed.
+ */
+
+#include "gps.h"
+#include "i2c_sim.h"
+#include "sim_sam_m8q.h"
+#include "../test_check.h"
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#define TIME_SCALE 50.0
+#define SIM_YEAR 2024
+#define FIX_WAIT_SECONDS 40
+#define RATE_WINDOW_SECONDS 3
+#define EXPECTED_RATE_HZ 10           // DEFAULT_NAVIGATION_CONFIG: 100 ms
+#define PUMP_PERIOD_MICROS 1000
+#define PUMP_CHUNK_LENGTH 256
+
+static double virtualSeconds(void) {
+    return I2cSim::NowNanos() / 1e9;
+}
+
+/** The receiver end of the pty */
+typedef struct {
+    int masterFd;
+    SimSamM8q receiver;
+    std::mutex lock;
+    std::atomic<bool> running;
+} UartLink;
+
+/**
+ * @brief   Move bytes between the pty master and the simulated receiver until stopped.
+ */
+static void pump(UartLink *link) {
+    uint8_t chunk[PUMP_CHUNK_LENGTH];
+    while (link->running.load()) {
+        {
+            std::lock_guard<std::mutex> guard(link->lock);
+            uint64_t now = I2cSim::NowNanos();
+            ssize_t received;
+            while ((received = read(link->masterFd, chunk, sizeof(chunk))) > 0) {
+                link->receiver.WriteStream(chunk, static_cast<uint16_t>(received), now);
+            }
+            uint16_t length;
+            while ((length = link->receiver.ReadStream(chunk, sizeof(chunk), now)) > 0) {
+                if (write(link->masterFd, chunk, length) != length) {
+                    break;
+                }
+            }
+        }
+        usleep(PUMP_PERIOD_MICROS);
+    }
+}
+
+int main(void) {
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    config.timeScale = TIME_SCALE;
+    I2cSim::Configure(config);
+
+    GpsPty pty;
+    if (!pty.Open()) {
+        printf("FAIL: could not open a pseudo terminal\n");
+        return 1;
+    }
+
+    UartLink link;
+    link.masterFd = pty.MasterFd();
+    link.receiver.Configure(SimSamM8qConfig SIM_SAM_M8Q_DEFAULT_CONFIG, I2cSim::NowNanos());
+    link.receiver.SetPort(PORT_ID_UART1);
+    link.running = true;
+    std::thread receiverThread(pump, &link);
+
+    SerialTransportConfig serial = SERIAL_TRANSPORT_DEFAULT_CONFIG;
+    serial.device = pty.SlaveName();
+    GpsNavigationConfig navigation = DEFAULT_NAVIGATION_CONFIG;
+    double start = virtualSeconds();
+    SerialGps gps(SIM_YEAR, navigation, SerialTransport(serial));
+
+    SimSamM8qStats receiver;
+    uint32_t baudRate;
+    {
+        std::lock_guard<std::mutex> guard(link.lock);
+        receiver = link.receiver.GetStats();
+        baudRate = link.receiver.BaudRate();
+    }
+    check(receiver.acks >= 3 && receiver.naks == 0, "driver configuration is acknowledged over UART1");
+    check(baudRate == GPS_SERIAL_BAUD, "CFG-PRT switched UART1 to the transport's baud rate");
+
+    PVTData data = {};
+    double ttff = -1.0;
+    while (virtualSeconds() - start < FIX_WAIT_SECONDS) {
+        data = gps.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+        if (data.year == SIM_YEAR && data.gnssFix == 3) {
+            ttff = virtualSeconds() - start;
+            break;
+        }
+    }
+    printf("Time to first fix: %.2f s (virtual)\n", ttff);
+    check(ttff >= SIM_GPS_TTFF_COLD_SECONDS && ttff < SIM_GPS_TTFF_COLD_SECONDS + 2, "first fix after the cold-start TTFF");
+
+    int fixes = 0;
+    double end = virtualSeconds() + RATE_WINDOW_SECONDS;
+    while (virtualSeconds() < end) {
+        data = gps.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+        if (data.newFix && data.year == SIM_YEAR && data.gnssFix == 3) {
+            fixes++;
+        }
+    }
+    printf("Fixes in %d s: %d\n", RATE_WINDOW_SECONDS, fixes);
+    check(abs(fixes - EXPECTED_RATE_HZ * RATE_WINDOW_SECONDS) <= 2, "fixes arrive at the navigation rate");
+    SimSamM8qConfig model = SIM_SAM_M8Q_DEFAULT_CONFIG;
+    check(fabs(data.latitude - model.latitude) < 0.001 && fabs(data.longitude - model.longitude) < 0.001,
+        "position is on the simulated drive");
+
+    GpsBusStats bus = gps.GetBusStats();
+    printf("UART: %u reads, %u bytes read, %u bytes written\n", bus.transactions, bus.bytesRead, bus.bytesWritten);
+    check(I2cSim::GetStats().gps.transactions == 0, "nothing went over I2C");
+
+    link.running = false;
+    receiverThread.join();
+
+    return checkSummary();
+}
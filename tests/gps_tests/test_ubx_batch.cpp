@@ -0,0 +1,304 @@
+/*
+ * test_ubx_batch.cpp - Parallel batch decoding against one sequential scan
+ *
+ * Builds an 8 MB UBX stream of NAV-PVT frames with NMEA-like garbage and false sync
+ * characters in between, and places a trap on every chunk edge the decoder will cut
+ * with UBX_BATCH_MIN_CHUNK_LENGTH chunks:
+ *
+ * - contained: the edge falls in a frame whose payload holds a complete, valid NAV-PVT
+ *   frame; the chunk after the edge finds it and must drop it
+ * - lost sync: the edge falls in a frame whose payload holds the header of a false frame
+ *   that ends after a real NAV-PVT, with a valid checksum; the chunk after the edge
+ *   skips the real NAV-PVT and must be rescanned
+ * - mid frame: the edge falls in a real NAV-PVT, just before a false sync in its payload
+ * - at start: the edge falls on the first byte of a frame
+ *
+ * The stream is written as a capture cut into records of random length, with TX records
+ * in between, and as a raw UBX file. Checks that the sequential scan finds exactly the
+ * real NAV-PVT frames, that every column of the parallel decode is identical to it, and
+ * that the column file holds them. No module needed.
+ */
+
+#include "ubx_batch.h"
+#include "../test_check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <random>
+#include <vector>
+
+#define TEST_CHUNKS 8
+#define TEST_STREAM_LENGTH (TEST_CHUNKS * UBX_BATCH_MIN_CHUNK_LENGTH)
+#define TEST_THREADS 4                   // TEST_CHUNKS <= TEST_THREADS * UBX_BATCH_CHUNKS_PER_THREAD
+#define TEST_START_ITOW 200000000U
+#define TEST_FALSE_ITOW 1U               // iTOW of the NAV-PVT hidden in a payload
+#define TEST_MAX_RECORD 2000
+#define TEST_GARBAGE_EVERY 7             // NAV-PVT frames between garbage
+#define TRAP_PAYLOAD_LENGTH 300          // Payload of the frames that hide false frames
+#define TRAP_EDGE_OFFSET 50              // Payload bytes of a trap frame before the chunk edge
+#define MID_FRAME_EDGE_OFFSET 30         // Bytes of the NAV-PVT before the chunk edge
+
+#define TRAP_CONTAINED 0
+#define TRAP_LOST_SYNC 1
+#define TRAP_MID_FRAME 2
+#define TRAP_AT_START 3
+#define TRAP_COUNT 4
+
+typedef struct {
+    std::vector<uint8_t> bytes;
+    std::vector<uint32_t> iTows;     // Real NAV-PVT in stream order
+    uint32_t nextITow;
+    uint32_t lostSyncTraps;
+} TestStream;
+
+static void appendFrame(std::vector<uint8_t> &bytes, uint8_t msgClass, uint8_t msgId, const uint8_t *payload,
+        uint16_t length) {
+    uint8_t frame[UBX_MAX_FRAME_LENGTH];
+    uint16_t frameLength = ComposeFrame(frame, msgClass, msgId, length, payload);
+    bytes.insert(bytes.end(), frame, frame + frameLength);
+}
+
+/**
+ * @brief   A NAV-PVT payload; syncInLongitude puts SYNC_CHAR_1 SYNC_CHAR_2 in its payload.
+ */
+static void composePvt(uint8_t *pvt, uint32_t iTow, bool syncInLongitude) {
+    memset(pvt, 0, NAV_PVT_PAYLOAD_LENGTH);
+    NavPvt::ITow::Put(pvt, iTow);
+    NavPvt::Year::Put(pvt, 2024);
+    NavPvt::Valid::Put(pvt, VALID_DATE_FLAG | VALID_TIME_FLAG);
+    NavPvt::FixType::Put(pvt, THREE_D_FIX);
+    NavPvt::NumSv::Put(pvt, 12);
+    NavPvt::Lat::Put(pvt, 450702388 + static_cast<int32_t>(iTow % 100000));
+    NavPvt::Lon::Put(pvt, syncInLongitude ? 0x0362B5 : 76868565);
+    NavPvt::Height::Put(pvt, static_cast<int32_t>(iTow % 5000));
+}
+
+static void appendPvt(TestStream &stream, bool syncInLongitude) {
+    uint8_t pvt[NAV_PVT_PAYLOAD_LENGTH];
+    composePvt(pvt, stream.nextITow, syncInLongitude);
+    appendFrame(stream.bytes, NAV_CLASS, NAV_PVT, pvt, sizeof(pvt));
+    stream.iTows.push_back(stream.nextITow);
+    stream.nextITow += 100;
+}
+
+// Filler without SYNC_CHAR_1
+static void fillPayload(uint8_t *payload, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        payload[i] = static_cast<uint8_t>(i & 0x7F);
+    }
+}
+
+/**
+ * @brief   A frame whose payload holds a complete NAV-PVT frame after the chunk edge.
+ */
+static void appendContained(TestStream &stream) {
+    uint8_t payload[TRAP_PAYLOAD_LENGTH];
+    fillPayload(payload, sizeof(payload));
+    uint8_t pvt[NAV_PVT_PAYLOAD_LENGTH];
+    composePvt(pvt, TEST_FALSE_ITOW, false);
+    ComposeFrame(&payload[TRAP_EDGE_OFFSET + 20], NAV_CLASS, NAV_PVT, sizeof(pvt), pvt);
+    appendFrame(stream.bytes, RXM_CLASS, 0x15, payload, sizeof(payload));
+}
+
+/**
+ * @brief   A frame whose payload starts a false frame after the chunk edge; it covers the
+ *          rest of the payload and the next real NAV-PVT, followed by its checksum.
+ */
+static void appendLostSync(TestStream &stream) {
+    const size_t falseOffset = TRAP_EDGE_OFFSET + 20;
+    const uint16_t falseLength = (TRAP_PAYLOAD_LENGTH - falseOffset - UBX_HEADER_LENGTH) + UBX_CHECKSUM_LENGTH +
+        UBX_FRAME_OVERHEAD + NAV_PVT_PAYLOAD_LENGTH;
+    uint8_t payload[TRAP_PAYLOAD_LENGTH];
+    fillPayload(payload, sizeof(payload));
+    payload[falseOffset] = SYNC_CHAR_1;
+    payload[falseOffset + 1] = SYNC_CHAR_2;
+    payload[falseOffset + 2] = NAV_CLASS;
+    payload[falseOffset + 3] = NAV_STATUS;
+    UbxU2::Store(&payload[falseOffset + 4], falseLength);
+
+    size_t falseStart = stream.bytes.size() + UBX_HEADER_LENGTH + falseOffset;
+    appendFrame(stream.bytes, RXM_CLASS, 0x13, payload, sizeof(payload));
+    appendPvt(stream, false);
+    uint8_t checksumA = 0;
+    uint8_t checksumB = 0;
+    UpdateChecksum(&stream.bytes[falseStart + UBX_VIEW_CLASS_OFFSET], falseLength + 4, checksumA, checksumB);
+    stream.bytes.push_back(checksumA);
+    stream.bytes.push_back(checksumB);
+    stream.lostSyncTraps++;
+}
+
+// Bytes of a trap that lie before the chunk edge
+static size_t trapLead(uint8_t trap) {
+    switch (trap) {
+        case TRAP_CONTAINED:
+        case TRAP_LOST_SYNC:
+            return UBX_HEADER_LENGTH + TRAP_EDGE_OFFSET;
+        case TRAP_MID_FRAME:
+            return MID_FRAME_EDGE_OFFSET;
+        default:
+            return 0;
+    }
+}
+
+static void appendTrap(TestStream &stream, uint8_t trap) {
+    switch (trap) {
+        case TRAP_CONTAINED:
+            appendContained(stream);
+            break;
+        case TRAP_LOST_SYNC:
+            appendLostSync(stream);
+            break;
+        case TRAP_MID_FRAME:
+            appendPvt(stream, true);
+            break;
+        default:
+            appendPvt(stream, false);
+            break;
+    }
+}
+
+/**
+ * @brief   NAV-PVT frames and garbage up to exactly target bytes.
+ */
+static void fillTo(TestStream &stream, size_t target) {
+    // A false sync with an impossible length, and one whose checksum fails
+    static const char garbage[] = "$GNGLL,,,,,,V,N*7A\r\n\xB5\x62\x01\x07\xFF\xFF-\xB5\x62\x01\x07\x04\x00\x01\x02\x03\x04\x00\x00";
+    const size_t frameLength = UBX_FRAME_OVERHEAD + NAV_PVT_PAYLOAD_LENGTH;
+    for (uint32_t frames = 0; stream.bytes.size() + frameLength + sizeof(garbage) <= target; frames++) {
+        appendPvt(stream, false);
+        if (frames % TEST_GARBAGE_EVERY == 0) {
+            stream.bytes.insert(stream.bytes.end(), garbage, garbage + sizeof(garbage) - 1);
+        }
+    }
+    stream.bytes.resize(target, '-');
+}
+
+static TestStream buildStream(void) {
+    TestStream stream;
+    stream.nextITow = TEST_START_ITOW;
+    stream.lostSyncTraps = 0;
+    stream.bytes.reserve(TEST_STREAM_LENGTH);
+    for (uint32_t edge = 1; edge < TEST_CHUNKS; edge++) {
+        uint8_t trap = (edge - 1) % TRAP_COUNT;
+        fillTo(stream, static_cast<size_t>(TEST_STREAM_LENGTH) / TEST_CHUNKS * edge - trapLead(trap));
+        appendTrap(stream, trap);
+    }
+    fillTo(stream, TEST_STREAM_LENGTH);
+    return stream;
+}
+
+/**
+ * @brief   Write the stream as RX records of random length with a TX record now and then.
+ */
+static bool writeCapture(const char *path, const std::vector<uint8_t> &bytes) {
+    UbxCaptureWriter writer;
+    if (!writer.Open(path)) {
+        return false;
+    }
+    std::mt19937 random(13);
+    std::uniform_int_distribution<size_t> recordLength(1, TEST_MAX_RECORD);
+    uint8_t poll[UBX_FRAME_OVERHEAD];
+    uint16_t pollLength = ComposeFrame(poll, NAV_CLASS, NAV_PVT, 0, nullptr);
+    uint64_t hostNanos = 1000000000ULL;
+    for (size_t offset = 0; offset < bytes.size(); ) {
+        size_t length = std::min(recordLength(random), bytes.size() - offset);
+        if (length % 5 == 0) {
+            writer.Write(CAPTURE_RECORD_TX, hostNanos, poll, pollLength);
+        }
+        writer.Write(CAPTURE_RECORD_RX, hostNanos, &bytes[offset], static_cast<uint16_t>(length));
+        offset += length;
+        hostNanos += 1000000ULL;
+    }
+    writer.Close();
+    return writer.GetStats().errors == 0;
+}
+
+static bool writeRaw(const char *path, const std::vector<uint8_t> &bytes) {
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && ok;
+}
+
+static bool sameColumns(const PvtColumns &a, const PvtColumns &b) {
+    bool same = a.Rows() == b.Rows();
+#define PVT_COLUMN_SAME(type, name, dtype) \
+    same = same && memcmp(a.name.data(), b.name.data(), a.Rows() * sizeof(type)) == 0;
+    PVT_COLUMN_LIST(PVT_COLUMN_SAME)
+#undef PVT_COLUMN_SAME
+    return same;
+}
+
+static bool temporaryPath(char *path) {
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("Failed to create temporary file");
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+int main(void) {
+    char capturePath[] = "/tmp/test_ubx_batch_XXXXXX";
+    char rawPath[] = "/tmp/test_ubx_batch_raw_XXXXXX";
+    char columnPath[] = "/tmp/test_ubx_batch_pvtcol_XXXXXX";
+    if (!temporaryPath(capturePath) || !temporaryPath(rawPath) || !temporaryPath(columnPath)) {
+        return 1;
+    }
+
+    TestStream stream = buildStream();
+    check(stream.bytes.size() == TEST_STREAM_LENGTH, "the stream fills the chunks exactly");
+    check(writeCapture(capturePath, stream.bytes) && writeRaw(rawPath, stream.bytes), "capture and raw file are written");
+
+    UbxBatchDecoder decoder;
+    check(decoder.Open(capturePath), "capture is mapped");
+    PvtColumns sequential;
+    PvtColumns parallel;
+    decoder.Decode(sequential, 1);
+    UbxBatchStats sequentialStats = decoder.GetStats();
+    decoder.Decode(parallel, TEST_THREADS);
+    UbxBatchStats stats = decoder.GetStats();
+    printf("%llu bytes in %u records: %zu rows, %u chunks, %u rescanned, %llu/%llu frames\n",
+        static_cast<unsigned long long>(stats.streamBytes), stats.spans, parallel.Rows(), stats.chunks,
+        stats.rescannedChunks, static_cast<unsigned long long>(sequentialStats.frames),
+        static_cast<unsigned long long>(stats.frames));
+
+    check(sequentialStats.chunks == 1 && stats.chunks == TEST_CHUNKS, "the stream is cut at the planned edges");
+    check(sequential.iTOW == stream.iTows, "the sequential scan finds exactly the real NAV-PVT");
+    check(sequentialStats.checksumFailures > 0, "false syncs in garbage fail the checksum");
+    check(sameColumns(sequential, parallel), "every parallel column matches the sequential scan");
+    check(stats.frames == sequentialStats.frames && stats.rows == sequentialStats.rows,
+        "false frames found after chunk edges are dropped");
+    check(stats.rescannedChunks == stream.lostSyncTraps, "a chunk that lost sync at its start is rescanned");
+    bool stamped = true;
+    for (size_t i = 1; i < parallel.Rows(); i++) {
+        stamped = stamped && parallel.hostReceiveNanos[i] >= parallel.hostReceiveNanos[i - 1] &&
+            parallel.newFix[i] == 1 && parallel.hostEpochNanos[i] != 0;
+    }
+    check(stamped, "rows carry their record stamps and epoch times");
+
+    PvtColumns raw;
+    UbxBatchDecoder rawDecoder;
+    check(rawDecoder.Open(rawPath) && rawDecoder.Decode(raw, TEST_THREADS), "raw file is decoded");
+    check(rawDecoder.GetStats().spans == 1 && raw.iTOW == sequential.iTOW && raw.latitude == sequential.latitude &&
+        raw.hostReceiveNanos[0] == 0, "a raw UBX file decodes to the same rows without host times");
+
+    check(WritePvtColumns(columnPath, parallel), "columns are written");
+    FILE *file = fopen(columnPath, "rb");
+    uint8_t header[PVT_COLUMNS_HEADER_LENGTH] = {0};
+    bool read = file != nullptr && fread(header, 1, sizeof(header), file) == sizeof(header);
+    if (file != nullptr) {
+        fclose(file);
+    }
+    check(read && memcmp(header, PVT_COLUMNS_MAGIC, PVT_COLUMNS_MAGIC_LENGTH) == 0 &&
+        UbxWire<uint64_t>::Load(&header[16]) == parallel.Rows(), "the column file header counts the rows");
+
+    unlink(capturePath);
+    unlink(rawPath);
+    unlink(columnPath);
+    return checkSummary();
+}
@@ -0,0 +1,185 @@
+/*
+ * test_ubx_capture.cpp - Capture files written, read back and replayed through the driver
+ *
+ * Writes a capture of synthetic NAV-PVT and NAV-STATUS frames, cut into RX records at
+ * odd offsets so frames span records, with TX records (polls) in between. Checks that
+ * UbxCaptureReader returns exactly the RX bytes with their stamps and skips the TX
+ * records, that a record cut short by the end of the file ends the replay, and that
+ * replaying through Gps with the loop of gps_capture.cpp delivers every fix, the ones
+ * in the last record included. No module needed.
+ */
+
+#include "gps.h"
+#include "../test_check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#define TEST_YEAR 2024
+#define TEST_EPOCHS 200
+#define TEST_START_ITOW 100000000U
+#define TEST_FIX_PERIOD_MILLIS 100
+#define TEST_RECORD_LENGTH 333           // Not a multiple of any frame length
+#define TEST_STAMP_STEP_NANOS 7000000ULL
+#define TEST_READ_CHUNK 50               // Reader chunks smaller than a record
+#define NAV_STATUS_PAYLOAD_LENGTH 16
+
+typedef struct {
+    uint64_t hostNanos;
+    size_t offset;               // Into the stream
+    size_t length;
+} RecordSpan;
+
+static void appendFrame(std::vector<uint8_t> &stream, uint8_t msgClass, uint8_t msgId, const uint8_t *payload,
+        uint16_t length) {
+    uint8_t frame[UBX_MAX_FRAME_LENGTH];
+    uint16_t frameLength = ComposeFrame(frame, msgClass, msgId, length, payload);
+    stream.insert(stream.end(), frame, frame + frameLength);
+}
+
+static std::vector<uint8_t> buildStream(void) {
+    std::vector<uint8_t> stream;
+    for (uint32_t epoch = 0; epoch < TEST_EPOCHS; epoch++) {
+        uint32_t iTow = TEST_START_ITOW + epoch * TEST_FIX_PERIOD_MILLIS;
+        uint8_t pvt[NAV_PVT_PAYLOAD_LENGTH] = {0};
+        NavPvt::ITow::Put(pvt, iTow);
+        NavPvt::Year::Put(pvt, TEST_YEAR);
+        NavPvt::Valid::Put(pvt, VALID_DATE_FLAG | VALID_TIME_FLAG);
+        NavPvt::FixType::Put(pvt, THREE_D_FIX);
+        NavPvt::Flags::Put(pvt, NAV_PVT_FLAGS_GNSS_FIX_OK);
+        NavPvt::Lat::Put(pvt, 450702388 + static_cast<int32_t>(epoch));
+        NavPvt::Lon::Put(pvt, 76868565);
+        appendFrame(stream, NAV_CLASS, NAV_PVT, pvt, sizeof(pvt));
+
+        uint8_t status[NAV_STATUS_PAYLOAD_LENGTH] = {0};
+        UbxU4::Store(&status[0], iTow);
+        status[4] = THREE_D_FIX;
+        appendFrame(stream, NAV_CLASS, NAV_STATUS, status, sizeof(status));
+    }
+    return stream;
+}
+
+/**
+ * @brief   Write the stream as RX records of TEST_RECORD_LENGTH with a poll (TX) every few.
+ *
+ * @return  The RX records written.
+ */
+static std::vector<RecordSpan> writeCapture(const char *path, const std::vector<uint8_t> &stream) {
+    std::vector<RecordSpan> records;
+    UbxCaptureWriter writer;
+    if (!writer.Open(path)) {
+        return records;
+    }
+    uint8_t poll[UBX_FRAME_OVERHEAD];
+    uint16_t pollLength = ComposeFrame(poll, NAV_CLASS, NAV_PVT, 0, nullptr);
+    uint64_t hostNanos = 1000000000ULL;
+    for (size_t offset = 0; offset < stream.size(); offset += TEST_RECORD_LENGTH) {
+        size_t length = stream.size() - offset < TEST_RECORD_LENGTH ? stream.size() - offset : TEST_RECORD_LENGTH;
+        if (records.size() % 3 == 0) {
+            writer.Write(CAPTURE_RECORD_TX, hostNanos - 1000, poll, pollLength);
+        }
+        writer.Write(CAPTURE_RECORD_RX, hostNanos, &stream[offset], static_cast<uint16_t>(length));
+        records.push_back({hostNanos, offset, length});
+        hostNanos += TEST_STAMP_STEP_NANOS;
+    }
+    writer.Close();
+    UbxCaptureStats stats = writer.GetStats();
+    check(stats.errors == 0 && stats.records == records.size() + (records.size() + 2) / 3, "capture is written");
+    return records;
+}
+
+/**
+ * @brief   Read every replayable byte in TEST_READ_CHUNK reads.
+ *
+ * @param   stamps  Set to the recorded time of each byte.
+ */
+static std::vector<uint8_t> readCapture(UbxCaptureReader &reader, std::vector<uint64_t> &stamps) {
+    std::vector<uint8_t> bytes;
+    uint8_t buf[TEST_READ_CHUNK];
+    while (reader.Available(EpochScheduler::NowNanos()) > 0) {
+        uint64_t hostNanos = 0;
+        uint16_t length = reader.Read(buf, sizeof(buf), hostNanos);
+        bytes.insert(bytes.end(), buf, buf + length);
+        stamps.insert(stamps.end(), length, hostNanos);
+    }
+    return bytes;
+}
+
+static bool stampsMatch(const std::vector<uint64_t> &stamps, const std::vector<RecordSpan> &records, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const RecordSpan &record = records[i];
+        for (size_t j = 0; j < record.length; j++) {
+            if (record.offset + j >= stamps.size() || stamps[record.offset + j] != record.hostNanos) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(void) {
+    char path[] = "/tmp/test_ubx_capture_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("Failed to create temporary capture");
+        return 1;
+    }
+    close(fd);
+
+    std::vector<uint8_t> stream = buildStream();
+    std::vector<RecordSpan> records = writeCapture(path, stream);
+
+    UbxCaptureReader reader;
+    check(reader.Open(path, CAPTURE_REPLAY_FAST), "capture is opened");
+    std::vector<uint64_t> stamps;
+    std::vector<uint8_t> replayed = readCapture(reader, stamps);
+    UbxCaptureStats stats = reader.GetStats();
+    printf("%zu bytes in %zu RX records, %zu replayed\n", stream.size(), records.size(), replayed.size());
+    check(replayed == stream, "RX bytes read back identical, TX records skipped");
+    check(stampsMatch(stamps, records, records.size()), "each byte carries its record's stamp");
+    check(reader.AtEnd() && stats.records == records.size() && stats.bytes == stream.size(), "reader stats count the RX records");
+
+    reader.Rewind();
+    stamps.clear();
+    check(readCapture(reader, stamps) == stream, "Rewind replays from the first record");
+
+    // The replay loop of gps_capture.cpp: the last record holds several fixes
+    reader.Rewind();
+    Gps gps(TEST_YEAR, reader);
+    uint32_t fixes = 0;
+    uint32_t lastITow = 0;
+    bool ordered = true;
+    while (!reader.AtEnd() || gps.HasPendingData()) {
+        PVTData data = gps.GetPvt(false, 0);
+        if (data.year != TEST_YEAR) {
+            continue;
+        }
+        ordered = ordered && (fixes == 0 || data.iTOW == lastITow + TEST_FIX_PERIOD_MILLIS);
+        lastITow = data.iTOW;
+        fixes++;
+    }
+    printf("Replayed %u of %d fixes\n", fixes, TEST_EPOCHS);
+    check(fixes == TEST_EPOCHS && ordered, "replay delivers every fix, the last record's included");
+
+    // Cut the file inside the last RX record: the replay ends before it
+    reader.Close();
+    FILE *file = fopen(path, "r+");
+    check(file != nullptr && fseek(file, 0, SEEK_END) == 0, "capture is reopened");
+    long size = file != nullptr ? ftell(file) : 0;
+    if (file != nullptr) {
+        fclose(file);
+    }
+    check(truncate(path, size - 5) == 0, "capture is cut short");
+    check(reader.Open(path, CAPTURE_REPLAY_FAST), "cut capture is opened");
+    stamps.clear();
+    replayed = readCapture(reader, stamps);
+    size_t complete = records.back().offset;
+    check(replayed.size() == complete && std::equal(replayed.begin(), replayed.end(), stream.begin()) &&
+        stampsMatch(stamps, records, records.size() - 1), "a truncated record ends the replay");
+
+    reader.Close();
+    unlink(path);
+    return checkSummary();
+}
@@ -0,0 +1,211 @@
+/*
+ * test_ubx_dispatch.cpp - Routing of framed UBX messages to their handlers
+ *
+ * Composes NAV-PVT, NAV-STATUS, MON-HW and ACK-ACK frames, feeds them back to back,
+ * split at odd offsets and behind garbage through UbxFramer, and dispatches every
+ * frame. Checks that each handler gets only its own messages with its context and
+ * decodes the fields that were put in, that messages without a handler are counted,
+ * that re-registering replaces and unregistering removes a handler, and that
+ * UBX_DISPATCH_MAX_CLASSES is enforced. No module needed.
+ */
+
+#include "ubx_dispatch.h"
+#include "ubx_framer.h"
+#include "ubx_msg.h"
+#include "../test_check.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define TEST_EPOCHS 50
+#define TEST_START_ITOW 345600000U       // ms
+#define TEST_CHUNK 7                     // Bytes per framer input chunk, splits every frame
+#define NAV_STATUS_PAYLOAD_LENGTH 16
+#define MON_HW_PAYLOAD_LENGTH 60
+
+typedef struct {
+    uint32_t calls;
+    uint32_t wrongMessage;       // Calls with another class/id than registered
+    uint32_t wrongFields;        // Calls whose decoded fields differ from the ones composed
+    uint32_t lastITow;
+} HandlerLog;
+
+// The fields NAV-PVT epoch i is composed with
+static int32_t latitudeOf(uint32_t epoch) { return 450702388 + static_cast<int32_t>(epoch) * 17; }
+static int32_t longitudeOf(uint32_t epoch) { return 76868565 - static_cast<int32_t>(epoch) * 23; }
+static int32_t velocityNorthOf(uint32_t epoch) { return 12345 - static_cast<int32_t>(epoch) * 100; }
+
+static void onNavPvt(const UbxMessageView &msg, void *context) {
+    HandlerLog *log = static_cast<HandlerLog *>(context);
+    log->calls++;
+    NavPvtView pvt(msg);
+    if (!pvt.IsValid()) {
+        log->wrongMessage++;
+        return;
+    }
+    uint32_t epoch = (pvt.ITow() - TEST_START_ITOW) / 100;
+    bool fieldsOk = pvt.ITow() == TEST_START_ITOW + epoch * 100 && pvt.Year() == 2024 && pvt.FixType() == THREE_D_FIX &&
+        pvt.NumSv() == 14 && NavPvt::Lat::Raw(msg.Payload().data()) == latitudeOf(epoch) &&
+        NavPvt::Lon::Raw(msg.Payload().data()) == longitudeOf(epoch) && pvt.VelocityNorth() == velocityNorthOf(epoch) &&
+        pvt.Height() == -1200;
+    log->wrongFields += fieldsOk ? 0 : 1;
+    log->lastITow = pvt.ITow();
+}
+
+static void onNavStatus(const UbxMessageView &msg, void *context) {
+    HandlerLog *log = static_cast<HandlerLog *>(context);
+    log->calls++;
+    if (!msg.Is(NAV_CLASS, NAV_STATUS) || msg.PayloadLength() != NAV_STATUS_PAYLOAD_LENGTH) {
+        log->wrongMessage++;
+        return;
+    }
+    // iTOW, gpsFix, flags, then msss (ms since startup)
+    bool fieldsOk = msg.U1(4) == THREE_D_FIX && msg.U4(12) == msg.U4(0) - TEST_START_ITOW + 5000;
+    log->wrongFields += fieldsOk ? 0 : 1;
+    log->lastITow = msg.U4(0);
+}
+
+static void onMonHw(const UbxMessageView &msg, void *context) {
+    HandlerLog *log = static_cast<HandlerLog *>(context);
+    log->calls++;
+    if (!msg.Is(MON_CLASS, MON_HW) || msg.PayloadLength() != MON_HW_PAYLOAD_LENGTH) {
+        log->wrongMessage++;
+        return;
+    }
+    // noisePerMS, agcCnt, aStatus
+    log->wrongFields += msg.U2(16) == 87 && msg.U2(18) == 4321 && msg.U1(20) == 2 ? 0 : 1;
+}
+
+static void onOther(const UbxMessageView &msg, void *context) {
+    HandlerLog *log = static_cast<HandlerLog *>(context);
+    log->calls++;
+    (void)msg;
+}
+
+static void appendFrame(std::vector<uint8_t> &stream, uint8_t msgClass, uint8_t msgId, uint16_t length,
+        const uint8_t *payload) {
+    uint8_t frame[MAX_MESSAGE_LENGTH + 8];
+    uint16_t frameLength = ComposeFrame(frame, msgClass, msgId, length, payload);
+    stream.insert(stream.end(), frame, frame + frameLength);
+}
+
+/**
+ * @brief   One epoch per 100 ms: NAV-PVT, NAV-STATUS, every 10th a MON-HW, and an ACK-ACK
+ *          and some NMEA-like garbage in between.
+ */
+static std::vector<uint8_t> composeStream(void) {
+    std::vector<uint8_t> stream;
+    for (uint32_t epoch = 0; epoch < TEST_EPOCHS; epoch++) {
+        uint32_t iTow = TEST_START_ITOW + epoch * 100;
+        uint8_t pvt[NAV_PVT_PAYLOAD_LENGTH] = {0};
+        NavPvt::ITow::Put(pvt, iTow);
+        NavPvt::Year::Put(pvt, 2024);
+        NavPvt::FixType::Put(pvt, THREE_D_FIX);
+        NavPvt::NumSv::Put(pvt, 14);
+        NavPvt::Lat::Put(pvt, latitudeOf(epoch));
+        NavPvt::Lon::Put(pvt, longitudeOf(epoch));
+        NavPvt::Height::Put(pvt, -1200);
+        NavPvt::VelN::Put(pvt, velocityNorthOf(epoch));
+        appendFrame(stream, NAV_CLASS, NAV_PVT, NAV_PVT_PAYLOAD_LENGTH, pvt);
+
+        const char *garbage = "$GNGLL,,,,,,V,N*7A\r\n\xB5";
+        stream.insert(stream.end(), garbage, garbage + strlen(garbage));
+
+        uint8_t status[NAV_STATUS_PAYLOAD_LENGTH] = {0};
+        UbxU4::Store(&status[0], iTow);
+        status[4] = THREE_D_FIX;
+        UbxU4::Store(&status[12], epoch * 100 + 5000);
+        appendFrame(stream, NAV_CLASS, NAV_STATUS, NAV_STATUS_PAYLOAD_LENGTH, status);
+
+        if (epoch % 10 == 0) {
+            uint8_t hw[MON_HW_PAYLOAD_LENGTH] = {0};
+            UbxU2::Store(&hw[16], 87);
+            UbxU2::Store(&hw[18], 4321);
+            hw[20] = 2;
+            appendFrame(stream, MON_CLASS, MON_HW, MON_HW_PAYLOAD_LENGTH, hw);
+        }
+        const uint8_t ack[2] = {CFG_CLASS, 0x01};
+        appendFrame(stream, ACK_CLASS, ACK_ACK, sizeof(ack), ack);
+    }
+    return stream;
+}
+
+/**
+ * @brief   Frame the stream in TEST_CHUNK byte reads and dispatch every frame.
+ *
+ * @return  The number of frames found.
+ */
+static uint32_t feed(UbxDispatcher &dispatcher, const std::vector<uint8_t> &stream) {
+    UbxFramer framer;
+    uint32_t frames = 0;
+    for (size_t start = 0; start < stream.size(); start += TEST_CHUNK) {
+        size_t length = stream.size() - start < TEST_CHUNK ? stream.size() - start : TEST_CHUNK;
+        size_t offset = 0;
+        while (true) {
+            offset += framer.Consume(&stream[start + offset], length - offset);
+            if (!framer.FrameReady()) {
+                break;
+            }
+            frames++;
+            dispatcher.Dispatch(UbxMessageView(framer.Frame()));
+        }
+    }
+    return frames;
+}
+
+int main(void) {
+    std::vector<uint8_t> stream = composeStream();
+    uint32_t monHwCount = (TEST_EPOCHS + 9) / 10;
+    uint32_t frameCount = 3 * TEST_EPOCHS + monHwCount;
+
+    UbxDispatcher dispatcher;
+    HandlerLog pvtLog = {};
+    HandlerLog statusLog = {};
+    HandlerLog hwLog = {};
+    check(dispatcher.Register(NAV_CLASS, NAV_PVT, onNavPvt, &pvtLog) &&
+        dispatcher.Register(NAV_CLASS, NAV_STATUS, onNavStatus, &statusLog) &&
+        dispatcher.Register(MON_CLASS, MON_HW, onMonHw, &hwLog), "handlers are registered");
+    check(!dispatcher.Register(NAV_CLASS, NAV_SAT, nullptr, nullptr), "a null handler is refused");
+
+    uint32_t frames = feed(dispatcher, stream);
+    UbxDispatchStats stats = dispatcher.GetStats();
+    printf("%zu bytes, %u frames: %u dispatched, %u unhandled\n", stream.size(), frames, stats.dispatched, stats.unhandled);
+    check(frames == frameCount, "every frame is found across chunk edges and garbage");
+    check(pvtLog.calls == TEST_EPOCHS && statusLog.calls == TEST_EPOCHS && hwLog.calls == monHwCount,
+        "each handler gets every message of its class and id");
+    check(pvtLog.wrongMessage == 0 && statusLog.wrongMessage == 0 && hwLog.wrongMessage == 0,
+        "and only those");
+    check(pvtLog.wrongFields == 0 && statusLog.wrongFields == 0 && hwLog.wrongFields == 0,
+        "decoded fields match the composed ones");
+    check(pvtLog.lastITow == TEST_START_ITOW + (TEST_EPOCHS - 1) * 100 && statusLog.lastITow == pvtLog.lastITow,
+        "messages arrive in stream order");
+    check(stats.dispatched == 2 * TEST_EPOCHS + monHwCount && stats.unhandled == TEST_EPOCHS,
+        "ACK-ACK without a handler is counted unhandled");
+
+    // Replace the NAV-PVT handler, drop NAV-STATUS
+    HandlerLog replacedLog = {};
+    dispatcher.Register(NAV_CLASS, NAV_PVT, onOther, &replacedLog);
+    dispatcher.Unregister(NAV_CLASS, NAV_STATUS);
+    dispatcher.Unregister(TIM_CLASS, 0x01);
+    dispatcher.ResetStats();
+    feed(dispatcher, stream);
+    stats = dispatcher.GetStats();
+    check(replacedLog.calls == TEST_EPOCHS && pvtLog.calls == TEST_EPOCHS, "registering again replaces the handler");
+    check(statusLog.calls == TEST_EPOCHS && stats.unhandled == 2 * TEST_EPOCHS, "an unregistered message is unhandled");
+    check(!dispatcher.Dispatch(UbxMessageView()), "an empty view is not dispatched");
+
+    // Two classes are in use; fill the rest and one more must be refused
+    HandlerLog otherLog = {};
+    const uint8_t classes[] = {RXM_CLASS, INF_CLASS, ACK_CLASS, CFG_CLASS, UPD_CLASS, AID_CLASS, TIM_CLASS};
+    uint32_t accepted = 0;
+    for (size_t i = 0; i < sizeof(classes); i++) {
+        accepted += dispatcher.Register(classes[i], 0x01, onOther, &otherLog) ? 1 : 0;
+    }
+    check(accepted == UBX_DISPATCH_MAX_CLASSES - 2, "UBX_DISPATCH_MAX_CLASSES classes can have handlers");
+    check(dispatcher.Register(NAV_CLASS, NAV_SAT, onOther, &otherLog), "a class in use takes more ids");
+    uint32_t before = otherLog.calls;
+    feed(dispatcher, stream);
+    check(otherLog.calls == before + TEST_EPOCHS, "ACK-ACK is routed once its class has a handler");
+
+    return checkSummary();
+}
@@ -0,0 +1,81 @@
+/*
+ * bench_imu_read.cpp - Achievable IMU sample rate with byte-wise and burst reads
+ *
+ * Reads the IMU back to back for SAMPLE_SECONDS of virtual time on the simulated bus
+ * (see include/i2c_sim.h), once per read mode and bus speed, and reports samples per
+ * second, transactions and bus time per sample. The bus-limited rate counts only the
+ * time the simulated bus was busy, so it does not depend on how quickly this machine
+ * wakes from the simulated transfer delays. No hardware needed.
+ */
+
+#include "i2c_sim.h"
+#include "imu.h"
+#include "../test_check.h"
+#include <stdio.h>
+
+#define SAMPLE_SECONDS 1
+#define TARGET_RATE_HZ 400            // "Several hundred Hz"
+#define SLOW_BUS_HZ 100000
+#define FAST_BUS_HZ 400000
+
+typedef struct {
+    double samplesPerSecond;     // Measured back to back in virtual time
+    double busLimitedRate;       // 1 / bus time per sample
+    double transactionsPerSample;
+    bool valid;                  // Every read succeeded and the accelerometer reads about 1 g
+} ReadRun;
+
+/**
+ * @brief   Sample the IMU back to back for SAMPLE_SECONDS with the given mode and bus speed.
+ */
+static ReadRun benchmark_mode(Imu &imu, uint32_t busHz, uint8_t mode, const char *name) {
+    I2cSimConfig config = I2cSim::GetConfig();
+    config.busHz = busHz;
+    I2cSim::Configure(config);
+    imu.SetReadMode(mode);
+    imu.ReadSensorData();             // Select bank 0 outside the measurement
+    I2cSim::ResetStats();
+
+    ReadRun result = {};
+    result.valid = true;
+    uint32_t samples = 0;
+    uint64_t start = I2cSim::NowNanos();
+    uint64_t end = start + SAMPLE_SECONDS * 1000000000ULL;
+    while (I2cSim::NowNanos() < end) {
+        result.valid = imu.ReadSensorData() && result.valid;
+        samples++;
+    }
+    double seconds = (I2cSim::NowNanos() - start) / 1e9;
+    double accelZ = imu.GetRawAccelerometerData()[Z_AXIS] * ACCEL_MG_LSB_2G;
+    result.valid = result.valid && accelZ > 0.9 && accelZ < 1.1;
+
+    I2cSimStats stats = I2cSim::GetStats();
+    result.samplesPerSecond = samples / seconds;
+    result.busLimitedRate = samples * 1e9 / stats.imu.busyNanos;
+    result.transactionsPerSample = static_cast<double>(stats.imu.transactions) / samples;
+    printf("%-5s at %3u kHz: %7.1f samples/s (bus-limited %7.1f), %4.1f transactions/sample, %6.1f us bus time/sample\n",
+        name, busHz / 1000, result.samplesPerSecond, result.busLimitedRate, result.transactionsPerSample,
+        stats.imu.busyNanos / 1e3 / samples);
+    return result;
+}
+
+int main(void) {
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    I2cSim::Configure(config);
+    printf("Simulated bus: %u us per transaction\n", config.latencyMicros);
+
+    Imu imu;
+    ReadRun slowByte = benchmark_mode(imu, SLOW_BUS_HZ, IMU_READ_MODE_BYTE, "byte");
+    ReadRun slowBlock = benchmark_mode(imu, SLOW_BUS_HZ, IMU_READ_MODE_BLOCK, "block");
+    ReadRun fastByte = benchmark_mode(imu, FAST_BUS_HZ, IMU_READ_MODE_BYTE, "byte");
+    ReadRun fastBlock = benchmark_mode(imu, FAST_BUS_HZ, IMU_READ_MODE_BLOCK, "block");
+
+    check(slowByte.valid && slowBlock.valid && fastByte.valid && fastBlock.valid, "every sample is read and plausible");
+    check(slowBlock.transactionsPerSample == 1.0 && fastBlock.transactionsPerSample == 1.0, "a burst sample is one transaction");
+    check(slowByte.busLimitedRate < TARGET_RATE_HZ, "byte-wise reads cannot reach the target rate at 100 kHz");
+    check(slowBlock.busLimitedRate >= TARGET_RATE_HZ && fastBlock.busLimitedRate >= TARGET_RATE_HZ,
+        "burst reads reach the target rate at 100 and 400 kHz");
+    check(fastBlock.busLimitedRate > 3 * fastByte.busLimitedRate, "burst reads sample at least 3x faster at 400 kHz");
+
+    return checkSummary();
+}
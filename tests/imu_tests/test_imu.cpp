@@ -30,11 +30,63 @@ void signal_handler(int signum) {
     }
 }
 
-int main(void) {
+#define FIFO_DEFAULT_RATE_HZ 1100
+#define FIFO_DRAIN_PERIOD_MS 10
+
+/**
+ * @brief   Stream from the IMU FIFO, draining it every FIFO_DRAIN_PERIOD_MS and
+ *          printing one line per second: samples, overflows and the mean readings.
+ */
+void run_fifo(Imu &imu_module, uint16_t rateHz) {
+  if (!imu_module.StartFifo(rateHz)) {
+    return;
+  }
+  printf("FIFO at %.1f Hz\n", imu_module.GetFifoRate());
+
+  ImuSample batch[FIFO_MAX_FRAMES];
+  auto next = std::chrono::steady_clock::now();
+  auto report = next + std::chrono::seconds(1);
+  uint32_t samples = 0;
+  double accel[3] = {0.0, 0.0, 0.0};
+  double gyro[3] = {0.0, 0.0, 0.0};
+  while (!exit_flag) {
+    next += std::chrono::milliseconds(FIFO_DRAIN_PERIOD_MS);
+    std::this_thread::sleep_until(next);
+    int count = imu_module.ReadFifo(batch, FIFO_MAX_FRAMES);
+    for (int i = 0; i < count; i++) {
+      for (int axis = 0; axis < 3; axis++) {
+        accel[axis] += batch[i].accelerometer[axis];
+        gyro[axis] += batch[i].gyroscope[axis];
+      }
+    }
+    samples += count > 0 ? count : 0;
+
+    if (next >= report && samples > 0) {
+      ImuFifoStats stats = imu_module.GetFifoStats();
+      printf("%u samples, %u overflows (%u lost), mean accel (%.0f, %.0f, %.0f) gyro (%.0f, %.0f, %.0f)\n",
+        samples, stats.overflows, stats.samplesLost, accel[0] / samples, accel[1] / samples, accel[2] / samples,
+        gyro[0] / samples, gyro[1] / samples, gyro[2] / samples);
+      report += std::chrono::seconds(1);
+      samples = 0;
+      for (int axis = 0; axis < 3; axis++) {
+        accel[axis] = 0.0;
+        gyro[axis] = 0.0;
+      }
+    }
+  }
+  imu_module.StopFifo();
+}
+
+int main(int argc, char **argv) {
   // Register the signal handler for SIGINT (Ctrl+C)
   signal(SIGINT, signal_handler);
 
   Imu imu_module;
+  if (argc > 1 && std::string(argv[1]) == "fifo") {
+    run_fifo(imu_module, argc > 2 ? atoi(argv[2]) : FIFO_DEFAULT_RATE_HZ);
+    std::cout << "Exiting program." << std::endl;
+    return 0;
+  }
   while (!exit_flag) {
     imu_module.ReadSensorData();
     printf("--------------------\n");
@@ -0,0 +1,215 @@
+/*
+ * test_imu_bias.cpp - Accelerometer and gyro biases tracked at standstill and over temperature
+ *
+ * Simulates a 40 minute drive at 100 Hz while the die warms from 20 to 45 degrees C:
+ * stops in different attitudes, vibrating drives with turns, and a quiet steady turn.
+ * The true biases follow a linear temperature model. Checks that ImuBiasEstimator
+ * takes only the stops as standstill, recovers the biases and their temperature
+ * coefficients, and that the heading integrated from the gyro drifts far less than
+ * with biases calibrated once. Then reads the die temperature and fits the biases of
+ * the simulated sensor on the simulated bus. No hardware needed.
+ */
+
+#include "i2c_sim.h"
+#include "imu.h"
+#include "imu_bias.h"
+#include "../test_check.h"
+#include <math.h>
+#include <random>
+#include <stdio.h>
+
+#define RATE_HZ 100
+#define CYCLE_SECONDS 60             // A stop, a drive, a steady turn
+#define STOP_SECONDS 20
+#define TURN_SECONDS 10              // At the end of the drive
+#define DRIVE_SECONDS 2400
+#define START_C 20.0
+#define END_C 45.0
+#define STILL_GYRO_NOISE 0.003       // rad/s
+#define STILL_ACCEL_NOISE 0.003      // g
+#define DRIVE_GYRO_NOISE 0.05        // Vibration while driving
+#define DRIVE_ACCEL_NOISE 0.08
+#define TURN_RATE 0.3                // rad/s, steady and quiet
+#define GYRO_TOLERANCE 0.0005        // rad/s
+#define ACCEL_TOLERANCE 0.003        // g
+#define SLOPE_TOLERANCE 0.15         // Relative
+#define SIM_WINDOWS 40
+#define SIM_WINDOW_SAMPLES 50
+
+static bool near(double value, double expected, double tolerance) {
+    return fabs(value - expected) < tolerance;
+}
+
+/** True biases at REFERENCE_C and their temperature coefficients */
+static const ImuBiases BIAS_25C = {{0.01F, -0.015F, 0.02F}, {0.01F, -0.006F, 0.004F}};
+static const ImuBiases SLOPE = {{0.0F, 0.0F, 0.0005F}, {0.0004F, -0.0003F, 0.0002F}};
+
+static double trueBias(const float *bias, const float *slope, int axis, double temperature) {
+    return bias[axis] + slope[axis] * (temperature - IMU_BIAS_REFERENCE_C);
+}
+
+/**
+ * @brief   Gravity in body axes for the attitude of a stop (level, rolled, pitched).
+ */
+static void stopGravity(int stop, double gravity[3]) {
+    static const double attitudes[][2] = {{0.0, 0.0}, {0.35, 0.0}, {0.0, 0.3}, {-0.3, -0.25}};
+    const double *attitude = attitudes[stop % 4];
+    double roll = attitude[0];
+    double pitch = attitude[1];
+    gravity[X_AXIS] = -sin(pitch);
+    gravity[Y_AXIS] = sin(roll) * cos(pitch);
+    gravity[Z_AXIS] = cos(roll) * cos(pitch);
+}
+
+static void testDrive(void) {
+    std::mt19937 random(7);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    ImuBiases calibratedOnce = BIAS_25C;
+    ImuBiasEstimator estimator(calibratedOnce);
+    ImuBiases tracked = calibratedOnce;
+
+    uint32_t samples = DRIVE_SECONDS * RATE_HZ;
+    uint32_t stopWindows = 0;
+    uint32_t stopsFound = 0;
+    uint32_t falseStill = 0;
+    uint32_t turnsStill = 0;
+    bool windowAllStopped = true;
+    bool windowInTurn = false;
+    double heading = 0.0;
+    double headingOnce = 0.0;
+    double headingTracked = 0.0;
+    double temperature = START_C;
+    for (uint32_t i = 0; i < samples; i++) {
+        double t = static_cast<double>(i) / RATE_HZ;
+        temperature = START_C + (END_C - START_C) * t / DRIVE_SECONDS;
+        double inCycle = fmod(t, CYCLE_SECONDS);
+        int cycle = static_cast<int>(t / CYCLE_SECONDS);
+        bool stopped = inCycle < STOP_SECONDS;
+        bool turning = inCycle >= CYCLE_SECONDS - TURN_SECONDS;
+
+        double gravity[3];
+        stopGravity(cycle, gravity);
+        double rate[3] = {0.0, 0.0, 0.0};
+        double gyroNoise = STILL_GYRO_NOISE;
+        double accelNoise = STILL_ACCEL_NOISE;
+        if (turning) {
+            rate[Z_AXIS] = TURN_RATE;
+        } else if (!stopped) {
+            rate[Z_AXIS] = 0.4 * sin(0.5 * t);
+            gravity[X_AXIS] = gravity[Y_AXIS] = 0.0;
+            gravity[Z_AXIS] = 1.0;
+            gyroNoise = DRIVE_GYRO_NOISE;
+            accelNoise = DRIVE_ACCEL_NOISE;
+        }
+
+        float accel[3];
+        float gyro[3];
+        for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+            accel[axis] = static_cast<float>(gravity[axis] + trueBias(BIAS_25C.accel, SLOPE.accel, axis, temperature) +
+                accelNoise * gauss(random));
+            gyro[axis] = static_cast<float>(rate[axis] + trueBias(BIAS_25C.gyro, SLOPE.gyro, axis, temperature) +
+                gyroNoise * gauss(random));
+        }
+        heading += rate[Z_AXIS] / RATE_HZ;
+        headingOnce += (gyro[Z_AXIS] - calibratedOnce.gyro[Z_AXIS]) / RATE_HZ;
+        headingTracked += (gyro[Z_AXIS] - tracked.gyro[Z_AXIS]) / RATE_HZ;
+
+        windowAllStopped = windowAllStopped && stopped;
+        windowInTurn = windowInTurn || turning;
+        if (estimator.AddSample(accel, gyro, static_cast<float>(temperature))) {
+            tracked = estimator.GetBiases();
+            stopWindows += windowAllStopped ? 1 : 0;
+            stopsFound += windowAllStopped && estimator.IsStill() ? 1 : 0;
+            falseStill += !windowAllStopped && estimator.IsStill() ? 1 : 0;
+            turnsStill += windowInTurn && estimator.IsStill() ? 1 : 0;
+            windowAllStopped = true;
+            windowInTurn = false;
+        }
+    }
+
+    ImuBiasStats stats = estimator.GetStats();
+    printf("%u windows, %u still of %u at a stop, temperature spread %.1f C\n", stats.windows, stats.stillWindows,
+        stopWindows, stats.temperatureSpreadC);
+    check(falseStill == 0 && turnsStill == 0, "driving and the steady turn are not taken as standstill");
+    check(stopsFound > stopWindows * 9 / 10, "stops are found");
+    check(stats.temperatureModel, "the stops span enough temperature for the slopes");
+
+    ImuBiases estimated = estimator.GetBiases(static_cast<float>(temperature));
+    ImuBiases slopes = estimator.GetSlopes();
+    bool gyroOk = true;
+    bool accelOk = true;
+    for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+        printf("Axis %d: gyro bias %.5f (true %.5f) rad/s, %.6f (true %.6f) per C; accel bias %.4f (true %.4f) g\n", axis,
+            estimated.gyro[axis], trueBias(BIAS_25C.gyro, SLOPE.gyro, axis, temperature), slopes.gyro[axis], SLOPE.gyro[axis],
+            estimated.accel[axis], trueBias(BIAS_25C.accel, SLOPE.accel, axis, temperature));
+        gyroOk = gyroOk && near(estimated.gyro[axis], trueBias(BIAS_25C.gyro, SLOPE.gyro, axis, temperature), GYRO_TOLERANCE) &&
+            near(slopes.gyro[axis], SLOPE.gyro[axis], SLOPE_TOLERANCE * fabs(SLOPE.gyro[axis]));
+        accelOk = accelOk && near(estimated.accel[axis], trueBias(BIAS_25C.accel, SLOPE.accel, axis, temperature), ACCEL_TOLERANCE);
+    }
+    check(gyroOk, "gyro biases and temperature coefficients are recovered");
+    check(accelOk, "accelerometer biases are recovered from stops in different attitudes");
+    check(near(slopes.accel[Z_AXIS], SLOPE.accel[Z_AXIS], 2 * SLOPE_TOLERANCE * SLOPE.accel[Z_AXIS]),
+        "and the temperature coefficient along gravity");
+
+    double driftOnce = fabs(headingOnce - heading) * RAD_TO_DEG;
+    double driftTracked = fabs(headingTracked - heading) * RAD_TO_DEG;
+    printf("Heading drift after %d s: %.1f deg with the biases calibrated once, %.1f deg tracked\n", DRIVE_SECONDS,
+        driftOnce, driftTracked);
+    check(driftTracked < driftOnce / 5, "tracked biases keep the integrated heading");
+}
+
+static void testSimulatedSensor(void) {
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    I2cSim::Configure(config);
+    SimIcm20948Config motion = SIM_ICM20948_DEFAULT_CONFIG;
+    motion.yawRate = 0.0;
+    I2cSim::ConfigureImu(motion);
+
+    Imu imu;
+    check(imu.ReadSensorData() && near(imu.GetTemperature(), motion.temperature, 0.01), "the sample block holds the temperature");
+    check(imu.ReadTemperature() && near(imu.GetTemperature(), motion.temperature, 0.01), "ReadTemperature reads it alone");
+
+    ImuBiasConfig biasConfig = DEFAULT_IMU_BIAS_CONFIG;
+    biasConfig.windowSamples = SIM_WINDOW_SAMPLES;
+    ImuBiasEstimator estimator(imu.GetBiases(), biasConfig);
+    for (int i = 0; i < SIM_WINDOWS * SIM_WINDOW_SAMPLES; i++) {
+        float accel[3];
+        float gyro[3];
+        if (!imu.ReadSensorData()) {
+            break;
+        }
+        imu.GetUncorrected(accel, gyro);
+        if (estimator.AddSample(accel, gyro, imu.GetTemperature())) {
+            imu.SetBiases(estimator.GetBiases());
+        }
+    }
+    ImuBiasStats stats = estimator.GetStats();
+    check(stats.windows == SIM_WINDOWS && stats.stillWindows == SIM_WINDOWS, "the resting sensor is still");
+
+    ImuBiases biases = imu.GetBiases();
+    bool gyroOk = true;
+    for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+        gyroOk = gyroOk && near(biases.gyro[axis], motion.gyroBias[axis], GYRO_TOLERANCE);
+    }
+    printf("Gyro biases (%.4f, %.4f, %.4f) rad/s, accel Z bias %.4f g\n", biases.gyro[X_AXIS], biases.gyro[Y_AXIS],
+        biases.gyro[Z_AXIS], biases.accel[Z_AXIS]);
+    check(gyroOk, "the simulated gyro biases are found");
+    check(near(biases.accel[Z_AXIS], motion.accelBias[Z_AXIS] / SENSORS_GRAVITY_STD, ACCEL_TOLERANCE),
+        "and the accelerometer bias along gravity");
+
+    double accelZ = 0.0;
+    double gyroZ = 0.0;
+    int count = 0;
+    for (int i = 0; i < SIM_WINDOW_SAMPLES && imu.ReadSensorData(); i++, count++) {
+        accelZ += imu.GetAccelZ();
+        gyroZ += imu.GetGyroZ();
+    }
+    check(count > 0 && near(accelZ / count, 1.0, ACCEL_TOLERANCE) && near(gyroZ / count, 0.0, 2 * GYRO_TOLERANCE),
+        "the getters subtract the biases set");
+}
+
+int main(void) {
+    testDrive();
+    testSimulatedSensor();
+    return checkSummary();
+}
@@ -0,0 +1,103 @@
+/*
+ * test_imu_config.cpp - IMU full-scale ranges, axis maps, filters and rates against
+ *                       the simulated bus
+ *
+ * Builds Imu types with different full-scale ranges and axis maps and checks that the
+ * sensor is set to the range the type scales for (the simulated chip scales its
+ * counts by the FS_SEL written) and that the getters read the simulated motion in
+ * the mapped axes. Then Configure() changes the filters and output data rates and the
+ * FIFO runs at the configured rate. No hardware needed.
+ */
+
+#include "i2c_sim.h"
+#include "imu.h"
+#include "epoch_scheduler.h"
+#include "../test_check.h"
+#include <math.h>
+#include <stdio.h>
+
+#define TOLERANCE_G 0.01
+#define TOLERANCE_RAD_S 0.005
+#define BIAS_MS2 2.0                  // Accelerometer bias on sensor X, m/s^2
+#define FIFO_WAIT_MILLIS 20
+
+static bool near(double value, double expected, double tolerance) {
+    return fabs(value - expected) < tolerance;
+}
+
+int main(void) {
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    I2cSim::Configure(config);
+    SimIcm20948Config motion = SIM_ICM20948_DEFAULT_CONFIG;
+    motion.gyroBias[X_AXIS] = motion.gyroBias[Y_AXIS] = motion.gyroBias[Z_AXIS] = 0.0;
+    motion.accelBias[X_AXIS] = BIAS_MS2;
+    motion.accelBias[Y_AXIS] = motion.accelBias[Z_AXIS] = 0.0;
+    motion.gyroNoise = motion.accelNoise = 0.0;
+    I2cSim::ConfigureImu(motion);
+    double biasG = BIAS_MS2 / SENSORS_GRAVITY_STD;
+
+    {
+        Imu imu;
+        check(imu.ReadSensorData() && near(imu.GetRawAccelerometerData()[Z_AXIS], 1.0 / ACCEL_MG_LSB_2G, 1.0 / ACCEL_MG_LSB_2G * TOLERANCE_G),
+            "Imu sets the 2 g range");
+        check(near(imu.GetAccelZ() + accel_z_offset, 1.0, TOLERANCE_G) && near(imu.GetAccelX() + accel_x_offset, biasG, TOLERANCE_G),
+            "Imu reads 1 g on Z and the bias on X");
+        check(near(imu.GetAccelY() + accel_y_offset, 0.0, TOLERANCE_G) && near(imu.GetGyroZ() + gyro_z_bias, motion.yawRate, TOLERANCE_RAD_S),
+            "Imu reads the yaw rate");
+    }
+
+    {
+        BasicImu<Gyro500dps, Accel4g> imu;
+        check(imu.ReadSensorData() && near(imu.GetRawAccelerometerData()[Z_AXIS], 1.0 / ACCEL_MG_LSB_4G, 1.0 / ACCEL_MG_LSB_4G * TOLERANCE_G) &&
+            near(imu.GetRawGyroscopeData()[Z_AXIS], motion.yawRate / Gyro500dps::SCALE, 1.0),
+            "BasicImu<Gyro500dps, Accel4g> sets the 500 dps and 4 g ranges");
+        check(near(imu.GetAccelZ() + accel_z_offset, 1.0, TOLERANCE_G) && near(imu.GetGyroZ() + gyro_z_bias, motion.yawRate, TOLERANCE_RAD_S),
+            "and scales for them");
+    }
+
+    {
+        // Sensor Z forward, sensor X to the right (body -Y), sensor Y down
+        typedef AxisMap<IMU_AXIS_Z, -IMU_AXIS_X, IMU_AXIS_Y> Mounted;
+        BasicImu<Gyro2000dps, Accel16g, Mounted> imu;
+        check(imu.ReadSensorData() && near(imu.GetRawAccelerometerData()[Z_AXIS], 1.0 / ACCEL_MG_LSB_16G, 1.0 / ACCEL_MG_LSB_16G * TOLERANCE_G),
+            "BasicImu<Gyro2000dps, Accel16g> sets the 16 g range");
+        check(near(imu.GetAccelX() + accel_x_offset, 1.0, TOLERANCE_G) && near(imu.GetAccelY() + accel_y_offset, -biasG, TOLERANCE_G) &&
+            near(imu.GetAccelZ() + accel_z_offset, 0.0, TOLERANCE_G),
+            "the axis map moves and negates the accelerometer axes");
+        check(near(imu.GetGyroX() + gyro_x_bias, motion.yawRate, 3 * TOLERANCE_RAD_S) && near(imu.GetGyroZ() + gyro_z_bias, 0.0, 3 * TOLERANCE_RAD_S),
+            "and the gyro axes");
+    }
+
+    Imu imu;
+    ImuConfig filtered = {GYRO_DLPF_51HZ, ACCEL_DLPF_50HZ, 100, 100};
+    check(imu.Configure(filtered) && imu.GetGyroRate() == 100.0 && near(imu.GetAccelRate(), ACCEL_ODR_HZ / 11.0, 1e-9),
+        "Configure sets the output data rates");
+    check(imu.ReadSensorData() && near(imu.GetAccelZ() + accel_z_offset, 1.0, TOLERANCE_G), "the range is kept");
+
+    ImuConfig invalid = {SENSOR_CONFIG_DLPFCFG_MAX + 1, ACCEL_DLPF_50HZ, 100, 100};
+    ImuConfig tooFast = {GYRO_DLPF_51HZ, ACCEL_DLPF_50HZ, GYRO_ODR_HZ + 1, 100};
+    check(!imu.Configure(invalid) && !imu.Configure(tooFast) && imu.GetConfig().gyroDlpf == GYRO_DLPF_51HZ,
+        "invalid settings are refused and leave the configuration");
+
+    ImuConfig unfiltered = {IMU_DLPF_OFF, IMU_DLPF_OFF, GYRO_ODR_HZ, ACCEL_ODR_HZ};
+    check(imu.Configure(unfiltered) && imu.GetGyroRate() == GYRO_UNFILTERED_ODR_HZ && imu.GetAccelRate() == ACCEL_UNFILTERED_ODR_HZ,
+        "without the DLPF the sensor runs at 9 and 4.5 kHz");
+    check(!imu.StartFifo(GYRO_ODR_HZ / 2), "the FIFO needs the gyro DLPF");
+
+    ImuConfig defaults = DEFAULT_IMU_CONFIG;
+    check(imu.Configure(defaults) && imu.StartFifo(GYRO_ODR_HZ / 2) && imu.GetFifoRate() == GYRO_ODR_HZ / 2 &&
+        imu.GetConfig().gyroRateHz == GYRO_ODR_HZ / 2, "StartFifo sets the output data rate");
+    EpochScheduler::SleepUntil(EpochScheduler::NowNanos() + FIFO_WAIT_MILLIS * 1000000ULL);
+    ImuSample batch[FIFO_MAX_FRAMES];
+    int count = imu.ReadFifo(batch, FIFO_MAX_FRAMES);
+    float accel[3];
+    float gyro[3];
+    if (count > 0) {
+        imu.ScaleSample(batch[count - 1], accel, gyro);
+    }
+    check(count > 0 && accel[Y_AXIS] == imu.GetAccelY() && accel[Z_AXIS] == imu.GetAccelZ() && gyro[Z_AXIS] == imu.GetGyroZ(),
+        "FIFO samples scale as the getters");
+    check(imu.StopFifo(), "FIFO stops");
+
+    return checkSummary();
+}
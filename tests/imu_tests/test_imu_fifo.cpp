@@ -0,0 +1,193 @@
+/*
+ * test_imu_fifo.cpp - ICM-20948 FIFO acquisition against the simulated bus
+ *
+ * Starts the FIFO at 1.1 kHz and 550 Hz and drains it every DRAIN_PERIOD_MICROS,
+ * checking that the batches add up to the sample rate, are evenly spaced and read the
+ * simulated motion, and how few transactions and wake-ups they take compared with one
+ * burst read per sample. Then the FIFO is left to overflow and must recover. A drain
+ * that wakes up too late overflows the FIFO as well; the checks allow for those, but
+ * not for overflows without a late drain. A FIFO one frame short of full, with the
+ * data-ready bit set in INT_STATUS_1 and no overflow in INT_STATUS_2, must be read out
+ * rather than reset. The clock runs in real time, since scaled sleeps would scale the
+ * wake-up latency too. No hardware needed.
+ */
+
+#include "i2c_sim.h"
+#include "imu.h"
+#include "epoch_scheduler.h"
+#include "../test_check.h"
+#include <math.h>
+#include <stdio.h>
+
+#define FAST_RATE_HZ 1100
+#define SLOW_RATE_HZ 550
+#define RUN_SECONDS 2.0
+#define DRAIN_PERIOD_MICROS 10000     // FIFO_MAX_FRAMES last 21.8 ms at 1.1 kHz
+#define OVERFLOW_PAUSE_MILLIS 500
+#define MAX_REALIGNMENTS 2            // After a preempted FIFO reset
+#define FULL_RATE_HZ 110              // Leaves 9 ms between the last frame that fits and the first that does not
+
+typedef struct {
+    uint32_t samples;
+    uint32_t lost;               // Counted by the overflows
+    uint32_t drains;             // Wake-ups that returned samples
+    uint32_t lateOverflows;      // Overflows after a drain too late for the FIFO
+    uint32_t otherOverflows;
+    uint32_t errors;
+    uint32_t transactions;
+    double seconds;
+    double maxSpacingError;      // ns, from the nominal period
+    uint32_t uneven;             // Samples more than 1 ns off it (timestamps re-aligned)
+    double maxLagNanos;          // From the newest timestamp of a batch to the start of its drain
+    uint32_t misstamped;         // Batches whose newest timestamp is not in the period before the drain
+    double accelZ;               // Means, in g, rad/s and uT
+    double gyroZ;
+    double field;
+} FifoRun;
+
+/**
+ * @brief   Drain the FIFO every DRAIN_PERIOD_MICROS for the given virtual time.
+ */
+static FifoRun drain(Imu &imu, double seconds) {
+    FifoRun run = {};
+    ImuSample batch[FIFO_MAX_FRAMES];
+    SimIcm20948Config motion = SIM_ICM20948_DEFAULT_CONFIG;
+    double period = 1e9 / imu.GetFifoRate();
+    uint64_t lastTime = 0;
+    uint64_t lastDrain = 0;
+    uint64_t lateNanos = static_cast<uint64_t>((FIFO_MAX_FRAMES - 2) * period);
+
+    I2cSimStats before = I2cSim::GetStats();
+    uint64_t start = EpochScheduler::NowNanos();
+    uint64_t next = start;
+    lastDrain = start;
+    while (next < start + static_cast<uint64_t>(seconds * NANOS_PER_SECOND)) {
+        next += DRAIN_PERIOD_MICROS * 1000ULL;
+        EpochScheduler::SleepUntil(next);
+        uint64_t now = EpochScheduler::NowNanos();
+        ImuFifoStats before = imu.GetFifoStats();
+        int count = imu.ReadFifo(batch, FIFO_MAX_FRAMES);
+        ImuFifoStats after = imu.GetFifoStats();
+        uint64_t end = EpochScheduler::NowNanos();
+        bool late = end - lastDrain > lateNanos;   // Since the previous drain counted its frames
+        lastDrain = now;
+        if (count < 0) {
+            run.errors++;
+            continue;
+        }
+        if (after.overflows != before.overflows) {
+            run.lost += after.samplesLost - before.samplesLost;
+            run.lateOverflows += late ? 1 : 0;
+            run.otherOverflows += late ? 0 : 1;
+            lastTime = 0;   // Timestamps restart from the reset
+        }
+        run.drains += count > 0 ? 1 : 0;
+        for (int i = 0; i < count; i++) {
+            const ImuSample &sample = batch[i];
+            if (lastTime != 0) {
+                double error = fabs(static_cast<double>(sample.timeNanos - lastTime) - period);
+                run.maxSpacingError = error > run.maxSpacingError ? error : run.maxSpacingError;
+                run.uneven += error > 1.0 ? 1 : 0;
+            }
+            lastTime = sample.timeNanos;
+            run.accelZ += sample.accelerometer[Z_AXIS] * ACCEL_MG_LSB_2G;
+            run.gyroZ += sample.gyroscope[Z_AXIS] * GYRO_SENSITIVITY_250DPS * DEG_TO_RAD;
+            double field = 0.0;
+            for (int axis = 0; axis < 3; axis++) {
+                double corrected = sample.magnetometer[axis] * MAG_UT_LSB - motion.magHardIron[axis];
+                field += corrected * corrected;
+            }
+            run.field += sqrt(field);
+        }
+        run.samples += count;
+        if (count > 0) {
+            double lag = static_cast<double>(now) - static_cast<double>(lastTime);
+            run.maxLagNanos = lag > run.maxLagNanos ? lag : run.maxLagNanos;
+            run.misstamped += (lastTime > end || lag > period + 1.0) ? 1 : 0;
+        }
+    }
+    run.seconds = (lastDrain - start) / 1e9;   // The last drain may have woken late
+    run.transactions = I2cSim::GetStats().imu.transactions - before.imu.transactions;
+    if (run.samples > 0) {
+        run.accelZ /= run.samples;
+        run.gyroZ /= run.samples;
+        run.field /= run.samples;
+    }
+    return run;
+}
+
+static void report(const char *name, const FifoRun &run) {
+    printf("%s: %u samples in %.2f s (%.1f Hz), %u drains, %.3f transactions/sample, spacing error %.0f ns, lag up to %.2f ms\n",
+        name, run.samples, run.seconds, run.samples / run.seconds, run.drains,
+        run.samples ? static_cast<double>(run.transactions) / run.samples : 0.0, run.maxSpacingError, run.maxLagNanos / 1e6);
+    if (run.lateOverflows + run.otherOverflows > 0) {
+        printf("  %u overflows after late wake-ups, %u others, %u samples lost\n", run.lateOverflows, run.otherOverflows, run.lost);
+    }
+}
+
+/**
+ * @brief   Whether a run delivered (or counted as lost) the rate's samples, with the
+ *          simulated motion in them, and overflowed only after late drains.
+ */
+static bool plausible(const FifoRun &run, double rateHz) {
+    SimIcm20948Config motion = SIM_ICM20948_DEFAULT_CONFIG;
+    double expected = 0.0;
+    for (int axis = 0; axis < 3; axis++) {
+        expected += motion.magField[axis] * motion.magField[axis];
+    }
+    return run.errors == 0 && run.otherOverflows == 0 &&
+        fabs(run.samples + run.lost - rateHz * run.seconds) <= rateHz * DRAIN_PERIOD_MICROS / 1e6 + 2 + 2 * run.lateOverflows &&
+        fabs(run.accelZ - 1.0) < 0.02 && fabs(run.gyroZ - motion.yawRate) < 0.02 && fabs(run.field - sqrt(expected)) < 2.0;
+}
+
+int main(void) {
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    I2cSim::Configure(config);
+
+    Imu imu;
+    check(imu.StartFifo(FAST_RATE_HZ) && imu.GetFifoRate() == FAST_RATE_HZ, "FIFO starts at 1.1 kHz");
+    FifoRun fast = drain(imu, RUN_SECONDS);
+    report("1.1 kHz", fast);
+    check(plausible(fast, FAST_RATE_HZ), "batches add up to the rate and read the motion");
+    check(fast.uneven <= MAX_REALIGNMENTS, "samples are evenly spaced");
+    check(fast.transactions * 4 < fast.samples && fast.drains * 4 < fast.samples,
+        "a sample costs under a quarter of a transaction and of a wake-up");
+    check(fast.otherOverflows == 0 && imu.GetFifoStats().overflows == fast.lateOverflows, "no overflow while drained on time");
+
+    imu.ResetFifoStats();
+    EpochScheduler::SleepUntil(EpochScheduler::NowNanos() + OVERFLOW_PAUSE_MILLIS * 1000000ULL);
+    ImuSample batch[FIFO_MAX_FRAMES];
+    int overflowRead = imu.ReadFifo(batch, FIFO_MAX_FRAMES);
+    ImuFifoStats stats = imu.GetFifoStats();
+    printf("Overflow: %u samples lost in %d ms\n", stats.samplesLost, OVERFLOW_PAUSE_MILLIS);
+    check(overflowRead == 0 && stats.overflows == 1, "an overflow is detected and the FIFO reset");
+    check(fabs(stats.samplesLost - FAST_RATE_HZ * OVERFLOW_PAUSE_MILLIS / 1000.0) < FAST_RATE_HZ * DRAIN_PERIOD_MICROS / 1e6 + FIFO_MAX_FRAMES,
+        "the lost samples are counted");
+    FifoRun recovered = drain(imu, RUN_SECONDS / 2);
+    report("Recovered", recovered);
+    check(plausible(recovered, FAST_RATE_HZ), "frames are aligned again after the reset");
+
+    check(imu.StartFifo(SLOW_RATE_HZ) && imu.GetFifoRate() == SLOW_RATE_HZ, "FIFO restarts at 550 Hz");
+    FifoRun slow = drain(imu, RUN_SECONDS / 2);
+    report("550 Hz", slow);
+    check(plausible(slow, SLOW_RATE_HZ), "550 Hz batches add up to the rate");
+    check(fast.misstamped == 0 && recovered.misstamped == 0 && slow.misstamped == 0,
+        "the newest timestamp of a batch is within a period of its drain");
+
+    // Only data-ready is pending when the FIFO holds FIFO_MAX_FRAMES; the status is read all the same
+    check(imu.StartFifo(FULL_RATE_HZ), "FIFO restarts at 110 Hz");
+    imu.ResetFifoStats();
+    uint32_t simOverflows = I2cSim::GetImuStats().fifoOverflows;
+    double fullPeriod = 1e9 / imu.GetFifoRate();
+    EpochScheduler::SleepUntil(EpochScheduler::NowNanos() + static_cast<uint64_t>((FIFO_MAX_FRAMES + 0.5) * fullPeriod));
+    int fullRead = imu.ReadFifo(batch, FIFO_MAX_FRAMES);
+    check(I2cSim::GetImuStats().fifoOverflows == simOverflows, "the FIFO filled up without overflowing");
+    check(fullRead == FIFO_MAX_FRAMES && imu.GetFifoStats().overflows == 0,
+        "data-ready in INT_STATUS_1 is not taken for an overflow");
+
+    check(imu.StopFifo() && imu.ReadFifo(batch, FIFO_MAX_FRAMES) < 0, "FIFO stops");
+    check(imu.ReadSensorData() && fabs(imu.GetRawAccelerometerData()[Z_AXIS] * ACCEL_MG_LSB_2G - 1.0) < 0.05,
+        "register reads work after the FIFO");
+
+    return checkSummary();
+}
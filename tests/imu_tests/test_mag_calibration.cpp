@@ -0,0 +1,264 @@
+/*
+ * test_mag_calibration.cpp - Online hard-iron and soft-iron calibration of the magnetometer
+ *
+ * Rotates a known field through random orientations, distorts it with a known
+ * soft-iron matrix and hard-iron bias, and checks that MagCalibrator recovers the
+ * bias and corrects the field back onto a sphere: streaming, from CSV and binary
+ * logs (timed), and after the installation changes with a forgetting factor. A
+ * rover that only turns about Z must not be calibrated. Then the calibration is
+ * saved, loaded and applied by the driver on the simulated bus. With a CSV argument
+ * (tests/calibration/raw_mag_data.csv) that log is fitted as well. No hardware needed.
+ */
+
+#include "i2c_sim.h"
+#include "imu.h"
+#include "mag_calibration.h"
+#include "epoch_scheduler.h"
+#include "../test_check.h"
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <vector>
+
+#define FIELD_UT 48.0
+#define NOISE_UT 0.3
+#define STREAM_SAMPLES 2000
+#define LOG_SAMPLES 1000000
+#define HARD_IRON_TOLERANCE_UT 0.5
+#define FIELD_TOLERANCE (2 * NOISE_UT / FIELD_UT)   // RMS, of the field strength
+#define CSV_PATH "/tmp/test_mag_calibration.csv"
+#define BINARY_PATH "/tmp/test_mag_calibration.bin"
+#define CALIBRATION_PATH "/tmp/test_mag_calibration.txt"
+
+typedef struct {
+    double softIron[3][3];       // Distortion applied to the field
+    double hardIron[3];          // uT
+} Distortion;
+
+static const Distortion ROVER = {{{1.15, 0.06, -0.03}, {0.06, 0.92, 0.04}, {-0.03, 0.04, 1.05}}, {25.0, -14.0, 31.0}};
+static const Distortion REFITTED = {{{0.95, -0.05, 0.0}, {-0.05, 1.1, 0.02}, {0.0, 0.02, 0.97}}, {-8.0, 20.0, 5.0}};
+
+/**
+ * @brief   A raw sample of the field pointing along direction, distorted.
+ */
+static void distortedSample(const Distortion &distortion, const double *direction, std::mt19937 &random, int16_t *raw) {
+    std::normal_distribution<double> noise(0.0, NOISE_UT);
+    for (int row = X_AXIS; row <= Z_AXIS; row++) {
+        double value = distortion.hardIron[row] + noise(random);
+        for (int column = X_AXIS; column <= Z_AXIS; column++) {
+            value += distortion.softIron[row][column] * FIELD_UT * direction[column];
+        }
+        raw[row] = static_cast<int16_t>(lround(value / MAG_UT_LSB));
+    }
+}
+
+/**
+ * @brief   A random direction, or one in the horizontal plane tilted by at most 2 degrees.
+ */
+static void randomDirection(std::mt19937 &random, bool level, double *direction) {
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    if (level) {
+        double yaw = M_PI * uniform(random);
+        double tilt = 2.0 * DEG_TO_RAD * uniform(random);
+        direction[X_AXIS] = cos(yaw) * cos(tilt);
+        direction[Y_AXIS] = sin(yaw) * cos(tilt);
+        direction[Z_AXIS] = sin(tilt);
+        return;
+    }
+    double norm;
+    do {
+        for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+            direction[axis] = uniform(random);
+        }
+        norm = sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+    } while (norm > 1.0 || norm < 0.1);
+    for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+        direction[axis] /= norm;
+    }
+}
+
+/**
+ * @brief   RMS error of the corrected field strength over fresh samples, as a fraction
+ *          of the field, and the largest error of the hard-iron bias in uT.
+ */
+static void evaluate(const MagCalibration &calibration, const Distortion &distortion, double &fieldError, double &biasError) {
+    std::mt19937 random(7);
+    double sum = 0.0;
+    for (int i = 0; i < 1000; i++) {
+        double direction[3];
+        int16_t raw[3];
+        randomDirection(random, false, direction);
+        distortedSample(distortion, direction, random, raw);
+        double squared = 0.0;
+        for (int row = X_AXIS; row <= Z_AXIS; row++) {
+            double corrected = 0.0;
+            for (int column = X_AXIS; column <= Z_AXIS; column++) {
+                corrected += calibration.softIron[row][column] * (raw[column] * MAG_UT_LSB - calibration.hardIron[column]);
+            }
+            squared += corrected * corrected;
+        }
+        double error = (sqrt(squared) - calibration.fieldUt) / calibration.fieldUt;
+        sum += error * error;
+    }
+    fieldError = sqrt(sum / 1000);
+    biasError = 0.0;
+    for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+        biasError = fmax(biasError, fabs(calibration.hardIron[axis] - distortion.hardIron[axis]));
+    }
+}
+
+static bool accurate(const MagCalibration &calibration, const Distortion &distortion, const char *name) {
+    double fieldError;
+    double biasError;
+    evaluate(calibration, distortion, fieldError, biasError);
+    printf("%s: field %.2f uT, hard iron (%.2f, %.2f, %.2f) uT, bias error %.3f uT, field error %.2f%%\n", name,
+        calibration.fieldUt, calibration.hardIron[X_AXIS], calibration.hardIron[Y_AXIS], calibration.hardIron[Z_AXIS],
+        biasError, 100.0 * fieldError);
+    return biasError < HARD_IRON_TOLERANCE_UT && fieldError < FIELD_TOLERANCE;
+}
+
+int main(int argc, char *argv[]) {
+    std::mt19937 random(1);
+
+    // Streaming: fits every MAG_CAL_REFIT_SAMPLES samples once MAG_CAL_MIN_SAMPLES are in
+    MagCalibrator online;
+    uint32_t accepted = 0;
+    uint32_t firstFit = 0;
+    for (uint32_t i = 1; i <= STREAM_SAMPLES; i++) {
+        double direction[3];
+        int16_t raw[3];
+        randomDirection(random, false, direction);
+        distortedSample(ROVER, direction, random, raw);
+        if (online.AddSample(raw)) {
+            accepted++;
+            firstFit = firstFit == 0 ? i : firstFit;
+        }
+    }
+    MagCalibrationStats stats = online.GetStats();
+    printf("Online: first fit after %u samples, %u fits, axis ratio %.3f, spread %.2f, residual %.3f uT\n",
+        firstFit, stats.fits, stats.axisRatio, stats.spread, stats.residualUt);
+    check(online.IsValid() && firstFit == MAG_CAL_MIN_SAMPLES && accepted == stats.fits, "the online fit converges at the first refit");
+    check(accurate(online.GetCalibration(), ROVER, "Online"), "it recovers the hard iron and corrects the field strength");
+    check(stats.residualUt < 2 * NOISE_UT, "the samples after the last fit are on the sphere");
+
+    // A rover turning on level ground sees a circle: Z is not observable
+    MagCalibrator level;
+    for (uint32_t i = 0; i < STREAM_SAMPLES; i++) {
+        double direction[3];
+        int16_t raw[3];
+        randomDirection(random, true, direction);
+        distortedSample(ROVER, direction, random, raw);
+        level.AddSample(raw);
+    }
+    check(!level.IsValid() && level.GetStats().rejected > 0, "turning only about Z is not enough to calibrate");
+
+    // Logs: the same samples from memory, a CSV file and a binary file
+    std::vector<int16_t> log(3 * LOG_SAMPLES);
+    for (uint32_t i = 0; i < LOG_SAMPLES; i++) {
+        double direction[3];
+        randomDirection(random, false, direction);
+        distortedSample(ROVER, direction, random, &log[3 * i]);
+    }
+    FILE *csv = fopen(CSV_PATH, "w");
+    FILE *binary = fopen(BINARY_PATH, "wb");
+    if (csv == nullptr || binary == nullptr) {
+        perror("Failed to create the test logs");
+        return 1;
+    }
+    fprintf(csv, "MagX,MagY,MagZ\n");
+    for (uint32_t i = 0; i < LOG_SAMPLES; i++) {
+        fprintf(csv, "%d,%d,%d\n", log[3 * i], log[3 * i + 1], log[3 * i + 2]);
+        uint8_t bytes[6];
+        for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+            bytes[2 * axis] = static_cast<uint8_t>(log[3 * i + axis] & BYTE_MASK);
+            bytes[2 * axis + 1] = static_cast<uint8_t>(static_cast<uint16_t>(log[3 * i + axis]) >> BITS_PER_BYTE);
+        }
+        fwrite(bytes, 1, sizeof(bytes), binary);
+    }
+    fclose(csv);
+    fclose(binary);
+
+    MagCalibrator memory;
+    MagCalibrator fromCsv;
+    MagCalibrator fromBinary;
+    uint64_t start = EpochScheduler::NowNanos();
+    memory.AddSamples(log.data(), LOG_SAMPLES);
+    bool memoryFit = memory.Fit();
+    uint64_t memoryDone = EpochScheduler::NowNanos();
+    bool csvFit = fromCsv.AddCsvFile(CSV_PATH) && fromCsv.Fit();
+    uint64_t csvDone = EpochScheduler::NowNanos();
+    bool binaryFit = fromBinary.AddBinaryFile(BINARY_PATH) && fromBinary.Fit();
+    uint64_t binaryDone = EpochScheduler::NowNanos();
+    printf("Batch of %u samples: memory %.1f ms (%.1f M samples/s), CSV %.1f ms, binary %.1f ms\n", LOG_SAMPLES,
+        (memoryDone - start) / 1e6, LOG_SAMPLES * 1e3 / (memoryDone - start), (csvDone - memoryDone) / 1e6, (binaryDone - csvDone) / 1e6);
+    check(memoryFit && accurate(memory.GetCalibration(), ROVER, "Batch"), "a log fits in one pass");
+    MagCalibration a = memory.GetCalibration();
+    MagCalibration b = fromCsv.GetCalibration();
+    MagCalibration c = fromBinary.GetCalibration();
+    check(csvFit && binaryFit && fromCsv.GetStats().samples == LOG_SAMPLES && fromBinary.GetStats().samples == LOG_SAMPLES &&
+        a.hardIron[X_AXIS] == b.hardIron[X_AXIS] && a.softIron[1][2] == b.softIron[1][2] &&
+        a.hardIron[Z_AXIS] == c.hardIron[Z_AXIS] && a.softIron[0][0] == c.softIron[0][0],
+        "CSV and binary logs give the same fit");
+    check(memoryDone - start < 1000000000ULL && binaryDone - csvDone < 1000000000ULL, "a million samples fit in under a second");
+
+    // With forgetting the fit follows a changed installation
+    MagCalibrator following(0.995);
+    MagCalibrator fixed;
+    for (uint32_t i = 0; i < 2 * STREAM_SAMPLES; i++) {
+        const Distortion &distortion = i < STREAM_SAMPLES ? ROVER : REFITTED;
+        double direction[3];
+        int16_t raw[3];
+        randomDirection(random, false, direction);
+        distortedSample(distortion, direction, random, raw);
+        following.AddSample(raw);
+        fixed.AddSample(raw);
+    }
+    check(accurate(following.GetCalibration(), REFITTED, "Forgetting"), "with forgetting the fit follows a new installation");
+    check(!accurate(fixed.GetCalibration(), REFITTED, "No forgetting"), "without it the old samples still count");
+
+    // Saved, loaded and applied by the driver
+    MagCalibration loaded = MAG_CALIBRATION_IDENTITY;
+    check(MagCalibrator::Save(online.GetCalibration(), CALIBRATION_PATH) && MagCalibrator::Load(loaded, CALIBRATION_PATH) &&
+        loaded.hardIron[Y_AXIS] == online.GetCalibration().hardIron[Y_AXIS] && loaded.softIron[2][1] == online.GetCalibration().softIron[2][1],
+        "the calibration is saved and loaded");
+
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    I2cSim::Configure(config);
+    SimIcm20948Config motion = SIM_ICM20948_DEFAULT_CONFIG;
+    motion.magNoise = 0.0;
+    I2cSim::ConfigureImu(motion);
+    Imu imu;
+    MagCalibration simulated = MAG_CALIBRATION_IDENTITY;
+    for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
+        simulated.hardIron[axis] = static_cast<float>(motion.magHardIron[axis]);
+    }
+    double expected = sqrt(motion.magField[0] * motion.magField[0] + motion.magField[1] * motion.magField[1] +
+        motion.magField[2] * motion.magField[2]);
+    EpochScheduler::SleepUntil(EpochScheduler::NowNanos() + 20000000ULL);   // A magnetometer measurement
+    bool read = imu.ReadSensorData();
+    double raw = sqrt(imu.GetMagX() * imu.GetMagX() + imu.GetMagY() * imu.GetMagY() + imu.GetMagZ() * imu.GetMagZ());
+    imu.SetMagCalibration(simulated);
+    double corrected = sqrt(imu.GetMagX() * imu.GetMagX() + imu.GetMagY() * imu.GetMagY() + imu.GetMagZ() * imu.GetMagZ());
+    float mag[3];
+    imu.CalibrateMag(imu.GetRawMagnetometerData(), mag);
+    printf("Driver: |field| %.2f uT uncorrected, %.2f uT corrected, %.2f uT expected\n", raw, corrected, expected);
+    check(read && fabs(corrected - expected) < 1.0 && fabs(raw - expected) > 5.0, "the driver applies the calibration");
+    check(mag[X_AXIS] == imu.GetMagX() && mag[Z_AXIS] == imu.GetMagZ(), "raw samples are corrected as the getters");
+
+    if (argc > 1) {
+        MagCalibrator recorded;
+        bool fitted = recorded.AddCsvFile(argv[1]) && recorded.Fit();
+        MagCalibration result = recorded.GetCalibration();
+        MagCalibrationStats recordedStats = recorded.GetStats();
+        printf("%s: %u samples, spread %.2f, %s\n", argv[1], recordedStats.samples, recordedStats.spread, fitted ? "fitted" : "not fitted");
+        if (fitted) {
+            printf("  field %.2f uT, hard iron (%.2f, %.2f, %.2f) uT, axis ratio %.3f\n", result.fieldUt,
+                result.hardIron[X_AXIS], result.hardIron[Y_AXIS], result.hardIron[Z_AXIS], recordedStats.axisRatio);
+        }
+    }
+
+    remove(CSV_PATH);
+    remove(BINARY_PATH);
+    remove(CALIBRATION_PATH);
+    return checkSummary();
+}
@@ -1,5 +1,6 @@
 #include "gps.h"
 #include "imu.h"
+#include "imu_bias.h"
 #include "ekfNavINS.h"
 #include <fstream> 
 #include <stdio.h>
@@ -11,6 +12,8 @@
 #include <string.h>
 #include <chrono>
 #include <iomanip>
+#include <memory>
+#include <thread>
 
 #define CURRENT_YEAR 2024
 
@@ -30,21 +33,37 @@ int main(void) {
     // Register the signal handler for SIGINT (Ctrl+C)
     signal(SIGINT, signal_handler);
 
+    // Bring both sensors up concurrently; the GPS spends most of its startup waiting on ACKs
+    auto startupBegin = std::chrono::steady_clock::now();
+    std::unique_ptr<Gps> gps;
+    // GPS only at ~18 Hz: the fusion loop gets a position update every 56 ms instead of 100 ms
+    const GpsNavigationConfig navigation = HIGH_RATE_NAVIGATION_CONFIG;
+    std::thread gpsStartup([&gps, &navigation]() { gps.reset(new Gps(CURRENT_YEAR, navigation)); });
     Imu imu_module;
-    Gps gps_module(CURRENT_YEAR);
+    auto imuReady = std::chrono::steady_clock::now();
+    gpsStartup.join();
+    auto startupEnd = std::chrono::steady_clock::now();
+    Gps &gps_module = *gps;
+
+    UbxConfigStats configStats = gps_module.GetConfigStats();
+    printf("Startup: %.1f ms total (IMU %.1f ms, GPS config %u ms: %u written, %u already set)\n",
+        std::chrono::duration<double, std::milli>(startupEnd - startupBegin).count(),
+        std::chrono::duration<double, std::milli>(imuReady - startupBegin).count(),
+        configStats.elapsedMillis, configStats.written, configStats.skipped);
     ekfNavINS ekf;
     float pitch, roll, yaw;
     float Gxyz[3], Axyz[3], Mxyz[3];
     float filteredAx = 0, filteredAy = 0, filteredAz = 0;
     float filteredMx = 0, filteredMy = 0, filteredMz = 0;
-    const float alpha = 0.5;  // Adjust this parameter to tweak the filter (range: 0-1)
-    const float accel_x_offset = -0.05673657500210876;
-    const float accel_y_offset = -0.014051752249833504;
-    const float accel_z_offset = -0.700553398935738;
-    const float gyro_x_bias = -0.008447830282040561;
-    const float gyro_y_bias = 0.0064697791963203004;
-    const float gyro_z_bias = -0.009548081446790717;
  
+    // Samples come with the fixes, so a standstill window is about a second of them
+    ImuBiasConfig biasConfig = DEFAULT_IMU_BIAS_CONFIG;
+    biasConfig.windowSamples = 20;
+    ImuBiasEstimator biasEstimator(imu_module.GetBiases(), biasConfig);
+
+    // Drain the GPS on its own thread so this loop never waits on the I2C bus
+    gps_module.StartAcquisition(false);
+
     auto lastTime = std::chrono::steady_clock::now();
 
     while(!exit_flag) {
@@ -53,8 +72,8 @@ int main(void) {
         lastTime = currentTime;
 
         // Get GPS data
-        PVTData data = gps_module.GetPvt(true, 1);
-        if (data.year == CURRENT_YEAR && data.numberOfSatellites > 0) {
+        PVTData data;
+        if (gps_module.WaitPvt(data, DEFAULT_TIMEOUT_MILLS) && data.numberOfSatellites > 0) {
             // All data for IMU is normalized already for 250dps, 2g, and 4 gauss
             imu_module.ReadSensorData();
             const int16_t *accel_data = imu_module.GetRawAccelerometerData();
@@ -75,19 +94,23 @@ int main(void) {
                 continue;
             }
 
-            // Apply accelerometer offsets
-            Axyz[0] = static_cast<float>(accel_data[0]) * ACCEL_MG_LSB_2G - accel_x_offset;
-            Axyz[1] = -1 * static_cast<float>(accel_data[1]) * ACCEL_MG_LSB_2G - accel_y_offset;
-            Axyz[2] = static_cast<float>(accel_data[2]) * ACCEL_MG_LSB_2G - accel_z_offset;
+            // Track the biases while the rover stands, and over the die temperature
+            imu_module.GetUncorrected(Axyz, Gxyz);
+            if (biasEstimator.AddSample(Axyz, Gxyz, imu_module.GetTemperature())) {
+                imu_module.SetBiases(biasEstimator.GetBiases());
+            }
 
-            // Apply gyroscope biases
-            Gxyz[0] = (GYRO_SENSITIVITY_250DPS * DEG_TO_RAD * static_cast<float>(gyro_data[0]) - gyro_x_bias);
-            Gxyz[1] = (GYRO_SENSITIVITY_250DPS * DEG_TO_RAD * static_cast<float>(gyro_data[1]) - gyro_y_bias);
-            Gxyz[2] = (GYRO_SENSITIVITY_250DPS * DEG_TO_RAD * static_cast<float>(gyro_data[2]) - gyro_z_bias );
+            // Apply accelerometer offsets and gyroscope biases
+            Axyz[0] = imu_module.GetAccelX();
+            Axyz[1] = imu_module.GetAccelY();
+            Axyz[2] = imu_module.GetAccelZ();
+            Gxyz[0] = imu_module.GetGyroX();
+            Gxyz[1] = imu_module.GetGyroY();
+            Gxyz[2] = imu_module.GetGyroZ();
 
-            Mxyz[0] = static_cast<float>(mag_data[0]) * MAG_UT_LSB;;
-            Mxyz[1] = static_cast<float>(mag_data[1]) * MAG_UT_LSB;;
-            Mxyz[2] = static_cast<float>(mag_data[2]) * MAG_UT_LSB;;
+            Mxyz[0] = imu_module.GetMagX();
+            Mxyz[1] = imu_module.GetMagY();
+            Mxyz[2] = imu_module.GetMagZ();
 
             // Low-pass filter for accelerometer data
             filteredAx = alpha * filteredAx + (1 - alpha) * Axyz[0];
@@ -116,9 +139,11 @@ int main(void) {
             }
 
             printf("\n---------------------\n");
-            std::this_thread::sleep_for(std::chrono::milliseconds(110));
         }
     }
 
+    GpsAcquisitionStats stats = gps_module.GetAcquisitionStats();
+    printf("GPS fixes queued: %u, overruns: %u, dropped: %u\n", stats.fixesQueued, stats.overruns, stats.drops);
+
     return 0;
 }
@@ -0,0 +1,116 @@
+/*
+ * test_i2c_bus.cpp - Gps and Imu sharing one simulated bus from two threads
+ *
+ * An IMU thread samples at IMU_PERIOD_MICROS while the main thread drains the GPS
+ * with GetPvt(). Both go through I2cBus::Shared(), first with priorities only and
+ * then with the IMU's sample period registered, so GPS drains are fitted between
+ * samples. IMU_PERIOD_MICROS does not divide the navigation period, so the slots
+ * sweep across the epochs and some drains run into one whatever the phase of the
+ * two threads. The clock runs in real time so thread wake-up latency stays small
+ * next to the delays measured, and the IMU wait is checked on average, as one late
+ * wake-up of the host can hold a sample past any bound. No hardware needed.
+ *
+ * The slot logic itself is checked on a controlled clock by test_i2c_bus_slots.cpp.
+ */
+
+#include "gps.h"
+#include "i2c_sim.h"
+#include "imu.h"
+#include "../test_check.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+#define TIME_SCALE 1.0
+#define SIM_YEAR 2024
+#define RUN_SECONDS 2
+#define IMU_PERIOD_MICROS 9000        // About 111 Hz; slots move 1 ms per epoch
+#define SLOT_MEAN_QUEUE_NANOS 100000ULL
+#define EXPECTED_RATE_HZ 10           // DEFAULT_NAVIGATION_CONFIG: 100 ms
+#define NAV_PVT_FRAME_LENGTH (UBX_FRAME_OVERHEAD + NAV_PVT_PAYLOAD_LENGTH)
+
+typedef struct {
+    I2cDeviceStats imu;
+    I2cDeviceStats gps;
+    double imuUtilization;
+    double gpsUtilization;
+    uint32_t samples;
+    uint32_t gpsBytes;           // Receiver output drained
+} BusRun;
+
+/**
+ * @brief   Sample the IMU at its period while the GPS is drained for RUN_SECONDS.
+ */
+static BusRun run(Gps &gps, Imu &imu, bool reserveSlots) {
+    I2cBus &bus = I2cBus::Shared(GPS_I2C_BUS);
+    imu.SetSamplePeriod(reserveSlots ? IMU_PERIOD_MICROS : 0);
+    bus.ResetStats();
+
+    BusRun result = {};
+    std::atomic<bool> running(true);
+    std::thread sampler([&]() {
+        uint64_t next = EpochScheduler::NowNanos();
+        while (running.load()) {
+            next += static_cast<uint64_t>(IMU_PERIOD_MICROS) * 1000;
+            EpochScheduler::SleepUntil(next);
+            imu.ReadSensorData();
+            result.samples++;
+        }
+    });
+
+    GpsBusStats before = gps.GetBusStats();
+    uint64_t end = EpochScheduler::NowNanos() + RUN_SECONDS * NANOS_PER_SECOND;
+    while (EpochScheduler::NowNanos() < end) {
+        gps.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+    }
+    running = false;
+    sampler.join();
+    result.gpsBytes = gps.GetBusStats().bytesRead - before.bytesRead;
+
+    int imuDevice = bus.Find("imu");
+    int gpsDevice = bus.Find("gps");
+    result.imu = bus.GetStats(imuDevice);
+    result.gps = bus.GetStats(gpsDevice);
+    result.imuUtilization = bus.Utilization(imuDevice);
+    result.gpsUtilization = bus.Utilization(gpsDevice);
+    return result;
+}
+
+static void report(const char *name, const BusRun &result) {
+    printf("%s: %u IMU samples, %u GPS bytes\n", name, result.samples, result.gpsBytes);
+    printf("  imu: %5.1f %% of the bus, queue mean %6.1f us max %6.1f us, %u deferrals\n",
+        result.imuUtilization * 100, result.imu.transfers ? result.imu.queueNanos / 1e3 / result.imu.transfers : 0.0,
+        result.imu.maxQueueNanos / 1e3, result.imu.deferrals);
+    printf("  gps: %5.1f %% of the bus, queue mean %6.1f us max %6.1f us, %u deferrals\n",
+        result.gpsUtilization * 100, result.gps.transfers ? result.gps.queueNanos / 1e3 / result.gps.transfers : 0.0,
+        result.gps.maxQueueNanos / 1e3, result.gps.deferrals);
+}
+
+int main(void) {
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    config.timeScale = TIME_SCALE;
+    I2cSim::Configure(config);
+
+    Gps gps(SIM_YEAR);
+    Imu imu;
+    I2cBus &bus = I2cBus::Shared(GPS_I2C_BUS);
+    check(bus.Find("gps") >= 0 && bus.Find("imu") >= 0, "both drivers are attached to one bus");
+
+    BusRun priority = run(gps, imu, false);
+    report("Priority only", priority);
+    BusRun slots = run(gps, imu, true);
+    report("Reserved IMU slots", slots);
+
+    uint32_t expectedSamples = RUN_SECONDS * 1000000 / IMU_PERIOD_MICROS;
+    check(slots.samples + 2 >= expectedSamples, "IMU keeps its sample rate");
+    check(slots.gpsBytes >= RUN_SECONDS * EXPECTED_RATE_HZ * NAV_PVT_FRAME_LENGTH * 8 / 10, "GPS output is drained at the navigation rate");
+    check(slots.imu.transfers == slots.samples, "each IMU sample is one bus grant");
+    check(slots.gps.deferrals > 0, "GPS drains are moved out of the IMU slots");
+    check(slots.imu.queueNanos < SLOT_MEAN_QUEUE_NANOS * slots.imu.transfers, "IMU waits less than 100 us on average with reserved slots");
+    check(slots.imu.errors == 0 && slots.gps.errors == 0, "no failed transfers");
+
+    I2cSimStats sim = I2cSim::GetStats();
+    check(sim.other.transactions == 0, "all traffic went to the two devices");
+
+    return checkSummary();
+}
@@ -0,0 +1,152 @@
+/*
+ * test_i2c_bus_slots.cpp - I2cBus slot reservation on a controlled clock
+ *
+ * I2cBus takes its time from EpochScheduler, i.e. clock_gettime and clock_nanosleep on
+ * CLOCK_MONOTONIC. This program defines both (as src/i2c_sim.cpp does), so the
+ * monotonic clock only moves when the bus sleeps or the test sets it: a sleep jumps
+ * straight to its wake-up time, running a scheduled action on the way. Every grant
+ * time and queueing delay is then exact, and a periodic IMU and a bulk GPS device are
+ * walked through each case of Acquire() and deferUntil() from one thread:
+ *
+ * - a transfer that ends before the reserved slot goes at once
+ * - one that would run into it is held back until the slot is used, or until
+ *   I2C_BUS_SLOT_SLACK_NANOS after it when it is not
+ * - one too long to fit between two slots, one of equal priority, and any once the
+ *   period is cleared are never held back
+ *
+ * The adapter is /dev/null: no transfer is made, and attaching reports that it is not
+ * an I2C adapter. No hardware needed.
+ */
+
+#include "i2c_bus.h"
+#include "epoch_scheduler.h"
+#include "../test_check.h"
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define TEST_BUS "/dev/null"
+#define START_NANOS NANOS_PER_SECOND
+#define IMU_PERIOD_MICROS 10000
+#define GPS_DRAIN_BYTES 100          // About 2.3 ms at 400 kHz
+#define GPS_LONG_BYTES 1000          // Longer than an IMU period
+
+static uint64_t clockNanos = START_NANOS;
+static uint64_t actionNanos = 0;     // When action runs; 0 if none is scheduled
+static void (*action)(void) = nullptr;
+
+static struct timespec toTimespec(uint64_t nanos) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(nanos / NANOS_PER_SECOND);
+    ts.tv_nsec = static_cast<long>(nanos % NANOS_PER_SECOND);
+    return ts;
+}
+
+int clock_gettime(clockid_t clock, struct timespec *ts) __THROW {
+    if (clock != CLOCK_MONOTONIC) {
+        return static_cast<int>(syscall(SYS_clock_gettime, clock, ts));
+    }
+    *ts = toTimespec(clockNanos);
+    return 0;
+}
+
+int clock_nanosleep(clockid_t clock, int flags, const struct timespec *request, struct timespec *remaining) {
+    (void)clock;
+    (void)remaining;
+    uint64_t wake = static_cast<uint64_t>(request->tv_sec) * NANOS_PER_SECOND + static_cast<uint64_t>(request->tv_nsec);
+    if (!(flags & TIMER_ABSTIME)) {
+        wake += clockNanos;
+    }
+    if (action != nullptr && actionNanos <= wake) {
+        clockNanos = actionNanos > clockNanos ? actionNanos : clockNanos;
+        void (*due)(void) = action;
+        action = nullptr;
+        due();
+        return 0;
+    }
+    clockNanos = wake > clockNanos ? wake : clockNanos;
+    return 0;
+}
+
+static I2cBus *bus;
+static int imu;
+static int gps;
+static int mag;
+
+// One IMU sample: the bus is granted and given back at once
+static void sampleImu(void) {
+    bus->Acquire(imu, 0);
+    bus->Release(imu);
+}
+
+/**
+ * @brief   Acquire and release the bus for a device at a time relative to START_NANOS.
+ *
+ * @return  The time from the request to the grant.
+ */
+static uint64_t transferAt(int device, uint64_t atMicros, uint32_t bytes) {
+    clockNanos = START_NANOS + atMicros * 1000;
+    uint64_t submitted = clockNanos;
+    bus->Acquire(device, bytes);
+    uint64_t granted = clockNanos;
+    bus->Release(device);
+    return granted - submitted;
+}
+
+int main(void) {
+    bus = &I2cBus::Shared(TEST_BUS);
+    const I2cDeviceConfig imuConfig = {"imu", 0x69, I2C_PRIORITY_HIGH, IMU_PERIOD_MICROS, 0};
+    const I2cDeviceConfig gpsConfig = {"gps", 0x42, I2C_PRIORITY_BULK, 0, 0};
+    const I2cDeviceConfig magConfig = {"mag", 0x0C, I2C_PRIORITY_HIGH, 0, 0};
+    imu = bus->Attach(imuConfig);
+    gps = bus->Attach(gpsConfig);
+    mag = bus->Attach(magConfig);
+    check(imu >= 0 && gps >= 0 && mag >= 0, "devices are attached");
+    bus->ResetStats();
+
+    // The IMU samples at 0 and reserves 10 ms
+    transferAt(imu, 0, 0);
+    uint64_t queued = transferAt(gps, 1000, GPS_DRAIN_BYTES);
+    check(queued == 0 && bus->GetStats(gps).deferrals == 0, "a drain that ends before the slot goes at once");
+
+    queued = transferAt(gps, 8000, GPS_DRAIN_BYTES);
+    check(bus->GetStats(gps).deferrals == 1, "a drain that would run into the slot is held back");
+    check(queued == 2 * 1000000ULL + I2C_BUS_SLOT_SLACK_NANOS, "an unused slot is released I2C_BUS_SLOT_SLACK_NANOS after it");
+
+    // The IMU samples at 20 ms and 30 ms; the drain submitted at 28 ms waits for the second
+    transferAt(imu, 20000, 0);
+    actionNanos = START_NANOS + 30 * 1000000ULL;
+    action = sampleImu;
+    queued = transferAt(gps, 28000, GPS_DRAIN_BYTES);
+    I2cDeviceStats imuStats = bus->GetStats(imu);
+    check(bus->GetStats(gps).deferrals == 2 && queued == 2 * 1000000ULL, "a held back drain goes as soon as the slot is used");
+    check(imuStats.transfers == 3 && imuStats.maxQueueNanos == 0 && imuStats.deferrals == 0, "the IMU never waits");
+
+    // Slot at 40 ms
+    queued = transferAt(gps, 39000, GPS_LONG_BYTES);
+    check(queued == 0 && bus->GetStats(gps).deferrals == 2, "a transfer too long to fit between slots is not held back");
+    queued = transferAt(mag, 39500, GPS_DRAIN_BYTES);
+    check(queued == 0 && bus->GetStats(mag).deferrals == 0, "a device of the same priority is not held back");
+
+    bus->SetPeriod(imu, 0);
+    transferAt(imu, 40000, 0);
+    queued = transferAt(gps, 49000, GPS_DRAIN_BYTES);
+    check(queued == 0 && bus->GetStats(gps).deferrals == 2, "without a period nothing is reserved");
+    bus->SetPeriod(imu, IMU_PERIOD_MICROS);
+    queued = transferAt(gps, 49500, GPS_DRAIN_BYTES);
+    check(queued == 0, "a new period reserves from the next sample");
+    transferAt(imu, 50000, 0);
+    queued = transferAt(gps, 58000, GPS_DRAIN_BYTES);
+    check(queued == 2 * 1000000ULL + I2C_BUS_SLOT_SLACK_NANOS && bus->GetStats(gps).deferrals == 3,
+        "and then holds back again");
+
+    I2cDeviceStats gpsStats = bus->GetStats(gps);
+    check(gpsStats.transfers == 7 && gpsStats.maxQueueNanos == queued && gpsStats.queueNanos == 3 * queued - 1000000ULL,
+        "queueing delays are accounted");
+
+    bus->Detach(mag);
+    bus->Detach(gps);
+    bus->Detach(imu);
+    return checkSummary();
+}
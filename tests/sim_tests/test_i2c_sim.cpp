@@ -0,0 +1,118 @@
+/*
+ * test_i2c_sim.cpp - Gps and Imu against the simulated I2C bus
+ *
+ * Linked with src/i2c_sim.cpp instead of -li2c, so the unmodified drivers open
+ * /dev/i2c-1 and talk to the simulated SAM-M8Q and ICM-20948. The clock runs
+ * TIME_SCALE times faster than real time, so the cold start takes about half a
+ * second. No hardware needed.
+ */
+
+#include "gps.h"
+#include "i2c_sim.h"
+#include "imu.h"
+#include "../test_check.h"
+#include <math.h>
+#include <stdio.h>
+
+#define TIME_SCALE 50.0
+#define SIM_YEAR 2024
+#define FIX_WAIT_SECONDS 40
+#define RATE_WINDOW_SECONDS 3
+#define EXPECTED_RATE_HZ 10           // DEFAULT_NAVIGATION_CONFIG: 100 ms
+#define IMU_READ_TRANSACTIONS 1       // One burst; bank 0 is already selected
+#define IMU_BYTE_READ_TRANSACTIONS 20 // One per register, temperature included
+
+static double virtualSeconds(void) {
+    return I2cSim::NowNanos() / 1e9;
+}
+
+/**
+ * @brief   Count new fixes read within a virtual time window.
+ */
+static int countFixes(Gps &gps, double seconds, PVTData *last) {
+    int fixes = 0;
+    double end = virtualSeconds() + seconds;
+    while (virtualSeconds() < end) {
+        PVTData data = gps.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+        if (data.newFix && data.year == SIM_YEAR && data.gnssFix == 3) {
+            fixes++;
+            *last = data;
+        }
+    }
+    return fixes;
+}
+
+int main(void) {
+    I2cSimConfig config = I2C_SIM_DEFAULT_CONFIG;
+    config.timeScale = TIME_SCALE;
+    I2cSim::Configure(config);
+
+    double start = virtualSeconds();
+    Gps gps(SIM_YEAR);
+    SimSamM8qStats receiver = I2cSim::GetGpsStats();
+    check(receiver.acks >= 3 && receiver.naks == 0, "driver configuration is acknowledged");
+
+    PVTData data = {};
+    double ttff = -1.0;
+    while (virtualSeconds() - start < FIX_WAIT_SECONDS) {
+        data = gps.GetPvt(false, DEFAULT_TIMEOUT_MILLS);
+        if (data.year == SIM_YEAR && data.gnssFix == 3) {
+            ttff = virtualSeconds() - start;
+            break;
+        }
+    }
+    printf("Time to first fix: %.2f s (virtual)\n", ttff);
+    check(ttff >= SIM_GPS_TTFF_COLD_SECONDS && ttff < SIM_GPS_TTFF_COLD_SECONDS + 2, "first fix after the cold-start TTFF");
+
+    int fixes = countFixes(gps, RATE_WINDOW_SECONDS, &data);
+    printf("Fixes in %d s: %d\n", RATE_WINDOW_SECONDS, fixes);
+    check(abs(fixes - EXPECTED_RATE_HZ * RATE_WINDOW_SECONDS) <= 2, "fixes arrive at the navigation rate");
+    SimSamM8qConfig model = SIM_SAM_M8Q_DEFAULT_CONFIG;
+    check(fabs(data.latitude - model.latitude) < 0.001 && fabs(data.longitude - model.longitude) < 0.001,
+        "position is on the simulated drive");
+
+    Imu imu;
+    I2cSimStats before = I2cSim::GetStats();
+    imu.ReadSensorData();
+    I2cSimStats after = I2cSim::GetStats();
+    check(after.imu.transactions - before.imu.transactions == IMU_READ_TRANSACTIONS, "IMU sample is one burst read");
+
+    SimIcm20948Config motion = SIM_ICM20948_DEFAULT_CONFIG;
+    const int16_t *accel = imu.GetRawAccelerometerData();
+    const int16_t *gyro = imu.GetRawGyroscopeData();
+    const int16_t *mag = imu.GetRawMagnetometerData();
+    check(fabs(accel[Z_AXIS] * ACCEL_MG_LSB_2G - 1.0) < 0.05, "accelerometer reads 1 g on Z");
+    check(fabs(gyro[Z_AXIS] * GYRO_SENSITIVITY_250DPS * DEG_TO_RAD - motion.yawRate) < 0.02, "gyroscope reads the yaw rate");
+    double field = 0.0;
+    double expected = 0.0;
+    for (int axis = 0; axis < 3; axis++) {
+        double corrected = mag[axis] * MAG_UT_LSB - motion.magHardIron[axis];
+        field += corrected * corrected;
+        expected += motion.magField[axis] * motion.magField[axis];
+    }
+    check(fabs(sqrt(field) - sqrt(expected)) < 2.0, "magnetometer reads the field through SLV0");
+
+    int16_t burstMag[3] = {mag[X_AXIS], mag[Y_AXIS], mag[Z_AXIS]};
+    imu.SetReadMode(IMU_READ_MODE_BYTE);
+    before = I2cSim::GetStats();
+    bool byteRead = imu.ReadSensorData();
+    after = I2cSim::GetStats();
+    check(byteRead && after.imu.transactions - before.imu.transactions == IMU_BYTE_READ_TRANSACTIONS,
+        "byte-wise IMU read costs one transaction per register");
+    check(abs(mag[X_AXIS] - burstMag[X_AXIS]) * MAG_UT_LSB < 3.0 && fabs(accel[Z_AXIS] * ACCEL_MG_LSB_2G - 1.0) < 0.05,
+        "byte-wise and burst reads agree");
+    imu.SetReadMode(IMU_READ_MODE_BLOCK);
+
+    config.nackRate = 0.05;
+    config.corruptRate = 0.003;
+    I2cSim::Configure(config);
+    I2cSim::ResetStats();
+    fixes = countFixes(gps, RATE_WINDOW_SECONDS, &data);
+    I2cSimStats injected = I2cSim::GetStats();
+    printf("With errors: %d fixes, %u NACKs, %u corrupted bytes\n", fixes, injected.gps.nacks, injected.gps.corruptedBytes);
+    check(injected.gps.nacks > 0 && injected.gps.corruptedBytes > 0, "errors are injected");
+    check(fixes >= EXPECTED_RATE_HZ * RATE_WINDOW_SECONDS / 2, "driver keeps reading fixes through bus errors");
+    check(injected.gps.busyNanos > 0 && injected.other.transactions == 0, "bus time is charged to the receiver");
+
+    return checkSummary();
+}
@@ -0,0 +1,33 @@
+/*
+ * test_check.h - Pass/fail bookkeeping shared by the test programs
+ *
+ * Each test program is one translation unit: check() prints a line per check and
+ * counts the failures, and checkSummary() prints the verdict and returns the exit
+ * status for main(), so a failed check fails `make test`.
+ */
+
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <stdio.h>
+
+static int failures = 0;
+
+static inline void check(bool condition, const char *description) {
+    printf("%s: %s\n", condition ? "PASS" : "FAIL", description);
+    if (!condition) {
+        failures++;
+    }
+}
+
+/**
+ * @brief   Print the verdict of the checks so far.
+ *
+ * @return  The exit status: 0 if every check passed, 1 otherwise.
+ */
+static inline int checkSummary(void) {
+    printf("%s\n", failures == 0 ? "All checks passed." : "Some checks failed.");
+    return failures == 0 ? 0 : 1;
+}
+
+#endif // TEST_CHECK_H